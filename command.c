@@ -125,7 +125,6 @@ static struct sockaddr_storage lastcmd_net_source;
 static socklen_t lastcmd_net_source_len;
 #endif
 
-#ifdef HAVE_CHEEVOS
 #if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETWORKING)
 static bool command_reply(const char * data, size_t len)
 {
@@ -147,7 +146,6 @@ static bool command_reply(const char * data, size_t len)
    return false;
 }
 #endif
-#endif
 
 struct cmd_map
 {
@@ -257,8 +255,61 @@ static bool command_write_ram(const char *arg)
 }
 #endif
 
+#if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETWORKING)
+static bool command_perf_trace(const char *arg)
+{
+   char reply[4096];
+   char trace_path[PATH_MAX_LENGTH];
+   settings_t *settings = config_get_ptr();
+
+   if (string_is_equal(arg, "START"))
+      return rarch_perf_trace_start();
+
+   if (string_is_equal(arg, "STOP"))
+   {
+      rarch_perf_trace_stop();
+      return true;
+   }
+
+   if (string_is_equal(arg, "STATS"))
+   {
+      strlcpy(reply, "PERF_TRACE STATS\n", sizeof(reply));
+      rarch_perf_trace_stats(reply + strlen(reply),
+            sizeof(reply) - strlen(reply));
+      command_reply(reply, strlen(reply));
+      return true;
+   }
+
+   /* Anyone who can reach the command port can send this, so only
+    * a bare .json name is taken, and written to the cache directory. */
+   if (     string_is_empty(arg)
+         || strchr(arg, '/')
+         || strchr(arg, '\\')
+         || strchr(arg, ':')
+         || !string_is_equal_noncase(path_get_extension(arg), "json"))
+   {
+      RARCH_ERR("[PERF]: Trace name must be a bare .json file name.\n");
+      return false;
+   }
+
+   if (string_is_empty(settings->directory.cache))
+   {
+      RARCH_ERR("[PERF]: Set a cache directory to write traces.\n");
+      return false;
+   }
+
+   fill_pathname_join(trace_path, settings->directory.cache, arg,
+         sizeof(trace_path));
+
+   return rarch_perf_trace_write(trace_path);
+}
+#endif
+
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER", command_set_shader, "<shader path>" },
+#if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETWORKING)
+   { "PERF_TRACE", command_perf_trace, "<START|STOP|STATS|trace name.json>" },
+#endif
 #ifdef HAVE_CHEEVOS
    { "READ_CORE_RAM", command_read_ram, "<address> <number of bytes>" },
    { "WRITE_CORE_RAM", command_write_ram, "<address> <byte1> <byte2> ..." },
@@ -298,6 +349,7 @@ static const struct cmd_map map[] = {
    { "DISK_PREV",              RARCH_DISK_PREV },
    { "GRAB_MOUSE_TOGGLE",      RARCH_GRAB_MOUSE_TOGGLE },
    { "GAME_FOCUS_TOGGLE",      RARCH_GAME_FOCUS_TOGGLE },
+   { "RECORD_REPLAY_SAVE",     RARCH_RECORD_REPLAY_SAVE },
    { "MENU_TOGGLE",            RARCH_MENU_TOGGLE },
    { "MENU_UP",                RETRO_DEVICE_ID_JOYPAD_UP },
    { "MENU_DOWN",              RETRO_DEVICE_ID_JOYPAD_DOWN },
@@ -2162,6 +2214,18 @@ bool command_event(enum event_command cmd, void *data)
          if (!recording_init())
             return false;
          break;
+      case CMD_EVENT_RECORD_REPLAY_SAVE:
+         if (!recording_save_replay())
+         {
+            runloop_msg_queue_push(
+                  msg_hash_to_str(MSG_RECORD_REPLAY_FAILED),
+                  1, 180, true);
+            return false;
+         }
+         runloop_msg_queue_push(
+               msg_hash_to_str(MSG_RECORD_REPLAY_SAVED),
+               1, 180, true);
+         break;
       case CMD_EVENT_HISTORY_DEINIT:
          if (g_defaults.content_history)
          {
@@ -2207,7 +2271,8 @@ bool command_event(enum event_command cmd, void *data)
                   settings->path.content_history);
             g_defaults.content_history = playlist_init(
                   settings->path.content_history,
-                  settings->content_history_size);
+                  settings->content_history_size,
+                  settings->playlist_binary_format);
 
 #ifdef HAVE_FFMPEG
             RARCH_LOG("%s: [%s].\n",
@@ -2215,14 +2280,16 @@ bool command_event(enum event_command cmd, void *data)
                   settings->path.content_music_history);
             g_defaults.music_history = playlist_init(
                   settings->path.content_music_history,
-                  settings->content_history_size);
+                  settings->content_history_size,
+                  settings->playlist_binary_format);
 
             RARCH_LOG("%s: [%s].\n",
                   msg_hash_to_str(MSG_LOADING_HISTORY_FILE),
                   settings->path.content_video_history);
             g_defaults.video_history = playlist_init(
                   settings->path.content_video_history,
-                  settings->content_history_size);
+                  settings->content_history_size,
+                  settings->playlist_binary_format);
 #endif
 
 #ifdef HAVE_IMAGEVIEWER
@@ -2231,7 +2298,8 @@ bool command_event(enum event_command cmd, void *data)
                   settings->path.content_image_history);
             g_defaults.image_history = playlist_init(
                   settings->path.content_image_history,
-                  settings->content_history_size);
+                  settings->content_history_size,
+                  settings->playlist_binary_format);
 #endif
          }
          break;
@@ -101,6 +101,8 @@ enum event_command
    CMD_EVENT_RECORD_INIT,
    /* Deinitializes recording system. */
    CMD_EVENT_RECORD_DEINIT,
+   /* Saves the instant replay ring of the recording system. */
+   CMD_EVENT_RECORD_REPLAY_SAVE,
    /* Deinitializes history playlist. */
    CMD_EVENT_HISTORY_DEINIT,
    /* Initializes history playlist. */
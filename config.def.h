@@ -435,6 +435,9 @@ static bool bundle_assets_extract_enable = false;
 static const bool def_history_list_enable = true;
 static const bool def_playlist_entry_remove = true;
 
+/* Save playlists in the indexed binary format instead of text. */
+static const bool def_playlist_binary_format = false;
+
 static const unsigned int def_user_language = 0;
 
 #if (defined(_WIN32) && !defined(_XBOX)) || (defined(__linux) && !defined(ANDROID) && !defined(HAVE_LAKKA)) || (defined(__MACH__) && !defined(IOS))
@@ -515,6 +518,12 @@ static const unsigned hard_sync_frames = 0;
  */
 static const unsigned frame_delay = 0;
 
+/* Picks the frame delay automatically, running the core as late
+ * before VSync as its recent frame times allow.
+ * Overrides frame_delay when enabled.
+ */
+static const bool frame_delay_auto = false;
+
 /* Inserts a black frame inbetween frames.
  * Useful for 120 Hz monitors who want to play 60 Hz material with eliminated
  * ghosting. video_refresh_rate should still be configured as if it
@@ -879,6 +888,10 @@ static const uint16_t network_remote_base_port = 55400;
 /* Number of entries that will be kept in content history playlist file. */
 static const unsigned default_content_history_size = 100;
 
+/* Size budget in megabytes of the cache of extracted archived
+ * content (under the cache directory), 0 disables it. */
+static const unsigned default_extraction_cache_size = 2048;
+
 /* Show Menu start-up screen on boot. */
 static const bool default_menu_show_start_screen = true;
 
@@ -84,6 +84,7 @@ static const struct retro_keybind retro_keybinds_1[] = {
    { true, RARCH_DISK_PREV,                MENU_ENUM_LABEL_VALUE_INPUT_META_DISK_PREV,            RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_GRAB_MOUSE_TOGGLE,        MENU_ENUM_LABEL_VALUE_INPUT_META_GRAB_MOUSE_TOGGLE,    RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_GAME_FOCUS_TOGGLE,        MENU_ENUM_LABEL_VALUE_INPUT_META_GAME_FOCUS_TOGGLE,    RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_RECORD_REPLAY_SAVE,       MENU_ENUM_LABEL_VALUE_INPUT_META_RECORD_REPLAY_SAVE,   RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_MENU_TOGGLE,              MENU_ENUM_LABEL_VALUE_INPUT_META_MENU_TOGGLE,          RETROK_SPACE,   NO_BTN, 0, AXIS_NONE },
 #else
    { true, RETRO_DEVICE_ID_JOYPAD_B,      MENU_ENUM_LABEL_VALUE_INPUT_JOYPAD_B,              RETROK_z,       NO_BTN, 0, AXIS_NONE },
@@ -146,6 +147,7 @@ static const struct retro_keybind retro_keybinds_1[] = {
    { true, RARCH_DISK_PREV,                MENU_ENUM_LABEL_VALUE_INPUT_META_DISK_PREV,            RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_GRAB_MOUSE_TOGGLE,        MENU_ENUM_LABEL_VALUE_INPUT_META_GRAB_MOUSE_TOGGLE,    RETROK_F11,     NO_BTN, 0, AXIS_NONE },
    { true, RARCH_GAME_FOCUS_TOGGLE,        MENU_ENUM_LABEL_VALUE_INPUT_META_GAME_FOCUS_TOGGLE,    RETROK_SCROLLOCK,  NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_RECORD_REPLAY_SAVE,       MENU_ENUM_LABEL_VALUE_INPUT_META_RECORD_REPLAY_SAVE,   RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_MENU_TOGGLE,              MENU_ENUM_LABEL_VALUE_INPUT_META_MENU_TOGGLE,          RETROK_F1,      NO_BTN, 0, AXIS_NONE },
 #endif
 };
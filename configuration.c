@@ -25,6 +25,7 @@
 #include <retro_stat.h>
 #include <retro_assert.h>
 #include <string/stdstring.h>
+#include <rhash.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -767,6 +768,7 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("video_vsync",                   &settings->video.vsync, true, vsync, false);
    SETTING_BOOL("video_hard_sync",               &settings->video.hard_sync, true, hard_sync, false);
    SETTING_BOOL("video_black_frame_insertion",   &settings->video.black_frame_insertion, true, black_frame_insertion, false);
+   SETTING_BOOL("video_frame_delay_auto",        &settings->video.frame_delay_auto, true, frame_delay_auto, false);
    SETTING_BOOL("video_disable_composition",     &settings->video.disable_composition, true, disable_composition, false);
    SETTING_BOOL("pause_nonactive",               &settings->pause_nonactive, true, pause_nonactive, false);
    SETTING_BOOL("video_gpu_screenshot",          &settings->video.gpu_screenshot, true, gpu_screenshot, false);
@@ -855,6 +857,7 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("savestate_thumbnail_enable",   &settings->savestate_thumbnail_enable, true, savestate_thumbnail_enable, false);
    SETTING_BOOL("history_list_enable",          &settings->history_list_enable, true, def_history_list_enable, false);
    SETTING_BOOL("playlist_entry_remove",        &settings->playlist_entry_remove, true, def_playlist_entry_remove, false);
+   SETTING_BOOL("playlist_binary_format",       &settings->playlist_binary_format, true, def_playlist_binary_format, false);
    SETTING_BOOL("game_specific_options",        &settings->game_specific_options, true, default_game_specific_options, false);
    SETTING_BOOL("auto_overrides_enable",        &settings->auto_overrides_enable, true, default_auto_overrides_enable, false);
    SETTING_BOOL("auto_remaps_enable",           &settings->auto_remaps_enable, true, default_auto_remaps_enable, false);
@@ -962,6 +965,7 @@ static struct config_int_setting *populate_settings_int(settings_t *settings, in
    SETTING_INT("custom_viewport_x",            (unsigned*)&settings->video_viewport_custom.x, false, 0 /* TODO */, false);
    SETTING_INT("custom_viewport_y",            (unsigned*)&settings->video_viewport_custom.y, false, 0 /* TODO */, false);
    SETTING_INT("content_history_size",         &settings->content_history_size,   true, default_content_history_size, false);
+   SETTING_INT("extraction_cache_size",        &settings->extraction_cache_size,  true, default_extraction_cache_size, false);
    SETTING_INT("video_hard_sync_frames",       &settings->video.hard_sync_frames, true, hard_sync_frames, false);
    SETTING_INT("video_frame_delay",            &settings->video.frame_delay,      true, frame_delay, false);
    SETTING_INT("video_max_swapchain_images",   &settings->video.max_swapchain_images, true, max_swapchain_images, false);
@@ -1746,6 +1750,36 @@ static void config_get_hex_base(config_file_t *conf,
 #endif
 
 
+/**
+ * config_file_new_snapshot:
+ * @path                : path to be read from.
+ *
+ * Loads a config file through a binary snapshot kept in the
+ * default cache directory, which skips parsing as long as the
+ * file and its includes are unchanged.
+ *
+ * Returns: the config file, or NULL if it couldn't be read.
+ **/
+static config_file_t *config_file_new_snapshot(const char *path)
+{
+   char snapshot_name[32];
+   char snapshot_path[PATH_MAX_LENGTH];
+
+   if (     string_is_empty(path)
+         || string_is_empty(g_defaults.dir.cache)
+         || !path_is_directory(g_defaults.dir.cache))
+      return config_file_new(path);
+
+   snapshot_path[0] = '\0';
+
+   snprintf(snapshot_name, sizeof(snapshot_name), "%08x.cfgsnap",
+         (unsigned)djb2_calculate(path));
+   fill_pathname_join(snapshot_path, g_defaults.dir.cache,
+         snapshot_name, sizeof(snapshot_path));
+
+   return config_file_new_cached(path, snapshot_path);
+}
+
 /**
  * config_load:
  * @path                : path to be read from.
@@ -1784,7 +1818,7 @@ static bool config_load_file(const char *path, bool set_defaults,
 
    if (path)
    {
-      conf = config_file_new(path);
+      conf = config_file_new_snapshot(path);
       if (!conf)
          goto end;
    }
@@ -2861,7 +2895,9 @@ static bool config_save_keybinds_file(const char *path)
    for (i = 0; i < MAX_USERS; i++)
       save_keybinds_user(conf, i);
 
-   ret = config_file_write(conf, path);
+   /* Only the settings that changed, the rest of the file
+    * stays as the user left it. */
+   ret = config_file_write_changes(conf, path);
    config_file_free(conf);
    return ret;
 }
@@ -3120,7 +3156,9 @@ bool config_save_file(const char *path)
    for (i = 0; i < MAX_USERS; i++)
       save_keybinds_user(conf, i);
 
-   ret = config_file_write(conf, path);
+   /* Only the settings that changed, the rest of the file
+    * stays as the user left it. */
+   ret = config_file_write_changes(conf, path);
    config_file_free(conf);
 
    return ret;
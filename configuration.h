@@ -68,6 +68,7 @@ typedef struct settings
       unsigned swap_interval;
       unsigned hard_sync_frames;
       unsigned frame_delay;
+      bool frame_delay_auto;
 #ifdef GEKKO
       unsigned viwidth;
       bool vfilter;
@@ -423,6 +424,7 @@ typedef struct settings
 #endif
 
    unsigned content_history_size;
+   unsigned extraction_cache_size;
 
    unsigned libretro_log_level;
 
@@ -430,6 +432,7 @@ typedef struct settings
 
    bool history_list_enable;
    bool playlist_entry_remove;
+   bool playlist_binary_format;
    bool rewind_enable;
    size_t rewind_buffer_size;
    unsigned rewind_granularity;
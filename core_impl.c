@@ -23,6 +23,7 @@
 #include <errno.h>
 
 #include <boolean.h>
+#include <features/features_cpu.h>
 #include <lists/string_list.h>
 #include <string/stdstring.h>
 #include <libretro.h>
@@ -42,6 +43,7 @@
 #include "managers/state_manager.h"
 #include "verbosity.h"
 #include "gfx/video_driver.h"
+#include "gfx/video_pacing.h"
 #include "audio/audio_driver.h"
 
 static unsigned            core_poll_type                 = POLL_TYPE_EARLY;
@@ -68,6 +70,9 @@ static int16_t core_input_state_poll(unsigned port,
    {
       if (!core_input_polled)
          input_poll();
+      else
+         /* Events which arrived since, during retro_run. */
+         input_driver_refresh(port);
 
       core_input_polled = true;
    }
@@ -433,6 +438,9 @@ bool core_run(void)
          break;
    }
 
+   video_pacing_mark(VIDEO_PACING_MARK_CORE_RUN,
+         cpu_features_get_time_usec());
+
    if (core.retro_run)
       core.retro_run();
    if (core_poll_type == POLL_TYPE_LATE && !core_input_polled)
@@ -15,7 +15,14 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
 #include <compat/strl.h>
+#include <compat/strcasestr.h>
+#include <compat/posix_string.h>
 #include <string/stdstring.h>
 #include <file/file_path.h>
 #include <lists/dir_list.h>
@@ -27,6 +34,11 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "performance_counters.h"
 #include "runloop.h"
 #include "verbosity.h"
 
@@ -36,11 +48,25 @@
 #include "file_path_special.h"
 #include "list_special.h"
 
-static const char *core_info_tmp_path               = NULL;
-static const struct string_list *core_info_tmp_list = NULL;
+#define CORE_INFO_CACHE_FILE  "core_info.cache"
+#define CORE_INFO_CACHE_MAGIC "RCORINF1"
+
 static core_info_t *core_info_current               = NULL;
 static core_info_list_t *core_info_curr_list        = NULL;
 
+/* The list is built in the background or on first use,
+ * whatever comes first. */
+static bool core_info_curr_list_pending             = false;
+/* Copied from the settings, which the thread must not read. */
+static char core_info_curr_list_dir[PATH_MAX_LENGTH];
+static char core_info_curr_list_info_dir[PATH_MAX_LENGTH];
+static char core_info_curr_list_cache_dir[PATH_MAX_LENGTH];
+#ifdef HAVE_THREADS
+static slock_t *core_info_curr_list_lock            = NULL;
+static scond_t *core_info_curr_list_cond            = NULL;
+static sthread_t *core_info_curr_list_thread        = NULL;
+#endif
+
 static void core_info_list_resolve_all_extensions(
       core_info_list_t *core_info_list)
 {
@@ -85,63 +111,6 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
-{
-   size_t i;
-   unsigned c;
-
-   for (i = 0; i < core_info_list->count; i++)
-   {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
-
-      if (!config || !config_get_uint(config, "firmware_count", &count))
-         continue;
-
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
-
-      if (!firmware)
-         continue;
-
-      info->firmware = firmware;
-
-      for (c = 0; c < count; c++)
-      {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         bool tmp_bool     = false;
-         char *tmp         = NULL;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
-
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
-
-         if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].path = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].desc = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (tmp)
-            free(tmp);
-         tmp = NULL;
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
-      }
-   }
-}
-
 static void core_info_list_free(core_info_list_t *core_info_list)
 {
    size_t i, j;
@@ -172,7 +141,6 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       string_list_free(info->licenses_list);
       string_list_free(info->categories_list);
       string_list_free(info->databases_list);
-      config_file_free((config_file_t*)info->config_data);
 
       for (j = 0; j < info->firmware_count; j++)
       {
@@ -183,19 +151,22 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    }
 
    free(core_info_list->all_ext);
+   free(core_info_list->ext_index);
+   free(core_info_list->db_index);
+   free(core_info_list->supported);
+   free(core_info_list->cache_strings);
    free(core_info_list->list);
    free(core_info_list);
 }
 
 static bool core_info_list_iterate(
-      char *s, size_t len,
+      char *s, size_t len, const char *info_dir,
       struct string_list *contents, size_t i)
 {
    char info_path_base[PATH_MAX_LENGTH];
 #if defined(RARCH_MOBILE) || (defined(RARCH_CONSOLE) && !defined(PSP) && !defined(_3DS) && !defined(VITA))
    char                       *substr   = NULL;
 #endif
-   settings_t                 *settings = config_get_ptr();
 
    if (!contents || !contents->elems[i].data)
       return false;
@@ -215,15 +186,64 @@ static bool core_info_list_iterate(
          file_path_str(FILE_PATH_CORE_INFO_EXTENSION),
          sizeof(info_path_base));
 
-   fill_pathname_join(s,
-         (!string_is_empty(settings->path.libretro_info)) ?
-         settings->path.libretro_info : settings->directory.libretro,
-         info_path_base, len);
+   fill_pathname_join(s, info_dir, info_path_base, len);
 
    return true;
 }
 
-static core_info_list_t *core_info_list_new(const char *path)
+static void core_info_read_firmware(core_info_t *info,
+      config_file_t *config)
+{
+   unsigned c;
+   unsigned count                  = 0;
+   core_info_firmware_t *firmware  = NULL;
+
+   if (!config_get_uint(config, "firmware_count", &count) || !count)
+      return;
+
+   firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+
+   if (!firmware)
+      return;
+
+   info->firmware       = firmware;
+   info->firmware_count = count;
+
+   for (c = 0; c < count; c++)
+   {
+      char path_key[64];
+      char desc_key[64];
+      char opt_key[64];
+      bool tmp_bool     = false;
+      char *tmp         = NULL;
+      path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
+
+      if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[c].path = strdup(tmp);
+         free(tmp);
+         tmp = NULL;
+      }
+      if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[c].desc = strdup(tmp);
+         free(tmp);
+         tmp = NULL;
+      }
+      if (tmp)
+         free(tmp);
+      tmp = NULL;
+      if (config_get_bool(config, opt_key , &tmp_bool))
+         info->firmware[c].optional = tmp_bool;
+   }
+}
+
+static core_info_list_t *core_info_list_parse(const char *path,
+      const char *info_dir)
 {
    size_t i;
    core_info_t *core_info           = NULL;
@@ -253,12 +273,11 @@ static core_info_list_t *core_info_list_new(const char *path)
 
       if ( 
             core_info_list_iterate(info_path, sizeof(info_path),
-            contents, i) 
+            info_dir, contents, i) 
             && path_is_valid(info_path))
       {
          char *tmp           = NULL;
          bool tmp_bool       = false;
-         unsigned count      = 0;
          config_file_t *conf = config_file_new(info_path);
 
          if (!conf)
@@ -291,9 +310,7 @@ static core_info_list_t *core_info_list_new(const char *path)
             tmp = NULL;
          }
 
-         config_get_uint(conf, "firmware_count", &count);
-
-         core_info[i].firmware_count = count;
+         core_info_read_firmware(&core_info[i], conf);
 
          if (config_get_string(conf, "supported_extensions", &tmp) && !string_is_empty(tmp))
          {
@@ -372,7 +389,8 @@ static core_info_list_t *core_info_list_new(const char *path)
                &tmp_bool))
             core_info[i].supports_no_game = tmp_bool;
 
-         core_info[i].config_data = conf;
+         core_info[i].has_info = true;
+         config_file_free(conf);
       }
 
       if (!string_is_empty(contents->elems[i].data))
@@ -383,11 +401,6 @@ static core_info_list_t *core_info_list_new(const char *path)
             strdup(path_basename(core_info[i].path));
    }
 
-   core_info_list_resolve_all_extensions(core_info_list);
-
-   if (core_info_list)
-      core_info_list_resolve_all_firmware(core_info_list);
-
    dir_list_free(contents);
    return core_info_list;
 
@@ -398,6 +411,618 @@ error:
    return NULL;
 }
 
+static int core_info_index_cmp(const void *a_, const void *b_)
+{
+   const core_info_index_t *a = (const core_info_index_t*)a_;
+   const core_info_index_t *b = (const core_info_index_t*)b_;
+   int ret                    = strcasecmp(a->key, b->key);
+
+   if (ret)
+      return ret;
+   return (a->core > b->core) - (a->core < b->core);
+}
+
+static core_info_index_t *core_info_index_new(core_info_list_t *list,
+      size_t offset, size_t *count)
+{
+   size_t i, j;
+   size_t n                 = 0;
+   core_info_index_t *index = NULL;
+
+   for (i = 0; i < list->count; i++)
+   {
+      const struct string_list *elems = *(struct string_list**)
+         ((uint8_t*)&list->list[i] + offset);
+      if (elems)
+         n += elems->size;
+   }
+
+   *count = 0;
+
+   if (!n)
+      return NULL;
+
+   index = (core_info_index_t*)calloc(n, sizeof(*index));
+
+   if (!index)
+      return NULL;
+
+   for (i = 0; i < list->count; i++)
+   {
+      const struct string_list *elems = *(struct string_list**)
+         ((uint8_t*)&list->list[i] + offset);
+
+      for (j = 0; elems && j < elems->size; j++)
+      {
+         const char *key = elems->elems[j].data;
+
+         /* Extensions are listed with or without a dot. */
+         if (*key == '.')
+            key++;
+
+         if (!*key)
+            continue;
+
+         index[*count].key  = key;
+         index[*count].core = i;
+         (*count)++;
+      }
+   }
+
+   qsort(index, *count, sizeof(*index), core_info_index_cmp);
+
+   return index;
+}
+
+/* Returns the first entry of @key, *num is the number of entries. */
+static const core_info_index_t *core_info_index_find(
+      const core_info_index_t *index, size_t count,
+      const char *key, size_t *num)
+{
+   size_t lo = 0;
+   size_t hi = count;
+   size_t end;
+
+   *num = 0;
+
+   if (!index || string_is_empty(key))
+      return NULL;
+
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (strcasecmp(index[mid].key, key) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   for (end = lo; end < count && !strcasecmp(index[end].key, key); end++);
+
+   *num = end - lo;
+
+   return *num ? &index[lo] : NULL;
+}
+
+static bool core_info_list_supports_ext(const core_info_list_t *list,
+      const char *ext)
+{
+   size_t num = 0;
+   core_info_index_find(list->ext_index, list->ext_index_count, ext, &num);
+   return num != 0;
+}
+
+static bool core_info_supports_ext(const core_info_t *info, const char *ext)
+{
+   return string_list_find_elem_prefix(
+         info->supported_extensions_list, ".", ext);
+}
+
+static void core_info_list_finish(core_info_list_t *list)
+{
+   if (!list->ext_index)
+      list->ext_index = core_info_index_new(list,
+            offsetof(core_info_t, supported_extensions_list),
+            &list->ext_index_count);
+   if (!list->db_index)
+      list->db_index = core_info_index_new(list,
+            offsetof(core_info_t, databases_list),
+            &list->db_index_count);
+
+   list->supported = (core_info_t*)calloc(
+         list->count ? list->count : 1, sizeof(*list->supported));
+
+   core_info_list_resolve_all_extensions(list);
+}
+
+struct core_info_cache_buf
+{
+   uint8_t *data;
+   size_t len;
+   size_t capacity;
+   bool error;
+};
+
+static void core_info_cache_put(struct core_info_cache_buf *buf,
+      const void *data, size_t len)
+{
+   if (buf->error)
+      return;
+
+   if (buf->len + len > buf->capacity)
+   {
+      size_t capacity = buf->capacity ? buf->capacity * 2 : 0x10000;
+      uint8_t *data_  = NULL;
+
+      while (capacity < buf->len + len)
+         capacity *= 2;
+
+      data_ = (uint8_t*)realloc(buf->data, capacity);
+
+      if (!data_)
+      {
+         buf->error = true;
+         return;
+      }
+
+      buf->data     = data_;
+      buf->capacity = capacity;
+   }
+
+   memcpy(buf->data + buf->len, data, len);
+   buf->len += len;
+}
+
+static void core_info_cache_put_u32(struct core_info_cache_buf *buf,
+      uint32_t val)
+{
+   core_info_cache_put(buf, &val, sizeof(val));
+}
+
+/* Adds @str to the string table, the record gets its offset + 1,
+ * 0 stands for NULL. */
+static void core_info_cache_put_string(struct core_info_cache_buf *rec,
+      struct core_info_cache_buf *strings, const char *str)
+{
+   if (!str)
+   {
+      core_info_cache_put_u32(rec, 0);
+      return;
+   }
+
+   core_info_cache_put_u32(rec, (uint32_t)strings->len + 1);
+   core_info_cache_put(strings, str, strlen(str) + 1);
+}
+
+static void core_info_cache_put_index(struct core_info_cache_buf *rec,
+      struct core_info_cache_buf *strings,
+      const core_info_index_t *index, size_t count)
+{
+   size_t i;
+
+   core_info_cache_put_u32(rec, (uint32_t)count);
+
+   for (i = 0; i < count; i++)
+   {
+      core_info_cache_put_string(rec, strings, index[i].key);
+      core_info_cache_put_u32(rec, (uint32_t)index[i].core);
+   }
+}
+
+/* Layout, in native byte order:
+ * magic, string table size, string table,
+ * cores directory, its mtime, info directory, its mtime,
+ * core count, then every core with its firmware,
+ * extension index, database index. */
+static void core_info_cache_save(const core_info_list_t *list,
+      const char *cache_path, const char *cores_dir, const char *info_dir,
+      int64_t cores_mtime, int64_t info_mtime)
+{
+   size_t i, j;
+   char tmp_path[PATH_MAX_LENGTH];
+   struct core_info_cache_buf strings = {0};
+   struct core_info_cache_buf rec     = {0};
+   FILE *file                         = NULL;
+
+   core_info_cache_put_string(&rec, &strings, cores_dir);
+   core_info_cache_put(&rec, &cores_mtime, sizeof(cores_mtime));
+   core_info_cache_put_string(&rec, &strings, info_dir);
+   core_info_cache_put(&rec, &info_mtime, sizeof(info_mtime));
+
+   core_info_cache_put_u32(&rec, (uint32_t)list->count);
+
+   for (i = 0; i < list->count; i++)
+   {
+      const core_info_t *info = &list->list[i];
+      uint8_t flags           = (info->supports_no_game ? 1 : 0)
+                              | (info->has_info         ? 2 : 0);
+
+      core_info_cache_put_string(&rec, &strings, info->path);
+      core_info_cache_put_string(&rec, &strings, info->display_name);
+      core_info_cache_put_string(&rec, &strings, info->core_name);
+      core_info_cache_put_string(&rec, &strings, info->system_manufacturer);
+      core_info_cache_put_string(&rec, &strings, info->systemname);
+      core_info_cache_put_string(&rec, &strings, info->supported_extensions);
+      core_info_cache_put_string(&rec, &strings, info->authors);
+      core_info_cache_put_string(&rec, &strings, info->permissions);
+      core_info_cache_put_string(&rec, &strings, info->licenses);
+      core_info_cache_put_string(&rec, &strings, info->categories);
+      core_info_cache_put_string(&rec, &strings, info->databases);
+      core_info_cache_put_string(&rec, &strings, info->notes);
+      core_info_cache_put(&rec, &flags, sizeof(flags));
+
+      core_info_cache_put_u32(&rec, (uint32_t)info->firmware_count);
+
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         uint8_t optional = info->firmware[j].optional;
+
+         core_info_cache_put_string(&rec, &strings, info->firmware[j].path);
+         core_info_cache_put_string(&rec, &strings, info->firmware[j].desc);
+         core_info_cache_put(&rec, &optional, sizeof(optional));
+      }
+   }
+
+   core_info_cache_put_index(&rec, &strings,
+         list->ext_index, list->ext_index_count);
+   core_info_cache_put_index(&rec, &strings,
+         list->db_index, list->db_index_count);
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path);
+
+   if (!strings.error && !rec.error && (file = fopen(tmp_path, "wb")))
+   {
+      uint32_t strings_len = (uint32_t)strings.len;
+      bool written         =
+            fwrite(CORE_INFO_CACHE_MAGIC, 1,
+               strlen(CORE_INFO_CACHE_MAGIC), file)
+               == strlen(CORE_INFO_CACHE_MAGIC)
+         && fwrite(&strings_len, 1, sizeof(strings_len), file)
+               == sizeof(strings_len)
+         && fwrite(strings.data, 1, strings.len, file) == strings.len
+         && fwrite(rec.data, 1, rec.len, file) == rec.len;
+
+      if (fclose(file) != 0)
+         written = false;
+
+      if (written)
+      {
+         remove(cache_path);
+         if (rename(tmp_path, cache_path) != 0)
+            remove(tmp_path);
+      }
+      else
+         remove(tmp_path);
+   }
+
+   free(strings.data);
+   free(rec.data);
+}
+
+struct core_info_cache_reader
+{
+   const uint8_t *pos;
+   const uint8_t *end;
+   const char *strings;
+   uint32_t strings_len;
+   bool error;
+};
+
+static void core_info_cache_get(struct core_info_cache_reader *r,
+      void *data, size_t len)
+{
+   if (r->error || (size_t)(r->end - r->pos) < len)
+   {
+      r->error = true;
+      memset(data, 0, len);
+      return;
+   }
+
+   memcpy(data, r->pos, len);
+   r->pos += len;
+}
+
+static uint32_t core_info_cache_get_u32(struct core_info_cache_reader *r)
+{
+   uint32_t val = 0;
+   core_info_cache_get(r, &val, sizeof(val));
+   return val;
+}
+
+/* Points into the string table, NULL for a NULL string. */
+static const char *core_info_cache_get_string(
+      struct core_info_cache_reader *r)
+{
+   uint32_t off = core_info_cache_get_u32(r);
+
+   if (!off || r->error)
+      return NULL;
+
+   if (off > r->strings_len)
+   {
+      r->error = true;
+      return NULL;
+   }
+
+   return r->strings + off - 1;
+}
+
+static char *core_info_cache_dup_string(struct core_info_cache_reader *r)
+{
+   const char *str = core_info_cache_get_string(r);
+   return str ? strdup(str) : NULL;
+}
+
+static core_info_index_t *core_info_cache_get_index(
+      struct core_info_cache_reader *r, size_t cores, size_t *count)
+{
+   size_t i;
+   core_info_index_t *index = NULL;
+   uint32_t n               = core_info_cache_get_u32(r);
+
+   *count = 0;
+
+   if (r->error || !n)
+      return NULL;
+
+   if ((size_t)(r->end - r->pos) < n * 2 * sizeof(uint32_t)
+         || !(index = (core_info_index_t*)calloc(n, sizeof(*index))))
+   {
+      r->error = true;
+      return NULL;
+   }
+
+   for (i = 0; i < n; i++)
+   {
+      index[i].key  = core_info_cache_get_string(r);
+      index[i].core = core_info_cache_get_u32(r);
+
+      if (!index[i].key || index[i].core >= cores)
+         r->error = true;
+   }
+
+   *count = n;
+   return index;
+}
+
+static core_info_list_t *core_info_cache_load(const char *cache_path,
+      const char *cores_dir, const char *info_dir,
+      int64_t cores_mtime, int64_t info_mtime)
+{
+   size_t i, j;
+   struct core_info_cache_reader r;
+   int64_t mtime                    = 0;
+   uint32_t count                   = 0;
+   uint8_t *data                    = NULL;
+   long len                         = 0;
+   core_info_list_t *list           = NULL;
+   const char *dir                  = NULL;
+   FILE *file                       = fopen(cache_path, "rb");
+   size_t magic_len                 = strlen(CORE_INFO_CACHE_MAGIC);
+
+   if (!file)
+      return NULL;
+
+   if (fseek(file, 0, SEEK_END) == 0)
+      len = ftell(file);
+
+   if (len > (long)magic_len && fseek(file, 0, SEEK_SET) == 0)
+      data = (uint8_t*)malloc(len);
+
+   if (data && fread(data, 1, len, file) != (size_t)len)
+   {
+      free(data);
+      data = NULL;
+   }
+
+   fclose(file);
+
+   if (!data)
+      return NULL;
+
+   memset(&r, 0, sizeof(r));
+   r.pos = data;
+   r.end = data + len;
+
+   if (memcmp(data, CORE_INFO_CACHE_MAGIC, magic_len))
+      goto error;
+   r.pos += magic_len;
+
+   r.strings_len = core_info_cache_get_u32(&r);
+
+   /* The string table has to end with a terminator. */
+   if (r.error || !r.strings_len
+         || (size_t)(r.end - r.pos) < r.strings_len
+         || r.pos[r.strings_len - 1] != '\0')
+      goto error;
+
+   r.strings = (const char*)r.pos;
+   r.pos    += r.strings_len;
+
+   dir = core_info_cache_get_string(&r);
+   core_info_cache_get(&r, &mtime, sizeof(mtime));
+   if (!dir || !string_is_equal(dir, cores_dir) || mtime != cores_mtime)
+      goto error;
+
+   dir = core_info_cache_get_string(&r);
+   core_info_cache_get(&r, &mtime, sizeof(mtime));
+   if (!dir || !string_is_equal(dir, info_dir) || mtime != info_mtime)
+      goto error;
+
+   count = core_info_cache_get_u32(&r);
+
+   if (r.error || (size_t)(r.end - r.pos) / (12 * sizeof(uint32_t)) < count)
+      goto error;
+
+   list = (core_info_list_t*)calloc(1, sizeof(*list));
+   if (!list)
+      goto error;
+
+   list->list  = (core_info_t*)calloc(count ? count : 1, sizeof(*list->list));
+   list->count = count;
+
+   if (!list->list)
+      goto error;
+
+   for (i = 0; i < count && !r.error; i++)
+   {
+      uint8_t flags     = 0;
+      core_info_t *info = &list->list[i];
+
+      info->path                 = core_info_cache_dup_string(&r);
+      info->display_name         = core_info_cache_dup_string(&r);
+      info->core_name            = core_info_cache_dup_string(&r);
+      info->system_manufacturer  = core_info_cache_dup_string(&r);
+      info->systemname           = core_info_cache_dup_string(&r);
+      info->supported_extensions = core_info_cache_dup_string(&r);
+      info->authors              = core_info_cache_dup_string(&r);
+      info->permissions          = core_info_cache_dup_string(&r);
+      info->licenses             = core_info_cache_dup_string(&r);
+      info->categories           = core_info_cache_dup_string(&r);
+      info->databases            = core_info_cache_dup_string(&r);
+      info->notes                = core_info_cache_dup_string(&r);
+      core_info_cache_get(&r, &flags, sizeof(flags));
+
+      info->supports_no_game     = (flags & 1) != 0;
+      info->has_info             = (flags & 2) != 0;
+
+      if (info->supported_extensions)
+         info->supported_extensions_list =
+            string_split(info->supported_extensions, "|");
+      if (info->authors)
+         info->authors_list     = string_split(info->authors, "|");
+      if (info->permissions)
+         info->permissions_list = string_split(info->permissions, "|");
+      if (info->licenses)
+         info->licenses_list    = string_split(info->licenses, "|");
+      if (info->categories)
+         info->categories_list  = string_split(info->categories, "|");
+      if (info->databases)
+         info->databases_list   = string_split(info->databases, "|");
+      if (info->notes)
+         info->note_list        = string_split(info->notes, "|");
+
+      info->firmware_count = core_info_cache_get_u32(&r);
+
+      if (!info->firmware_count)
+         continue;
+
+      if (r.error
+            || (size_t)(r.end - r.pos) / (2 * sizeof(uint32_t) + 1)
+               < info->firmware_count
+            || !(info->firmware = (core_info_firmware_t*)calloc(
+                  info->firmware_count, sizeof(*info->firmware))))
+      {
+         info->firmware_count = 0;
+         goto error;
+      }
+
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         uint8_t optional = 0;
+
+         info->firmware[j].path     = core_info_cache_dup_string(&r);
+         info->firmware[j].desc     = core_info_cache_dup_string(&r);
+         core_info_cache_get(&r, &optional, sizeof(optional));
+         info->firmware[j].optional = optional != 0;
+      }
+   }
+
+   list->ext_index = core_info_cache_get_index(&r, count,
+         &list->ext_index_count);
+   list->db_index  = core_info_cache_get_index(&r, count,
+         &list->db_index_count);
+
+   if (r.error)
+      goto error;
+
+   /* The indexes keep pointing into the string table. */
+   list->cache_strings = (char*)malloc(r.strings_len);
+
+   if (!list->cache_strings)
+      goto error;
+
+   memcpy(list->cache_strings, r.strings, r.strings_len);
+
+   for (i = 0; i < list->ext_index_count; i++)
+      list->ext_index[i].key = list->cache_strings +
+         (list->ext_index[i].key - r.strings);
+   for (i = 0; i < list->db_index_count; i++)
+      list->db_index[i].key  = list->cache_strings +
+         (list->db_index[i].key - r.strings);
+
+   free(data);
+   return list;
+
+error:
+   free(data);
+   core_info_list_free(list);
+   return NULL;
+}
+
+static core_info_list_t *core_info_list_new(const char *path,
+      const char *info_dir, const char *cache_dir)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   core_info_list_t *list = NULL;
+   int64_t cores_mtime    = path_get_mtime(path);
+   int64_t info_mtime     = path_get_mtime(info_dir);
+
+   cache_path[0] = '\0';
+
+   if (!string_is_empty(cache_dir) && path_is_directory(cache_dir))
+      fill_pathname_join(cache_path, cache_dir,
+            CORE_INFO_CACHE_FILE, sizeof(cache_path));
+
+   /* Directories get a new mtime when a file is added, removed
+    * or renamed, which is what installing cores and their .info
+    * files does. */
+   if (!string_is_empty(cache_path) && cores_mtime > 0 && info_mtime > 0)
+   {
+      list = core_info_cache_load(cache_path, path, info_dir,
+            cores_mtime, info_mtime);
+
+      if (list)
+      {
+         core_info_list_finish(list);
+         return list;
+      }
+   }
+
+   list = core_info_list_parse(path, info_dir);
+
+   if (!list)
+      return NULL;
+
+   core_info_list_finish(list);
+
+   /* A directory changed within the last second might change
+    * again without its mtime showing it. */
+   if (!string_is_empty(cache_path) && cores_mtime > 0 && info_mtime > 0
+         && cores_mtime < (int64_t)time(NULL) - 1
+         && info_mtime  < (int64_t)time(NULL) - 1)
+      core_info_cache_save(list, cache_path, path, info_dir,
+            cores_mtime, info_mtime);
+
+   return list;
+}
+
+void core_info_cache_invalidate(void)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   settings_t *settings = config_get_ptr();
+
+   cache_path[0] = '\0';
+
+   if (!settings || string_is_empty(settings->directory.cache))
+      return;
+
+   fill_pathname_join(cache_path, settings->directory.cache,
+         CORE_INFO_CACHE_FILE, sizeof(cache_path));
+   remove(cache_path);
+}
+
 /* Shallow-copies internal state.
  *
  * Data in *info is invalidated when the
@@ -426,47 +1051,11 @@ static bool core_info_list_get_info(core_info_list_t *core_info_list,
    return false;
 }
 
-static bool core_info_does_support_any_file(const core_info_t *core,
-      const struct string_list *list)
-{
-   size_t i;
-   if (!list || !core || !core->supported_extensions_list)
-      return false;
-
-   for (i = 0; i < list->size; i++)
-      if (string_list_find_elem_prefix(core->supported_extensions_list,
-               ".", path_get_extension(list->elems[i].data)))
-         return true;
-   return false;
-}
-
-static bool core_info_does_support_file(
-      const core_info_t *core, const char *path)
-{
-   if (!core || !core->supported_extensions_list)
-      return false;
-   if (string_is_empty(path))
-      return false;
-
-   return string_list_find_elem_prefix(
-         core->supported_extensions_list, ".", path_get_extension(path));
-}
-
-/* qsort_r() is not in standard C, sadly. */
-
 static int core_info_qsort_cmp(const void *a_, const void *b_)
 {
    const core_info_t *a = (const core_info_t*)a_;
    const core_info_t *b = (const core_info_t*)b_;
-   int support_a        =
-         core_info_does_support_any_file(a, core_info_tmp_list)
-      || core_info_does_support_file(a, core_info_tmp_path);
-   int support_b        =
-         core_info_does_support_any_file(b, core_info_tmp_list)
-      || core_info_does_support_file(b, core_info_tmp_path);
-
-   if (support_a != support_b)
-      return support_b - support_a;
+
    return strcasecmp(a->display_name, b->display_name);
 }
 
@@ -598,22 +1187,100 @@ bool core_info_get_current_core(core_info_t **core)
    return true;
 }
 
+static core_info_list_t *core_info_list_build(void)
+{
+   int span               = rarch_startup_trace_begin("core info list");
+   core_info_list_t *list = core_info_list_new(core_info_curr_list_dir,
+         core_info_curr_list_info_dir, core_info_curr_list_cache_dir);
+
+   rarch_startup_trace_end(span);
+   return list;
+}
+
+#ifdef HAVE_THREADS
+static void core_info_list_thread(void *data)
+{
+   core_info_list_t *list = core_info_list_build();
+
+   slock_lock(core_info_curr_list_lock);
+   core_info_curr_list         = list;
+   core_info_curr_list_pending = false;
+   scond_broadcast(core_info_curr_list_cond);
+   slock_unlock(core_info_curr_list_lock);
+}
+#endif
+
+/* Returns the list once it is built. */
+static core_info_list_t *core_info_list_wait(void)
+{
+#ifdef HAVE_THREADS
+   if (core_info_curr_list_thread)
+   {
+      slock_lock(core_info_curr_list_lock);
+      while (core_info_curr_list_pending)
+         scond_wait(core_info_curr_list_cond, core_info_curr_list_lock);
+      slock_unlock(core_info_curr_list_lock);
+      return core_info_curr_list;
+   }
+#endif
+
+   if (core_info_curr_list_pending)
+   {
+      core_info_curr_list         = core_info_list_build();
+      core_info_curr_list_pending = false;
+   }
+
+   return core_info_curr_list;
+}
+
 void core_info_deinit_list(void)
 {
+#ifdef HAVE_THREADS
+   if (core_info_curr_list_thread)
+      sthread_join(core_info_curr_list_thread);
+   core_info_curr_list_thread = NULL;
+#endif
+
+   /* A list nobody asked for yet is not built just to be freed. */
+   core_info_curr_list_pending = false;
+
    if (core_info_curr_list)
       core_info_list_free(core_info_curr_list);
    core_info_curr_list = NULL;
 }
 
+/* Starts building the list, it is ready once
+ * core_info_get_list() and friends return. */
 bool core_info_init_list(void)
 {
    settings_t *settings = config_get_ptr();
 
-   if (settings)
-      core_info_curr_list = core_info_list_new(settings->directory.libretro);
-
-   if (!core_info_curr_list)
+   if (!settings)
       return false;
+
+   core_info_deinit_list();
+
+   strlcpy(core_info_curr_list_dir, settings->directory.libretro,
+         sizeof(core_info_curr_list_dir));
+   strlcpy(core_info_curr_list_info_dir,
+         !string_is_empty(settings->path.libretro_info)
+         ? settings->path.libretro_info : settings->directory.libretro,
+         sizeof(core_info_curr_list_info_dir));
+   strlcpy(core_info_curr_list_cache_dir, settings->directory.cache,
+         sizeof(core_info_curr_list_cache_dir));
+   core_info_curr_list_pending = true;
+
+#ifdef HAVE_THREADS
+   if (!core_info_curr_list_lock)
+      core_info_curr_list_lock = slock_new();
+   if (!core_info_curr_list_cond)
+      core_info_curr_list_cond = scond_new();
+
+   if (core_info_curr_list_lock && core_info_curr_list_cond)
+      core_info_curr_list_thread = sthread_create(
+            core_info_list_thread, NULL);
+#endif
+
    return true;
 }
 
@@ -621,7 +1288,7 @@ bool core_info_get_list(core_info_list_t **core)
 {
    if (!core)
       return false;
-   *core = core_info_curr_list;
+   *core = core_info_list_wait();
    return true;
 }
 
@@ -630,24 +1297,26 @@ bool core_info_list_update_missing_firmware(core_info_ctx_firmware_t *info)
    if (!info)
       return false;
    return core_info_list_update_missing_firmware_internal(
-         core_info_curr_list,
+         core_info_list_wait(),
          info->path, info->directory.system);
 }
 
 bool core_info_load(core_info_ctx_find_t *info)
 {
    core_info_t *core_info     = NULL;
+   core_info_list_t *list     = NULL;
 
    if (!info)
       return false;
 
    core_info_get_current_core(&core_info);
 
-   if (!core_info_curr_list)
+   list = core_info_list_wait();
+
+   if (!list)
       return false;
 
-   if (!core_info_list_get_info(core_info_curr_list,
-            core_info, info->path))
+   if (!core_info_list_get_info(list, core_info, info->path))
       return false;
 
    return true;
@@ -655,9 +1324,11 @@ bool core_info_load(core_info_ctx_find_t *info)
 
 bool core_info_find(core_info_ctx_find_t *info, const char *core_path)
 {
-   if (!info || !core_info_curr_list)
+   core_info_list_t *list = core_info_list_wait();
+
+   if (!info || !list)
       return false;
-   info->inf = core_info_find_internal(core_info_curr_list, core_path);
+   info->inf = core_info_find_internal(list, core_path);
    if (!info->inf)
       return false;
    return true;
@@ -676,48 +1347,65 @@ core_info_t *core_info_get(core_info_list_t *list, size_t i)
    return info;
 }
 
+/* Flags the cores supporting the extension of @path. */
+static void core_info_list_mark_supported(core_info_list_t *core_info_list,
+      const char *path, bool *marks)
+{
+   size_t i;
+   size_t num                     = 0;
+   const core_info_index_t *index = core_info_index_find(
+         core_info_list->ext_index, core_info_list->ext_index_count,
+         path_get_extension(path), &num);
+
+   for (i = 0; i < num; i++)
+      marks[index[i].core] = true;
+}
+
 void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
       const char *path, const core_info_t **infos, size_t *num_infos)
 {
    size_t i;
-   struct string_list *list = NULL;
+   bool *marks              = NULL;
    size_t supported         = 0;
 
    if (!core_info_list)
       return;
 
-   core_info_tmp_path = path;
+   *infos     = core_info_list->supported;
+   *num_infos = 0;
 
-#ifdef HAVE_COMPRESSION
-   if (path_is_compressed_file(path))
-      list = file_archive_get_file_list(path, NULL);
-   core_info_tmp_list = list;
-#endif
+   if (!core_info_list->supported || string_is_empty(path))
+      return;
 
-   /* Let supported core come first in list so we can return
-    * a pointer to them. */
-   qsort(core_info_list->list, core_info_list->count,
-         sizeof(core_info_t), core_info_qsort_cmp);
+   marks = (bool*)calloc(core_info_list->count + 1, sizeof(*marks));
 
-   for (i = 0; i < core_info_list->count; i++, supported++)
-   {
-      const core_info_t *core = &core_info_list->list[i];
+   if (!marks)
+      return;
 
-      if (core_info_does_support_file(core, path))
-         continue;
+   core_info_list_mark_supported(core_info_list, path, marks);
 
 #ifdef HAVE_COMPRESSION
-      if (core_info_does_support_any_file(core, list))
-         continue;
-#endif
+   if (path_is_compressed_file(path))
+   {
+      struct string_list *list = file_archive_get_file_list(path, NULL);
 
-      break;
-   }
+      for (i = 0; list && i < list->size; i++)
+         core_info_list_mark_supported(core_info_list,
+               list->elems[i].data, marks);
 
-   if (list)
       string_list_free(list);
+   }
+#endif
+
+   for (i = 0; i < core_info_list->count; i++)
+      if (marks[i])
+         core_info_list->supported[supported++] = core_info_list->list[i];
+
+   free(marks);
+
+   qsort(core_info_list->supported, supported,
+         sizeof(core_info_t), core_info_qsort_cmp);
 
-   *infos     = core_info_list->list;
    *num_infos = supported;
 }
 
@@ -743,8 +1431,11 @@ void core_info_get_name(const char *path, char *s, size_t len)
       if (!string_is_equal(contents->elems[i].data, path))
          continue;
 
-      if (!core_info_list_iterate(info_path,
-               sizeof(info_path), contents, i)
+      if (!core_info_list_iterate(info_path, sizeof(info_path),
+               !string_is_empty(settings->path.libretro_info)
+               ? settings->path.libretro_info
+               : settings->directory.libretro,
+               contents, i)
             && path_is_valid(info_path))
          continue;
 
@@ -777,58 +1468,37 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
-   }
+      num += core_info_list->list[i].has_info;
 
    return num;
 }
 
 bool core_info_unsupported_content_path(const char *path)
 {
-   size_t i;
-   const char *archive_path = NULL;
    const char *delim        = path_get_archive_delim(path);
+   core_info_list_t *list   = core_info_list_wait();
 
-   if (delim)
-      archive_path = delim - 1;
-
-   if (!core_info_curr_list)
+   if (!list)
       return false;
 
    /* if the path contains a compressed file and the core supports archives,
     * we don't want to look at this file */
-   if (archive_path)
-   {
-      for (i = 0; i < core_info_curr_list->count; i++)
-      {
-         const core_info_t *info = &core_info_curr_list->list[i];
-
-         if (     !string_list_find_elem(info->supported_extensions_list, "zip")
-               && !string_list_find_elem(info->supported_extensions_list, "7z"))
-            continue;
-
-         return false;
-      }
-   }
-
-   for (i = 0; i < core_info_curr_list->count; i++)
-   {
-      const core_info_t *info = &core_info_curr_list->list[i];
-
-      if (string_list_find_elem(info->supported_extensions_list, path_get_extension(path)))
-         return false;
-   }
+   if (delim && (core_info_list_supports_ext(list, "zip")
+            || core_info_list_supports_ext(list, "7z")))
+      return false;
 
-   return true;
+   return !core_info_list_supports_ext(list, path_get_extension(path));
 }
 
 bool core_info_database_supports_content_path(const char *database_path, const char *path)
 {
-   char *database           = NULL;
-   const char *new_path     = path_basename(database_path);
+   size_t i;
+   size_t num                     = 0;
+   char *database                 = NULL;
+   const core_info_index_t *index = NULL;
+   core_info_list_t *list         = NULL;
+   const char *new_path           = path_basename(database_path);
+   bool ret                       = false;
 
    if (string_is_empty(new_path))
       return false;
@@ -844,54 +1514,41 @@ bool core_info_database_supports_content_path(const char *database_path, const c
 
    path_remove_extension(database);
 
-   if (core_info_curr_list)
-   {
-      size_t i;
-      const char *delim           = path_get_archive_delim(path);
+   list  = core_info_list_wait();
 
-      if (delim)
+   if (list)
+      index = core_info_index_find(list->db_index, list->db_index_count,
+            database, &num);
+
+   /* if the path contains a compressed file and the core supports archives,
+    * we don't want to look at this file */
+   if (path_get_archive_delim(path))
+   {
+      for (i = 0; i < num; i++)
       {
-         const char *archive_path = delim - 1;
+         const core_info_t *info = &list->list[index[i].core];
 
-         /* if the path contains a compressed file and the core supports archives,
-          * we don't want to look at this file */
-         if (archive_path)
+         if (     core_info_supports_ext(info, "zip")
+               || core_info_supports_ext(info, "7z"))
          {
-            for (i = 0; i < core_info_curr_list->count; i++)
-            {
-               const core_info_t *info = &core_info_curr_list->list[i];
-
-               if (!string_list_find_elem(info->databases_list, database))
-                  continue;
-
-               if (     !string_list_find_elem(info->supported_extensions_list, "zip")
-                     && !string_list_find_elem(info->supported_extensions_list, "7z"))
-                  continue;
-
-               free(database);
-               return false;
-            }
+            free(database);
+            return false;
          }
       }
+   }
 
-      for (i = 0; i < core_info_curr_list->count; i++)
+   for (i = 0; i < num; i++)
+   {
+      if (core_info_supports_ext(&list->list[index[i].core],
+               path_get_extension(path)))
       {
-         const core_info_t *info = &core_info_curr_list->list[i];
-
-         if (!string_list_find_elem(info->supported_extensions_list,
-                  path_get_extension(path)))
-            continue;
-
-         if (!string_list_find_elem(info->databases_list, database))
-            continue;
-
-         free(database);
-         return true;
+         ret = true;
+         break;
       }
    }
 
    free(database);
-   return false;
+   return ret;
 }
 
 bool core_info_list_get_display_name(core_info_list_t *core_info_list,
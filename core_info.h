@@ -38,7 +38,6 @@ typedef struct
 typedef struct
 {
    char *path;
-   void *config_data;
    char *display_name;
    char *core_name;
    char *system_manufacturer;
@@ -61,14 +60,34 @@ typedef struct
    core_info_firmware_t *firmware;
    size_t firmware_count;
    bool supports_no_game;
+   /* The core came with an .info file. */
+   bool has_info;
    void *userdata;
 } core_info_t;
 
+typedef struct
+{
+   const char *key;
+   size_t core;
+} core_info_index_t;
+
 typedef struct
 {
    core_info_t *list;
    size_t count;
    char *all_ext;
+
+   /* Cores by supported extension and by database, sorted
+    * case-insensitively by key. */
+   core_info_index_t *ext_index;
+   size_t ext_index_count;
+   core_info_index_t *db_index;
+   size_t db_index_count;
+
+   /* Returned by core_info_list_get_supported_cores(). */
+   core_info_t *supported;
+   /* Strings the indexes point to when loaded from the cache. */
+   char *cache_strings;
 } core_info_list_t;
 
 typedef struct core_info_ctx_firmware
@@ -111,6 +130,10 @@ void core_info_deinit_list(void);
 
 bool core_info_init_list(void);
 
+/* Drops the cached list, for when .info files were
+ * overwritten in place. */
+void core_info_cache_invalidate(void);
+
 bool core_info_get_list(core_info_list_t **core);
 
 bool core_info_list_update_missing_firmware(core_info_ctx_firmware_t *info);
@@ -21,9 +21,11 @@
 #include <compat/strl.h>
 #include <retro_endianness.h>
 #include <file/file_path.h>
+#include <rhash.h>
 #include <string/stdstring.h>
 
 #include "libretro-db/libretrodb.h"
+#include "libretro-db/rmsgpack.h"
 
 #include "list_special.h"
 #include "database_info.h"
@@ -206,156 +208,225 @@ char *bin_to_hex_alloc(const uint8_t *data, size_t len)
 }
 
 
-static int database_cursor_iterate(libretrodb_cursor_t *cur,
-      database_info_t *db_info)
+/* Same as msg_hash_calculate(), for keys that are read in
+ * place and not NUL-terminated. */
+static uint32_t database_info_hash_key(const char *s, uint32_t len)
 {
-   unsigned i;
-   struct rmsgpack_dom_value item;
-   const char* str                = NULL;
+   uint32_t i;
+   uint32_t hash = 5381;
+
+   for (i = 0; i < len; i++)
+      hash = (hash << 5) + hash + (unsigned char)s[i];
+
+   return hash;
+}
+
+/* Copies a string or binary value, NULL if it is empty. */
+static char *database_info_strdup_token(const struct rmsgpack_token *val)
+{
+   char *str = NULL;
+
+   if (     val->type != RMSGPACK_TOKEN_STRING
+         && val->type != RMSGPACK_TOKEN_BINARY)
+      return NULL;
 
-   if (libretrodb_cursor_read_item(cur, &item) != 0)
+   if (!val->val.string.len || !val->val.string.buff[0])
+      return NULL;
+
+   str = (char*)malloc(val->val.string.len + 1);
+
+   if (!str)
+      return NULL;
+
+   memcpy(str, val->val.string.buff, val->val.string.len);
+   str[val->val.string.len] = '\0';
+   return str;
+}
+
+static unsigned database_info_uint_token(const struct rmsgpack_token *val)
+{
+   if (val->type == RMSGPACK_TOKEN_INT || val->type == RMSGPACK_TOKEN_UINT)
+      return (unsigned)val->val.uint_;
+   return 0;
+}
+
+static uint32_t database_info_crc32_token(const struct rmsgpack_token *val)
+{
+   uint32_t crc = 0;
+
+   if (val->type == RMSGPACK_TOKEN_BINARY && val->val.binary.len >= 4)
+      memcpy(&crc, val->val.binary.buff, sizeof(crc));
+
+   return swap_if_little32(crc);
+}
+
+/* Reads the next key and value of a map, nested maps and
+ * arrays are skipped over. */
+static int database_info_read_field(const uint8_t **pos, const uint8_t *end,
+      struct rmsgpack_token *key, struct rmsgpack_token *val)
+{
+   const uint8_t *start = NULL;
+
+   if (rmsgpack_read_token_buf(pos, end, key) < 0)
+      return -1;
+
+   start = *pos;
+
+   if (rmsgpack_read_token_buf(pos, end, val) < 0)
       return -1;
 
-   if (item.type != RDT_MAP)
+   if (val->type == RMSGPACK_TOKEN_MAP || val->type == RMSGPACK_TOKEN_ARRAY)
    {
-      rmsgpack_dom_value_free(&item);
-      return 1;
+      *pos = start;
+      if (rmsgpack_skip_buf(pos, end) < 0)
+         return -1;
    }
 
+   return key->type == RMSGPACK_TOKEN_STRING ? 0 : 1;
+}
+
+static int database_cursor_iterate(libretrodb_cursor_t *cur,
+      database_info_t *db_info)
+{
+   uint32_t i;
+   struct rmsgpack_token item;
+   const uint8_t *pos = NULL;
+   const uint8_t *end = NULL;
+
+   /* Documents are read in place, only the fields
+    * that are kept get copied. */
+   if (libretrodb_cursor_read_raw(cur, &pos, &end) != 0)
+      return -1;
+
+   if (rmsgpack_read_token_buf(&pos, end, &item) < 0
+         || item.type != RMSGPACK_TOKEN_MAP)
+      return 1;
+
    db_info->analog_supported       = -1;
    db_info->rumble_supported       = -1;
    db_info->coop_supported         = -1;
 
-   for (i = 0; i < item.val.map.len; i++)
+   for (i = 0; i < item.val.len; i++)
    {
-      uint32_t                 value = 0;
-      struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
-      struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
-      const char *val_string         = NULL;
+      struct rmsgpack_token key, val;
+      int rv = database_info_read_field(&pos, end, &key, &val);
 
-      if (!key || !val)
+      if (rv < 0)
+         break;
+      if (rv > 0)
          continue;
 
-      val_string = val->val.string.buff;
-      str        = key->val.string.buff;
-      value      = msg_hash_calculate(str);
-
-      switch (value)
+      switch (database_info_hash_key(key.val.string.buff, key.val.string.len))
       {
          case DB_CURSOR_SERIAL:
-            if (!string_is_empty(val_string))
-               db_info->serial = strdup(val_string);
+            db_info->serial               = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_ROM_NAME:
-            if (!string_is_empty(val_string))
-               db_info->rom_name = strdup(val_string);
+            db_info->rom_name             = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_NAME:
-            if (!string_is_empty(val_string))
-               db_info->name = strdup(val_string);
+            db_info->name                 = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_DESCRIPTION:
-            if (!string_is_empty(val_string))
-               db_info->description = strdup(val_string);
+            db_info->description          = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_GENRE:
-            if (!string_is_empty(val_string))
-               db_info->genre = strdup(val_string);
+            db_info->genre                = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_PUBLISHER:
-            if (!string_is_empty(val_string))
-               db_info->publisher = strdup(val_string);
+            db_info->publisher            = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_DEVELOPER:
-            if (!string_is_empty(val_string))
-               db_info->developer = string_split(val_string, "|");
+            {
+               char *developer = database_info_strdup_token(&val);
+
+               if (developer)
+               {
+                  db_info->developer = string_split(developer, "|");
+                  free(developer);
+               }
+            }
             break;
          case DB_CURSOR_ORIGIN:
-            if (!string_is_empty(val_string))
-               db_info->origin = strdup(val_string);
+            db_info->origin               = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_FRANCHISE:
-            if (!string_is_empty(val_string))
-               db_info->franchise = strdup(val_string);
+            db_info->franchise            = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_BBFC_RATING:
-            if (!string_is_empty(val_string))
-               db_info->bbfc_rating = strdup(val_string);
+            db_info->bbfc_rating          = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_ESRB_RATING:
-            if (!string_is_empty(val_string))
-               db_info->esrb_rating = strdup(val_string);
+            db_info->esrb_rating          = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_ELSPA_RATING:
-            if (!string_is_empty(val_string))
-               db_info->elspa_rating = strdup(val_string);
+            db_info->elspa_rating         = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_CERO_RATING:
-            if (!string_is_empty(val_string))
-               db_info->cero_rating          = strdup(val_string);
+            db_info->cero_rating          = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_PEGI_RATING:
-            if (!string_is_empty(val_string))
-               db_info->pegi_rating          = strdup(val_string);
+            db_info->pegi_rating          = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_ENHANCEMENT_HW:
-            if (!string_is_empty(val_string))
-               db_info->enhancement_hw       = strdup(val_string);
+            db_info->enhancement_hw       = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_EDGE_MAGAZINE_REVIEW:
-            if (!string_is_empty(val_string))
-               db_info->edge_magazine_review = strdup(val_string);
+            db_info->edge_magazine_review = database_info_strdup_token(&val);
             break;
          case DB_CURSOR_EDGE_MAGAZINE_RATING:
-            db_info->edge_magazine_rating    = (unsigned)val->val.uint_;
+            db_info->edge_magazine_rating    = database_info_uint_token(&val);
             break;
          case DB_CURSOR_EDGE_MAGAZINE_ISSUE:
-            db_info->edge_magazine_issue     = (unsigned)val->val.uint_;
+            db_info->edge_magazine_issue     = database_info_uint_token(&val);
             break;
          case DB_CURSOR_FAMITSU_MAGAZINE_RATING:
-            db_info->famitsu_magazine_rating = (unsigned)val->val.uint_;
+            db_info->famitsu_magazine_rating = database_info_uint_token(&val);
             break;
          case DB_CURSOR_TGDB_RATING:
-            db_info->tgdb_rating             = (unsigned)val->val.uint_;
+            db_info->tgdb_rating             = database_info_uint_token(&val);
             break;
          case DB_CURSOR_MAX_USERS:
-            db_info->max_users               = (unsigned)val->val.uint_;
+            db_info->max_users               = database_info_uint_token(&val);
             break;
          case DB_CURSOR_RELEASEDATE_MONTH:
-            db_info->releasemonth            = (unsigned)val->val.uint_;
+            db_info->releasemonth            = database_info_uint_token(&val);
             break;
          case DB_CURSOR_RELEASEDATE_YEAR:
-            db_info->releaseyear             = (unsigned)val->val.uint_;
+            db_info->releaseyear             = database_info_uint_token(&val);
             break;
          case DB_CURSOR_RUMBLE_SUPPORTED:
-            db_info->rumble_supported        = (int)val->val.uint_;
+            db_info->rumble_supported        = (int)database_info_uint_token(&val);
             break;
          case DB_CURSOR_COOP_SUPPORTED:
-            db_info->coop_supported          = (int)val->val.uint_;
+            db_info->coop_supported          = (int)database_info_uint_token(&val);
             break;
          case DB_CURSOR_ANALOG_SUPPORTED:
-            db_info->analog_supported        = (int)val->val.uint_;
+            db_info->analog_supported        = (int)database_info_uint_token(&val);
             break;
          case DB_CURSOR_SIZE:
-            db_info->size                    = (unsigned)val->val.uint_;
+            db_info->size                    = database_info_uint_token(&val);
             break;
          case DB_CURSOR_CHECKSUM_CRC32:
-            db_info->crc32 = swap_if_little32(*(uint32_t*)val->val.binary.buff);
+            db_info->crc32                   = database_info_crc32_token(&val);
             break;
          case DB_CURSOR_CHECKSUM_SHA1:
-            db_info->sha1 = bin_to_hex_alloc((uint8_t*)val->val.binary.buff, val->val.binary.len);
+            if (val.type == RMSGPACK_TOKEN_BINARY)
+               db_info->sha1 = bin_to_hex_alloc(
+                     (const uint8_t*)val.val.binary.buff, val.val.binary.len);
             break;
          case DB_CURSOR_CHECKSUM_MD5:
-            db_info->md5 = bin_to_hex_alloc((uint8_t*)val->val.binary.buff, val->val.binary.len);
+            if (val.type == RMSGPACK_TOKEN_BINARY)
+               db_info->md5 = bin_to_hex_alloc(
+                     (const uint8_t*)val.val.binary.buff, val.val.binary.len);
             break;
          default:
-            RARCH_LOG("Unknown key: %s\n", str);
+            RARCH_LOG("Unknown key: %.*s\n",
+                  (int)key.val.string.len, key.val.string.buff);
             break;
       }
    }
 
-   rmsgpack_dom_value_free(&item);
-
    return 0;
 }
 
@@ -659,3 +730,224 @@ void database_info_list_free(database_info_list_t *database_info_list)
 
    free(database_info_list->list);
 }
+
+struct database_info_index
+{
+   database_info_index_entry_t *entries;
+   size_t count;
+
+   /* Open-addressed hash tables holding entry index + 1,
+    * 0 marks an empty slot. */
+   size_t *crc_index;
+   size_t *serial_index;
+   size_t cap;
+};
+
+static int database_info_index_read_entry(libretrodb_cursor_t *cur,
+      database_info_index_entry_t *entry)
+{
+   uint32_t i;
+   struct rmsgpack_token item;
+   const uint8_t *pos = NULL;
+   const uint8_t *end = NULL;
+
+   if (libretrodb_cursor_read_raw(cur, &pos, &end) != 0)
+      return -1;
+
+   if (rmsgpack_read_token_buf(&pos, end, &item) < 0
+         || item.type != RMSGPACK_TOKEN_MAP)
+      return 1;
+
+   for (i = 0; i < item.val.len; i++)
+   {
+      struct rmsgpack_token key, val;
+      int rv = database_info_read_field(&pos, end, &key, &val);
+
+      if (rv < 0)
+         break;
+      if (rv > 0)
+         continue;
+
+      switch (database_info_hash_key(key.val.string.buff, key.val.string.len))
+      {
+         case DB_CURSOR_NAME:
+            entry->name   = database_info_strdup_token(&val);
+            break;
+         case DB_CURSOR_SERIAL:
+            entry->serial = database_info_strdup_token(&val);
+            break;
+         case DB_CURSOR_CHECKSUM_CRC32:
+            entry->crc32  = database_info_crc32_token(&val);
+            break;
+         default:
+            break;
+      }
+   }
+
+   return 0;
+}
+
+static void database_info_index_insert(size_t *table, size_t cap,
+      uint32_t hash, size_t idx)
+{
+   size_t slot = hash & (cap - 1);
+
+   while (table[slot])
+      slot = (slot + 1) & (cap - 1);
+
+   table[slot] = idx + 1;
+}
+
+database_info_index_t *database_info_index_new(const char *rdb_path)
+{
+   size_t i;
+   int ret                      = 0;
+   size_t entries_cap           = 0;
+   database_info_index_t *index = NULL;
+   libretrodb_t *db             = libretrodb_new();
+   libretrodb_cursor_t *cur     = libretrodb_cursor_new();
+
+   if (!db || !cur)
+      goto end;
+
+   if (database_cursor_open(db, cur, rdb_path, NULL) != 0)
+      goto end;
+
+   index = (database_info_index_t*)calloc(1, sizeof(*index));
+
+   if (!index)
+      goto end;
+
+   while (ret != -1)
+   {
+      database_info_index_entry_t entry = {0};
+      ret = database_info_index_read_entry(cur, &entry);
+
+      if (ret != 0)
+         continue;
+
+      if (index->count == entries_cap)
+      {
+         size_t new_cap = entries_cap ? entries_cap * 2 : 1024;
+         database_info_index_entry_t *new_ptr =
+            (database_info_index_entry_t*)realloc(index->entries,
+                  new_cap * sizeof(*new_ptr));
+
+         if (!new_ptr)
+         {
+            free(entry.name);
+            free(entry.serial);
+            database_info_index_free(index);
+            index = NULL;
+            goto end;
+         }
+
+         index->entries = new_ptr;
+         entries_cap    = new_cap;
+      }
+
+      index->entries[index->count++] = entry;
+   }
+
+   /* Keep the load factor at or below one half. */
+   index->cap = 16;
+   while (index->cap < index->count * 2)
+      index->cap <<= 1;
+
+   index->crc_index    = (size_t*)calloc(index->cap, sizeof(size_t));
+   index->serial_index = (size_t*)calloc(index->cap, sizeof(size_t));
+
+   if (!index->crc_index || !index->serial_index)
+   {
+      database_info_index_free(index);
+      index = NULL;
+      goto end;
+   }
+
+   /* Inserting in database order keeps the first matching
+    * entry first along each probe sequence. */
+   for (i = 0; i < index->count; i++)
+   {
+      const database_info_index_entry_t *entry = &index->entries[i];
+
+      if (entry->crc32)
+         database_info_index_insert(index->crc_index, index->cap,
+               entry->crc32, i);
+      if (entry->serial)
+         database_info_index_insert(index->serial_index, index->cap,
+               djb2_calculate(entry->serial), i);
+   }
+
+end:
+   if (db)
+   {
+      database_cursor_close(db, cur);
+      libretrodb_free(db);
+   }
+   if (cur)
+      libretrodb_cursor_free(cur);
+
+   return index;
+}
+
+void database_info_index_free(database_info_index_t *index)
+{
+   size_t i;
+
+   if (!index)
+      return;
+
+   for (i = 0; i < index->count; i++)
+   {
+      free(index->entries[i].name);
+      free(index->entries[i].serial);
+   }
+
+   free(index->entries);
+   free(index->crc_index);
+   free(index->serial_index);
+   free(index);
+}
+
+const database_info_index_entry_t *database_info_index_find_crc(
+      const database_info_index_t *index, uint32_t crc32)
+{
+   size_t slot;
+
+   if (!index || !crc32)
+      return NULL;
+
+   for (slot = crc32 & (index->cap - 1); index->crc_index[slot];
+         slot = (slot + 1) & (index->cap - 1))
+   {
+      const database_info_index_entry_t *entry =
+         &index->entries[index->crc_index[slot] - 1];
+
+      if (entry->crc32 == crc32)
+         return entry;
+   }
+
+   return NULL;
+}
+
+const database_info_index_entry_t *database_info_index_find_serial(
+      const database_info_index_t *index, const char *serial)
+{
+   size_t slot;
+
+   if (!index || string_is_empty(serial))
+      return NULL;
+
+   for (slot = djb2_calculate(serial) & (index->cap - 1);
+         index->serial_index[slot];
+         slot = (slot + 1) & (index->cap - 1))
+   {
+      const database_info_index_entry_t *entry =
+         &index->entries[index->serial_index[slot] - 1];
+
+      if (string_is_equal(entry->serial, serial))
+         return entry;
+   }
+
+   return NULL;
+}
@@ -119,11 +119,44 @@ typedef struct
    size_t count;
 } database_info_list_t;
 
+/* The subset of an entry needed to match scanned content. */
+typedef struct
+{
+   char *name;
+   char *serial;
+   uint32_t crc32;
+} database_info_index_entry_t;
+
+typedef struct database_info_index database_info_index_t;
+
 database_info_list_t *database_info_list_new(const char *rdb_path,
       const char *query);
 
 void database_info_list_free(database_info_list_t *list);
 
+/**
+ * database_info_index_new:
+ * @rdb_path            : Path to database.
+ *
+ * Reads the whole database in a single pass and indexes
+ * its entries by CRC32 and serial, so that any number of
+ * lookups can be answered without querying it again.
+ *
+ * Returns: index handle, or NULL if the database could
+ * not be read.
+ **/
+database_info_index_t *database_info_index_new(const char *rdb_path);
+
+void database_info_index_free(database_info_index_t *index);
+
+/* Return the first entry in database order with the given
+ * CRC32 or serial, or NULL if there is none. */
+const database_info_index_entry_t *database_info_index_find_crc(
+      const database_info_index_t *index, uint32_t crc32);
+
+const database_info_index_entry_t *database_info_index_find_serial(
+      const database_info_index_t *index, const char *serial);
+
 database_info_handle_t *database_info_dir_init(const char *dir,
       enum database_type type);
 
@@ -17,6 +17,7 @@
 
 #include "glslang/glslang/Public/ShaderLang.h"
 #include "GlslangToSpv.h"
+#include "glslang/OGLCompilersDLL/InitializeDll.h"
 #include <vector>
 #include <iostream>
 #include <cstring>
@@ -386,3 +387,15 @@ bool glslang::compile_spirv(const string &source, Stage stage, std::vector<uint3
    return true;
 }
 
+
+void glslang::release_thread()
+{
+   DetachThread();
+}
+
+string glslang::version()
+{
+   string spirv;
+   GetSpirvVersion(spirv);
+   return string(GetGlslVersionString()) + " " + spirv;
+}
@@ -18,6 +18,13 @@ namespace glslang
     };
 
     bool compile_spirv(const std::string &source, Stage stage, std::vector<uint32_t> *spirv);
+
+    // Frees the per-thread compiler pools of the calling thread.
+    void release_thread();
+
+    // Identifies this glslang build, so SPIR-V it compiled can be
+    // told apart from that of another version.
+    std::string version();
 }
 
 #endif
@@ -40,6 +40,7 @@
 #include "core.h"
 #include "core_info.h"
 #include "driver.h"
+#include "performance_counters.h"
 #include "runloop.h"
 #include "verbosity.h"
 
@@ -320,6 +321,7 @@ void drivers_init(int flags)
    {
       struct retro_hw_render_callback *hwr =
          video_driver_get_hw_context();
+      int span = rarch_startup_trace_begin("video init");
 
       video_driver_monitor_reset();
       video_driver_init();
@@ -330,12 +332,15 @@ void drivers_init(int flags)
       video_driver_unset_video_cache_context_ack();
 
       runloop_ctl(RUNLOOP_CTL_SET_FRAME_TIME_LAST, NULL);
+      rarch_startup_trace_end(span);
    }
 
    if (flags & DRIVER_AUDIO_MASK)
    {
+      int span = rarch_startup_trace_begin("audio init");
       audio_driver_init();
       audio_driver_new_devices_list();
+      rarch_startup_trace_end(span);
    }
 
    /* Only initialize camera driver if we're ever going to use it. */
@@ -351,8 +356,13 @@ void drivers_init(int flags)
 #ifdef HAVE_MENU
    if (flags & DRIVER_MENU_MASK)
    {
+      int span = rarch_startup_trace_begin("menu init");
       menu_driver_ctl(RARCH_MENU_CTL_INIT, NULL);
+      rarch_startup_trace_end(span);
+
+      span = rarch_startup_trace_begin("menu context reset");
       menu_driver_ctl(RARCH_MENU_CTL_CONTEXT_RESET, NULL);
+      rarch_startup_trace_end(span);
    }
 #endif
 
@@ -690,6 +690,9 @@ bool init_libretro_sym(enum rarch_core_type type, struct retro_core_t *current_c
  **/
 void uninit_libretro_sym(struct retro_core_t *current_core)
 {
+   /* Performance counters no longer valid, they live in the core. */
+   performance_counters_clear();
+
 #ifdef HAVE_DYNAMIC
    if (lib_handle)
       dylib_close(lib_handle);
@@ -703,9 +706,6 @@ void uninit_libretro_sym(struct retro_core_t *current_core)
    runloop_ctl(RUNLOOP_CTL_FRAME_TIME_FREE, NULL);
    camera_driver_ctl(RARCH_CAMERA_CTL_UNSET_ACTIVE, NULL);
    location_driver_ctl(RARCH_LOCATION_CTL_UNSET_ACTIVE, NULL);
-
-   /* Performance counters no longer valid. */
-   performance_counters_clear();
 }
 
 static void rarch_log_libretro(enum retro_log_level level,
@@ -956,14 +956,19 @@ static void core_performance_counter_start(struct retro_perf_counter *perf)
    if (runloop_ctl(RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL))
    {
       perf->call_cnt++;
+      rarch_perf_trace_event(perf->ident, PERF_TRACE_BEGIN);
       perf->start      = cpu_features_get_perf_counter();
    }
 }
 
 static void core_performance_counter_stop(struct retro_perf_counter *perf)
 {
-   if (runloop_ctl(RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL))
+   if (runloop_ctl(RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL) && perf->start)
+   {
       perf->total += cpu_features_get_perf_counter() - perf->start;
+      perf->start  = 0;
+      rarch_perf_trace_event(perf->ident, PERF_TRACE_END);
+   }
 }
 
 /**
@@ -33,6 +33,7 @@
 
 #include "../driver.h"
 #include "../paths.h"
+#include "../performance_counters.h"
 #include "../retroarch.h"
 
 #ifndef HAVE_MAIN
@@ -51,6 +52,10 @@ void main_exit(void *args)
 {
    settings_t *settings = config_get_ptr();
 
+   /* Tracing enables performance counters, which would
+    * otherwise be saved to the config. */
+   rarch_perf_trace_stop();
+
    if (settings->config_save_on_exit)
       command_event(CMD_EVENT_MENU_SAVE_CURRENT_CONFIG, NULL);
 
@@ -80,6 +85,8 @@ void main_exit(void *args)
    driver_ctl(RARCH_DRIVER_CTL_DEINIT, NULL);
    ui_companion_driver_free();
    frontend_driver_free();
+
+   rarch_perf_trace_deinit();
 }
 
 /**
@@ -96,10 +103,13 @@ void main_exit(void *args)
 int rarch_main(int argc, char *argv[], void *data)
 {
    void *args                      = (void*)data;
+   int span                        = rarch_startup_trace_begin("frontend init");
 
    rarch_ctl(RARCH_CTL_PREINIT, NULL);
    frontend_driver_init_first(args);
    rarch_ctl(RARCH_CTL_INIT, NULL);
+
+   rarch_startup_trace_end(span);
    
    if (frontend_driver_is_inited())
    {
@@ -120,7 +130,9 @@ int rarch_main(int argc, char *argv[], void *data)
          return 1;
    }
 
+   span = rarch_startup_trace_begin("ui companion init");
    ui_companion_driver_init_first();
+   rarch_startup_trace_end(span);
 
 #ifndef HAVE_MAIN
    do
@@ -326,6 +326,9 @@ typedef struct vk
       VkDescriptorSetLayout set_layout;
       VkPipelineLayout layout;
       VkPipelineCache cache;
+      /* Where the pipeline cache blob and compiled slang
+       * SPIR-V are persisted between runs. Empty if disabled. */
+      char cache_dir[PATH_MAX_LENGTH];
    } pipelines;
 
    struct
@@ -391,6 +394,19 @@ typedef struct vk
    } tracker;
 
    void *filter_chain;
+
+   /* Presets applied at runtime are compiled on a worker thread
+    * and swapped in by vulkan_frame once they are ready. */
+   struct
+   {
+      sthread_t *thread;
+      slock_t *lock;
+      struct vulkan_filter_chain_preset *preset;
+      char path[PATH_MAX_LENGTH];
+      /* From video_driver_shader_compile_begin. */
+      unsigned generation;
+      bool done;
+   } shader_compile;
 } vk_t;
 
 uint32_t vulkan_find_memory_type(
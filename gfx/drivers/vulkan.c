@@ -20,6 +20,9 @@
 #include <string.h>
 
 #include <compat/strl.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
 #include <gfx/scaler/scaler.h>
 #include <formats/image.h>
 #include <retro_inline.h>
@@ -49,6 +52,7 @@
 
 #include "../video_context_driver.h"
 #include "../video_coord_array.h"
+#include "../video_shader_driver.h"
 
 static void vulkan_set_viewport(void *data, unsigned viewport_width,
       unsigned viewport_height, bool force_full, bool allow_rotate);
@@ -712,25 +716,32 @@ static void vulkan_deinit_framebuffers(vk_t *vk)
    vkDestroyRenderPass(vk->context->device, vk->render_pass, NULL);
 }
 
+static void vulkan_init_filter_chain_info(vk_t *vk,
+      struct vulkan_filter_chain_create_info *info)
+{
+   memset(info, 0, sizeof(*info));
+
+   info->device                = vk->context->device;
+   info->gpu                   = vk->context->gpu;
+   info->memory_properties     = &vk->context->memory_properties;
+   info->pipeline_cache        = vk->pipelines.cache;
+   info->queue                 = vk->context->queue;
+   info->command_pool          = vk->swapchain[vk->context->current_swapchain_index].cmd_pool;
+   info->max_input_size.width  = vk->tex_w;
+   info->max_input_size.height = vk->tex_h;
+   info->swapchain.viewport    = vk->vk_vp;
+   info->swapchain.format      = vk->context->swapchain_format;
+   info->swapchain.render_pass = vk->render_pass;
+   info->swapchain.num_indices = vk->context->num_swapchain_images;
+   info->original_format       = vk->tex_fmt;
+   info->shader_cache_dir      = vk->pipelines.cache_dir;
+}
+
 static bool vulkan_init_default_filter_chain(vk_t *vk)
 {
    struct vulkan_filter_chain_create_info info;
 
-   memset(&info, 0, sizeof(info));
-
-   info.device                = vk->context->device;
-   info.gpu                   = vk->context->gpu;
-   info.memory_properties     = &vk->context->memory_properties;
-   info.pipeline_cache        = vk->pipelines.cache;
-   info.queue                 = vk->context->queue;
-   info.command_pool          = vk->swapchain[vk->context->current_swapchain_index].cmd_pool;
-   info.max_input_size.width  = vk->tex_w;
-   info.max_input_size.height = vk->tex_h;
-   info.swapchain.viewport    = vk->vk_vp;
-   info.swapchain.format      = vk->context->swapchain_format;
-   info.swapchain.render_pass = vk->render_pass;
-   info.swapchain.num_indices = vk->context->num_swapchain_images;
-   info.original_format       = vk->tex_fmt;
+   vulkan_init_filter_chain_info(vk, &info);
 
    vk->filter_chain           = vulkan_filter_chain_create_default(
          &info,
@@ -750,21 +761,7 @@ static bool vulkan_init_filter_chain_preset(vk_t *vk, const char *shader_path)
 {
    struct vulkan_filter_chain_create_info info;
 
-   memset(&info, 0, sizeof(info));
-
-   info.device                = vk->context->device;
-   info.gpu                   = vk->context->gpu;
-   info.memory_properties     = &vk->context->memory_properties;
-   info.pipeline_cache        = vk->pipelines.cache;
-   info.queue                 = vk->context->queue;
-   info.command_pool          = vk->swapchain[vk->context->current_swapchain_index].cmd_pool;
-   info.max_input_size.width  = vk->tex_w;
-   info.max_input_size.height = vk->tex_h;
-   info.swapchain.viewport    = vk->vk_vp;
-   info.swapchain.format      = vk->context->swapchain_format;
-   info.swapchain.render_pass = vk->render_pass;
-   info.swapchain.num_indices = vk->context->num_swapchain_images;
-   info.original_format       = vk->tex_fmt;
+   vulkan_init_filter_chain_info(vk, &info);
 
    vk->filter_chain           = vulkan_filter_chain_create_from_preset(
          &info, shader_path,
@@ -780,6 +777,112 @@ static bool vulkan_init_filter_chain_preset(vk_t *vk, const char *shader_path)
    return true;
 }
 
+static void vulkan_shader_compile_thread(void *data)
+{
+   vk_t *vk                             = (vk_t*)data;
+   vulkan_filter_chain_preset_t *preset = 
+      vulkan_filter_chain_preset_new(vk->shader_compile.path,
+            vk->pipelines.cache_dir);
+
+   slock_lock(vk->shader_compile.lock);
+   vk->shader_compile.preset = preset;
+   vk->shader_compile.done   = true;
+   slock_unlock(vk->shader_compile.lock);
+}
+
+/* Waits for a pending compile and throws its result away. */
+static void vulkan_shader_compile_cancel(vk_t *vk)
+{
+   if (!vk->shader_compile.thread)
+      return;
+
+   sthread_join(vk->shader_compile.thread);
+   vk->shader_compile.thread = NULL;
+
+   if (vk->shader_compile.preset)
+      vulkan_filter_chain_preset_free(vk->shader_compile.preset);
+   vk->shader_compile.preset = NULL;
+   vk->shader_compile.done   = false;
+}
+
+static bool vulkan_shader_compile_start(vk_t *vk, const char *path)
+{
+   vulkan_shader_compile_cancel(vk);
+
+   if (!vk->shader_compile.lock)
+      vk->shader_compile.lock = slock_new();
+   if (!vk->shader_compile.lock)
+      return false;
+
+   strlcpy(vk->shader_compile.path, path, sizeof(vk->shader_compile.path));
+   vk->shader_compile.done   = false;
+   vk->shader_compile.thread = sthread_create(
+         vulkan_shader_compile_thread, vk);
+
+   return vk->shader_compile.thread != NULL;
+}
+
+/* Called at the start of a frame. Swaps in the new filter chain
+ * if the worker finished; until then the old one keeps rendering. */
+static void vulkan_shader_compile_poll(vk_t *vk)
+{
+   bool done                            = false;
+   vulkan_filter_chain_preset_t *preset = NULL;
+   vulkan_filter_chain_t *chain         = NULL;
+   struct vulkan_filter_chain_create_info info;
+
+   if (!vk->shader_compile.thread)
+      return;
+
+   slock_lock(vk->shader_compile.lock);
+   done = vk->shader_compile.done;
+   slock_unlock(vk->shader_compile.lock);
+
+   if (!done)
+      return;
+
+   sthread_join(vk->shader_compile.thread);
+   vk->shader_compile.thread = NULL;
+   vk->shader_compile.done   = false;
+   preset                    = vk->shader_compile.preset;
+   vk->shader_compile.preset = NULL;
+
+   if (!preset)
+   {
+      RARCH_ERR("[Vulkan]: Failed to compile preset: \"%s\". Keeping current shader.\n",
+            vk->shader_compile.path);
+      video_driver_shader_compile_end(
+            vk->shader_compile.generation, false);
+      return;
+   }
+
+   /* Pipelines are created here, on the video thread, but with
+    * SPIR-V ready and a warm pipeline cache this is quick. */
+   vulkan_init_filter_chain_info(vk, &info);
+   chain = vulkan_filter_chain_create_from_compiled(&info, preset,
+         vk->video.smooth ?
+         VULKAN_FILTER_CHAIN_LINEAR : VULKAN_FILTER_CHAIN_NEAREST);
+
+   if (!chain)
+   {
+      RARCH_ERR("[Vulkan]: Failed to create preset: \"%s\". Keeping current shader.\n",
+            vk->shader_compile.path);
+      video_driver_shader_compile_end(
+            vk->shader_compile.generation, false);
+      return;
+   }
+
+   /* Previous frames may still reference the old chain. */
+   vkQueueWaitIdle(vk->context->queue);
+
+   if (vk->filter_chain)
+      vulkan_filter_chain_free((vulkan_filter_chain_t*)vk->filter_chain);
+   vk->filter_chain = chain;
+   video_driver_shader_compile_end(vk->shader_compile.generation, true);
+
+   RARCH_LOG("[Vulkan]: Switched to preset \"%s\".\n", vk->shader_compile.path);
+}
+
 static bool vulkan_init_filter_chain(vk_t *vk)
 {
    settings_t *settings = config_get_ptr();
@@ -817,18 +920,127 @@ static void vulkan_init_resources(vk_t *vk)
    vulkan_init_command_buffers(vk);
 }
 
+#define VULKAN_PIPELINE_CACHE_FILE "vulkan_pipeline_cache.bin"
+
+/* The driver rejects blobs from another device or driver build,
+ * but not all of them do so gracefully, so check the header
+ * ourselves before handing the data over. */
+static bool vulkan_pipeline_cache_is_valid(vk_t *vk,
+      const uint8_t *data, ssize_t len)
+{
+   uint32_t header[4];
+   const VkPhysicalDeviceProperties *props = &vk->context->gpu_properties;
+
+   if (len < (ssize_t)(sizeof(header) + VK_UUID_SIZE))
+      return false;
+
+   memcpy(header, data, sizeof(header));
+
+   if (header[0] < sizeof(header) + VK_UUID_SIZE)
+      return false;
+   if (header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+      return false;
+   if (header[2] != props->vendorID || header[3] != props->deviceID)
+      return false;
+
+   return memcmp(data + sizeof(header),
+         props->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+static void vulkan_save_pipeline_cache(vk_t *vk)
+{
+   char path[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH + 4];
+   size_t size = 0;
+   void *data  = NULL;
+
+   if (string_is_empty(vk->pipelines.cache_dir))
+      return;
+
+   if (vkGetPipelineCacheData(vk->context->device,
+            vk->pipelines.cache, &size, NULL) != VK_SUCCESS || !size)
+      return;
+
+   data = malloc(size);
+   if (!data)
+      return;
+
+   if (vkGetPipelineCacheData(vk->context->device,
+            vk->pipelines.cache, &size, data) != VK_SUCCESS)
+      goto end;
+
+   fill_pathname_join(path, vk->pipelines.cache_dir,
+         VULKAN_PIPELINE_CACHE_FILE, sizeof(path));
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+   /* Write to a temporary file first so a crash mid-write
+    * cannot leave a truncated blob behind. */
+   if (filestream_write_file(tmp_path, data, size))
+   {
+      remove(path);
+      if (rename(tmp_path, path) == 0)
+         RARCH_LOG("[Vulkan]: Saved pipeline cache (%u bytes) to \"%s\".\n",
+               (unsigned)size, path);
+      else
+         remove(tmp_path);
+   }
+
+end:
+   free(data);
+}
+
 static void vulkan_init_static_resources(vk_t *vk)
 {
    unsigned i;
    uint32_t blank[4 * 4];
+   char cache_path[PATH_MAX_LENGTH];
+   void *cache_data                  = NULL;
+   ssize_t cache_len                 = 0;
    VkCommandPoolCreateInfo pool_info = { 
       VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
    /* Create the pipeline cache. */
    VkPipelineCacheCreateInfo cache   = { 
       VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
 
-   vkCreatePipelineCache(vk->context->device,
-         &cache, NULL, &vk->pipelines.cache);
+   cache_path[0] = '\0';
+
+   video_shader_driver_get_cache_dir(vk->pipelines.cache_dir,
+         sizeof(vk->pipelines.cache_dir));
+
+   /* Seed the pipeline cache with the blob from the previous run. */
+   if (!string_is_empty(vk->pipelines.cache_dir))
+   {
+      fill_pathname_join(cache_path, vk->pipelines.cache_dir,
+            VULKAN_PIPELINE_CACHE_FILE, sizeof(cache_path));
+
+      if (path_file_exists(cache_path) &&
+            filestream_read_file(cache_path, &cache_data, &cache_len))
+      {
+         if (vulkan_pipeline_cache_is_valid(vk,
+                  (const uint8_t*)cache_data, cache_len))
+         {
+            cache.initialDataSize = cache_len;
+            cache.pInitialData    = cache_data;
+         }
+         else
+            RARCH_WARN("[Vulkan]: Discarding stale pipeline cache \"%s\".\n",
+                  cache_path);
+      }
+   }
+
+   if (vkCreatePipelineCache(vk->context->device,
+         &cache, NULL, &vk->pipelines.cache) != VK_SUCCESS
+         && cache.pInitialData)
+   {
+      cache.initialDataSize = 0;
+      cache.pInitialData    = NULL;
+      vkCreatePipelineCache(vk->context->device,
+            &cache, NULL, &vk->pipelines.cache);
+   }
+   else if (cache.pInitialData)
+      RARCH_LOG("[Vulkan]: Loaded pipeline cache from \"%s\".\n", cache_path);
+
+   free(cache_data);
 
    pool_info.queueFamilyIndex = vk->context->graphics_queue_index;
 
@@ -846,6 +1058,7 @@ static void vulkan_init_static_resources(vk_t *vk)
 static void vulkan_deinit_static_resources(vk_t *vk)
 {
    unsigned i;
+   vulkan_save_pipeline_cache(vk);
    vkDestroyPipelineCache(vk->context->device,
          vk->pipelines.cache, NULL);
    vulkan_destroy_texture(
@@ -904,6 +1117,10 @@ static void vulkan_free(void *data)
 
       font_driver_free_osd();
 
+      vulkan_shader_compile_cancel(vk);
+      if (vk->shader_compile.lock)
+         slock_free(vk->shader_compile.lock);
+
       vulkan_deinit_static_resources(vk);
       vulkan_overlay_free(vk);
 
@@ -1289,6 +1506,16 @@ static bool vulkan_set_shader(void *data,
       path = NULL;
    }
 
+   /* Compile in the background and keep rendering with the current
+    * chain; vulkan_frame swaps the new one in once it is ready. */
+   if (path && vk->filter_chain && vulkan_shader_compile_start(vk, path))
+   {
+      vk->shader_compile.generation = video_driver_shader_compile_begin();
+      return true;
+   }
+
+   vulkan_shader_compile_cancel(vk);
+
    if (vk->filter_chain)
       vulkan_filter_chain_free((vulkan_filter_chain_t*)vk->filter_chain);
    vk->filter_chain = NULL;
@@ -1611,6 +1838,8 @@ static bool vulkan_frame(void *data, const void *frame,
 
    performance_counter_start_plus(video_info->is_perfcnt_enable, frame_run);
 
+   vulkan_shader_compile_poll(vk);
+
    /* Bookkeeping on start of frame. */
    chain     = &vk->swapchain[frame_index];
    vk->chain = chain;
@@ -190,8 +190,11 @@ static bool font_renderer_create_atlas(ft_font_renderer_t *handle, float font_si
       }
    }
 
+   /* Control characters are never drawn, they are still
+    * rendered on demand should anything ask for them. */
    for (i = 0; i < 256; i++)
-      font_renderer_ft_get_glyph(handle, i);
+      if ((i >= 0x20 && i < 0x7f) || i >= 0xa0)
+         font_renderer_ft_get_glyph(handle, i);
 
    for (i = 0; i < 256; i++)
       if(isalnum(i))
@@ -363,11 +363,156 @@ bool glslang_parse_meta(const vector<string> &lines, glslang_meta *meta)
    return true;
 }
 
-bool glslang_compile_shader(const char *shader_path, glslang_output *output)
+/* On-disk SPIR-V cache.
+ *
+ * Entries are keyed by a hash over both fully preprocessed
+ * stage sources (includes resolved, #line directives and
+ * stage selection applied) and the glslang version, so
+ * editing any included file or upgrading glslang invalidates
+ * the entry. Bump the version whenever the compile options
+ * change. */
+#define SLANG_CACHE_MAGIC   0x43565053u /* "SPVC" */
+#define SLANG_CACHE_VERSION 1u
+#define SPIRV_MAGIC         0x07230203u
+
+struct slang_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint64_t hash;
+   uint32_t vertex_words;
+   uint32_t fragment_words;
+};
+
+static uint64_t slang_cache_hash(const string &vertex, const string &fragment)
+{
+   /* 64-bit FNV-1a. */
+   uint64_t hash         = 0xcbf29ce484222325ull;
+   const string compiler = glslang::version();
+   const string *src[]   = { &vertex, &fragment, &compiler };
+
+   for (unsigned i = 0; i < 3; i++)
+   {
+      for (unsigned char c : *src[i])
+      {
+         hash ^= c;
+         hash *= 0x100000001b3ull;
+      }
+
+      /* Separate the inputs so moving code between them changes the key. */
+      hash ^= 0xff;
+      hash *= 0x100000001b3ull;
+   }
+
+   hash ^= SLANG_CACHE_VERSION;
+   hash *= 0x100000001b3ull;
+   return hash;
+}
+
+static void slang_cache_path(char *s, size_t len,
+      const char *cache_dir, uint64_t hash)
+{
+   char dir[PATH_MAX_LENGTH];
+   char name[32];
+
+   fill_pathname_join(dir, cache_dir, "slang", sizeof(dir));
+   snprintf(name, sizeof(name), "%016llx.spv", (unsigned long long)hash);
+   fill_pathname_join(s, dir, name, len);
+}
+
+static bool slang_cache_load(const char *path, uint64_t hash,
+      glslang_output *output)
+{
+   slang_cache_header header;
+   void *buf    = NULL;
+   ssize_t len  = 0;
+   bool ret     = false;
+   const uint8_t *data;
+
+   if (!path_file_exists(path) || !filestream_read_file(path, &buf, &len))
+      return false;
+
+   data = (const uint8_t*)buf;
+
+   if (len < (ssize_t)sizeof(header))
+      goto end;
+
+   memcpy(&header, data, sizeof(header));
+
+   if (     header.magic   != SLANG_CACHE_MAGIC
+         || header.version != SLANG_CACHE_VERSION
+         || header.hash    != hash
+         || !header.vertex_words
+         || !header.fragment_words
+         || (size_t)len != sizeof(header) + 
+            ((size_t)header.vertex_words + header.fragment_words) * sizeof(uint32_t))
+      goto end;
+
+   data += sizeof(header);
+   output->vertex.resize(header.vertex_words);
+   memcpy(output->vertex.data(), data, header.vertex_words * sizeof(uint32_t));
+   data += header.vertex_words * sizeof(uint32_t);
+   output->fragment.resize(header.fragment_words);
+   memcpy(output->fragment.data(), data, header.fragment_words * sizeof(uint32_t));
+
+   ret = output->vertex[0] == SPIRV_MAGIC && output->fragment[0] == SPIRV_MAGIC;
+
+   if (!ret)
+   {
+      output->vertex.clear();
+      output->fragment.clear();
+   }
+
+end:
+   free(buf);
+   return ret;
+}
+
+static void slang_cache_store(const char *path, uint64_t hash,
+      const glslang_output *output)
+{
+   char dir[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   slang_cache_header header;
+   vector<uint8_t> blob;
+   size_t vertex_size   = output->vertex.size()   * sizeof(uint32_t);
+   size_t fragment_size = output->fragment.size() * sizeof(uint32_t);
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   if (!path_mkdir(dir))
+      return;
+
+   header.magic          = SLANG_CACHE_MAGIC;
+   header.version        = SLANG_CACHE_VERSION;
+   header.hash           = hash;
+   header.vertex_words   = (uint32_t)output->vertex.size();
+   header.fragment_words = (uint32_t)output->fragment.size();
+
+   blob.resize(sizeof(header) + vertex_size + fragment_size);
+   memcpy(blob.data(), &header, sizeof(header));
+   memcpy(blob.data() + sizeof(header), output->vertex.data(), vertex_size);
+   memcpy(blob.data() + sizeof(header) + vertex_size,
+         output->fragment.data(), fragment_size);
+
+   /* Write to a temporary file and rename so concurrent
+    * instances never observe a partially written entry. */
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+   if (!filestream_write_file(tmp_path, blob.data(), blob.size()))
+      return;
+
+   remove(path);
+   if (rename(tmp_path, path) != 0)
+      remove(tmp_path);
+}
+
+bool glslang_compile_shader(const char *shader_path,
+      const char *cache_dir, glslang_output *output)
 {
+   char cache_path[PATH_MAX_LENGTH];
    vector<string> lines;
+   uint64_t hash = 0;
 
-   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
+   cache_path[0] = '\0';
 
    if (!glslang_read_shader_file(shader_path, &lines, true))
       return false;
@@ -375,20 +520,44 @@ bool glslang_compile_shader(const char *shader_path, glslang_output *output)
    if (!glslang_parse_meta(lines, &output->meta))
       return false;
 
-   if (    !glslang::compile_spirv(build_stage_source(lines, "vertex"),
+   string vertex_source   = build_stage_source(lines, "vertex");
+   string fragment_source = build_stage_source(lines, "fragment");
+
+   if (cache_dir && *cache_dir)
+   {
+      hash = slang_cache_hash(vertex_source, fragment_source);
+      slang_cache_path(cache_path, sizeof(cache_path), cache_dir, hash);
+
+      if (slang_cache_load(cache_path, hash, output))
+      {
+         RARCH_LOG("[slang]: Using cached SPIR-V for \"%s\".\n", shader_path);
+         return true;
+      }
+   }
+
+   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
+
+   if (    !glslang::compile_spirv(vertex_source,
             glslang::StageVertex, &output->vertex))
    {
       RARCH_ERR("Failed to compile vertex shader stage.\n");
       return false;
    }
 
-   if (    !glslang::compile_spirv(build_stage_source(lines, "fragment"),
+   if (    !glslang::compile_spirv(fragment_source,
             glslang::StageFragment, &output->fragment))
    {
       RARCH_ERR("Failed to compile fragment shader stage.\n");
       return false;
    }
 
+   if (*cache_path)
+      slang_cache_store(cache_path, hash, output);
+
    return true;
 }
 
+void glslang_release_thread(void)
+{
+   glslang::release_thread();
+}
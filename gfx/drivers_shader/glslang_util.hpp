@@ -87,9 +87,15 @@ struct glslang_output
    glslang_meta meta;
 };
 
-bool glslang_compile_shader(const char *shader_path, glslang_output *output);
+/* If cache_dir is non-empty, compiled SPIR-V is looked up in and
+ * stored to a cache below it, keyed on the preprocessed source. */
+bool glslang_compile_shader(const char *shader_path,
+      const char *cache_dir, glslang_output *output);
 const char *glslang_format_to_string(enum glslang_format fmt);
 
+/* Call before a thread that compiled shaders exits. */
+void glslang_release_thread(void);
+
 // Helpers for internal use.
 bool glslang_read_shader_file(const char *path, std::vector<std::string> *output, bool root_file);
 bool glslang_parse_meta(const std::vector<std::string> &lines, glslang_meta *meta);
@@ -21,6 +21,7 @@
 #include <compat/posix_string.h>
 #include <file/file_path.h>
 #include <retro_assert.h>
+#include <rhash.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
 
@@ -39,6 +40,22 @@
 
 #define PREV_TEXTURES (GFX_MAX_TEXTURES - 1)
 
+#if defined(GL_PROGRAM_BINARY_LENGTH) && defined(GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+#define HAVE_GLSL_PROGRAM_BINARY
+
+/* Bump whenever the way sources are assembled changes. */
+#define GLSL_BINARY_CACHE_MAGIC   0x42534c47u /* "GLSB" */
+#define GLSL_BINARY_CACHE_VERSION 1u
+
+struct glsl_binary_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t format;
+   uint32_t size;
+};
+#endif
+
 /* Cache the VBO. */
 struct cache_vbo
 {
@@ -147,6 +164,9 @@ typedef struct glsl_shader_data
    struct shader_program_glsl_data prg[GFX_MAX_SHADERS];
    GLuint lut_textures[GFX_MAX_TEXTURES];
    state_tracker_t *state_tracker;
+
+   /* Where linked program binaries are cached, empty if unsupported. */
+   char binary_cache_dir[PATH_MAX_LENGTH];
 } glsl_shader_data_t;
 
 static bool glsl_core;
@@ -316,6 +336,133 @@ static bool gl_glsl_link_program(GLuint prog)
 }
 
 
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+/* Program binaries are only valid for the exact driver that
+ * produced them, so the key covers the driver identification
+ * strings on top of everything fed to glShaderSource. */
+static void gl_glsl_binary_cache_path(glsl_shader_data_t *glsl,
+      struct shader_program_info *program_info,
+      char *s, size_t len)
+{
+   unsigned i;
+   MD5_CTX ctx;
+   char context[64];
+   char name[2 * 16 + 5];
+   unsigned char digest[16];
+   const char *strings[7];
+
+   snprintf(context, sizeof(context), "%u %u.%u %u",
+         glsl_core, glsl_major, glsl_minor, GLSL_BINARY_CACHE_VERSION);
+
+   strings[0] = (const char*)glGetString(GL_VENDOR);
+   strings[1] = (const char*)glGetString(GL_RENDERER);
+   strings[2] = (const char*)glGetString(GL_VERSION);
+   strings[3] = context;
+   strings[4] = glsl->alias_define;
+   strings[5] = program_info->vertex;
+   strings[6] = program_info->fragment;
+
+   MD5_Init(&ctx);
+   for (i = 0; i < ARRAY_SIZE(strings); i++)
+   {
+      /* Include the terminator so adjacent strings cannot alias. */
+      if (strings[i])
+         MD5_Update(&ctx, strings[i], strlen(strings[i]) + 1);
+      else
+         MD5_Update(&ctx, "", 1);
+   }
+   MD5_Final(digest, &ctx);
+
+   for (i = 0; i < 16; i++)
+      snprintf(name + 2 * i, 3, "%02x", digest[i]);
+   strlcat(name, ".bin", sizeof(name));
+
+   fill_pathname_join(s, glsl->binary_cache_dir, name, len);
+}
+
+static bool gl_glsl_load_program_binary(GLuint prog, const char *path)
+{
+   GLint status                      = GL_FALSE;
+   struct glsl_binary_header header;
+   void *buf                         = NULL;
+   ssize_t len                       = 0;
+
+   if (!path_file_exists(path) || !filestream_read_file(path, &buf, &len))
+      return false;
+
+   if (len < (ssize_t)sizeof(header))
+      goto error;
+
+   memcpy(&header, buf, sizeof(header));
+
+   if (     header.magic   != GLSL_BINARY_CACHE_MAGIC
+         || header.version != GLSL_BINARY_CACHE_VERSION
+         || header.size    != (size_t)len - sizeof(header))
+      goto error;
+
+   glProgramBinary(prog, header.format,
+         (const uint8_t*)buf + sizeof(header), header.size);
+   glGetProgramiv(prog, GL_LINK_STATUS, &status);
+
+   if (status != GL_TRUE)
+      goto error;
+
+   free(buf);
+   return true;
+
+error:
+   /* Driver updates invalidate binaries, don't keep retrying. */
+   RARCH_WARN("[GLSL]: Discarding stale program binary \"%s\".\n", path);
+   free(buf);
+   remove(path);
+   return false;
+}
+
+static void gl_glsl_save_program_binary(GLuint prog, const char *path)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   char dir[PATH_MAX_LENGTH];
+   struct glsl_binary_header header;
+   GLint size      = 0;
+   GLsizei written = 0;
+   GLenum format   = 0;
+   uint8_t *buf    = NULL;
+
+   glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &size);
+   if (size <= 0)
+      return;
+
+   buf = (uint8_t*)malloc(sizeof(header) + size);
+   if (!buf)
+      return;
+
+   glGetProgramBinary(prog, size, &written, &format, buf + sizeof(header));
+   if (written <= 0)
+      goto end;
+
+   header.magic   = GLSL_BINARY_CACHE_MAGIC;
+   header.version = GLSL_BINARY_CACHE_VERSION;
+   header.format  = format;
+   header.size    = written;
+   memcpy(buf, &header, sizeof(header));
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   if (!path_mkdir(dir))
+      goto end;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+   if (filestream_write_file(tmp_path, buf, sizeof(header) + written))
+   {
+      remove(path);
+      if (rename(tmp_path, path) != 0)
+         remove(tmp_path);
+   }
+
+end:
+   free(buf);
+}
+#endif
+
 static bool gl_glsl_compile_program(
       void *data,
       unsigned idx,
@@ -325,6 +472,11 @@ static bool gl_glsl_compile_program(
    glsl_shader_data_t *glsl = (glsl_shader_data_t*)data;
    struct shader_program_glsl_data *program = (struct shader_program_glsl_data*)program_data;
    GLuint prog = glCreateProgram();
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+   char binary_path[PATH_MAX_LENGTH];
+
+   binary_path[0] = '\0';
+#endif
 
    if (!program)
       program = &glsl->prg[idx];
@@ -332,6 +484,37 @@ static bool gl_glsl_compile_program(
    if (!prog)
       goto error;
 
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+   if (*glsl->binary_cache_dir && 
+         (program_info->vertex || program_info->fragment))
+   {
+      gl_glsl_binary_cache_path(glsl, program_info,
+            binary_path, sizeof(binary_path));
+
+      if (gl_glsl_load_program_binary(prog, binary_path))
+      {
+         RARCH_LOG("[GLSL]: Using cached program binary for #%u.\n", idx);
+         program->vprg = 0;
+         program->fprg = 0;
+
+         glUseProgram(prog);
+         glUniform1i(gl_glsl_get_uniform(glsl, prog, "Texture"), 0);
+         glUseProgram(0);
+
+         program->id = prog;
+         return true;
+      }
+
+      /* Start over with a clean program object after a failed load. */
+      glDeleteProgram(prog);
+      prog = glCreateProgram();
+      if (!prog)
+         goto error;
+
+      glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+   }
+#endif
+
    if (program_info->vertex)
    {
       RARCH_LOG("[GLSL]: Found GLSL vertex shader.\n");
@@ -369,6 +552,11 @@ static bool gl_glsl_compile_program(
       if (!gl_glsl_link_program(prog))
          goto error;
 
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+      if (*binary_path)
+         gl_glsl_save_program_binary(prog, binary_path);
+#endif
+
       /* Clean up dead memory. We're not going to relink the program.
        * Detaching first seems to kill some mobile drivers
        * (according to the intertubes anyways). */
@@ -828,6 +1016,17 @@ static void *gl_glsl_init(void *data, const char *path)
    }
 #endif
 
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+   if (gl_check_capability(GL_CAPS_PROGRAM_BINARY))
+   {
+      char cache_dir[PATH_MAX_LENGTH];
+
+      if (video_shader_driver_get_cache_dir(cache_dir, sizeof(cache_dir)))
+         fill_pathname_join(glsl->binary_cache_dir, cache_dir, "glsl",
+               sizeof(glsl->binary_cache_dir));
+   }
+#endif
+
    /* Find all aliases we use in our GLSLP and add #defines for them so
     * that a shader can choose a fallback if we are not using a preset. */
    *glsl->alias_define = '\0';
@@ -25,7 +25,9 @@
 #include <math.h>
 
 #include <compat/strl.h>
+#include <features/features_cpu.h>
 #include <formats/image.h>
+#include <rthreads/rthreads.h>
 
 #include "slang_reflection.hpp"
 
@@ -254,6 +256,29 @@ class StaticTexture
       Texture texture;
 };
 
+// Device memory backing one or more framebuffers.
+struct FramebufferMemory
+{
+   FramebufferMemory(VkDevice device) : device(device) {}
+   ~FramebufferMemory()
+   {
+      if (memory != VK_NULL_HANDLE)
+         vkFreeMemory(device, memory, nullptr);
+   }
+
+   VkDevice device;
+   VkDeviceMemory memory = VK_NULL_HANDLE;
+   size_t size = 0;
+   uint32_t type = 0;
+};
+
+// Framebuffers sharing an alias never hold live contents at the same
+// time within a frame, so they can all be bound to the same memory.
+struct FramebufferAlias
+{
+   shared_ptr<FramebufferMemory> memory;
+};
+
 class Framebuffer
 {
    public:
@@ -279,6 +304,9 @@ class Framebuffer
       unsigned get_levels() const { return levels; }
       void generate_mips(VkCommandBuffer cmd);
 
+      // Only call while the device is idle.
+      void set_alias(shared_ptr<FramebufferAlias> alias);
+
    private:
       VkDevice device = VK_NULL_HANDLE;
       const VkPhysicalDeviceMemoryProperties &memory_properties;
@@ -293,14 +321,11 @@ class Framebuffer
       VkFramebuffer framebuffer = VK_NULL_HANDLE;
       VkRenderPass render_pass = VK_NULL_HANDLE;
 
-      struct
-      {
-         size_t size = 0;
-         uint32_t type = 0;
-         VkDeviceMemory memory = VK_NULL_HANDLE;
-      } memory;
+      shared_ptr<FramebufferMemory> memory;
+      shared_ptr<FramebufferAlias> alias;
 
       void init(DeferredDisposer *disposer);
+      void destroy_image();
       void init_framebuffer();
       void init_render_pass();
 };
@@ -360,6 +385,12 @@ class Pass
          return framebuffer_feedback.get();
       }
 
+      void set_framebuffer_alias(shared_ptr<FramebufferAlias> alias)
+      {
+         if (framebuffer)
+            framebuffer->set_alias(move(alias));
+      }
+
       Size2D set_pass_info(
             const Size2D &max_original,
             const Size2D &max_source,
@@ -600,6 +631,7 @@ struct vulkan_filter_chain
       bool init_history();
       bool init_feedback();
       bool init_alias();
+      void init_framebuffer_aliases();
       void update_history(DeferredDisposer &disposer, VkCommandBuffer cmd);
       vector<unique_ptr<Framebuffer>> original_history;
       bool require_clear = false;
@@ -982,10 +1014,80 @@ bool vulkan_filter_chain::init()
       return false;
    if (!init_feedback())
       return false;
+   init_framebuffer_aliases();
    common.pass_outputs.resize(passes.size());
    return true;
 }
 
+// Works out for how long within a frame each pass output is needed
+// and lets outputs whose lifetimes do not overlap share memory.
+// Every pass transitions its framebuffer from UNDEFINED after all
+// previous graphics work, which is what makes the aliasing safe.
+void vulkan_filter_chain::init_framebuffer_aliases()
+{
+   struct Slot
+   {
+      shared_ptr<FramebufferAlias> alias;
+      VkFormat format;
+      unsigned last_use;
+   };
+
+   unsigned i, j;
+   unsigned aliased     = 0;
+   // The final pass renders straight to the backbuffer.
+   unsigned num_outputs = passes.size() - 1;
+   vector<unsigned> last_use(num_outputs);
+   vector<Slot> slots;
+
+   // Every output is at least read as Source by the next pass.
+   for (i = 0; i < num_outputs; i++)
+      last_use[i] = i + 1;
+
+   for (j = 0; j < passes.size(); j++)
+   {
+      auto &outputs = passes[j]->get_reflection().
+         semantic_textures[SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT];
+
+      for (i = 0; i < outputs.size() && i < num_outputs; i++)
+         if (outputs[i].texture)
+            last_use[i] = max(last_use[i], j);
+   }
+
+   for (i = 0; i < num_outputs; i++)
+   {
+      Slot *slot = nullptr;
+
+      // Feedback outputs are read again next frame.
+      if (passes[i]->get_feedback_framebuffer())
+         continue;
+
+      for (auto &s : slots)
+      {
+         if (s.format == pass_info[i].rt_format && s.last_use < i)
+         {
+            slot = &s;
+            break;
+         }
+      }
+
+      if (slot)
+         aliased++;
+      else
+      {
+         slots.push_back({ make_shared<FramebufferAlias>(),
+               pass_info[i].rt_format, 0 });
+         slot = &slots.back();
+      }
+
+      slot->last_use = last_use[i];
+      passes[i]->set_framebuffer_alias(slot->alias);
+   }
+
+   if (aliased)
+      RARCH_LOG("[Vulkan filter chain]: %u pass outputs share memory, using %u framebuffer allocations.\n",
+            aliased, unsigned(slots.size()));
+}
+
 void vulkan_filter_chain::clear_history_and_feedback(VkCommandBuffer cmd)
 {
    for (auto &texture : original_history)
@@ -2384,25 +2486,33 @@ void Framebuffer::init(DeferredDisposer *disposer)
          memory_properties, mem_reqs.memoryTypeBits,
          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-   // Can reuse already allocated memory.
-   if (memory.size < mem_reqs.size || memory.type != alloc.memoryTypeIndex)
+   // Can reuse already allocated memory, possibly the memory
+   // of another framebuffer we are aliased with.
+   auto target = alias ? alias->memory : memory;
+
+   if (!target || target->size < mem_reqs.size || 
+         target->type != alloc.memoryTypeIndex)
    {
-      // Memory might still be in use since we don't want to totally stall
-      // the world for framebuffer recreation.
-      if (memory.memory != VK_NULL_HANDLE && disposer)
-      {
-         auto d = device;
-         auto m = memory.memory;
-         disposer->defer([=] { vkFreeMemory(d, m, nullptr); });
-      }
+      target.reset(new FramebufferMemory(device));
+      target->type = alloc.memoryTypeIndex;
+      target->size = mem_reqs.size;
 
-      memory.type = alloc.memoryTypeIndex;
-      memory.size = mem_reqs.size;
+      vkAllocateMemory(device, &alloc, nullptr, &target->memory);
 
-      vkAllocateMemory(device, &alloc, nullptr, &memory.memory);
+      if (alias)
+         alias->memory = target;
    }
 
-   vkBindImageMemory(device, image, memory.memory, 0);
+   // Memory might still be in use since we don't want to totally stall
+   // the world for framebuffer recreation.
+   if (memory && memory != target && disposer)
+   {
+      auto m = memory;
+      disposer->defer([=] { (void)m; });
+   }
+
+   memory = target;
+   vkBindImageMemory(device, image, memory->memory, 0);
 
    VkImageViewCreateInfo view_info           = { 
       VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
@@ -2509,20 +2619,39 @@ void Framebuffer::set_size(DeferredDisposer &disposer, const Size2D &size)
    init(&disposer);
 }
 
-Framebuffer::~Framebuffer()
+void Framebuffer::destroy_image()
 {
    if (framebuffer != VK_NULL_HANDLE)
       vkDestroyFramebuffer(device, framebuffer, nullptr);
-   if (render_pass != VK_NULL_HANDLE)
-      vkDestroyRenderPass(device, render_pass, nullptr);
    if (view != VK_NULL_HANDLE)
       vkDestroyImageView(device, view, nullptr);
    if (fb_view != VK_NULL_HANDLE)
       vkDestroyImageView(device, fb_view, nullptr);
    if (image != VK_NULL_HANDLE)
       vkDestroyImage(device, image, nullptr);
-   if (memory.memory != VK_NULL_HANDLE)
-      vkFreeMemory(device, memory.memory, nullptr);
+
+   framebuffer = VK_NULL_HANDLE;
+   view        = VK_NULL_HANDLE;
+   fb_view     = VK_NULL_HANDLE;
+   image       = VK_NULL_HANDLE;
+}
+
+void Framebuffer::set_alias(shared_ptr<FramebufferAlias> alias)
+{
+   this->alias = move(alias);
+
+   // Rebind to the shared memory, dropping our own allocation
+   // unless it becomes the shared one.
+   destroy_image();
+   memory.reset();
+   init(nullptr);
+}
+
+Framebuffer::~Framebuffer()
+{
+   destroy_image();
+   if (render_pass != VK_NULL_HANDLE)
+      vkDestroyRenderPass(device, render_pass, nullptr);
 }
 
 // C glue
@@ -2843,22 +2972,148 @@ error:
    return false;
 }
 
+struct vulkan_filter_chain_preset
+{
+   unique_ptr<video_shader> shader;
+   unique_ptr<config_file_t, ConfigDeleter> conf;
+   vector<glslang_output> outputs;
+};
+
+#define SLANG_MAX_COMPILE_THREADS 8
+
+struct slang_compile_job
+{
+   const video_shader *shader;
+   const char *cache_dir;
+   glslang_output *outputs;
+   slock_t *lock;
+   unsigned next_pass;
+   bool failed;
+};
+
+/* Pulls passes off the job until all are compiled or
+ * one of them fails. Passes are independent, so the
+ * order in which workers finish them does not matter. */
+static void slang_compile_passes(slang_compile_job *job)
+{
+   for (;;)
+   {
+      unsigned i;
+      bool stop;
+
+      slock_lock(job->lock);
+      i    = job->next_pass++;
+      stop = job->failed || i >= job->shader->passes;
+      slock_unlock(job->lock);
+
+      if (stop)
+         break;
+
+      if (!glslang_compile_shader(job->shader->pass[i].source.path,
+               job->cache_dir, &job->outputs[i]))
+      {
+         RARCH_ERR("Failed to compile shader: \"%s\".\n",
+               job->shader->pass[i].source.path);
+
+         slock_lock(job->lock);
+         job->failed = true;
+         slock_unlock(job->lock);
+      }
+   }
+}
+
+static void slang_compile_thread(void *data)
+{
+   slang_compile_passes((slang_compile_job*)data);
+   glslang_release_thread();
+}
+
+vulkan_filter_chain_preset_t *vulkan_filter_chain_preset_new(
+      const char *path, const char *cache_dir)
+{
+   unsigned i;
+   unsigned num_threads = 0;
+   sthread_t *threads[SLANG_MAX_COMPILE_THREADS];
+   slang_compile_job job;
+   unique_ptr<vulkan_filter_chain_preset> preset{ new vulkan_filter_chain_preset() };
+
+   preset->shader.reset(new video_shader());
+   preset->conf.reset(config_file_new(path));
+   if (!preset->conf)
+      return nullptr;
+
+   if (!video_shader_read_conf_cgp(preset->conf.get(), preset->shader.get()))
+      return nullptr;
+
+   video_shader_resolve_relative(preset->shader.get(), path);
+
+   preset->outputs.resize(preset->shader->passes);
+
+   job.shader    = preset->shader.get();
+   job.cache_dir = cache_dir;
+   job.outputs   = preset->outputs.data();
+   job.lock      = slock_new();
+   job.next_pass = 0;
+   job.failed    = false;
+
+   if (!job.lock)
+      return nullptr;
+
+   /* Compile on dedicated workers only. glslang keeps per-thread
+    * state which we can only release on threads that are about to
+    * exit, not on the long-lived video thread calling us. */
+   unsigned wanted = MIN(cpu_features_get_core_amount(),
+         preset->shader->passes);
+   wanted          = MIN(wanted, SLANG_MAX_COMPILE_THREADS);
+
+   for (i = 0; i < wanted; i++)
+   {
+      threads[num_threads] = sthread_create(slang_compile_thread, &job);
+      if (!threads[num_threads])
+         break;
+      num_threads++;
+   }
+
+   if (!num_threads)
+      slang_compile_passes(&job);
+
+   for (i = 0; i < num_threads; i++)
+      sthread_join(threads[i]);
+
+   slock_free(job.lock);
+
+   if (job.failed)
+      return nullptr;
+
+   return preset.release();
+}
+
+void vulkan_filter_chain_preset_free(vulkan_filter_chain_preset_t *preset)
+{
+   delete preset;
+}
+
 vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       const struct vulkan_filter_chain_create_info *info,
       const char *path, vulkan_filter_chain_filter filter)
 {
-   unique_ptr<video_shader> shader{ new video_shader() };
-   if (!shader)
-      return nullptr;
+   vulkan_filter_chain_preset_t *preset = 
+      vulkan_filter_chain_preset_new(path, info->shader_cache_dir);
 
-   unique_ptr<config_file_t, ConfigDeleter> conf{ config_file_new(path) };
-   if (!conf)
+   if (!preset)
       return nullptr;
 
-   if (!video_shader_read_conf_cgp(conf.get(), shader.get()))
-      return nullptr;
+   return vulkan_filter_chain_create_from_compiled(info, preset, filter);
+}
 
-   video_shader_resolve_relative(shader.get(), path);
+vulkan_filter_chain_t *vulkan_filter_chain_create_from_compiled(
+      const struct vulkan_filter_chain_create_info *info,
+      vulkan_filter_chain_preset_t *compiled,
+      vulkan_filter_chain_filter filter)
+{
+   unique_ptr<vulkan_filter_chain_preset> preset{ compiled };
+   unique_ptr<video_shader> shader{ move(preset->shader) };
+   unique_ptr<config_file_t, ConfigDeleter> conf{ move(preset->conf) };
 
    bool last_pass_is_fbo = shader->pass[shader->passes - 1].fbo.valid;
    auto tmpinfo          = *info;
@@ -2881,13 +3136,7 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       struct vulkan_filter_chain_pass_info pass_info;
       memset(&pass_info, 0, sizeof(pass_info));
 
-      glslang_output output;
-      if (!glslang_compile_shader(pass->source.path, &output))
-      {
-         RARCH_ERR("Failed to compile shader: \"%s\".\n",
-               pass->source.path);
-         return nullptr;
-      }
+      glslang_output &output = preset->outputs[i];
 
       for (auto &meta_param : output.meta.parameters)
       {
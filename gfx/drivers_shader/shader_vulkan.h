@@ -28,6 +28,7 @@
 RETRO_BEGIN_DECLS
 
 typedef struct vulkan_filter_chain vulkan_filter_chain_t;
+typedef struct vulkan_filter_chain_preset vulkan_filter_chain_preset_t;
 
 enum vulkan_filter_chain_filter
 {
@@ -108,6 +109,9 @@ struct vulkan_filter_chain_create_info
       unsigned width, height;
    } max_input_size;
    struct vulkan_filter_chain_swapchain_info swapchain;
+
+   /* Directory for compiled SPIR-V, NULL or empty to always compile. */
+   const char *shader_cache_dir;
 };
 
 vulkan_filter_chain_t *vulkan_filter_chain_new(
@@ -161,6 +165,21 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       const struct vulkan_filter_chain_create_info *info,
       const char *path, enum vulkan_filter_chain_filter filter);
 
+/* Parses a .slangp preset and compiles all of its passes to SPIR-V,
+ * spreading the passes over worker threads. Touches no Vulkan state,
+ * so it may run on any thread while the current chain keeps rendering. */
+vulkan_filter_chain_preset_t *vulkan_filter_chain_preset_new(
+      const char *path, const char *cache_dir);
+
+void vulkan_filter_chain_preset_free(vulkan_filter_chain_preset_t *preset);
+
+/* Builds a filter chain from a compiled preset. Takes ownership of
+ * @preset, which is freed whether or not creation succeeds. */
+vulkan_filter_chain_t *vulkan_filter_chain_create_from_compiled(
+      const struct vulkan_filter_chain_create_info *info,
+      vulkan_filter_chain_preset_t *preset,
+      enum vulkan_filter_chain_filter filter);
+
 struct video_shader *vulkan_filter_chain_get_preset(
       vulkan_filter_chain_t *chain);
 
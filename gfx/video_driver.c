@@ -45,6 +45,7 @@
 
 #include "video_thread_wrapper.h"
 #include "video_context_driver.h"
+#include "video_pacing.h"
 
 #include "../frontend/frontend_driver.h"
 #include "../record/record_driver.h"
@@ -83,11 +84,21 @@
    if (context_lock) \
       slock_unlock(context_lock)
 
+#define video_driver_shader_lock() \
+   if (shader_lock) \
+      slock_lock(shader_lock)
+
+#define video_driver_shader_unlock() \
+   if (shader_lock) \
+      slock_unlock(shader_lock)
+
 #define video_driver_lock_free() \
    slock_free(display_lock); \
    slock_free(context_lock); \
+   slock_free(shader_lock); \
    display_lock = NULL; \
-   context_lock = NULL
+   context_lock = NULL; \
+   shader_lock  = NULL
 
 #define video_driver_threaded_lock() \
    if (video_driver_is_threaded()) \
@@ -100,6 +111,8 @@
 #define video_driver_lock()            ((void)0)
 #define video_driver_unlock()          ((void)0)
 #define video_driver_lock_free()       ((void)0)
+#define video_driver_shader_lock()     ((void)0)
+#define video_driver_shader_unlock()   ((void)0)
 #define video_driver_threaded_lock()   ((void)0)
 #define video_driver_threaded_unlock() ((void)0)
 #define video_driver_context_lock()    ((void)0)
@@ -185,8 +198,28 @@ static uint8_t *video_driver_record_gpu_buffer           = NULL;
 #ifdef HAVE_THREADS
 static slock_t *display_lock                             = NULL;
 static slock_t *context_lock                             = NULL;
+static slock_t *shader_lock                              = NULL;
 #endif
 
+enum video_shader_compile_state
+{
+   VIDEO_SHADER_COMPILE_NONE = 0,
+   VIDEO_SHADER_COMPILE_PENDING,
+   VIDEO_SHADER_COMPILE_APPLIED,
+   VIDEO_SHADER_COMPILE_FAILED
+};
+
+/* Shader the driver is compiling in the background, and the
+ * path to save to the settings once it is in use. Guarded by
+ * shader_lock, since the driver reports from the video thread.
+ * Every set_shader starts a new generation, so the outcome of
+ * a compile it replaced is ignored. */
+static enum video_shader_compile_state video_driver_shader_compile =
+   VIDEO_SHADER_COMPILE_NONE;
+static unsigned video_driver_shader_compile_generation   = 0;
+static bool video_driver_shader_store                    = false;
+static char video_driver_shader_store_path[PATH_MAX_LENGTH] = {0};
+
 struct aspect_ratio_elem aspectratio_lut[ASPECT_RATIO_END] = {
    { "4:3",           1.3333f },
    { "16:9",          1.7778f },
@@ -412,11 +445,130 @@ retro_proc_address_t video_driver_get_proc_address(const char *sym)
 bool video_driver_set_shader(enum rarch_shader_type type,
       const char *path)
 {
+   /* A new request replaces any compile still running. */
+   video_driver_shader_lock();
+   video_driver_shader_compile_generation++;
+   video_driver_shader_compile = VIDEO_SHADER_COMPILE_NONE;
+   video_driver_shader_store   = false;
+   video_driver_shader_unlock();
+
    if (current_video->set_shader)
       return current_video->set_shader(video_driver_data, type, path);
    return false;
 }
 
+/**
+ * video_driver_shader_compile_begin:
+ *
+ * Called by a driver from set_shader when it only started
+ * compiling the shader in the background and keeps rendering
+ * with the current one. The driver reports the outcome through
+ * video_driver_shader_compile_end.
+ *
+ * Returns: generation of the compile, to pass to
+ * video_driver_shader_compile_end.
+ **/
+unsigned video_driver_shader_compile_begin(void)
+{
+   unsigned generation;
+
+   video_driver_shader_lock();
+   video_driver_shader_compile = VIDEO_SHADER_COMPILE_PENDING;
+   generation                  = video_driver_shader_compile_generation;
+   video_driver_shader_unlock();
+
+   return generation;
+}
+
+/**
+ * video_driver_shader_compile_end:
+ * @generation        : returned by video_driver_shader_compile_begin.
+ * @success           : true if the new shader was swapped in.
+ *
+ * May be called from the video thread.
+ **/
+void video_driver_shader_compile_end(unsigned generation, bool success)
+{
+   video_driver_shader_lock();
+   if (     generation == video_driver_shader_compile_generation
+         && video_driver_shader_compile == VIDEO_SHADER_COMPILE_PENDING)
+      video_driver_shader_compile = success
+         ? VIDEO_SHADER_COMPILE_APPLIED : VIDEO_SHADER_COMPILE_FAILED;
+   video_driver_shader_unlock();
+}
+
+static void video_driver_shader_save(const char *path, bool success)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (!success)
+   {
+      settings->video.shader_enable = false;
+      return;
+   }
+
+   strlcpy(settings->path.shader, path ? path : "",
+         sizeof(settings->path.shader));
+   settings->video.shader_enable = true;
+}
+
+/**
+ * video_driver_shader_save_when_applied:
+ * @path              : Shader just passed to video_driver_set_shader.
+ *
+ * Makes @path the shader used on driver reinit, so it has to
+ * actually work: right away if it was applied synchronously,
+ * otherwise once the background compile has been swapped in.
+ **/
+void video_driver_shader_save_when_applied(const char *path)
+{
+   bool pending;
+
+   video_driver_shader_lock();
+   pending = video_driver_shader_compile == VIDEO_SHADER_COMPILE_PENDING;
+
+   if (pending)
+   {
+      strlcpy(video_driver_shader_store_path, path ? path : "",
+            sizeof(video_driver_shader_store_path));
+      video_driver_shader_store = true;
+   }
+   video_driver_shader_unlock();
+
+   if (!pending)
+      video_driver_shader_save(path, true);
+}
+
+/* Main thread, once per frame. */
+static void video_driver_shader_compile_poll(void)
+{
+   char path[PATH_MAX_LENGTH];
+   enum video_shader_compile_state state;
+   bool store = false;
+
+   video_driver_shader_lock();
+   state = video_driver_shader_compile;
+
+   if (     state == VIDEO_SHADER_COMPILE_NONE
+         || state == VIDEO_SHADER_COMPILE_PENDING)
+   {
+      video_driver_shader_unlock();
+      return;
+   }
+
+   store = video_driver_shader_store;
+   if (store)
+      strlcpy(path, video_driver_shader_store_path, sizeof(path));
+
+   video_driver_shader_compile = VIDEO_SHADER_COMPILE_NONE;
+   video_driver_shader_store   = false;
+   video_driver_shader_unlock();
+
+   if (store)
+      video_driver_shader_save(path,
+            state == VIDEO_SHADER_COMPILE_APPLIED);
+}
+
 static void video_driver_filter_free(void)
 {
    if (video_driver_state_filter)
@@ -612,6 +764,8 @@ static void video_driver_free_internal(void)
       return;
 
    video_driver_monitor_compute_fps_statistics();
+   video_pacing_log_statistics();
+   input_driver_log_statistics();
 }
 
 static bool video_driver_pixel_converter_init(unsigned size)
@@ -684,6 +838,7 @@ static bool video_driver_init_internal(void)
    struct retro_system_av_info *av_info   =
       video_viewport_get_system_av_info();
 
+   video_pacing_reset();
    video_driver_filter_free();
 
    if (!string_is_empty(settings->path.softfilter_plugin))
@@ -1312,6 +1467,10 @@ static void video_driver_lock_new(void)
    if (!context_lock)
       context_lock = slock_new();
    retro_assert(context_lock);
+
+   if (!shader_lock)
+      shader_lock = slock_new();
+   retro_assert(shader_lock);
 #endif
 }
 
@@ -2046,6 +2205,9 @@ void video_driver_frame(const void *data, unsigned width,
    if (!video_driver_active)
       return;
 
+   video_pacing_mark(VIDEO_PACING_MARK_FRAME, new_time);
+   video_driver_shader_compile_poll();
+
    if (video_driver_scaler_ptr && data &&
          (video_driver_pix_fmt == RETRO_PIXEL_FORMAT_0RGB1555) &&
          (data != RETRO_HW_FRAME_BUFFER_VALID))
@@ -2184,6 +2346,14 @@ void video_driver_frame(const void *data, unsigned width,
             (unsigned)pitch, video_driver_msg, &video_info))
       video_driver_active = false;
 
+   if (!video_info.frame_count)
+      rarch_startup_trace_finish();
+
+   rarch_perf_trace_frame();
+
+   video_pacing_mark(VIDEO_PACING_MARK_PRESENT,
+         cpu_features_get_time_usec());
+
    if (video_info.fps_show)
       runloop_msg_queue_push(video_info.fps_text, 1, 1, false);
 }
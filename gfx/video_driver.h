@@ -431,6 +431,12 @@ retro_proc_address_t video_driver_get_proc_address(const char *sym);
 bool video_driver_set_shader(enum rarch_shader_type type,
       const char *shader);
 
+unsigned video_driver_shader_compile_begin(void);
+
+void video_driver_shader_compile_end(unsigned generation, bool success);
+
+void video_driver_shader_save_when_applied(const char *path);
+
 bool video_driver_set_rotation(unsigned rotation);
 
 bool video_driver_set_video_mode(unsigned width,
@@ -0,0 +1,271 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+
+#include "video_pacing.h"
+
+#include "../verbosity.h"
+
+/* Never schedule the core closer than this to the next VSync. */
+#define VIDEO_PACING_SAFETY_USEC 1000
+/* Step by which the delay creeps up while no VSync is missed. */
+#define VIDEO_PACING_STEP_USEC   100
+
+static retro_time_t video_pacing_marks[VIDEO_PACING_MARK_LAST];
+static retro_time_t video_pacing_last_present = 0;
+static retro_time_t video_pacing_delay         = 0;
+/* Estimate of how long the core needs to produce a frame. */
+static retro_time_t video_pacing_core_estimate = 0;
+static uint64_t     video_pacing_missed        = 0;
+static float        video_pacing_refresh_rate  = 0.0f;
+
+static struct video_pacing_histogram
+video_pacing_histograms[VIDEO_PACING_HISTOGRAM_LAST];
+
+static const char *video_pacing_histogram_names[VIDEO_PACING_HISTOGRAM_LAST] = {
+   "Input to present",
+   "Core run",
+   "Present",
+   "Input event to input_state",
+   "Input event to present",
+};
+
+static void video_pacing_histogram_add(
+      enum video_pacing_histogram_type type, retro_time_t usec)
+{
+   struct video_pacing_histogram *hist = &video_pacing_histograms[type];
+   retro_time_t bin                    = usec / VIDEO_PACING_BIN_USEC;
+
+   if (usec < 0)
+      return;
+
+   if (bin >= VIDEO_PACING_BINS)
+      bin = VIDEO_PACING_BINS - 1;
+
+   hist->bins[bin]++;
+   hist->count++;
+   hist->total += usec;
+}
+
+static void video_pacing_update_delay(retro_time_t interval,
+      retro_time_t core_time)
+{
+   retro_time_t period, max_delay;
+
+   if (video_pacing_refresh_rate <= 0.0f)
+      return;
+
+   period = (retro_time_t)(1000000.0f / video_pacing_refresh_rate);
+
+   /* Rise immediately, decay slowly, so that a single
+    * slow frame pushes the core earlier for a while. */
+   if (core_time > video_pacing_core_estimate)
+      video_pacing_core_estimate = core_time;
+   else
+      video_pacing_core_estimate = (video_pacing_core_estimate * 31
+            + core_time) / 32;
+
+   if (interval > period + period / 2)
+   {
+      /* Missed a VSync, back off quickly. */
+      video_pacing_missed++;
+      video_pacing_delay -= period / 8;
+   }
+   else
+      video_pacing_delay += VIDEO_PACING_STEP_USEC;
+
+   max_delay = period - video_pacing_core_estimate
+      - video_pacing_core_estimate / 4 - VIDEO_PACING_SAFETY_USEC;
+
+   if (video_pacing_delay > max_delay)
+      video_pacing_delay = max_delay;
+   if (video_pacing_delay < 0)
+      video_pacing_delay = 0;
+}
+
+void video_pacing_mark(enum video_pacing_mark mark, retro_time_t time)
+{
+   retro_time_t *marks = video_pacing_marks;
+
+   marks[mark] = time;
+
+   if (mark != VIDEO_PACING_MARK_PRESENT)
+      return;
+
+   if (marks[VIDEO_PACING_MARK_INPUT_POLL])
+      video_pacing_histogram_add(VIDEO_PACING_HISTOGRAM_INPUT_LATENCY,
+            time - marks[VIDEO_PACING_MARK_INPUT_POLL]);
+
+   if (marks[VIDEO_PACING_MARK_FRAME])
+      video_pacing_histogram_add(VIDEO_PACING_HISTOGRAM_PRESENT,
+            time - marks[VIDEO_PACING_MARK_FRAME]);
+
+   if (marks[VIDEO_PACING_MARK_INPUT_EVENT])
+   {
+      if (marks[VIDEO_PACING_MARK_INPUT_STATE])
+         video_pacing_histogram_add(VIDEO_PACING_HISTOGRAM_EVENT_TO_STATE,
+               marks[VIDEO_PACING_MARK_INPUT_STATE]
+               - marks[VIDEO_PACING_MARK_INPUT_EVENT]);
+
+      video_pacing_histogram_add(VIDEO_PACING_HISTOGRAM_EVENT_TO_PRESENT,
+            time - marks[VIDEO_PACING_MARK_INPUT_EVENT]);
+   }
+
+   if (marks[VIDEO_PACING_MARK_CORE_RUN] && marks[VIDEO_PACING_MARK_FRAME])
+   {
+      retro_time_t core_time = marks[VIDEO_PACING_MARK_FRAME]
+         - marks[VIDEO_PACING_MARK_CORE_RUN];
+
+      video_pacing_histogram_add(VIDEO_PACING_HISTOGRAM_CORE_RUN, core_time);
+
+      if (video_pacing_last_present)
+         video_pacing_update_delay(time - video_pacing_last_present,
+               core_time);
+   }
+
+   video_pacing_last_present = time;
+
+   /* Only count marks which belong to the next frame. */
+   memset(marks, 0, sizeof(video_pacing_marks));
+}
+
+void video_pacing_input_event(retro_time_t time)
+{
+   retro_time_t *marks = video_pacing_marks;
+
+   if (     !marks[VIDEO_PACING_MARK_INPUT_EVENT]
+         || time < marks[VIDEO_PACING_MARK_INPUT_EVENT])
+   {
+      marks[VIDEO_PACING_MARK_INPUT_EVENT] = time;
+      /* Wait for the core to read this one. */
+      marks[VIDEO_PACING_MARK_INPUT_STATE] = 0;
+   }
+}
+
+void video_pacing_input_state(retro_time_t time)
+{
+   retro_time_t *marks = video_pacing_marks;
+
+   if (     marks[VIDEO_PACING_MARK_INPUT_EVENT]
+         && !marks[VIDEO_PACING_MARK_INPUT_STATE])
+      marks[VIDEO_PACING_MARK_INPUT_STATE] = time;
+}
+
+void video_pacing_wait(float refresh_rate)
+{
+   retro_time_t target, now;
+
+   video_pacing_refresh_rate = refresh_rate;
+
+   if (!video_pacing_last_present || !video_pacing_delay)
+      return;
+
+   target = video_pacing_last_present + video_pacing_delay;
+   now    = cpu_features_get_time_usec();
+
+   if (target - now >= 1000)
+      retro_sleep((unsigned)((target - now) / 1000));
+}
+
+retro_time_t video_pacing_get_delay(void)
+{
+   return video_pacing_delay;
+}
+
+retro_time_t video_pacing_percentile(
+      enum video_pacing_histogram_type type, double percentile)
+{
+   unsigned i;
+   uint64_t accum                            = 0;
+   const struct video_pacing_histogram *hist = &video_pacing_histograms[type];
+   uint64_t target                           = (uint64_t)
+      (hist->count * percentile / 100.0);
+
+   if (!hist->count)
+      return 0;
+
+   for (i = 0; i < VIDEO_PACING_BINS; i++)
+   {
+      accum += hist->bins[i];
+      if (accum > target)
+         break;
+   }
+
+   if (i >= VIDEO_PACING_BINS)
+      i = VIDEO_PACING_BINS - 1;
+
+   return (retro_time_t)(i + 1) * VIDEO_PACING_BIN_USEC;
+}
+
+const struct video_pacing_histogram *video_pacing_get_histogram(
+      enum video_pacing_histogram_type type)
+{
+   return &video_pacing_histograms[type];
+}
+
+void video_pacing_reset(void)
+{
+   memset(video_pacing_marks,      0, sizeof(video_pacing_marks));
+   memset(video_pacing_histograms, 0, sizeof(video_pacing_histograms));
+
+   video_pacing_last_present  = 0;
+   video_pacing_delay         = 0;
+   video_pacing_core_estimate = 0;
+   video_pacing_missed        = 0;
+}
+
+void video_pacing_log_statistics(void)
+{
+   unsigned i, j;
+
+   for (i = 0; i < VIDEO_PACING_HISTOGRAM_LAST; i++)
+   {
+      const struct video_pacing_histogram *hist = &video_pacing_histograms[i];
+
+      if (!hist->count)
+         continue;
+
+      RARCH_LOG("[Pacing]: %s: avg %.3f ms, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms (%u frames).\n",
+            video_pacing_histogram_names[i],
+            hist->total / (hist->count * 1000.0),
+            video_pacing_percentile((enum video_pacing_histogram_type)i, 50) / 1000.0,
+            video_pacing_percentile((enum video_pacing_histogram_type)i, 90) / 1000.0,
+            video_pacing_percentile((enum video_pacing_histogram_type)i, 99) / 1000.0,
+            (unsigned)hist->count);
+
+      for (j = 0; j < VIDEO_PACING_BINS; j++)
+      {
+         if (!hist->bins[j])
+            continue;
+
+         if (j == VIDEO_PACING_BINS - 1)
+            RARCH_LOG("[Pacing]:    > %6.2f ms: %u\n",
+                  j * VIDEO_PACING_BIN_USEC / 1000.0,
+                  hist->bins[j]);
+         else
+            RARCH_LOG("[Pacing]:   <= %6.2f ms: %u\n",
+                  (j + 1) * VIDEO_PACING_BIN_USEC / 1000.0,
+                  hist->bins[j]);
+      }
+   }
+
+   if (video_pacing_delay || video_pacing_missed)
+      RARCH_LOG("[Pacing]: Automatic frame delay: %.2f ms, missed VSyncs: %u.\n",
+            video_pacing_delay / 1000.0, (unsigned)video_pacing_missed);
+}
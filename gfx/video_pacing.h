@@ -0,0 +1,145 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIDEO_PACING_H
+#define __VIDEO_PACING_H
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Width of a histogram bin in microseconds. */
+#define VIDEO_PACING_BIN_USEC 250
+/* The last bin collects everything above 32ms. */
+#define VIDEO_PACING_BINS     129
+
+enum video_pacing_mark
+{
+   /* Frontend polled input for the core. */
+   VIDEO_PACING_MARK_INPUT_POLL = 0,
+   /* retro_run was entered. */
+   VIDEO_PACING_MARK_CORE_RUN,
+   /* Core handed its frame to video_driver_frame. */
+   VIDEO_PACING_MARK_FRAME,
+   /* Video driver returned from presenting the frame. */
+   VIDEO_PACING_MARK_PRESENT,
+   /* Oldest input event handed to the core in this frame,
+    * see video_pacing_input_event(). */
+   VIDEO_PACING_MARK_INPUT_EVENT,
+   /* Core first queried input after that event. */
+   VIDEO_PACING_MARK_INPUT_STATE,
+   VIDEO_PACING_MARK_LAST
+};
+
+enum video_pacing_histogram_type
+{
+   /* Input poll to present. */
+   VIDEO_PACING_HISTOGRAM_INPUT_LATENCY = 0,
+   /* retro_run entry to the frame being handed over. */
+   VIDEO_PACING_HISTOGRAM_CORE_RUN,
+   /* Time spent in the video driver's frame callback. */
+   VIDEO_PACING_HISTOGRAM_PRESENT,
+   /* Input event to the core reading it. */
+   VIDEO_PACING_HISTOGRAM_EVENT_TO_STATE,
+   /* Input event to present. */
+   VIDEO_PACING_HISTOGRAM_EVENT_TO_PRESENT,
+   VIDEO_PACING_HISTOGRAM_LAST
+};
+
+struct video_pacing_histogram
+{
+   uint32_t bins[VIDEO_PACING_BINS];
+   uint64_t count;
+   retro_time_t total;
+};
+
+/**
+ * video_pacing_mark:
+ * @mark                 : which point of the frame was reached.
+ * @time                 : current time in microseconds.
+ *
+ * Timestamps a point of the current frame. Histograms are
+ * updated once the frame is presented.
+ **/
+void video_pacing_mark(enum video_pacing_mark mark, retro_time_t time);
+
+/**
+ * video_pacing_input_event:
+ * @time                 : when the event happened, on the clock of
+ *                         cpu_features_get_time_usec().
+ *
+ * Reports an input event which was handed to the core. Only the
+ * oldest event of a frame is kept, its latency to the core's next
+ * input query and to present is added to the histograms.
+ **/
+void video_pacing_input_event(retro_time_t time);
+
+/**
+ * video_pacing_input_state:
+ * @time                 : current time in microseconds.
+ *
+ * Reports that the core queried input after an input event
+ * was handed to it.
+ **/
+void video_pacing_input_state(retro_time_t time);
+
+/**
+ * video_pacing_wait:
+ * @refresh_rate         : display refresh rate in Hz.
+ *
+ * Sleeps after the last present for as long as the core can be
+ * delayed without missing the next VSync. The delay adapts to
+ * how long the core has recently taken to produce a frame and
+ * backs off whenever a VSync is missed.
+ **/
+void video_pacing_wait(float refresh_rate);
+
+/**
+ * video_pacing_get_delay:
+ *
+ * Returns: the current adaptive frame delay in microseconds.
+ **/
+retro_time_t video_pacing_get_delay(void);
+
+/**
+ * video_pacing_percentile:
+ * @type                 : which histogram to query.
+ * @percentile           : percentile in the range [0, 100].
+ *
+ * Returns: upper bound of the histogram bin which contains
+ * the percentile, in microseconds, or 0 if there are no samples.
+ **/
+retro_time_t video_pacing_percentile(
+      enum video_pacing_histogram_type type, double percentile);
+
+const struct video_pacing_histogram *video_pacing_get_histogram(
+      enum video_pacing_histogram_type type);
+
+void video_pacing_reset(void);
+
+/**
+ * video_pacing_log_statistics:
+ *
+ * Logs percentiles and the full latency histograms.
+ **/
+void video_pacing_log_statistics(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -15,6 +15,9 @@
 
 #include <string.h>
 
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <retro_stat.h>
 #include <string/stdstring.h>
 
 #ifdef HAVE_CONFIG_H
@@ -22,6 +25,8 @@
 #endif
 
 #include "video_shader_driver.h"
+#include "../configuration.h"
+#include "../paths.h"
 #include "../verbosity.h"
 
 static const shader_backend_t *shader_ctx_drivers[] = {
@@ -241,3 +246,38 @@ bool video_shader_driver_wrap_type(video_shader_ctx_wrap_t *wrap)
    wrap->type = current_shader->wrap_type(shader_data, wrap->idx);
    return true;
 }
+
+/**
+ * video_shader_driver_get_cache_dir:
+ * @s                  : output directory.
+ * @len                : size of @s.
+ *
+ * Gets the directory shader backends persist compiled
+ * programs to. Uses the cache directory if set, the
+ * directory of the active config file otherwise.
+ *
+ * Returns: true (1) if @s holds an existing directory,
+ * otherwise false (0).
+ **/
+bool video_shader_driver_get_cache_dir(char *s, size_t len)
+{
+   settings_t *settings = config_get_ptr();
+
+   *s = '\0';
+
+   if (!string_is_empty(settings->directory.cache))
+      strlcpy(s, settings->directory.cache, len);
+   else if (!path_is_empty(RARCH_PATH_CONFIG))
+      fill_pathname_basedir(s, path_get(RARCH_PATH_CONFIG), len);
+
+   if (string_is_empty(s))
+      return false;
+
+   if (!path_is_directory(s) && !path_mkdir(s))
+   {
+      *s = '\0';
+      return false;
+   }
+
+   return true;
+}
@@ -320,6 +320,8 @@ bool video_shader_driver_compile_program(struct shader_program_info *program_inf
 
 bool video_shader_driver_wrap_type(video_shader_ctx_wrap_t *wrap);
 
+bool video_shader_driver_get_cache_dir(char *s, size_t len);
+
 extern const shader_backend_t *current_shader;
 extern void *shader_data;
 
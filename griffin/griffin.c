@@ -122,6 +122,7 @@ CONFIG FILE
 #include "../libretro-common/file/config_file.c"
 #include "../libretro-common/file/config_file_userdata.c"
 #include "../managers/core_manager.c"
+#include "../managers/extract_cache_manager.c"
 #include "../managers/core_option_manager.c"
 
 /*============================================================
@@ -671,6 +672,7 @@ AUDIO
 DRIVERS
 ============================================================ */
 #include "../gfx/video_driver.c"
+#include "../gfx/video_pacing.c"
 #include "../gfx/video_coord_array.c"
 #include "../input/input_driver.c"
 #include "../audio/audio_driver.c"
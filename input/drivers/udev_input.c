@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -38,6 +39,7 @@
 
 #include <file/file_path.h>
 #include <compat/strl.h>
+#include <features/features_cpu.h>
 #include <string/stdstring.h>
 
 #include "../input_config.h"
@@ -53,6 +55,9 @@
 
 #include "../../verbosity.h"
 
+/* Events read from the devices before they are applied. */
+#define UDEV_INPUT_QUEUE_SIZE 256
+
 typedef struct udev_input udev_input_t;
 
 typedef void (*device_handle_cb)(void *data,
@@ -64,6 +69,8 @@ struct udev_input_device
    dev_t dev;
    device_handle_cb handle_cb;
    char devnode[PATH_MAX_LENGTH];
+   /* Kernel timestamps are on the monotonic clock. */
+   bool monotonic;
 
    union
    {
@@ -82,6 +89,13 @@ struct udev_input_device
    } state;
 };
 
+struct udev_input_event
+{
+   struct input_event event;
+   retro_time_t time;
+   udev_input_device_t *device;
+};
+
 struct udev_input
 {
    bool blocked;
@@ -98,6 +112,9 @@ struct udev_input
    int16_t mouse_x;
    int16_t mouse_y;
    bool mouse_l, mouse_r, mouse_m, mouse_wu, mouse_wd, mouse_whu, mouse_whd;
+
+   struct udev_input_event queue[UDEV_INPUT_QUEUE_SIZE];
+   unsigned queue_count;
 };
 
 #ifdef HAVE_XKBCOMMON
@@ -236,6 +253,9 @@ static bool udev_input_add_device(udev_input_t *udev,
    udev_input_device_t **tmp;
    udev_input_device_t *device = NULL;
    struct stat st              = {0};
+#ifdef EVIOCSCLOCKID
+   int clock_id                = CLOCK_MONOTONIC;
+#endif
 
    if (stat(devnode, &st) < 0)
       return false;
@@ -251,6 +271,10 @@ static bool udev_input_add_device(udev_input_t *udev,
    device->fd        = fd;
    device->dev       = st.st_dev;
    device->handle_cb = cb;
+#ifdef EVIOCSCLOCKID
+   /* Timestamp events on the clock latency is measured with. */
+   device->monotonic = ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0;
+#endif
 
    strlcpy(device->devnode, devnode, sizeof(device->devnode));
 
@@ -352,45 +376,124 @@ end:
    udev_device_unref(dev);
 }
 
-static void udev_input_poll(void *data)
+/* Applies the queued events in the order they happened. */
+static bool udev_input_apply_events(udev_input_t *udev)
 {
-   int i, ret;
-   struct epoll_event events[32];
-   udev_input_t *udev = (udev_input_t*)data;
+   unsigned i, j;
+   retro_time_t oldest = 0;
 
-   if (!udev)
-      return;
+   if (!udev->queue_count)
+      return false;
 
-   udev->mouse_x   = udev->mouse_y   = 0;
-   udev->mouse_wu  = udev->mouse_wd  = 0;
-   udev->mouse_whu = udev->mouse_whd = 0;
+   /* Events of each device are in order already,
+    * this only interleaves the devices. */
+   for (i = 1; i < udev->queue_count; i++)
+   {
+      struct udev_input_event tmp = udev->queue[i];
 
-   while (udev->monitor && udev_hotplug_available(udev->monitor))
-      udev_input_handle_hotplug(udev);
+      for (j = i; j > 0 && udev->queue[j - 1].time > tmp.time; j--)
+         udev->queue[j] = udev->queue[j - 1];
+      udev->queue[j] = tmp;
+   }
+
+   for (i = 0; i < udev->queue_count; i++)
+   {
+      const struct udev_input_event *e = &udev->queue[i];
+
+      e->device->handle_cb(udev, &e->event, e->device);
+
+      if (     e->event.type != EV_SYN
+            && e->event.type != EV_MSC
+            && (!oldest || e->time < oldest))
+         oldest = e->time;
+   }
+
+   udev->queue_count = 0;
+
+   if (oldest)
+      input_driver_mark_event(oldest);
+
+   return true;
+}
+
+/* Reads everything the devices have into the queue. */
+static void udev_input_read_events(udev_input_t *udev)
+{
+   int i, ret;
+   struct epoll_event events[32];
+   retro_time_t now = cpu_features_get_time_usec();
 
    ret = epoll_waiting(&udev->epfd, events, ARRAY_SIZE(events), 0);
 
    for (i = 0; i < ret; i++)
    {
-      if (events[i].events & EPOLLIN)
+      udev_input_device_t *device = (udev_input_device_t*)events[i].data.ptr;
+
+      if (!(events[i].events & EPOLLIN))
+         continue;
+
+      for (;;)
       {
          int j, len;
          struct input_event input_events[32];
-         udev_input_device_t *device = (udev_input_device_t*)events[i].data.ptr;
 
-         while ((len = read(device->fd, input_events, sizeof(input_events))) > 0)
+         if (udev->queue_count + ARRAY_SIZE(input_events) > UDEV_INPUT_QUEUE_SIZE)
+            udev_input_apply_events(udev);
+
+         len = read(device->fd, input_events, sizeof(input_events));
+
+         if (len <= 0)
+            break;
+
+         len /= sizeof(*input_events);
+
+         for (j = 0; j < len; j++)
          {
-            len /= sizeof(*input_events);
-            for (j = 0; j < len; j++)
-               device->handle_cb(udev, &input_events[j], device);
+            struct udev_input_event *e = &udev->queue[udev->queue_count++];
+
+            e->event  = input_events[j];
+            e->device = device;
+            e->time   = device->monotonic
+               ? (retro_time_t)input_events[j].time.tv_sec * 1000000
+                  + input_events[j].time.tv_usec
+               : now;
          }
       }
    }
+}
+
+static void udev_input_poll(void *data)
+{
+   udev_input_t *udev = (udev_input_t*)data;
+
+   if (!udev)
+      return;
+
+   udev->mouse_x   = udev->mouse_y   = 0;
+   udev->mouse_wu  = udev->mouse_wd  = 0;
+   udev->mouse_whu = udev->mouse_whd = 0;
+
+   while (udev->monitor && udev_hotplug_available(udev->monitor))
+      udev_input_handle_hotplug(udev);
+
+   udev_input_read_events(udev);
+   udev_input_apply_events(udev);
 
    if (udev->joypad)
       udev->joypad->poll();
 }
 
+static bool udev_input_refresh(void *data)
+{
+   udev_input_t *udev = (udev_input_t*)data;
+
+   if (!udev)
+      return false;
+
+   udev_input_read_events(udev);
+   return udev_input_apply_events(udev);
+}
+
 static int16_t udev_mouse_state(udev_input_t *udev, unsigned id)
 {
    switch (id)
@@ -742,4 +845,5 @@ input_driver_t input_udev = {
    NULL,
    udev_input_keyboard_mapping_is_blocked,
    udev_input_keyboard_mapping_set_block,
+   udev_input_refresh,
 };
@@ -83,6 +83,7 @@ enum
    RARCH_DISK_PREV,
    RARCH_GRAB_MOUSE_TOGGLE,
    RARCH_GAME_FOCUS_TOGGLE,
+   RARCH_RECORD_REPLAY_SAVE,
 
    RARCH_MENU_TOGGLE,
 
@@ -16,6 +16,8 @@
 
 #include <string.h>
 
+#include <features/features_cpu.h>
+
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
 #endif
@@ -40,6 +42,7 @@
 #include "../list_special.h"
 #include "../verbosity.h"
 #include "../command.h"
+#include "../gfx/video_pacing.h"
 
 static const input_driver_t *input_drivers[] = {
 #ifdef __CELLOS_LV2__
@@ -107,7 +110,26 @@ struct turbo_buttons
    unsigned count;
 };
 
+/* RetroPad state of a user as seen by the core, valid
+ * until the next poll. */
+struct input_snapshot
+{
+   uint16_t buttons;
+   int16_t analog[2][2];
+   bool joypad_valid;
+   bool analog_valid;
+   /* Taken before events a refresh applied since. */
+   bool stale;
+};
+
 static turbo_buttons_t input_driver_turbo_btns;
+static struct input_snapshot input_driver_snapshot[MAX_USERS];
+static uint64_t input_driver_queries;
+static uint64_t input_driver_polls;
+/* An event was applied which the core has not queried input for. */
+static bool input_driver_event_pending;
+/* Last time the driver was polled or refreshed. */
+static retro_time_t input_driver_refreshed;
 #ifdef HAVE_COMMAND
 static command_t *input_driver_command            = NULL;
 #endif
@@ -273,7 +295,11 @@ void input_poll(void)
    
    current_input->poll(current_input_data);
 
+   input_driver_refreshed = cpu_features_get_time_usec();
+   video_pacing_mark(VIDEO_PACING_MARK_INPUT_POLL, input_driver_refreshed);
+
    input_driver_turbo_btns.count++;
+   input_driver_polls++;
 
    for (i = 0; i < max_users; i++)
    {
@@ -281,6 +307,13 @@ void input_poll(void)
       input_driver_turbo_btns.frame_enable[i] = 0;
    }
 
+   for (i = 0; i < MAX_USERS; i++)
+   {
+      input_driver_snapshot[i].joypad_valid = false;
+      input_driver_snapshot[i].analog_valid = false;
+      input_driver_snapshot[i].stale        = false;
+   }
+
    if (!input_driver_block_libretro_input)
    {
       rarch_joypad_info_t joypad_info;
@@ -321,6 +354,116 @@ void input_poll(void)
    }
 }
 
+/* Resolves a query through remapping, the driver, the overlay,
+ * the network gamepad and turbo. */
+static int16_t input_state_resolve(settings_t *settings,
+      unsigned port, unsigned device, unsigned idx, unsigned id)
+{
+   int16_t res = 0;
+
+   if (settings->input.remap_binds_enable)
+   {
+      switch (device)
+      {
+         case RETRO_DEVICE_JOYPAD:
+            if (id < RARCH_FIRST_CUSTOM_BIND)
+               id = settings->input.remap_ids[port][id];
+            break;
+         case RETRO_DEVICE_ANALOG:
+            if (idx < 2 && id < 2)
+            {
+               unsigned new_id = RARCH_FIRST_CUSTOM_BIND + (idx * 2 + id);
+
+               new_id = settings->input.remap_ids[port][new_id];
+               idx   = (new_id & 2) >> 1;
+               id    = new_id & 1;
+            }
+            break;
+      }
+   }
+
+   if (((id < RARCH_FIRST_META_KEY) || (device == RETRO_DEVICE_KEYBOARD)))
+   {
+      bool bind_valid = libretro_input_binds[port] && libretro_input_binds[port][id].valid;
+
+      if (bind_valid || device == RETRO_DEVICE_KEYBOARD)
+      {
+         rarch_joypad_info_t joypad_info;
+
+         joypad_info.axis_threshold = settings->input.axis_threshold;
+         joypad_info.joy_idx        = settings->input.joypad_map[port];
+         joypad_info.auto_binds     = settings->input.autoconf_binds[joypad_info.joy_idx];
+
+         res = current_input->input_state(
+               current_input_data, joypad_info, libretro_input_binds, port, device, idx, id);
+      }
+   }
+
+#ifdef HAVE_OVERLAY
+   if (overlay_ptr)
+      input_state_overlay(overlay_ptr, &res, port, device, idx, id);
+#endif
+
+#ifdef HAVE_NETWORKGAMEPAD
+   input_remote_state(&res, port, device, idx, id);
+#endif
+
+   /* Don't allow turbo for D-pad. */
+   if (device == RETRO_DEVICE_JOYPAD && (id < RETRO_DEVICE_ID_JOYPAD_UP ||
+            id > RETRO_DEVICE_ID_JOYPAD_RIGHT))
+   {
+      /*
+       * Apply turbo button if activated.
+       *
+       * If turbo button is held, all buttons pressed except
+       * for D-pad will go into a turbo mode. Until the button is
+       * released again, the input state will be modulated by a 
+       * periodic pulse defined by the configured duty cycle. 
+       */
+      if (res && input_driver_turbo_btns.frame_enable[port])
+         input_driver_turbo_btns.enable[port] |= (1 << id);
+      else if (!res)
+         input_driver_turbo_btns.enable[port] &= ~(1 << id);
+
+      if (input_driver_turbo_btns.enable[port] & (1 << id))
+      {
+         /* if turbo button is enabled for this key ID */
+         res = res && ((input_driver_turbo_btns.count 
+                  % settings->input.turbo_period)
+               < settings->input.turbo_duty_cycle);
+      }
+   }
+
+   return res;
+}
+
+static void input_snapshot_joypad(settings_t *settings,
+      struct input_snapshot *snapshot, unsigned port)
+{
+   unsigned id;
+
+   snapshot->buttons = 0;
+
+   for (id = 0; id < RARCH_FIRST_CUSTOM_BIND; id++)
+      if (input_state_resolve(settings, port, RETRO_DEVICE_JOYPAD, 0, id))
+         snapshot->buttons |= 1 << id;
+
+   snapshot->joypad_valid = true;
+}
+
+static void input_snapshot_analog(settings_t *settings,
+      struct input_snapshot *snapshot, unsigned port)
+{
+   unsigned idx, id;
+
+   for (idx = 0; idx < 2; idx++)
+      for (id = 0; id < 2; id++)
+         snapshot->analog[idx][id] = input_state_resolve(settings,
+               port, RETRO_DEVICE_ANALOG, idx, id);
+
+   snapshot->analog_valid = true;
+}
+
 /**
  * input_state:
  * @port                 : user number.
@@ -330,6 +473,10 @@ void input_poll(void)
  *
  * Input state callback function.
  *
+ * RetroPad buttons and analog sticks are resolved for all IDs of
+ * a user at once, on the first query after a poll. Further queries
+ * until the next poll are looked up in that snapshot.
+ *
  * Returns: Non-zero if the given key (identified by @id) 
  * was pressed by the user (assigned to @port).
  **/
@@ -340,6 +487,14 @@ int16_t input_state(unsigned port, unsigned device,
 
    device &= RETRO_DEVICE_MASK;
 
+   input_driver_queries++;
+
+   if (input_driver_event_pending)
+   {
+      input_driver_event_pending = false;
+      video_pacing_input_state(cpu_features_get_time_usec());
+   }
+
    if (bsv_movie_ctl(BSV_MOVIE_CTL_PLAYBACK_ON, NULL))
    {
       int16_t bsv_result;
@@ -352,80 +507,26 @@ int16_t input_state(unsigned port, unsigned device,
    if (     !input_driver_flushing_input 
          && !input_driver_block_libretro_input)
    {
-      settings_t *settings = config_get_ptr();
+      settings_t *settings              = config_get_ptr();
+      struct input_snapshot *snapshot   = port < MAX_USERS
+         ? &input_driver_snapshot[port] : NULL;
 
-      if (settings->input.remap_binds_enable)
+      if (snapshot && device == RETRO_DEVICE_JOYPAD
+            && id < RARCH_FIRST_CUSTOM_BIND)
       {
-         switch (device)
-         {
-            case RETRO_DEVICE_JOYPAD:
-               if (id < RARCH_FIRST_CUSTOM_BIND)
-                  id = settings->input.remap_ids[port][id];
-               break;
-            case RETRO_DEVICE_ANALOG:
-               if (idx < 2 && id < 2)
-               {
-                  unsigned new_id = RARCH_FIRST_CUSTOM_BIND + (idx * 2 + id);
-
-                  new_id = settings->input.remap_ids[port][new_id];
-                  idx   = (new_id & 2) >> 1;
-                  id    = new_id & 1;
-               }
-               break;
-         }
+         if (!snapshot->joypad_valid)
+            input_snapshot_joypad(settings, snapshot, port);
+         res = (snapshot->buttons >> id) & 1;
       }
-
-      if (((id < RARCH_FIRST_META_KEY) || (device == RETRO_DEVICE_KEYBOARD)))
+      else if (snapshot && device == RETRO_DEVICE_ANALOG
+            && idx < 2 && id < 2)
       {
-         bool bind_valid = libretro_input_binds[port] && libretro_input_binds[port][id].valid;
-
-         if (bind_valid || device == RETRO_DEVICE_KEYBOARD)
-         {
-            rarch_joypad_info_t joypad_info;
-
-            joypad_info.axis_threshold = settings->input.axis_threshold;
-            joypad_info.joy_idx        = settings->input.joypad_map[port];
-            joypad_info.auto_binds     = settings->input.autoconf_binds[joypad_info.joy_idx];
-
-            res = current_input->input_state(
-                  current_input_data, joypad_info, libretro_input_binds, port, device, idx, id);
-         }
-      }
-
-#ifdef HAVE_OVERLAY
-      if (overlay_ptr)
-         input_state_overlay(overlay_ptr, &res, port, device, idx, id);
-#endif
-
-#ifdef HAVE_NETWORKGAMEPAD
-      input_remote_state(&res, port, device, idx, id);
-#endif
-
-      /* Don't allow turbo for D-pad. */
-      if (device == RETRO_DEVICE_JOYPAD && (id < RETRO_DEVICE_ID_JOYPAD_UP ||
-               id > RETRO_DEVICE_ID_JOYPAD_RIGHT))
-      {
-         /*
-          * Apply turbo button if activated.
-          *
-          * If turbo button is held, all buttons pressed except
-          * for D-pad will go into a turbo mode. Until the button is
-          * released again, the input state will be modulated by a 
-          * periodic pulse defined by the configured duty cycle. 
-          */
-         if (res && input_driver_turbo_btns.frame_enable[port])
-            input_driver_turbo_btns.enable[port] |= (1 << id);
-         else if (!res)
-            input_driver_turbo_btns.enable[port] &= ~(1 << id);
-
-         if (input_driver_turbo_btns.enable[port] & (1 << id))
-         {
-            /* if turbo button is enabled for this key ID */
-            res = res && ((input_driver_turbo_btns.count 
-                     % settings->input.turbo_period)
-                  < settings->input.turbo_duty_cycle);
-         }
+         if (!snapshot->analog_valid)
+            input_snapshot_analog(settings, snapshot, port);
+         res = snapshot->analog[idx][id];
       }
+      else
+         res = input_state_resolve(settings, port, device, idx, id);
    }
 
    if (bsv_movie_ctl(BSV_MOVIE_CTL_PLAYBACK_OFF, NULL))
@@ -1006,6 +1107,44 @@ void input_driver_poll(void)
    current_input->poll(current_input_data);
 }
 
+bool input_driver_refresh(unsigned port)
+{
+   unsigned i;
+   struct input_snapshot *snapshot = NULL;
+   retro_time_t now                = cpu_features_get_time_usec();
+
+   /* Cores query inputs back to back, reading the driver again
+    * for every query would only add syscalls. */
+   if (     now - input_driver_refreshed >= INPUT_DRIVER_REFRESH_USEC
+         && current_input
+         && current_input->refresh)
+   {
+      input_driver_refreshed = now;
+
+      if (current_input->refresh(current_input_data))
+         for (i = 0; i < MAX_USERS; i++)
+            input_driver_snapshot[i].stale = true;
+   }
+
+   if (port >= MAX_USERS || !input_driver_snapshot[port].stale)
+      return false;
+
+   /* Only @port is re-resolved now, the others once the
+    * core moves on to them. */
+   snapshot               = &input_driver_snapshot[port];
+   snapshot->joypad_valid = false;
+   snapshot->analog_valid = false;
+   snapshot->stale        = false;
+
+   return true;
+}
+
+void input_driver_mark_event(retro_time_t time)
+{
+   video_pacing_input_event(time);
+   input_driver_event_pending = true;
+}
+
 bool input_driver_init(void)
 {
    unsigned i;
@@ -1028,6 +1167,19 @@ void input_driver_deinit(void)
    current_input_data = NULL;
 }
 
+void input_driver_log_statistics(void)
+{
+   if (!input_driver_polls)
+      return;
+
+   RARCH_LOG("[Input]: %.1f queries per frame (%llu frames).\n",
+         (double)input_driver_queries / input_driver_polls,
+         (unsigned long long)input_driver_polls);
+
+   input_driver_queries = 0;
+   input_driver_polls   = 0;
+}
+
 void input_driver_destroy_data(void)
 {
    current_input_data = NULL;
@@ -1042,6 +1194,7 @@ void input_driver_destroy(void)
    input_driver_flushing_input           = false;
    input_driver_data_own                 = false;
    memset(&input_driver_turbo_btns, 0, sizeof(turbo_buttons_t));
+   memset(input_driver_snapshot, 0, sizeof(input_driver_snapshot));
    current_input                         = NULL;
 }
 
@@ -116,6 +116,12 @@ typedef struct input_driver
    const input_device_driver_t *(*get_sec_joypad_driver)(void *data);
    bool (*keyboard_mapping_is_blocked)(void *data);
    void (*keyboard_mapping_set_block)(void *data, bool value);
+
+   /* Applies events which arrived since the last poll. Unlike
+    * poll, does not start a new frame of input, relative motion
+    * keeps accumulating. Returns true if any event was applied.
+    * Optional, used for cores which poll late. */
+   bool (*refresh)(void *data);
 } input_driver_t;
 
 extern const input_driver_t *current_input;
@@ -284,10 +290,48 @@ bool input_driver_has_capabilities(void);
 
 void input_driver_poll(void);
 
+/* Minimum time between two reads of the driver by
+ * input_driver_refresh(). */
+#define INPUT_DRIVER_REFRESH_USEC 1000
+
+/**
+ * input_driver_refresh:
+ * @port               : User the core is about to query.
+ *
+ * Picks up input events which arrived since the last poll,
+ * so that the core sees them when it queries @port again
+ * within the same frame. The driver is read at most once
+ * every INPUT_DRIVER_REFRESH_USEC, so this is cheap enough
+ * to call for every query.
+ *
+ * Returns: true (1) if the state of @port has to be resolved
+ * again, otherwise false (0).
+ **/
+bool input_driver_refresh(unsigned port);
+
+/**
+ * input_driver_mark_event:
+ * @time                 : when the event happened, on the clock of
+ *                         cpu_features_get_time_usec().
+ *
+ * Called by input drivers for events they applied during a poll,
+ * to measure latency from the event to the core reading it and
+ * to present.
+ **/
+void input_driver_mark_event(retro_time_t time);
+
 bool input_driver_init(void);
 
 void input_driver_deinit(void);
 
+/**
+ * input_driver_log_statistics:
+ *
+ * Logs how many times per frame the core queried input
+ * and resets the count.
+ **/
+void input_driver_log_statistics(void);
+
 void input_driver_destroy_data(void);
 
 void input_driver_destroy(void);
@@ -171,6 +171,8 @@ MSG_HASH(MENU_ENUM_LABEL_CONTENT_HISTORY_SIZE,
       "content_history_size")
 MSG_HASH(MENU_ENUM_LABEL_PLAYLIST_ENTRY_REMOVE,
       "playlist_entry_remove")
+MSG_HASH(MENU_ENUM_LABEL_PLAYLIST_BINARY_FORMAT,
+      "playlist_binary_format")
 MSG_HASH(MENU_ENUM_LABEL_CONTENT_SETTINGS,
       "quick_menu")
 MSG_HASH(MENU_ENUM_LABEL_CORE_ASSETS_DIRECTORY,
@@ -1005,6 +1007,8 @@ MSG_HASH(MENU_ENUM_LABEL_VIDEO_FORCE_SRGB_DISABLE,
       "video_force_srgb_disable")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_FRAME_DELAY,
       "video_frame_delay")
+MSG_HASH(MENU_ENUM_LABEL_VIDEO_FRAME_DELAY_AUTO,
+      "video_frame_delay_auto")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_FULLSCREEN,
       "video_fullscreen")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_GAMMA,
@@ -142,6 +142,14 @@ int menu_hash_get_help_us_enum(enum msg_hash_enums msg, char *s, size_t len) {
                                  "the window to allow relative mouse input to \n"
                                  "work better.");
                 break;
+            case RARCH_RECORD_REPLAY_SAVE:
+                snprintf(s, len,
+                         "Saves the instant replay ring. \n"
+                                 " \n"
+                                 "Only available while recording with \n"
+                                 "segment_time and replay_time set in \n"
+                                 "the recording config.");
+                break;
             case RARCH_GAME_FOCUS_TOGGLE:
                 snprintf(s, len,
                          "Toggles game focus.\n"
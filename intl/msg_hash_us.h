@@ -483,6 +483,8 @@ MSG_HASH(
       "History List Size")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_PLAYLIST_ENTRY_REMOVE,
       "Allow to remove entries")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_PLAYLIST_BINARY_FORMAT,
+      "Save playlists in binary format")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_CONTENT_SETTINGS,
       "Quick Menu")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_CORE_ASSETS_DIR,
@@ -767,6 +769,8 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_INPUT_META_GRAB_MOUSE_TOGGLE,
       "Grab mouse toggle")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_INPUT_META_GAME_FOCUS_TOGGLE,
       "Game focus toggle")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_INPUT_META_RECORD_REPLAY_SAVE,
+      "Save instant replay")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_INPUT_META_LOAD_STATE_KEY,
       "Load state")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_INPUT_META_MENU_TOGGLE,
@@ -1565,6 +1569,8 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FORCE_SRGB_DISABLE,
       "Force-disable sRGB FBO")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FRAME_DELAY,
       "Frame Delay")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FRAME_DELAY_AUTO,
+      "Automatic Frame Delay")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FULLSCREEN,
       "Use Fullscreen Mode")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_GAMMA,
@@ -1805,6 +1811,8 @@ MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_BLACK_FRAME_INSERTION,
       "Inserts a black frame inbetween frames. Useful for users with 120Hz screens who want to play 60Hz content to eliminate ghosting.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_FRAME_DELAY,
       "Reduces latency at the cost of a higher risk of video stuttering. Adds a delay after V-Sync (in ms).")
+MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_FRAME_DELAY_AUTO,
+      "Runs the core as late before V-Sync as its recent frame times allow. Overrides Frame Delay.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_HARD_SYNC_FRAMES,
       "Sets how many frames the CPU can run ahead of the GPU when using 'Hard GPU Sync'.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_MAX_SWAPCHAIN_IMAGES,
@@ -2073,6 +2081,10 @@ MSG_HASH(MSG_MOVIE_PLAYBACK_ENDED,
       "Movie playback ended.")
 MSG_HASH(MSG_MOVIE_RECORD_STOPPED,
       "Stopping movie record.")
+MSG_HASH(MSG_RECORD_REPLAY_SAVED,
+      "Instant replay saved.")
+MSG_HASH(MSG_RECORD_REPLAY_FAILED,
+      "Instant replay is not available.")
 MSG_HASH(MSG_NETPLAY_FAILED,
       "Failed to initialize netplay.")
 MSG_HASH(MSG_NO_CONTENT_STARTING_DUMMY_CORE,
@@ -2800,6 +2812,8 @@ MSG_HASH(MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_ENABLE,
       "Perform tasks on a separate thread.")
 MSG_HASH(MENU_ENUM_SUBLABEL_PLAYLIST_ENTRY_REMOVE,
       "Allow the user to remove entries from collections.")
+MSG_HASH(MENU_ENUM_SUBLABEL_PLAYLIST_BINARY_FORMAT,
+      "Save playlists in a compact indexed format that loads faster. Both formats are always readable.")
 MSG_HASH(MENU_ENUM_SUBLABEL_SYSTEM_DIRECTORY,
       "Sets the System directory. Cores can query for this directory to load BIOSes, system-specific configs, etc.")
 MSG_HASH(MENU_ENUM_SUBLABEL_RGUI_BROWSER_DIRECTORY,
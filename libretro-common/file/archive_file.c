@@ -40,6 +40,7 @@
 
 #include <compat/strl.h>
 #include <file/archive_file.h>
+#include <rhash.h>
 #include <file/file_path.h>
 #include <streams/file_stream.h>
 #include <retro_stat.h>
@@ -47,6 +48,61 @@
 #include <lists/string_list.h>
 #include <string/stdstring.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#define FILE_ARCHIVE_INDEX_CACHE_SIZE 4
+
+struct file_archive_index_entry
+{
+   char *name;
+   uint32_t hash;
+   bool is_dir;
+   struct file_archive_entry entry;
+};
+
+/* Every entry of an archive, as found by one walk over its
+ * central directory (ZIP) or header (7z). Indexes are cached
+ * by path and invalidated when the size or mtime changes.
+ * They don't change once built, so lookups only hold the
+ * cache lock to take and drop a reference. */
+struct file_archive_index
+{
+   char *path;
+   int64_t mtime;
+   int32_t size;
+   unsigned last_used;
+   /* Lookups in flight; an index evicted meanwhile is freed
+    * by the last of them. */
+   unsigned refs;
+   bool evicted;
+   size_t count;
+   size_t capacity;
+   struct file_archive_index_entry *entries;
+   /* Open addressing table of entry index + 1, 0 is empty. */
+   uint32_t *table;
+   size_t table_size;
+};
+
+struct file_archive_index_builder
+{
+   /* Must be first, the walk callback casts back from it. */
+   struct archive_extract_userdata userdata;
+   const file_archive_transfer_t *state;
+   struct file_archive_index *index;
+   uint64_t ordinal;
+   bool error;
+};
+
+static struct file_archive_index
+   *file_archive_index_cache[FILE_ARCHIVE_INDEX_CACHE_SIZE];
+static unsigned file_archive_index_clock = 0;
+static bool file_archive_cache_inited    = false;
+#ifdef HAVE_THREADS
+static slock_t *file_archive_cache_lock  = NULL;
+#endif
+
 struct file_archive_file_data
 {
 #ifdef HAVE_MMAP
@@ -167,68 +223,6 @@ error:
 }
 #endif
 
-static int file_archive_get_file_list_cb(
-      const char *path,
-      const char *valid_exts,
-      const uint8_t *cdata,
-      unsigned cmode,
-      uint32_t csize,
-      uint32_t size,
-      uint32_t checksum,
-      struct archive_extract_userdata *userdata)
-{
-   union string_list_elem_attr attr;
-   int ret                      = 0;
-   struct string_list *ext_list = NULL;
-   size_t path_len              = strlen(path);
-
-   (void)cdata;
-   (void)cmode;
-   (void)csize;
-   (void)size;
-   (void)checksum;
-
-   attr.i = 0;
-
-   if (!path_len)
-      return 0;
-
-   if (valid_exts)
-      ext_list = string_split(valid_exts, "|");
-
-   if (ext_list)
-   {
-      const char *file_ext         = NULL;
-      /* Checks if this entry is a directory or a file. */
-      char last_char = path[path_len-1];
-
-      /* Skip if directory. */
-      if (last_char == '/' || last_char == '\\' )
-         goto error;
-
-      file_ext = path_get_extension(path);
-
-      if (!file_ext)
-         goto error;
-      
-      if (!string_list_find_elem_prefix(ext_list, ".", file_ext))
-      {
-         /* keep iterating */
-         ret = -1;
-         goto error;
-      }
-
-      attr.i = RARCH_COMPRESSED_FILE_IN_ARCHIVE;
-      string_list_free(ext_list);
-   }
-
-   return string_list_append(userdata->list, path, attr);
-
-error:
-   string_list_free(ext_list);
-   return ret;
-}
-
 static int file_archive_extract_cb(const char *name, const char *valid_exts,
       const uint8_t *cdata,
       unsigned cmode, uint32_t csize, uint32_t size,
@@ -512,6 +506,454 @@ int file_archive_parse_file_progress(file_archive_transfer_t *state)
    return (int)(delta * 100 / state->archive_size);
 }
 
+static void file_archive_index_free(struct file_archive_index *index)
+{
+   size_t i;
+
+   if (!index)
+      return;
+
+   for (i = 0; i < index->count; i++)
+      free(index->entries[i].name);
+
+   free(index->entries);
+   free(index->table);
+   free(index->path);
+   free(index);
+}
+
+static int file_archive_index_cb(const char *name, const char *valid_exts,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t checksum, struct archive_extract_userdata *userdata)
+{
+   struct file_archive_index_builder *builder =
+      (struct file_archive_index_builder*)userdata;
+   struct file_archive_index *index           = builder->index;
+   struct file_archive_index_entry *entry     = NULL;
+   uint64_t ordinal                           = builder->ordinal++;
+   size_t len                                 = strlen(name);
+
+   (void)valid_exts;
+
+   /* 7z directories are reported without a name. */
+   if (!len)
+      return 1;
+
+   if (index->count == index->capacity)
+   {
+      size_t capacity = index->capacity ? index->capacity * 2 : 16;
+      struct file_archive_index_entry *entries =
+         (struct file_archive_index_entry*)realloc(index->entries,
+               capacity * sizeof(*entries));
+
+      if (!entries)
+         goto error;
+
+      index->entries  = entries;
+      index->capacity = capacity;
+   }
+
+   entry       = &index->entries[index->count];
+   entry->name = strdup(name);
+
+   if (!entry->name)
+      goto error;
+
+   entry->hash         = djb2_calculate(name);
+   entry->is_dir       = name[len - 1] == '/' || name[len - 1] == '\\';
+   entry->entry.crc32  = checksum;
+   entry->entry.size   = size;
+   entry->entry.csize  = csize;
+   entry->entry.cmode  = cmode;
+
+   /* 7z entries carry no data pointer,
+    * they are addressed by their file index instead. */
+   if (cdata)
+      entry->entry.offset = (uint64_t)(cdata - builder->state->data);
+   else
+      entry->entry.offset = ordinal;
+
+   index->count++;
+
+   return 1;
+
+error:
+   builder->error = true;
+   return 0;
+}
+
+static bool file_archive_index_build_table(struct file_archive_index *index)
+{
+   size_t i;
+   size_t table_size = 8;
+
+   while (table_size < index->count * 2)
+      table_size *= 2;
+
+   index->table      = (uint32_t*)calloc(table_size, sizeof(uint32_t));
+   index->table_size = table_size;
+
+   if (!index->table)
+      return false;
+
+   for (i = 0; i < index->count; i++)
+   {
+      size_t slot = index->entries[i].hash & (table_size - 1);
+
+      while (index->table[slot])
+         slot = (slot + 1) & (table_size - 1);
+
+      index->table[slot] = (uint32_t)(i + 1);
+   }
+
+   return true;
+}
+
+static struct file_archive_index *file_archive_index_new(
+      const char *path, int32_t size, int64_t mtime)
+{
+   file_archive_transfer_t state;
+   struct file_archive_index_builder builder;
+   bool returnerr                = true;
+
+   memset(&builder, 0, sizeof(builder));
+
+   builder.state                 = &state;
+   builder.index                 = (struct file_archive_index*)
+      calloc(1, sizeof(*builder.index));
+
+   if (!builder.index)
+      return NULL;
+
+   builder.index->path           = strdup(path);
+   builder.index->size           = size;
+   builder.index->mtime          = mtime;
+
+   state.type                    = ARCHIVE_TRANSFER_INIT;
+   state.archive_size            = 0;
+   state.handle                  = NULL;
+   state.stream                  = NULL;
+   state.footer                  = NULL;
+   state.directory               = NULL;
+   state.data                    = NULL;
+   state.backend                 = NULL;
+
+   for (;;)
+   {
+      if (file_archive_parse_file_iterate(&state, &returnerr, path,
+            NULL, file_archive_index_cb, &builder.userdata) != 0)
+         break;
+   }
+
+   if (!returnerr || builder.error || !builder.index->path
+         || !file_archive_index_build_table(builder.index))
+   {
+      file_archive_index_free(builder.index);
+      return NULL;
+   }
+
+   return builder.index;
+}
+
+static const struct file_archive_index_entry *file_archive_index_lookup(
+      const struct file_archive_index *index, const char *needle,
+      bool partial)
+{
+   size_t i;
+
+   /* No needle, use the first file. */
+   if (string_is_empty(needle))
+   {
+      for (i = 0; i < index->count; i++)
+         if (!index->entries[i].is_dir)
+            return &index->entries[i];
+      return NULL;
+   }
+
+   if (index->table)
+   {
+      uint32_t hash = djb2_calculate(needle);
+      size_t slot   = hash & (index->table_size - 1);
+
+      while (index->table[slot])
+      {
+         const struct file_archive_index_entry *entry =
+            &index->entries[index->table[slot] - 1];
+
+         if (     entry->hash == hash
+               && !entry->is_dir
+               && string_is_equal(entry->name, needle))
+            return entry;
+
+         slot = (slot + 1) & (index->table_size - 1);
+      }
+   }
+
+   if (partial)
+   {
+      for (i = 0; i < index->count; i++)
+         if (!index->entries[i].is_dir
+               && strstr(index->entries[i].name, needle))
+            return &index->entries[i];
+   }
+
+   return NULL;
+}
+
+/* Returns the cached index of the archive at @path with a
+ * reference taken, or NULL. Must be called with the cache
+ * lock held. */
+static struct file_archive_index *file_archive_index_find(
+      const char *path, int32_t size, int64_t mtime)
+{
+   unsigned i;
+
+   for (i = 0; i < FILE_ARCHIVE_INDEX_CACHE_SIZE; i++)
+   {
+      struct file_archive_index *index = file_archive_index_cache[i];
+
+      if (     index
+            && index->size  == size
+            && index->mtime == mtime
+            && string_is_equal(index->path, path))
+      {
+         index->last_used = ++file_archive_index_clock;
+         index->refs++;
+         return index;
+      }
+   }
+
+   return NULL;
+}
+
+/* Caches @index in place of the least recently used one and
+ * takes a reference. Must be called with the cache lock held. */
+static void file_archive_index_insert(struct file_archive_index *index)
+{
+   unsigned i;
+   unsigned victim = 0;
+
+   for (i = 0; i < FILE_ARCHIVE_INDEX_CACHE_SIZE; i++)
+   {
+      if (!file_archive_index_cache[i])
+      {
+         victim = i;
+         break;
+      }
+
+      if (file_archive_index_cache[i]->last_used
+            < file_archive_index_cache[victim]->last_used)
+         victim = i;
+   }
+
+   if (file_archive_index_cache[victim])
+   {
+      if (file_archive_index_cache[victim]->refs)
+         file_archive_index_cache[victim]->evicted = true;
+      else
+         file_archive_index_free(file_archive_index_cache[victim]);
+   }
+
+   file_archive_index_cache[victim] = index;
+   index->last_used                 = ++file_archive_index_clock;
+   index->refs                      = 1;
+}
+
+/**
+ * file_archive_cache_init:
+ *
+ * Enables caching of archive indexes (and decoded 7z blocks).
+ * Until this is called every lookup walks the archive again.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool file_archive_cache_init(void)
+{
+   if (file_archive_cache_inited)
+      return true;
+
+#ifdef HAVE_THREADS
+   file_archive_cache_lock = slock_new();
+   if (!file_archive_cache_lock)
+      return false;
+#endif
+
+#ifdef HAVE_7ZIP
+   if (!sevenzip_cache_init())
+   {
+#ifdef HAVE_THREADS
+      slock_free(file_archive_cache_lock);
+      file_archive_cache_lock = NULL;
+#endif
+      return false;
+   }
+#endif
+
+   file_archive_cache_inited = true;
+   return true;
+}
+
+/**
+ * file_archive_cache_deinit:
+ *
+ * Drops every cached index and decoded block. No archive
+ * lookup may be in flight.
+ **/
+void file_archive_cache_deinit(void)
+{
+   unsigned i;
+
+   if (!file_archive_cache_inited)
+      return;
+
+   file_archive_cache_inited = false;
+
+   for (i = 0; i < FILE_ARCHIVE_INDEX_CACHE_SIZE; i++)
+   {
+      file_archive_index_free(file_archive_index_cache[i]);
+      file_archive_index_cache[i] = NULL;
+   }
+
+#ifdef HAVE_7ZIP
+   sevenzip_cache_deinit();
+#endif
+
+#ifdef HAVE_THREADS
+   slock_free(file_archive_cache_lock);
+   file_archive_cache_lock = NULL;
+#endif
+}
+
+/* Returns the index of @path with a reference taken, or a
+ * private index when caching is disabled. Pair with
+ * file_archive_index_release. On a miss the archive is walked
+ * without the cache lock held, so lookups in other archives
+ * go on meanwhile. */
+static struct file_archive_index *file_archive_index_acquire(const char *file)
+{
+   char path[PATH_MAX_LENGTH];
+   int32_t size;
+   int64_t mtime;
+   char *last                       = NULL;
+   struct file_archive_index *index = NULL;
+   struct file_archive_index *built = NULL;
+
+   strlcpy(path, file, sizeof(path));
+
+   last = (char*)path_get_archive_delim(path);
+
+   if (last)
+      *last = '\0';
+
+   if (!file_archive_cache_inited)
+   {
+      int32_t size = path_get_size(path);
+
+      if (size < 0)
+         return NULL;
+      return file_archive_index_new(path, size, 0);
+   }
+
+   size  = path_get_size(path);
+   mtime = path_get_mtime(path);
+
+   if (size < 0 || mtime < 0)
+      return NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(file_archive_cache_lock);
+#endif
+   index = file_archive_index_find(path, size, mtime);
+#ifdef HAVE_THREADS
+   slock_unlock(file_archive_cache_lock);
+#endif
+
+   if (index)
+      return index;
+
+   built = file_archive_index_new(path, size, mtime);
+
+   if (!built)
+      return NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(file_archive_cache_lock);
+#endif
+
+   /* Another lookup may have built it in the meantime. */
+   index = file_archive_index_find(path, size, mtime);
+
+   if (!index)
+   {
+      file_archive_index_insert(built);
+      index = built;
+      built = NULL;
+   }
+
+#ifdef HAVE_THREADS
+   slock_unlock(file_archive_cache_lock);
+#endif
+
+   file_archive_index_free(built);
+
+   return index;
+}
+
+static void file_archive_index_release(struct file_archive_index *index)
+{
+   if (!file_archive_cache_inited)
+   {
+      file_archive_index_free(index);
+      return;
+   }
+
+#ifdef HAVE_THREADS
+   slock_lock(file_archive_cache_lock);
+#endif
+
+   if (--index->refs == 0 && index->evicted)
+      file_archive_index_free(index);
+
+#ifdef HAVE_THREADS
+   slock_unlock(file_archive_cache_lock);
+#endif
+}
+
+/**
+ * file_archive_find_entry:
+ * @archive_path                : filename path of archive, without
+ *                                the path within the archive.
+ * @needle                      : path within the archive, NULL or
+ *                                empty for the first file.
+ * @partial                     : when there is no exact match, accept
+ *                                the first file containing @needle.
+ * @entry                       : location of the found entry.
+ *
+ * Looks up a file in the index of @archive_path. Directories
+ * are never returned.
+ *
+ * Returns: true (1) if the file was found, otherwise false (0).
+ **/
+bool file_archive_find_entry(const char *archive_path, const char *needle,
+      bool partial, struct file_archive_entry *entry)
+{
+   const struct file_archive_index_entry *found = NULL;
+   struct file_archive_index *index             =
+      file_archive_index_acquire(archive_path);
+
+   if (!index)
+      return false;
+
+   found = file_archive_index_lookup(index, needle, partial);
+
+   if (found)
+      *entry = found->entry;
+
+   file_archive_index_release(index);
+
+   return found != NULL;
+}
+
 /**
  * file_archive_extract_file:
  * @archive_path                    : filename path to archive.
@@ -597,46 +1039,57 @@ end:
 struct string_list *file_archive_get_file_list(const char *path,
       const char *valid_exts)
 {
-   int ret;
-   struct archive_extract_userdata userdata;
+   size_t i;
+   struct string_list *list         = NULL;
+   struct string_list *ext_list     = NULL;
+   struct file_archive_index *index = file_archive_index_acquire(path);
 
-   strlcpy(userdata.archive_path, path, sizeof(userdata.archive_path));
-   userdata.first_extracted_file_path       = NULL;
-   userdata.extracted_file_path             = NULL;
-   userdata.extraction_directory            = NULL;
-   userdata.archive_path_size               = 0;
-   userdata.ext                             = NULL;
-   userdata.list                            = string_list_new();
-   userdata.found_file                      = false;
-   userdata.list_only                       = true;
-   userdata.context                         = NULL;
-   userdata.archive_name[0]                 = '\0';
-   userdata.crc                             = 0;
-   userdata.dec                             = NULL;
-
-   userdata.decomp_state.opt_file           = NULL;
-   userdata.decomp_state.needle             = NULL;
-   userdata.decomp_state.size               = 0;
-   userdata.decomp_state.found              = NULL;
-
-   if (!userdata.list)
-      goto error;
+   if (!index)
+      return NULL;
+
+   list = string_list_new();
 
-   ret = file_archive_walk(path, valid_exts,
-         file_archive_get_file_list_cb, &userdata);
+   if (!list)
+      goto end;
 
-   if (ret <= 0)
+   if (valid_exts)
+      ext_list = string_split(valid_exts, "|");
+
+   for (i = 0; i < index->count; i++)
    {
-      if (ret != -1)
-         goto error;
-   }
+      union string_list_elem_attr attr;
+      const struct file_archive_index_entry *entry = &index->entries[i];
 
-   return userdata.list;
+      attr.i = 0;
 
-error:
-   if (userdata.list)
-      string_list_free(userdata.list);
-   return NULL;
+      if (ext_list)
+      {
+         const char *file_ext = NULL;
+
+         if (entry->is_dir)
+            continue;
+
+         file_ext = path_get_extension(entry->name);
+
+         if (!file_ext ||
+               !string_list_find_elem_prefix(ext_list, ".", file_ext))
+            continue;
+
+         attr.i = RARCH_COMPRESSED_FILE_IN_ARCHIVE;
+      }
+
+      if (!string_list_append(list, entry->name, attr))
+      {
+         string_list_free(list);
+         list = NULL;
+         break;
+      }
+   }
+
+end:
+   string_list_free(ext_list);
+   file_archive_index_release(index);
+   return list;
 }
 
 bool file_archive_perform_mode(const char *path, const char *valid_exts,
@@ -663,6 +1116,14 @@ bool file_archive_perform_mode(const char *path, const char *valid_exts,
             if (!handle.backend)
                goto error;
 
+            if (handle.backend->stream_decompress_to_file)
+            {
+               if (!handle.backend->stream_decompress_to_file(path,
+                        cdata, csize, size, crc32))
+                  goto error;
+               break;
+            }
+
             if (!handle.backend->stream_decompress_data_to_file_init(&handle,
                      cdata, csize, size))
                goto error;
@@ -843,19 +1304,13 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
  **/
 uint32_t file_archive_get_file_crc32(const char *path)
 {
-   file_archive_transfer_t state;
-   const struct file_archive_file_backend *backend = file_archive_get_file_backend(path);
-   struct archive_extract_userdata userdata        = {{0}};
-   bool returnerr                                  = false;
-   bool contains_compressed                        = false;
-   const char *archive_path                        = NULL;
+   struct file_archive_entry entry;
+   const char *archive_path = NULL;
 
-   if (!backend)
+   if (!file_archive_get_file_backend(path))
       return 0;
 
-   contains_compressed = path_contains_compressed_file(path);
-
-   if (contains_compressed)
+   if (path_contains_compressed_file(path))
    {
       archive_path = path_get_archive_delim(path);
 
@@ -864,49 +1319,8 @@ uint32_t file_archive_get_file_crc32(const char *path)
          archive_path += 1;
    }
 
-   state.type          = ARCHIVE_TRANSFER_INIT;
-   state.archive_size  = 0;
-   state.handle        = NULL;
-   state.stream        = NULL;
-   state.footer        = NULL;
-   state.directory     = NULL;
-   state.data          = NULL;
-   state.backend       = NULL;
-
-   /* Initialize and open archive first.
-      Sets next state type to ITERATE. */
-   file_archive_parse_file_iterate(&state,
-            &returnerr, path, NULL, NULL,
-            &userdata);
-
-   for (;;)
-   {
-      /* Now find the first file in the archive. */
-      if (state.type == ARCHIVE_TRANSFER_ITERATE)
-         file_archive_parse_file_iterate(&state,
-                  &returnerr, path, NULL, NULL,
-                  &userdata);
-
-      /* If no path specified within archive, stop after
-       * finding the first file.
-       */
-      if (!contains_compressed)
-         break;
-
-      /* Stop when the right file in the archive is found. */
-      if (archive_path)
-      {
-         if (string_is_equal(userdata.extracted_file_path, archive_path))
-            break;
-      }
-      else
-         break;
-   }
-
-   file_archive_parse_file_iterate_stop(&state);
-
-   if (userdata.crc)
-      return userdata.crc;
+   if (!file_archive_find_entry(path, archive_path, false, &entry))
+      return 0;
 
-   return 0;
+   return entry.crc32;
 }
@@ -31,6 +31,10 @@
 #include <lists/string_list.h>
 #include <file/file_path.h>
 #include <compat/strl.h>
+#include <retro_stat.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include "../../deps/7zip/7z.h"
 #include "../../deps/7zip/7zAlloc.h"
 #include "../../deps/7zip/7zCrc.h"
@@ -39,6 +43,10 @@
 #define SEVENZIP_MAGIC "7z\xBC\xAF\x27\x1C"
 #define SEVENZIP_MAGIC_LEN 6
 
+#define SEVENZIP_CACHE_ARCHIVES  2
+#define SEVENZIP_CACHE_BLOCKS    4
+#define SEVENZIP_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
 struct sevenzip_context_t {
    CFileInStream archiveStream;
    CLookToRead lookStream;
@@ -89,172 +97,493 @@ static void sevenzip_stream_free(void *data)
    File_Close(&sevenzip_context->archiveStream.file);
 }
 
-/* Extract the relative path (needle) from a 7z archive
- * (path) and allocate a buf for it to write it in.
- * If optional_outfile is set, extract to that instead
- * and don't allocate buffer.
- */
-static int sevenzip_file_read(
-      const char *path,
-      const char *needle, void **buf,
-      const char *optional_outfile)
+/* An archive kept open between reads, so the header
+ * is only parsed once. The cache lock covers the
+ * bookkeeping, the archive's own lock its stream. */
+struct sevenzip_archive
 {
+   char *path;
+   int64_t mtime;
+   int32_t size;
+   unsigned last_used;
+   /* Reads in flight; an archive evicted meanwhile is
+    * freed by the last of them. */
+   unsigned refs;
+   bool evicted;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
    CFileInStream archiveStream;
    CLookToRead lookStream;
-   ISzAlloc allocImp;
-   ISzAlloc allocTempImp;
    CSzArEx db;
-   uint8_t *output      = 0;
-   long outsize         = -1;
+};
+
+/* A decoded solid block. Files of the same block are
+ * served from it without running LZMA again. */
+struct sevenzip_block
+{
+   struct sevenzip_archive *archive;
+   uint32_t index;
+   unsigned last_used;
+   /* Reads copying out of it, it isn't evicted meanwhile. */
+   unsigned refs;
+   uint8_t *output;
+   size_t size;
+};
+
+static ISzAlloc sevenzip_alloc      = { SzAlloc, SzFree };
+static ISzAlloc sevenzip_alloc_temp = { SzAllocTemp, SzFreeTemp };
+
+static struct sevenzip_archive *sevenzip_archives[SEVENZIP_CACHE_ARCHIVES];
+static struct sevenzip_block sevenzip_blocks[SEVENZIP_CACHE_BLOCKS];
+static size_t sevenzip_cache_bytes  = 0;
+static unsigned sevenzip_cache_clock = 0;
+static bool sevenzip_cache_inited    = false;
+#ifdef HAVE_THREADS
+static slock_t *sevenzip_cache_lock  = NULL;
+#endif
+
+static void sevenzip_block_free(struct sevenzip_block *block)
+{
+   if (block->output)
+      IAlloc_Free(&sevenzip_alloc, block->output);
+
+   sevenzip_cache_bytes -= block->size;
 
-   /*These are the allocation routines.
-    * Currently using the non-standard 7zip choices. */
-   allocImp.Alloc       = SzAlloc;
-   allocImp.Free        = SzFree;
-   allocTempImp.Alloc   = SzAllocTemp;
-   allocTempImp.Free    = SzFreeTemp;
+   block->archive       = NULL;
+   block->index         = 0xFFFFFFFF;
+   block->output        = NULL;
+   block->size          = 0;
+   block->refs          = 0;
+}
+
+static void sevenzip_archive_free(struct sevenzip_archive *archive)
+{
+   unsigned i;
+
+   if (!archive)
+      return;
+
+   for (i = 0; i < SEVENZIP_CACHE_BLOCKS; i++)
+      if (sevenzip_blocks[i].archive == archive)
+         sevenzip_block_free(&sevenzip_blocks[i]);
+
+   SzArEx_Free(&archive->db, &sevenzip_alloc);
+   File_Close(&archive->archiveStream.file);
+#ifdef HAVE_THREADS
+   if (archive->lock)
+      slock_free(archive->lock);
+#endif
+   free(archive->path);
+   free(archive);
+}
+
+static struct sevenzip_archive *sevenzip_archive_open(const char *path,
+      int32_t size, int64_t mtime)
+{
+   struct sevenzip_archive *archive = (struct sevenzip_archive*)
+      calloc(1, sizeof(*archive));
+
+   if (!archive)
+      return NULL;
 
    /* Could not open 7zip archive? */
-   if (InFile_Open(&archiveStream.file, path))
-      return -1;
+   if (InFile_Open(&archive->archiveStream.file, path))
+   {
+      free(archive);
+      return NULL;
+   }
 
-   FileInStream_CreateVTable(&archiveStream);
-   LookToRead_CreateVTable(&lookStream, False);
-   lookStream.realStream = &archiveStream.s;
-   LookToRead_Init(&lookStream);
+   FileInStream_CreateVTable(&archive->archiveStream);
+   LookToRead_CreateVTable(&archive->lookStream, False);
+   archive->lookStream.realStream = &archive->archiveStream.s;
+   LookToRead_Init(&archive->lookStream);
    CrcGenerateTable();
+   SzArEx_Init(&archive->db);
+
+   archive->path  = strdup(path);
+   archive->size  = size;
+   archive->mtime = mtime;
+#ifdef HAVE_THREADS
+   archive->lock  = slock_new();
+
+   if (!archive->lock)
+   {
+      sevenzip_archive_free(archive);
+      return NULL;
+   }
+#endif
 
-   db.db.PackSizes               = NULL;
-   db.db.PackCRCsDefined         = NULL;
-   db.db.PackCRCs                = NULL;
-   db.db.Folders                 = NULL;
-   db.db.Files                   = NULL;
-   db.db.NumPackStreams          = 0;
-   db.db.NumFolders              = 0;
-   db.db.NumFiles                = 0;
-   db.startPosAfterHeader        = 0;
-   db.dataPos                    = 0;
-   db.FolderStartPackStreamIndex = NULL;
-   db.PackStreamStartPositions   = NULL;
-   db.FolderStartFileIndex       = NULL;
-   db.FileIndexToFolderIndexMap  = NULL;
-   db.FileNameOffsets            = NULL;
-   db.FileNames.data             = NULL;
-   db.FileNames.size             = 0;
-
-   SzArEx_Init(&db);
-
-   if (SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp) == SZ_OK)
+   if (!archive->path || SzArEx_Open(&archive->db, &archive->lookStream.s,
+            &sevenzip_alloc, &sevenzip_alloc_temp) != SZ_OK)
    {
-      uint32_t i;
-      bool file_found      = false;
-      uint16_t *temp       = NULL;
-      size_t temp_size     = 0;
-      uint32_t block_index = 0xFFFFFFFF;
-      SRes res             = SZ_OK;
-
-      for (i = 0; i < db.db.NumFiles; i++)
+      sevenzip_archive_free(archive);
+      return NULL;
+   }
+
+   return archive;
+}
+
+/* Returns the cached archive for @path with a reference
+ * taken, or NULL. Must be called with the cache lock held. */
+static struct sevenzip_archive *sevenzip_archive_find(const char *path,
+      int32_t size, int64_t mtime)
+{
+   unsigned i;
+
+   for (i = 0; i < SEVENZIP_CACHE_ARCHIVES; i++)
+   {
+      struct sevenzip_archive *archive = sevenzip_archives[i];
+
+      if (     archive
+            && archive->size  == size
+            && archive->mtime == mtime
+            && string_is_equal(archive->path, path))
       {
-         size_t len;
-         char infile[PATH_MAX_LENGTH];
-         size_t offset                = 0;
-         size_t outSizeProcessed      = 0;
-         const CSzFileItem    *f      = db.db.Files + i;
-
-         /* We skip over everything which is not a directory.
-          * FIXME: Why continue then if f->IsDir is true?*/
-         if (f->IsDir)
-            continue;
+         archive->last_used = ++sevenzip_cache_clock;
+         archive->refs++;
+         return archive;
+      }
+   }
 
-         len = SzArEx_GetFileNameUtf16(&db, i, NULL);
+   return NULL;
+}
 
-         if (len > temp_size)
-         {
-            if (temp)
-               free(temp);
-            temp_size = len;
-            temp = (uint16_t *)malloc(temp_size * sizeof(temp[0]));
+/* Drops a reference taken by sevenzip_archive_acquire.
+ * Must be called with the cache lock held. */
+static void sevenzip_archive_put(struct sevenzip_archive *archive)
+{
+   if (--archive->refs == 0 && archive->evicted)
+      sevenzip_archive_free(archive);
+}
 
-            if (temp == 0)
-            {
-               res = SZ_ERROR_MEM;
-               break;
-            }
-         }
+/* Returns the open archive for @path with a reference taken,
+ * opening it on a miss. The header is parsed without the cache
+ * lock held, so other archives can be read meanwhile. */
+static struct sevenzip_archive *sevenzip_archive_acquire(const char *path)
+{
+   unsigned i;
+   unsigned victim                  = 0;
+   struct sevenzip_archive *archive = NULL;
+   struct sevenzip_archive *opened  = NULL;
+   int32_t size                     = path_get_size(path);
+   int64_t mtime                    = path_get_mtime(path);
+
+   if (size < 0 || mtime < 0)
+      return NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(sevenzip_cache_lock);
+#endif
+   archive = sevenzip_archive_find(path, size, mtime);
+#ifdef HAVE_THREADS
+   slock_unlock(sevenzip_cache_lock);
+#endif
+
+   if (archive)
+      return archive;
+
+   opened = sevenzip_archive_open(path, size, mtime);
+
+   if (!opened)
+      return NULL;
 
-         SzArEx_GetFileNameUtf16(&db, i, temp);
-         res       = SZ_ERROR_FAIL;
-         infile[0] = '\0';
+#ifdef HAVE_THREADS
+   slock_lock(sevenzip_cache_lock);
+#endif
 
-         if (temp)
-            res = utf16_to_char_string(temp, infile, sizeof(infile))
-               ? SZ_OK : SZ_ERROR_FAIL;
+   /* Another read may have opened it in the meantime. */
+   archive = sevenzip_archive_find(path, size, mtime);
 
-         if (string_is_equal(infile, needle))
+   if (!archive)
+   {
+      for (i = 0; i < SEVENZIP_CACHE_ARCHIVES; i++)
+      {
+         if (!sevenzip_archives[i])
          {
-            size_t output_size   = 0;
+            victim = i;
+            break;
+         }
 
-            /*RARCH_LOG_OUTPUT("Opened archive %s. Now trying to extract %s\n",
-                  path, needle);*/
+         if (sevenzip_archives[i]->last_used
+               < sevenzip_archives[victim]->last_used)
+            victim = i;
+      }
 
-            /* C LZMA SDK does not support chunked extraction - see here:
-             * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
-             * */
-            file_found = true;
-            res = SzArEx_Extract(&db, &lookStream.s, i, &block_index,
-                  &output, &output_size, &offset, &outSizeProcessed,
-                  &allocImp, &allocTempImp);
+      if (sevenzip_archives[victim])
+      {
+         if (sevenzip_archives[victim]->refs)
+            sevenzip_archives[victim]->evicted = true;
+         else
+            sevenzip_archive_free(sevenzip_archives[victim]);
+      }
+
+      archive                   = opened;
+      opened                    = NULL;
+      archive->last_used        = ++sevenzip_cache_clock;
+      archive->refs             = 1;
+      sevenzip_archives[victim] = archive;
+   }
 
-            if (res != SZ_OK)
-               break; /* This goes to the error section. */
+#ifdef HAVE_THREADS
+   slock_unlock(sevenzip_cache_lock);
+#endif
 
-            outsize = outSizeProcessed;
+   if (opened)
+      sevenzip_archive_free(opened);
 
-            if (optional_outfile != NULL)
-            {
-               const void *ptr = (const void*)(output + offset);
-
-               if (!filestream_write_file(optional_outfile, ptr, outsize))
-               {
-                  /*RARCH_ERR("Could not open outfilepath %s.\n",
-                        optional_outfile);*/
-                  res        = SZ_OK;
-                  file_found = true;
-                  outsize    = -1;
-               }
-            }
-            else
+   return archive;
+}
+
+/* Keeps a freshly decoded block, evicting the least recently
+ * used ones to stay within SEVENZIP_CACHE_MAX_BYTES.
+ * Returns false if the block wasn't taken over. */
+static bool sevenzip_block_insert(struct sevenzip_archive *archive,
+      uint32_t index, uint8_t *output, size_t size)
+{
+   unsigned i;
+
+   if (size > SEVENZIP_CACHE_MAX_BYTES)
+      return false;
+
+   /* Decoded by another read in the meantime. */
+   for (i = 0; i < SEVENZIP_CACHE_BLOCKS; i++)
+      if (     sevenzip_blocks[i].output
+            && sevenzip_blocks[i].archive == archive
+            && sevenzip_blocks[i].index   == index)
+         return false;
+
+   for (;;)
+   {
+      struct sevenzip_block *victim = NULL;
+
+      for (i = 0; i < SEVENZIP_CACHE_BLOCKS; i++)
+      {
+         struct sevenzip_block *block = &sevenzip_blocks[i];
+
+         if (!block->output)
+         {
+            if (sevenzip_cache_bytes + size <= SEVENZIP_CACHE_MAX_BYTES)
             {
-               /*We could either use the 7Zip allocated buffer,
-                * or create our own and use it.
-                * We would however need to realloc anyways, because RetroArch
-                * expects a \0 at the end, therefore we allocate new,
-                * copy and free the old one. */
-               *buf = malloc(outsize + 1);
-               ((char*)(*buf))[outsize] = '\0';
-               memcpy(*buf,output + offset,outsize);
+               block->archive        = archive;
+               block->index          = index;
+               block->output         = output;
+               block->size           = size;
+               block->last_used      = ++sevenzip_cache_clock;
+               block->refs           = 0;
+               sevenzip_cache_bytes += size;
+               return true;
             }
-            break;
+            continue;
          }
+
+         if (block->refs)
+            continue;
+
+         if (!victim || block->last_used < victim->last_used)
+            victim = block;
       }
 
-      if (temp)
-         free(temp);
-      IAlloc_Free(&allocImp, output);
+      if (!victim)
+         return false;
+
+      sevenzip_block_free(victim);
+   }
+}
 
-      if (!(file_found && res == SZ_OK))
+static struct sevenzip_block *sevenzip_block_find(
+      const struct sevenzip_archive *archive, uint32_t index)
+{
+   unsigned i;
+
+   for (i = 0; i < SEVENZIP_CACHE_BLOCKS; i++)
+   {
+      struct sevenzip_block *block = &sevenzip_blocks[i];
+
+      if (block->output && block->archive == archive && block->index == index)
       {
-         /* Error handling
-          *
-          * Failed to open compressed file inside 7zip archive.
-          */
+         block->last_used = ++sevenzip_cache_clock;
+         block->refs++;
+         return block;
+      }
+   }
+
+   return NULL;
+}
+
+bool sevenzip_cache_init(void)
+{
+   unsigned i;
+
+   if (sevenzip_cache_inited)
+      return true;
+
+#ifdef HAVE_THREADS
+   sevenzip_cache_lock = slock_new();
+   if (!sevenzip_cache_lock)
+      return false;
+#endif
+
+   for (i = 0; i < SEVENZIP_CACHE_BLOCKS; i++)
+   {
+      sevenzip_blocks[i].archive = NULL;
+      sevenzip_blocks[i].index   = 0xFFFFFFFF;
+      sevenzip_blocks[i].output  = NULL;
+      sevenzip_blocks[i].size    = 0;
+      sevenzip_blocks[i].refs    = 0;
+   }
+
+   sevenzip_cache_bytes  = 0;
+   sevenzip_cache_inited = true;
+   return true;
+}
+
+void sevenzip_cache_deinit(void)
+{
+   unsigned i;
+
+   if (!sevenzip_cache_inited)
+      return;
+
+   sevenzip_cache_inited = false;
+
+   for (i = 0; i < SEVENZIP_CACHE_ARCHIVES; i++)
+   {
+      sevenzip_archive_free(sevenzip_archives[i]);
+      sevenzip_archives[i] = NULL;
+   }
+
+#ifdef HAVE_THREADS
+   slock_free(sevenzip_cache_lock);
+   sevenzip_cache_lock = NULL;
+#endif
+}
+
+/* Extract the relative path (needle) from a 7z archive
+ * (path) and allocate a buf for it to write it in.
+ * If optional_outfile is set, extract to that instead
+ * and don't allocate buffer.
+ *
+ * The file is looked up in the cached archive index and
+ * decoded blocks are kept around, so further files of the
+ * same solid block don't decode it again. Decoding holds
+ * only the archive's lock, not the cache lock.
+ */
+static int sevenzip_file_read(
+      const char *path,
+      const char *needle, void **buf,
+      const char *optional_outfile)
+{
+   struct file_archive_entry entry;
+   struct sevenzip_archive *archive = NULL;
+   struct sevenzip_block *block     = NULL;
+   uint8_t *output                  = NULL;
+   size_t output_size               = 0;
+   size_t offset                    = 0;
+   size_t outSizeProcessed          = 0;
+   uint32_t block_index             = 0xFFFFFFFF;
+   uint32_t file_index              = 0;
+   bool cached                      = sevenzip_cache_inited;
+   long outsize                     = -1;
+   SRes res                         = SZ_ERROR_FAIL;
+
+   if (!file_archive_find_entry(path, needle, false, &entry))
+      return -1;
+
+   file_index = (uint32_t)entry.offset;
+
+   if (cached)
+      archive = sevenzip_archive_acquire(path);
+   else
+      archive = sevenzip_archive_open(path, 0, 0);
+
+   if (!archive)
+      return -1;
+
+   if (file_index >= archive->db.db.NumFiles)
+      goto end;
+
+   if (cached)
+   {
+#ifdef HAVE_THREADS
+      slock_lock(sevenzip_cache_lock);
+#endif
+      block = sevenzip_block_find(archive,
+            archive->db.FileIndexToFolderIndexMap[file_index]);
+#ifdef HAVE_THREADS
+      slock_unlock(sevenzip_cache_lock);
+#endif
+   }
 
-         outsize    = -1;
+   if (block)
+   {
+      block_index = block->index;
+      output      = block->output;
+      output_size = block->size;
+   }
+
+   /* C LZMA SDK does not support chunked extraction - see here:
+    * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
+    * */
+#ifdef HAVE_THREADS
+   slock_lock(archive->lock);
+#endif
+   res = SzArEx_Extract(&archive->db, &archive->lookStream.s, file_index,
+         &block_index, &output, &output_size, &offset, &outSizeProcessed,
+         &sevenzip_alloc, &sevenzip_alloc_temp);
+#ifdef HAVE_THREADS
+   slock_unlock(archive->lock);
+#endif
+
+   if (res != SZ_OK)
+      goto end;
+
+   outsize = (long)outSizeProcessed;
+
+   if (optional_outfile != NULL)
+   {
+      const void *ptr = (const void*)(output + offset);
+
+      if (!filestream_write_file(optional_outfile, ptr, outsize))
+      {
+         /*RARCH_ERR("Could not open outfilepath %s.\n",
+               optional_outfile);*/
+         outsize = -1;
       }
    }
+   else
+   {
+      /* The decoded block may be cached, and RetroArch expects
+       * a \0 at the end, so always hand out a copy. */
+      *buf = malloc(outsize + 1);
+      ((char*)(*buf))[outsize] = '\0';
+      memcpy(*buf, output + offset, outsize);
+   }
 
-   SzArEx_Free(&db, &allocImp);
-   File_Close(&archiveStream.file);
+end:
+   if (!cached)
+   {
+      if (output)
+         IAlloc_Free(&sevenzip_alloc, output);
+      sevenzip_archive_free(archive);
+      return (int)outsize;
+   }
+
+#ifdef HAVE_THREADS
+   slock_lock(sevenzip_cache_lock);
+#endif
+
+   if (block)
+      block->refs--;
+   else if (output && !(res == SZ_OK && sevenzip_block_insert(
+               archive, block_index, output, output_size)))
+      IAlloc_Free(&sevenzip_alloc, output);
+
+   sevenzip_archive_put(archive);
+
+#ifdef HAVE_THREADS
+   slock_unlock(sevenzip_cache_lock);
+#endif
 
    return (int)outsize;
 }
@@ -344,50 +673,52 @@ static int sevenzip_parse_file_iterate_step_internal(
 {
    struct sevenzip_context_t *sevenzip_context = (struct sevenzip_context_t*)state->stream;
    const CSzFileItem *file = sevenzip_context->db.db.Files + sevenzip_context->index;
+   uint64_t compressed_size = 0;
+   size_t len               = 0;
 
-   if (sevenzip_context->index < sevenzip_context->db.db.NumFiles)
-   {
-      size_t len = SzArEx_GetFileNameUtf16(&sevenzip_context->db,
-            sevenzip_context->index, NULL);
-      uint64_t compressed_size = 0;
+   /* Past the last file, stop walking. */
+   if (sevenzip_context->index >= sevenzip_context->db.db.NumFiles)
+      return 0;
 
-      if (sevenzip_context->packIndex < sevenzip_context->db.db.NumPackStreams)
-      {
-         compressed_size = sevenzip_context->db.db.PackSizes[sevenzip_context->packIndex];
-         sevenzip_context->packIndex++;
-      }
+   len = SzArEx_GetFileNameUtf16(&sevenzip_context->db,
+         sevenzip_context->index, NULL);
 
-      if (len < PATH_MAX_LENGTH && !file->IsDir)
-      {
-         char infile[PATH_MAX_LENGTH];
-         SRes res                     = SZ_ERROR_FAIL;
-         uint16_t *temp               = (uint16_t*)malloc(len * sizeof(uint16_t));
+   if (sevenzip_context->packIndex < sevenzip_context->db.db.NumPackStreams)
+   {
+      compressed_size = sevenzip_context->db.db.PackSizes[sevenzip_context->packIndex];
+      sevenzip_context->packIndex++;
+   }
 
-         if (!temp)
-            return -1;
+   if (len < PATH_MAX_LENGTH && !file->IsDir)
+   {
+      char infile[PATH_MAX_LENGTH];
+      SRes res                     = SZ_ERROR_FAIL;
+      uint16_t *temp               = (uint16_t*)malloc(len * sizeof(uint16_t));
 
-         infile[0] = '\0';
+      if (!temp)
+         return -1;
 
-         SzArEx_GetFileNameUtf16(&sevenzip_context->db, sevenzip_context->index,
-               temp);
+      infile[0] = '\0';
 
-         if (temp)
-         {
-            res  = utf16_to_char_string(temp, infile, sizeof(infile))
-               ? SZ_OK : SZ_ERROR_FAIL;
-            free(temp);
-         }
+      SzArEx_GetFileNameUtf16(&sevenzip_context->db, sevenzip_context->index,
+            temp);
 
-         if (res != SZ_OK)
-            return -1;
+      if (temp)
+      {
+         res  = utf16_to_char_string(temp, infile, sizeof(infile))
+            ? SZ_OK : SZ_ERROR_FAIL;
+         free(temp);
+      }
 
-         strlcpy(filename, infile, PATH_MAX_LENGTH);
+      if (res != SZ_OK)
+         return -1;
 
-         *cmode    = ARCHIVE_MODE_COMPRESSED;
-         *checksum = file->Crc;
-         *size     = (uint32_t)file->Size;
-         *csize    = (uint32_t)compressed_size;
-      }
+      strlcpy(filename, infile, PATH_MAX_LENGTH);
+
+      *cmode    = ARCHIVE_MODE_COMPRESSED;
+      *checksum = file->Crc;
+      *size     = (uint32_t)file->Size;
+      *csize    = (uint32_t)compressed_size;
    }
 
    *payback = 1;
@@ -443,6 +774,7 @@ const struct file_archive_file_backend sevenzip_backend = {
    sevenzip_stream_free,
    sevenzip_stream_decompress_data_to_file_init,
    sevenzip_stream_decompress_data_to_file_iterate,
+   NULL,
    sevenzip_stream_crc32_calculate,
    sevenzip_file_read,
    sevenzip_parse_file_init,
@@ -20,6 +20,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <file/archive_file.h>
@@ -40,6 +41,9 @@
 #define END_OF_CENTRAL_DIR_SIGNATURE 0x06054b50
 #endif
 
+/* Inflated data is written out in chunks of this size. */
+#define ZIP_EXTRACT_CHUNK_SIZE (128 * 1024)
+
 static void *zlib_stream_new(void)
 {
    return zlib_inflate_backend.stream_new();
@@ -106,6 +110,79 @@ static int zlib_stream_decompress_data_to_file_iterate(void *stream)
    return 0;
 }
 
+/* Inflates an entry to @path through a fixed size buffer and
+ * checks its CRC32 on the way, unless @crc32 is 0. */
+static bool zlib_stream_decompress_to_file(const char *path,
+      const uint8_t *cdata, uint32_t csize, uint32_t size, uint32_t crc32)
+{
+   bool ret       = false;
+   uint32_t crc   = 0;
+   uint32_t total = 0;
+   RFILE *file    = NULL;
+   void *stream   = zlib_inflate_backend.stream_new();
+   uint8_t *buf   = (uint8_t*)malloc(ZIP_EXTRACT_CHUNK_SIZE);
+
+   if (!stream || !buf)
+      goto end;
+
+   if (zlib_inflate_backend.define)
+      zlib_inflate_backend.define(stream, "window_bits", (uint32_t)-MAX_WBITS);
+
+   file = filestream_open(path, RFILE_MODE_WRITE, -1);
+
+   if (!file)
+      goto end;
+
+   zlib_inflate_backend.set_in(stream, cdata, csize);
+
+   for (;;)
+   {
+      uint32_t rd                    = 0;
+      uint32_t wn                    = 0;
+      enum trans_stream_error terror = TRANS_STREAM_ERROR_NONE;
+      bool zstatus;
+
+      zlib_inflate_backend.set_out(stream, buf, ZIP_EXTRACT_CHUNK_SIZE);
+
+      zstatus = zlib_inflate_backend.trans(stream, false, &rd, &wn, &terror);
+
+      if (!zstatus && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+         goto end;
+
+      /* More than the entry claims to hold. */
+      if (wn > size - total)
+         goto end;
+
+      if (wn)
+      {
+         if (filestream_write(file, buf, wn) != (ssize_t)wn)
+            goto end;
+
+         crc    = encoding_crc32(crc, buf, wn);
+         total += wn;
+      }
+
+      if (zstatus && terror == TRANS_STREAM_ERROR_NONE)
+         break;
+
+      /* Ran out of input before the end of the stream. */
+      if (!rd && !wn)
+         goto end;
+   }
+
+   ret = (total == size) && (!crc32 || crc == crc32);
+
+end:
+   if (file && filestream_close(file) != 0)
+      ret = false;
+   if (file && !ret)
+      remove(path);
+   if (stream)
+      zlib_inflate_backend.stream_free(stream);
+   free(buf);
+   return ret;
+}
+
 static uint32_t zlib_stream_crc32_calculate(uint32_t crc,
       const uint8_t *data, size_t length)
 {
@@ -131,6 +208,9 @@ static bool zip_file_decompressed_handle(
             handle->stream);
    }while(ret == 0);
 
+   if (ret < 0)
+      goto error;
+
 #if 0
    handle->real_checksum = handle->backend->stream_crc_calculate(0,
          handle->data, size);
@@ -139,21 +219,20 @@ static bool zip_file_decompressed_handle(
       goto error;
 #endif
 
-   if (handle->stream)
-      free(handle->stream);
+   zlib_inflate_backend.stream_free(handle->stream);
+   handle->stream = NULL;
 
    return true;
-#if 0
+
 error:
    if (handle->stream)
-      free(handle->stream);
+      zlib_inflate_backend.stream_free(handle->stream);
    if (handle->data)
       free(handle->data);
 
    handle->stream = NULL;
    handle->data   = NULL;
    return false;
-#endif
 }
 
 /* Extract the relative path (needle) from a
@@ -161,115 +240,79 @@ error:
  *
  * optional_outfile if not NULL will be used to extract the file to.
  * buf will be 0 then.
+ *
+ * The entry is looked up in the cached archive index, so only its
+ * compressed data is read from the archive.
  */
-
-static int zip_file_decompressed(
-      const char *name, const char *valid_exts,
-      const uint8_t *cdata, unsigned cmode,
-      uint32_t csize, uint32_t size,
-      uint32_t crc32, struct archive_extract_userdata *userdata)
+static int zip_file_read(
+      const char *path,
+      const char *needle, void **buf,
+      const char *optional_outfile)
 {
-   /* Ignore directories. */
-   if (name[strlen(name) - 1] == '/' || name[strlen(name) - 1] == '\\')
-      return 1;
+   struct file_archive_entry entry;
+   file_archive_file_handle_t handle = {0};
+   uint8_t *cdata                    = NULL;
+   RFILE *file                       = NULL;
+   int ret                           = -1;
 
-#if 0
-   RARCH_LOG("[deflate] Path: %s, CRC32: 0x%x\n", name, crc32);
-#endif
-
-   if (strstr(name, userdata->decomp_state.needle))
-   {
-      bool goto_error = false;
-      file_archive_file_handle_t handle = {0};
+   if (!file_archive_find_entry(path, needle, true, &entry))
+      return -1;
 
-      userdata->decomp_state.found = true;
+   if (     entry.cmode != ARCHIVE_MODE_UNCOMPRESSED
+         && entry.cmode != ARCHIVE_MODE_COMPRESSED)
+      return -1;
 
-      if (zip_file_decompressed_handle(&handle,
-               cdata, csize, size, crc32))
-      {
-         if (userdata->decomp_state.opt_file != 0)
-         {
-            /* Called in case core has need_fullpath enabled. */
-            char *buf       = (char*)malloc(size);
-
-            if (buf)
-            {
-               /*RARCH_LOG("%s: %s\n",
-                     msg_hash_to_str(MSG_EXTRACTING_FILE),
-                     userdata->decomp_state.opt_file);*/
-               memcpy(buf, handle.data, size);
-
-               if (!filestream_write_file(userdata->decomp_state.opt_file, buf, size))
-                  goto_error = true;
-            }
-
-            free(buf);
-
-            userdata->decomp_state.size = 0;
-         }
-         else
-         {
-            /* Called in case core has need_fullpath disabled.
-             * Will copy decompressed content directly into
-             * RetroArch's ROM buffer. */
-            *userdata->decomp_state.buf = malloc(size);
-            memcpy(*userdata->decomp_state.buf, handle.data, size);
-
-            userdata->decomp_state.size = size;
-         }
-      }
+   /* Stored entries must not claim more data than they hold. */
+   if (entry.cmode == ARCHIVE_MODE_UNCOMPRESSED && entry.csize < entry.size)
+      return -1;
 
-      if (handle.data)
-         free(handle.data);
+   cdata = (uint8_t*)malloc(entry.csize + 1);
+   file  = filestream_open(path, RFILE_MODE_READ, -1);
 
-      if (goto_error)
-         return 0;
-   }
+   if (!cdata || !file)
+      goto end;
 
-   return 1;
-}
+   if (filestream_seek(file, (ssize_t)entry.offset, SEEK_SET) != 0)
+      goto end;
 
-static int zip_file_read(
-      const char *path,
-      const char *needle, void **buf,
-      const char *optional_outfile)
-{
-   file_archive_transfer_t zlib;
-   struct archive_extract_userdata userdata = {{0}};
-   bool returnerr                    = true;
-   int ret                           = 0;
+   if (filestream_read(file, cdata, entry.csize) != (ssize_t)entry.csize)
+      goto end;
 
-   zlib.type                         = ARCHIVE_TRANSFER_INIT;
+   filestream_close(file);
+   file = NULL;
 
-   userdata.decomp_state.needle      = NULL;
-   userdata.decomp_state.opt_file    = NULL;
-   userdata.decomp_state.found       = false;
-   userdata.decomp_state.buf         = buf;
+   if (entry.cmode == ARCHIVE_MODE_UNCOMPRESSED)
+   {
+      handle.data = cdata;
+      cdata       = NULL;
+   }
+   else if (!zip_file_decompressed_handle(&handle,
+            cdata, entry.csize, entry.size, entry.crc32))
+      goto end;
 
-   if (needle)
-      userdata.decomp_state.needle   = strdup(needle);
    if (optional_outfile)
-      userdata.decomp_state.opt_file = strdup(optional_outfile);
-
-   do
    {
-      ret = file_archive_parse_file_iterate(&zlib, &returnerr, path,
-            "", zip_file_decompressed, &userdata);
-      if (!returnerr)
-         break;
-   }while(ret == 0 && !userdata.decomp_state.found);
-
-   file_archive_parse_file_iterate_stop(&zlib);
-
-   if (userdata.decomp_state.opt_file)
-      free(userdata.decomp_state.opt_file);
-   if (userdata.decomp_state.needle)
-      free(userdata.decomp_state.needle);
-
-   if (!userdata.decomp_state.found)
-      return -1;
+      /* Called in case core has need_fullpath enabled. */
+      if (!filestream_write_file(optional_outfile, handle.data, entry.size))
+         goto end;
+      ret = 0;
+   }
+   else
+   {
+      /* Called in case core has need_fullpath disabled.
+       * Hands the decompressed content directly over to
+       * RetroArch's ROM buffer. */
+      *buf        = handle.data;
+      handle.data = NULL;
+      ret         = (int)entry.size;
+   }
 
-   return (int)userdata.decomp_state.size;
+end:
+   if (file)
+      filestream_close(file);
+   free(cdata);
+   free(handle.data);
+   return ret;
 }
 
 static int zip_parse_file_init(file_archive_transfer_t *state,
@@ -370,6 +413,7 @@ const struct file_archive_file_backend zlib_backend = {
    zlib_stream_free,
    zlib_stream_decompress_data_to_file_init,
    zlib_stream_decompress_data_to_file_iterate,
+   zlib_stream_decompress_to_file,
    zlib_stream_crc32_calculate,
    zip_file_read,
    zip_parse_file_init,
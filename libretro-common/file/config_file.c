@@ -48,11 +48,15 @@
 
 #define MAX_INCLUDE_DEPTH 16
 
+#define CONFIG_SNAPSHOT_MAGIC "RCFGSNP2"
+
 struct config_entry_list
 {
    /* If we got this from an #include,
     * do not allow overwrite. */
    bool readonly;
+   /* Changed since loaded or last written. */
+   bool dirty;
    char *key;
    char *value;
    uint32_t key_hash;
@@ -63,6 +67,11 @@ struct config_entry_list
 struct config_include_list
 {
    char *path;
+   /* Sources only: taken before the file was read, mtime in
+    * microseconds so a same-size rewrite within the second
+    * still shows. */
+   int64_t mtime;
+   int32_t size;
    struct config_include_list *next;
 };
 
@@ -71,9 +80,16 @@ struct config_file
    char *path;
    struct config_entry_list *entries;
    struct config_entry_list *tail;
+   /* Open addressing on key_hash, holds the first entry of
+    * every key. */
+   struct config_entry_list **index;
+   size_t index_size;
+   size_t index_count;
    unsigned include_depth;
 
    struct config_include_list *includes;
+   /* Every file read for this config, include or not. */
+   struct config_include_list *sources;
 };
 
 static config_file_t *config_file_new_internal(
@@ -192,9 +208,10 @@ static char *extract_value(char *line, bool is_value)
    return NULL;
 }
 
-static void add_include_list(config_file_t *conf, const char *path)
+static void add_include_list(struct config_include_list **list,
+      const char *path)
 {
-   struct config_include_list *head = conf->includes;
+   struct config_include_list *head = *list;
    struct config_include_list *node = (struct config_include_list*)calloc(1, sizeof(*node));
 
    if (!node)
@@ -210,7 +227,115 @@ static void add_include_list(config_file_t *conf, const char *path)
       head->next = node;
    }
    else
-      conf->includes = node;
+      *list = node;
+}
+
+/* Stats @path before it is read, so a change made while it is
+ * being parsed still invalidates a snapshot of the result. */
+static void add_source_list(struct config_include_list **list,
+      const char *path)
+{
+   struct config_include_list *tail = NULL;
+
+   add_include_list(list, path);
+
+   for (tail = *list; tail && tail->next; tail = tail->next);
+
+   if (tail)
+   {
+      tail->mtime = path_get_mtime_usec(path);
+      tail->size  = path_get_size(path);
+   }
+}
+
+static void free_include_list(struct config_include_list *list)
+{
+   while (list)
+   {
+      struct config_include_list *hold = list;
+      list = list->next;
+      free(hold->path);
+      free(hold);
+   }
+}
+
+static struct config_entry_list **config_index_slot(
+      const config_file_t *conf, const char *key, uint32_t hash)
+{
+   size_t mask = conf->index_size - 1;
+   size_t i    = hash & mask;
+
+   while (conf->index[i])
+   {
+      const struct config_entry_list *entry = conf->index[i];
+
+      if (entry->key_hash == hash && string_is_equal(entry->key, key))
+         break;
+
+      i = (i + 1) & mask;
+   }
+
+   return &conf->index[i];
+}
+
+/* Indexes all entries. The first one of each key wins,
+ * like it would when walking the list. */
+static void config_index_build(config_file_t *conf)
+{
+   struct config_entry_list *entry = NULL;
+   size_t count                    = 0;
+   size_t size                     = 64;
+
+   for (entry = conf->entries; entry; entry = entry->next)
+      count++;
+
+   while (size < count * 2 + 2)
+      size *= 2;
+
+   free(conf->index);
+   conf->index       = (struct config_entry_list**)calloc(size, sizeof(*conf->index));
+   conf->index_size  = conf->index ? size : 0;
+   conf->index_count = 0;
+
+   if (!conf->index)
+      return;
+
+   for (entry = conf->entries; entry; entry = entry->next)
+   {
+      struct config_entry_list **slot = NULL;
+
+      if (!entry->key || !entry->value)
+         continue;
+
+      slot = config_index_slot(conf, entry->key, entry->key_hash);
+
+      if (!*slot)
+      {
+         *slot = entry;
+         conf->index_count++;
+      }
+   }
+}
+
+/* Indexes an entry just added to the end of the list. */
+static void config_index_add(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   struct config_entry_list **slot = NULL;
+
+   if ((conf->index_count + 1) * 2 > conf->index_size)
+   {
+      config_index_build(conf);
+      return;
+   }
+
+   slot = config_index_slot(conf, entry->key, entry->key_hash);
+
+   if (!*slot)
+   {
+      *slot = entry;
+      conf->index_count++;
+   }
 }
 
 static void set_list_readonly(struct config_entry_list *list)
@@ -265,7 +390,7 @@ static void add_sub_conf(config_file_t *conf, char *line)
    if (!path)
       return;
 
-   add_include_list(conf, path);
+   add_include_list(&conf->includes, path);
 
    real_path[0] = '\0';
 
@@ -290,12 +415,25 @@ static void add_sub_conf(config_file_t *conf, char *line)
       config_file_new_internal(real_path, conf->include_depth + 1);
    if (!sub_conf)
    {
+      /* Still a source, it may show up later. */
+      add_source_list(&conf->sources, real_path);
       free(path);
       return;
    }
 
    /* Pilfer internal list. */
    add_child_list(conf, sub_conf);
+
+   if (conf->sources)
+   {
+      struct config_include_list *head = conf->sources;
+      while (head->next)
+         head = head->next;
+      head->next = sub_conf->sources;
+   }
+   else
+      conf->sources = sub_conf->sources;
+   sub_conf->sources = NULL;
    config_file_free(sub_conf);
    free(path);
 }
@@ -392,10 +530,12 @@ static config_file_t *config_file_new_internal(
       goto error;
 
    conf->include_depth = depth;
+   add_source_list(&conf->sources, path);
    file = fopen(path, "r");
 
    if (!file)
    {
+      free_include_list(conf->sources);
       free(conf->path);
       goto error;
    }
@@ -440,6 +580,8 @@ static config_file_t *config_file_new_internal(
 
    fclose(file);
 
+   config_index_build(conf);
+
    return conf;
 
 error:
@@ -450,7 +592,6 @@ error:
 
 void config_file_free(config_file_t *conf)
 {
-   struct config_include_list *inc_tmp = NULL;
    struct config_entry_list *tmp       = NULL;
    if (!conf)
       return;
@@ -474,16 +615,10 @@ void config_file_free(config_file_t *conf)
          free(hold);
    }
 
-   inc_tmp = (struct config_include_list*)conf->includes;
-   while (inc_tmp)
-   {
-      struct config_include_list *hold = NULL;
-      free(inc_tmp->path);
-      hold = (struct config_include_list*)inc_tmp;
-      inc_tmp = inc_tmp->next;
-      free(hold);
-   }
+   free_include_list(conf->includes);
+   free_include_list(conf->sources);
 
+   free(conf->index);
    if (conf->path)
       free(conf->path);
    free(conf);
@@ -498,11 +633,14 @@ bool config_append_file(config_file_t *conf, const char *path)
    if (new_conf->tail)
    {
       new_conf->tail->next = conf->entries;
+      if (!conf->tail)
+         conf->tail        = new_conf->tail;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
    }
 
    config_file_free(new_conf);
+   config_index_build(conf);
    return true;
 }
 
@@ -557,6 +695,8 @@ config_file_t *config_file_new_from_string(const char *from_string)
 
    string_list_free(lines);
 
+   config_index_build(conf);
+
    return conf;
 }
 
@@ -567,33 +707,27 @@ config_file_t *config_file_new(const char *path)
 
 
 static struct config_entry_list *config_get_entry(const config_file_t *conf,
-      const char *key, struct config_entry_list **prev)
+      const char *key)
 {
    struct config_entry_list *entry;
-   struct config_entry_list *previous = NULL;
-
    uint32_t hash = djb2_calculate(key);
 
-   if (prev)
-      previous = *prev;
+   if (conf->index)
+      return *config_index_slot(conf, key, hash);
 
    for (entry = conf->entries; entry; entry = entry->next)
    {
-      if (hash == entry->key_hash && !strcmp(key, entry->key))
+      if (hash == entry->key_hash && entry->value
+            && string_is_equal(key, entry->key))
          return entry;
-
-      previous = entry;
    }
 
-   if (prev)
-      *prev = previous;
-
    return NULL;
 }
 
 bool config_get_double(config_file_t *conf, const char *key, double *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
       *in = strtod(entry->value, NULL);
@@ -603,7 +737,7 @@ bool config_get_double(config_file_t *conf, const char *key, double *in)
 
 bool config_get_float(config_file_t *conf, const char *key, float *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -616,7 +750,7 @@ bool config_get_float(config_file_t *conf, const char *key, float *in)
 
 bool config_get_int(config_file_t *conf, const char *key, int *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -633,7 +767,7 @@ bool config_get_int(config_file_t *conf, const char *key, int *in)
 #if defined(__STDC_VERSION__) && __STDC_VERSION__>=199901L
 bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -650,7 +784,7 @@ bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 
 bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -666,7 +800,7 @@ bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 
 bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -682,7 +816,7 @@ bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 
 bool config_get_char(config_file_t *conf, const char *key, char *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -697,7 +831,7 @@ bool config_get_char(config_file_t *conf, const char *key, char *in)
 
 bool config_get_string(config_file_t *conf, const char *key, char **str)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
       *str = strdup(entry->value);
@@ -716,7 +850,7 @@ bool config_get_config_path(config_file_t *conf, char *s, size_t len)
 bool config_get_array(config_file_t *conf, const char *key,
       char *buf, size_t size)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
       return strlcpy(buf, entry->value, size) < size;
@@ -730,7 +864,7 @@ bool config_get_path(config_file_t *conf, const char *key,
 #if defined(RARCH_CONSOLE)
    return config_get_array(conf, key, buf, size);
 #else
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
       fill_pathname_expand_special(buf, entry->value, size);
@@ -741,7 +875,7 @@ bool config_get_path(config_file_t *conf, const char *key,
 
 bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -762,42 +896,81 @@ bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
-   struct config_entry_list *last  = conf->entries;
-   struct config_entry_list *entry = config_get_entry(conf, key, &last);
+   struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry && !entry->readonly)
    {
+      /* Nothing to write back if it stays the same. */
+      if (!val || string_is_equal(entry->value, val))
+         return;
+
       free(entry->value);
       entry->value = strdup(val);
+      entry->dirty = true;
       return;
    }
 
    if (!val) return;
 
+   if (!entry)
+   {
+      /* Set again after being unset, keeps its place in the file. */
+      uint32_t hash = djb2_calculate(key);
+
+      for (entry = conf->entries; entry; entry = entry->next)
+      {
+         if (     !entry->value && !entry->readonly
+               && entry->key_hash == hash
+               && string_is_equal(entry->key, key))
+         {
+            entry->value = strdup(val);
+            entry->dirty = true;
+            config_index_add(conf, entry);
+            return;
+         }
+      }
+   }
+
    entry = (struct config_entry_list*)calloc(1, sizeof(*entry));
    if (!entry) return;
 
-   entry->key   = strdup(key);
-   entry->value = strdup(val);
+   entry->key      = strdup(key);
+   entry->value    = strdup(val);
+   entry->key_hash = djb2_calculate(key);
+   entry->dirty    = true;
+
+   if (!entry->key || !entry->value)
+   {
+      free(entry->key);
+      free(entry->value);
+      free(entry);
+      return;
+   }
 
-   if (last)
-      last->next = entry;
+   if (conf->tail)
+      conf->tail->next = entry;
    else
       conf->entries = entry;
+
+   conf->tail = entry;
+
+   config_index_add(conf, entry);
 }
 
 void config_unset(config_file_t *conf, const char *key)
 {
-   struct config_entry_list *last  = conf->entries;
-   struct config_entry_list *entry = config_get_entry(conf, key, &last);
+   struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return;
 
-   entry->key   = NULL;
-   entry->value = NULL;
-   free(entry->key);
+   /* The key stays, so writing back knows what to remove. */
    free(entry->value);
+   entry->value = NULL;
+   entry->dirty = true;
+
+   /* A later entry may have the same key. */
+   config_index_build(conf);
 }
 
 void config_set_path(config_file_t *conf, const char *entry, const char *val)
@@ -899,7 +1072,15 @@ bool config_file_write(config_file_t *conf, const char *path)
    config_file_dump(conf, file);
 
    if (path)
-      fclose(file);
+   {
+      struct config_entry_list *list = NULL;
+
+      if (fclose(file) != 0)
+         return false;
+
+      for (list = conf->entries; list; list = list->next)
+         list->dirty = false;
+   }
 
    return true;
 }
@@ -919,7 +1100,7 @@ void config_file_dump(config_file_t *conf, FILE *file)
 
    while (list)
    {
-      if (!list->readonly && list->key)
+      if (!list->readonly && list->key && list->value)
          fprintf(file, "%s = \"%s\"\n", list->key, list->value);
       list = list->next;
    }
@@ -927,16 +1108,7 @@ void config_file_dump(config_file_t *conf, FILE *file)
 
 bool config_entry_exists(config_file_t *conf, const char *entry)
 {
-   struct config_entry_list *list = conf->entries;
-
-   while (list)
-   {
-      if (!strcmp(entry, list->key))
-         return true;
-      list = list->next;
-   }
-
-   return false;
+   return config_get_entry(conf, entry) != NULL;
 }
 
 bool config_get_entry_list_head(config_file_t *conf,
@@ -944,6 +1116,10 @@ bool config_get_entry_list_head(config_file_t *conf,
 {
    const struct config_entry_list *head = conf->entries;
 
+   /* Skip unset entries. */
+   while (head && (!head->key || !head->value))
+      head = head->next;
+
    if (!head)
       return false;
 
@@ -957,6 +1133,9 @@ bool config_get_entry_list_next(struct config_file_entry *entry)
 {
    const struct config_entry_list *next = entry->next;
 
+   while (next && (!next->key || !next->value))
+      next = next->next;
+
    if (!next)
       return false;
 
@@ -975,3 +1154,472 @@ bool config_file_exists(const char *path)
    config_file_free(config);
    return true;
 }
+
+/* Reads the key of a line the way parse_line does. */
+static size_t config_line_key(const char *line, const char **key)
+{
+   size_t len = 0;
+
+   while (isspace((int)*line))
+      line++;
+
+   *key = line;
+
+   while (isgraph((int)line[len]))
+      len++;
+
+   return len;
+}
+
+static bool config_file_replace(const char *tmp_path, const char *path)
+{
+   /* rename() doesn't replace files everywhere. */
+   if (!rename(tmp_path, path))
+      return true;
+
+   remove(path);
+
+   if (!rename(tmp_path, path))
+      return true;
+
+   remove(tmp_path);
+   return false;
+}
+
+bool config_file_write_changes(config_file_t *conf, const char *path)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   config_file_t changes;
+   struct config_entry_list *list = NULL;
+   FILE *in                       = NULL;
+   FILE *out                      = NULL;
+   char *line                     = NULL;
+   size_t changed                 = 0;
+   bool ret                       = true;
+
+   if (!path)
+      path = conf->path;
+
+   if (!path)
+      return false;
+
+   for (list = conf->entries; list; list = list->next)
+   {
+      if (list->dirty && !list->readonly && list->key)
+         changed++;
+   }
+
+   in = fopen(path, "r");
+
+   if (!in)
+      return config_file_write(conf, path);
+
+   if (!changed)
+   {
+      fclose(in);
+      return true;
+   }
+
+   /* Indexes the changed entries, unset ones included, which
+    * conf->index leaves out. The first one of each key wins,
+    * like it would when walking the list. */
+   memset(&changes, 0, sizeof(changes));
+   changes.index_size = 16;
+
+   while (changes.index_size < changed * 2 + 2)
+      changes.index_size *= 2;
+
+   changes.index = (struct config_entry_list**)
+      calloc(changes.index_size, sizeof(*changes.index));
+
+   if (!changes.index)
+   {
+      fclose(in);
+      return false;
+   }
+
+   for (list = conf->entries; list; list = list->next)
+   {
+      struct config_entry_list **slot = NULL;
+
+      if (!list->dirty || list->readonly || !list->key)
+         continue;
+
+      slot = config_index_slot(&changes, list->key, list->key_hash);
+
+      if (!*slot)
+         *slot = list;
+   }
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+   out = fopen(tmp_path, "w");
+
+   if (!out)
+   {
+      free(changes.index);
+      fclose(in);
+      return false;
+   }
+
+   setvbuf(in, NULL, _IOFBF, 0x4000);
+   setvbuf(out, NULL, _IOFBF, 0x4000);
+
+   /* Keeps the file as it is, only rewriting or dropping the lines
+    * of changed keys. */
+   while (!feof(in) && (line = getaline(in)))
+   {
+      const char *key = NULL;
+      size_t key_len  = config_line_key(line, &key);
+      bool keep       = true;
+
+      if (key_len && *key != '#')
+      {
+         char *key_end = line + (key - line) + key_len;
+         char next     = *key_end;
+
+         *key_end      = '\0';
+         list          = *config_index_slot(&changes, key,
+               djb2_calculate(key));
+         *key_end      = next;
+
+         if (list && list->dirty)
+         {
+            if (list->value)
+               fprintf(out, "%s = \"%s\"\n", list->key, list->value);
+
+            list->dirty = false;
+            keep        = false;
+         }
+      }
+
+      if (keep && (*line || !feof(in)))
+         fprintf(out, "%s\n", line);
+
+      free(line);
+   }
+
+   fclose(in);
+   free(changes.index);
+
+   /* Keys the file didn't have yet. */
+   for (list = conf->entries; list; list = list->next)
+   {
+      if (list->dirty && !list->readonly && list->key && list->value)
+         fprintf(out, "%s = \"%s\"\n", list->key, list->value);
+      list->dirty = false;
+   }
+
+   if (fclose(out) != 0)
+      ret = false;
+
+   if (ret)
+      ret = config_file_replace(tmp_path, path);
+   else
+      remove(tmp_path);
+
+   return ret;
+}
+
+struct config_snapshot
+{
+   uint8_t *data;
+   size_t len;
+   size_t capacity;
+   bool error;
+};
+
+static void config_snapshot_put(struct config_snapshot *snap,
+      const void *data, size_t len)
+{
+   if (snap->error)
+      return;
+
+   if (snap->len + len > snap->capacity)
+   {
+      size_t capacity = snap->capacity ? snap->capacity * 2 : 0x4000;
+      uint8_t *buf    = NULL;
+
+      while (capacity < snap->len + len)
+         capacity *= 2;
+
+      buf = (uint8_t*)realloc(snap->data, capacity);
+
+      if (!buf)
+      {
+         snap->error = true;
+         return;
+      }
+
+      snap->data     = buf;
+      snap->capacity = capacity;
+   }
+
+   memcpy(snap->data + snap->len, data, len);
+   snap->len += len;
+}
+
+static void config_snapshot_put_string(struct config_snapshot *snap,
+      const char *str)
+{
+   uint32_t len = (uint32_t)strlen(str);
+
+   config_snapshot_put(snap, &len, sizeof(len));
+   config_snapshot_put(snap, str, len);
+}
+
+static bool config_snapshot_get(const uint8_t **pos, const uint8_t *end,
+      void *data, size_t len)
+{
+   if ((size_t)(end - *pos) < len)
+      return false;
+
+   memcpy(data, *pos, len);
+   *pos += len;
+   return true;
+}
+
+static char *config_snapshot_get_string(const uint8_t **pos,
+      const uint8_t *end)
+{
+   uint32_t len = 0;
+   char *str    = NULL;
+
+   if (!config_snapshot_get(pos, end, &len, sizeof(len))
+         || (size_t)(end - *pos) < len)
+      return NULL;
+
+   str = (char*)malloc(len + 1);
+
+   if (!str)
+      return NULL;
+
+   memcpy(str, *pos, len);
+   str[len] = '\0';
+   *pos    += len;
+
+   return str;
+}
+
+/* Layout, in native byte order:
+ * magic,
+ * source count, then path, mtime and size of every source,
+ * include count, then every #include as written,
+ * entry count, then readonly flag, key and value of every entry. */
+static void config_snapshot_save(const config_file_t *conf,
+      const char *snapshot_path)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   struct config_snapshot snap                = {0};
+   const struct config_include_list *node     = NULL;
+   const struct config_entry_list *entry      = NULL;
+   uint32_t count                             = 0;
+   FILE *file                                 = NULL;
+
+   config_snapshot_put(&snap, CONFIG_SNAPSHOT_MAGIC,
+         strlen(CONFIG_SNAPSHOT_MAGIC));
+
+   for (count = 0, node = conf->sources; node; node = node->next)
+      count++;
+   config_snapshot_put(&snap, &count, sizeof(count));
+
+   for (node = conf->sources; node; node = node->next)
+   {
+      /* Without mtimes (some console filesystems report 0) a
+       * changed file can't be told apart, so don't snapshot. */
+      if (node->mtime == 0)
+         snap.error = true;
+
+      config_snapshot_put_string(&snap, node->path);
+      config_snapshot_put(&snap, &node->mtime, sizeof(node->mtime));
+      config_snapshot_put(&snap, &node->size, sizeof(node->size));
+   }
+
+   for (count = 0, node = conf->includes; node; node = node->next)
+      count++;
+   config_snapshot_put(&snap, &count, sizeof(count));
+
+   for (node = conf->includes; node; node = node->next)
+      config_snapshot_put_string(&snap, node->path);
+
+   for (count = 0, entry = conf->entries; entry; entry = entry->next)
+      if (entry->key && entry->value)
+         count++;
+   config_snapshot_put(&snap, &count, sizeof(count));
+
+   for (entry = conf->entries; entry; entry = entry->next)
+   {
+      uint8_t readonly = entry->readonly;
+
+      if (!entry->key || !entry->value)
+         continue;
+
+      config_snapshot_put(&snap, &readonly, sizeof(readonly));
+      config_snapshot_put_string(&snap, entry->key);
+      config_snapshot_put_string(&snap, entry->value);
+   }
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", snapshot_path);
+
+   if (!snap.error && (file = fopen(tmp_path, "wb")))
+   {
+      bool written = fwrite(snap.data, 1, snap.len, file) == snap.len;
+
+      if (fclose(file) == 0 && written)
+         config_file_replace(tmp_path, snapshot_path);
+      else
+         remove(tmp_path);
+   }
+
+   free(snap.data);
+}
+
+/* Returns NULL unless the snapshot is of @path and all its sources
+ * are unchanged. */
+static config_file_t *config_snapshot_load(const char *path,
+      const char *snapshot_path)
+{
+   uint32_t i;
+   uint32_t count          = 0;
+   uint8_t *data           = NULL;
+   const uint8_t *pos      = NULL;
+   const uint8_t *end      = NULL;
+   long len                = 0;
+   config_file_t *conf     = NULL;
+   FILE *file              = fopen(snapshot_path, "rb");
+
+   if (!file)
+      return NULL;
+
+   if (fseek(file, 0, SEEK_END) == 0)
+      len = ftell(file);
+
+   if (len > 0 && fseek(file, 0, SEEK_SET) == 0)
+      data = (uint8_t*)malloc(len);
+
+   if (data && fread(data, 1, len, file) != (size_t)len)
+   {
+      free(data);
+      data = NULL;
+   }
+
+   fclose(file);
+
+   if (!data)
+      return NULL;
+
+   pos  = data;
+   end  = data + len;
+   conf = (config_file_t*)calloc(1, sizeof(*conf));
+
+   if (!conf)
+      goto error;
+
+   if (     (size_t)len < strlen(CONFIG_SNAPSHOT_MAGIC)
+         || memcmp(pos, CONFIG_SNAPSHOT_MAGIC, strlen(CONFIG_SNAPSHOT_MAGIC)))
+      goto error;
+   pos += strlen(CONFIG_SNAPSHOT_MAGIC);
+
+   if (!config_snapshot_get(&pos, end, &count, sizeof(count)) || !count)
+      goto error;
+
+   for (i = 0; i < count; i++)
+   {
+      int64_t mtime = 0;
+      int32_t size  = 0;
+      bool valid    = false;
+      char *source  = config_snapshot_get_string(&pos, end);
+
+      if (source
+            && config_snapshot_get(&pos, end, &mtime, sizeof(mtime))
+            && config_snapshot_get(&pos, end, &size, sizeof(size))
+            /* The first source is the file itself. */
+            && (i || string_is_equal(source, path))
+            && mtime != 0)
+         valid =  path_get_mtime_usec(source) == mtime
+               && path_get_size(source)  == size;
+
+      free(source);
+
+      if (!valid)
+         goto error;
+   }
+
+   if (!config_snapshot_get(&pos, end, &count, sizeof(count)))
+      goto error;
+
+   for (i = 0; i < count; i++)
+   {
+      char *include = config_snapshot_get_string(&pos, end);
+
+      if (!include)
+         goto error;
+
+      add_include_list(&conf->includes, include);
+      free(include);
+   }
+
+   if (!config_snapshot_get(&pos, end, &count, sizeof(count)))
+      goto error;
+
+   for (i = 0; i < count; i++)
+   {
+      uint8_t readonly                = 0;
+      struct config_entry_list *entry = (struct config_entry_list*)
+         calloc(1, sizeof(*entry));
+
+      if (!entry)
+         goto error;
+
+      if (conf->tail)
+         conf->tail->next = entry;
+      else
+         conf->entries = entry;
+      conf->tail = entry;
+
+      if (!config_snapshot_get(&pos, end, &readonly, sizeof(readonly)))
+         goto error;
+
+      entry->readonly = readonly != 0;
+      entry->key      = config_snapshot_get_string(&pos, end);
+      entry->value    = config_snapshot_get_string(&pos, end);
+
+      if (!entry->key || !entry->value)
+         goto error;
+
+      entry->key_hash = djb2_calculate(entry->key);
+   }
+
+   conf->path = strdup(path);
+   add_include_list(&conf->sources, path);
+
+   free(data);
+   config_index_build(conf);
+
+   return conf;
+
+error:
+   free(data);
+   config_file_free(conf);
+   return NULL;
+}
+
+config_file_t *config_file_new_cached(const char *path,
+      const char *snapshot_path)
+{
+   config_file_t *conf = NULL;
+
+   if (!path || !*path || !snapshot_path || !*snapshot_path)
+      return config_file_new(path);
+
+   conf = config_snapshot_load(path, snapshot_path);
+
+   if (conf)
+      return conf;
+
+   conf = config_file_new(path);
+
+   if (conf)
+      config_snapshot_save(conf, snapshot_path);
+
+   return conf;
+}
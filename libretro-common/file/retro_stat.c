@@ -81,7 +81,8 @@ enum stat_mode
    IS_VALID
 };
 
-static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
+static bool path_stat(const char *path, enum stat_mode mode, int32_t *size,
+      int64_t *mtime)
 {
 #if defined(VITA) || defined(PSP)
    SceIoStat buf;
@@ -118,6 +119,22 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
    if (size)
       *size = (int32_t)buf.st_size;
 
+   /* In microseconds, finer than seconds where stat has it. */
+   if (mtime)
+   {
+#if defined(VITA) || defined(PSP) || defined(__CELLOS_LV2__)
+      *mtime = 0;
+#elif defined(__linux__) && defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L
+      *mtime = (int64_t)buf.st_mtim.tv_sec * 1000000
+         + buf.st_mtim.tv_nsec / 1000;
+#elif defined(__APPLE__) && !defined(_POSIX_C_SOURCE)
+      *mtime = (int64_t)buf.st_mtimespec.tv_sec * 1000000
+         + buf.st_mtimespec.tv_nsec / 1000;
+#else
+      *mtime = (int64_t)buf.st_mtime * 1000000;
+#endif
+   }
+
    switch (mode)
    {
       case IS_DIRECTORY:
@@ -153,28 +170,60 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
  */
 bool path_is_directory(const char *path)
 {
-   return path_stat(path, IS_DIRECTORY, NULL);
+   return path_stat(path, IS_DIRECTORY, NULL, NULL);
 }
 
 bool path_is_character_special(const char *path)
 {
-   return path_stat(path, IS_CHARACTER_SPECIAL, NULL);
+   return path_stat(path, IS_CHARACTER_SPECIAL, NULL, NULL);
 }
 
 bool path_is_valid(const char *path)
 {
-   return path_stat(path, IS_VALID, NULL);
+   return path_stat(path, IS_VALID, NULL, NULL);
 }
 
 int32_t path_get_size(const char *path)
 {
    int32_t filesize = 0;
-   if (path_stat(path, IS_VALID, &filesize))
+   if (path_stat(path, IS_VALID, &filesize, NULL))
       return filesize;
 
    return -1;
 }
 
+/**
+ * path_get_mtime:
+ * @path               : path
+ *
+ * Returns: last modification time of @path in seconds, 0 where
+ * the platform doesn't report it and -1 if @path doesn't exist.
+ */
+int64_t path_get_mtime(const char *path)
+{
+   int64_t mtime = 0;
+   if (path_stat(path, IS_VALID, NULL, &mtime))
+      return mtime / 1000000;
+
+   return -1;
+}
+
+/**
+ * path_get_mtime_usec:
+ * @path               : path
+ *
+ * Like path_get_mtime, in microseconds. Platforms which only
+ * report whole seconds give a multiple of 1000000.
+ */
+int64_t path_get_mtime_usec(const char *path)
+{
+   int64_t mtime = 0;
+   if (path_stat(path, IS_VALID, NULL, &mtime))
+      return mtime;
+
+   return -1;
+}
+
 /**
  * path_mkdir_norecurse:
  * @dir                : directory
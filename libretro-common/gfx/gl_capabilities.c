@@ -321,6 +321,29 @@ bool gl_check_capability(enum gl_capability_enum enum_idx)
          if (gl_query_extension("EXT_texture_storage"))
             return true;
          break;
+      case GL_CAPS_PROGRAM_BINARY:
+#ifdef GL_PROGRAM_BINARY_LENGTH
+         {
+            GLint num_formats = 0;
+#ifdef HAVE_OPENGLES
+            if (major < 3)
+               return false;
+#else
+            if (major < 4 || (major == 4 && minor < 1))
+               if (!gl_query_extension("ARB_get_program_binary"))
+                  return false;
+
+            if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+               return false;
+#endif
+            /* Some drivers expose the entry points but
+             * support no binary formats at all. */
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+            if (num_formats > 0)
+               return true;
+         }
+#endif
+         break;
       case GL_CAPS_NONE:
       default:
          break;
@@ -76,6 +76,18 @@ enum file_archive_compression_mode
    ARCHIVE_MODE_COMPRESSED   = 8
 };
 
+/* One file inside an archive, as recorded in its cached index. */
+struct file_archive_entry
+{
+   /* Offset of the compressed data for ZIP,
+    * index of the file for 7z. */
+   uint64_t offset;
+   uint32_t crc32;
+   uint32_t size;
+   uint32_t csize;
+   unsigned cmode;
+};
+
 struct decomp_state_t
 {
    char *opt_file;
@@ -128,6 +140,9 @@ struct file_archive_file_backend
    bool     (*stream_decompress_data_to_file_init)(
          file_archive_file_handle_t *, const uint8_t *,  uint32_t, uint32_t);
    int      (*stream_decompress_data_to_file_iterate)(void *);
+   /* Optional, decompresses straight to a file in bounded memory. */
+   bool     (*stream_decompress_to_file)(const char *path,
+         const uint8_t *cdata, uint32_t csize, uint32_t size, uint32_t crc32);
    uint32_t (*stream_crc_calculate)(uint32_t, const uint8_t *, size_t);
    int (*compressed_file_read)(const char *path, const char *needle, void **buf,
          const char *optional_outfile);
@@ -194,6 +209,28 @@ const struct file_archive_file_backend* file_archive_get_7z_file_backend(void);
 
 const struct file_archive_file_backend* file_archive_get_file_backend(const char *path);
 
+bool file_archive_cache_init(void);
+
+void file_archive_cache_deinit(void);
+
+/**
+ * file_archive_find_entry:
+ * @archive_path                : filename path of archive, without
+ *                                the path within the archive.
+ * @needle                      : path within the archive, NULL or
+ *                                empty for the first file.
+ * @partial                     : when there is no exact match, accept
+ *                                the first file containing @needle.
+ * @entry                       : location of the found entry.
+ *
+ * Looks up a file in the index of @archive_path. Directories
+ * are never returned.
+ *
+ * Returns: true (1) if the file was found, otherwise false (0).
+ **/
+bool file_archive_find_entry(const char *archive_path, const char *needle,
+      bool partial, struct file_archive_entry *entry);
+
 /**
  * file_archive_get_file_crc32:
  * @path                         : filename path of archive
@@ -207,6 +244,11 @@ uint32_t file_archive_get_file_crc32(const char *path);
 extern const struct file_archive_file_backend zlib_backend;
 extern const struct file_archive_file_backend sevenzip_backend;
 
+/* Open archive and decoded block cache of the 7z backend,
+ * driven by file_archive_cache_init/deinit. */
+bool sevenzip_cache_init(void);
+void sevenzip_cache_deinit(void);
+
 RETRO_END_DECLS
 
 #endif
@@ -68,6 +68,13 @@ typedef struct config_file config_file_t;
  * NULL path will create an empty config file. */
 config_file_t *config_file_new(const char *path);
 
+/* Loads a config file like config_file_new(), from a binary snapshot
+ * at snapshot_path as long as the file and everything it includes
+ * keep their modification time and size. Otherwise parses the file
+ * and rewrites the snapshot. */
+config_file_t *config_file_new_cached(const char *path,
+      const char *snapshot_path);
+
 /* Load a config file from a string. */
 config_file_t *config_file_new_from_string(const char *from_string);
 
@@ -154,6 +161,12 @@ void config_set_bool(config_file_t *conf, const char *entry, bool val);
 /* Write the current config to a file. */
 bool config_file_write(config_file_t *conf, const char *path);
 
+/* Writes back only the keys that changed since the config was
+ * loaded or last written, leaving the rest of the file, comments
+ * included, as it is. Doesn't touch the file when nothing changed.
+ * NULL path writes to the file the config was loaded from. */
+bool config_file_write_changes(config_file_t *conf, const char *path);
+
 /* Dump the current config to an already opened file.
  * Does not close the file. */
 void config_file_dump(config_file_t *conf, FILE *file);
@@ -34,6 +34,20 @@ RETRO_BEGIN_DECLS
 struct http_t;
 struct http_connection_t;
 
+/* Receives the body of a response as it arrives.
+ * Returns false to abort the transfer. */
+typedef bool (*net_http_sink_t)(void *userdata,
+      const uint8_t *data, size_t len);
+
+/* Keeps connections that finished a response open for the next
+ * request to the same host. Without it, every request gets a
+ * connection of its own. */
+bool net_http_pool_init(void);
+
+/* Closes the idle connections. Requests still in flight close
+ * theirs when done. */
+void net_http_pool_deinit(void);
+
 struct http_connection_t *net_http_connection_new(const char *url, const char *method, const char *data);
 
 bool net_http_connection_iterate(struct http_connection_t *conn);
@@ -46,6 +60,12 @@ const char *net_http_connection_url(struct http_connection_t *conn);
 
 struct http_t *net_http_new(struct http_connection_t *conn);
 
+/* Streams the body to @sink instead of keeping it in memory,
+ * net_http_data then returns no data. Set it before the first
+ * net_http_update. */
+void net_http_set_sink(struct http_t *state,
+      net_http_sink_t sink, void *userdata);
+
 /* You can use this to call net_http_update 
  * only when something will happen; select() it for reading. */
 int net_http_fd(struct http_t *state);
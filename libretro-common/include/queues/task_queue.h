@@ -42,6 +42,16 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+enum task_priority
+{
+   TASK_PRIORITY_NORMAL = 0,
+   /* Short tasks the user is waiting on, e.g. thumbnails. */
+   TASK_PRIORITY_HIGH,
+   /* Long running background work, e.g. database scans. */
+   TASK_PRIORITY_LOW,
+   TASK_PRIORITY_LAST
+};
+
 
 enum task_queue_ctl_state
 {
@@ -153,10 +163,40 @@ struct retro_task
 
    enum task_type type;
 
-   /* don't touch this. */
+   /* set before pushing the task. Workers pick the
+    * highest priority task that is ready to run. */
+   enum task_priority priority;
+
+   /* set to true before pushing the task if the handler
+    * may run for several tasks at once. Tasks sharing a
+    * non-reentrant handler are run one at a time. */
+   bool reentrant;
+
+   /* don't touch these. */
+   bool busy;
+   int64_t queued_time;
    retro_task_t *next;
 };
 
+typedef struct task_queue_stats
+{
+   /* worker threads, 0 if not threaded */
+   unsigned workers;
+
+   /* tasks waiting for their next tick, per priority */
+   unsigned queued[TASK_PRIORITY_LAST];
+
+   /* tasks a worker is running right now */
+   unsigned running;
+
+   uint64_t pushed;
+   uint64_t finished;
+
+   /* time from push to first tick, in microseconds */
+   int64_t latency_avg;
+   int64_t latency_max;
+} task_queue_stats_t;
+
 typedef struct task_finder_data
 {
    retro_task_finder_t func;
@@ -188,6 +228,11 @@ void task_queue_retriever_info_free(task_retriever_info_t *list);
  * it to complete. */
 void task_queue_cancel_task(void *task);
 
+/**
+ * Fills @stats with the current queue depth
+ * and task latency. */
+void task_queue_get_stats(task_queue_stats_t *stats);
+
 void task_set_finished(retro_task_t *task, bool finished);
 
 void task_set_mute(retro_task_t *task, bool mute);
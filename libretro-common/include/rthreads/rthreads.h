@@ -86,6 +86,14 @@ void sthread_join(sthread_t *thread);
  */
 bool sthread_isself(sthread_t *thread);
 
+/**
+ * sthread_get_current_thread_id:
+ *
+ * Returns: an ID of the calling thread, unique among
+ * the threads running at the same time.
+ */
+uintptr_t sthread_get_current_thread_id(void);
+
 /**
  * slock_new:
  *
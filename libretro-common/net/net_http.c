@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <time.h>
 
 #include <net/net_http.h>
 #include <net/net_compat.h>
@@ -30,12 +31,18 @@
 #include <compat/strl.h>
 #include <string/stdstring.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 enum
 {
    P_HEADER_TOP = 0,
    P_HEADER,
    P_BODY,
    P_BODY_CHUNKLEN,
+   P_BODY_CHUNKEND,
+   P_TRAILER,
    P_DONE,
    P_ERROR
 };
@@ -47,21 +54,65 @@ enum
    T_CHUNK
 };
 
+#define HTTP_POOL_SIZE         8
+#define HTTP_POOL_IDLE_SECONDS 15
+
 struct http_t
 {
    int fd;
    int status;
-   
+   int port;
+
    char part;
    char bodytype;
    bool error;
-   
+   /* the server lets us reuse the connection */
+   bool keep_alive;
+   /* the connection came from the pool */
+   bool reused;
+   /* GET or HEAD, safe to send twice */
+   bool idempotent;
+   bool received_any;
+
+   /* receive buffer */
    size_t pos;
-   size_t len;
    size_t buflen;
+   char * buf;
+
+   /* body bytes left in the message (T_LEN) or chunk (T_CHUNK) */
+   size_t remaining;
+   /* expected body size, 0 if unknown */
+   size_t total;
+
+   /* body, unless a sink takes it */
+   size_t len;
+   size_t datalen;
    char * data;
+
+   net_http_sink_t sink;
+   void *sink_data;
+
+   char *domain;
+   char *request;
+   size_t request_len;
+};
+
+/* Idle keep-alive connections, reused by requests to the same host. */
+struct http_pooled_connection
+{
+   char domain[256];
+   int port;
+   int fd;
+   time_t idle_since;
 };
 
+static struct http_pooled_connection http_pool[HTTP_POOL_SIZE];
+static unsigned http_pool_count = 0;
+static bool http_pool_inited    = false;
+#ifdef HAVE_THREADS
+static slock_t *http_pool_lock  = NULL;
+#endif
+
 struct http_connection_t
 {
    char *domain;
@@ -144,13 +195,110 @@ error:
    return -1;
 }
 
-static void net_http_send_str(int fd, bool *error, const char *text)
+static void net_http_pool_lock(void)
 {
-   if (*error)
-      return;
+#ifdef HAVE_THREADS
+   slock_lock(http_pool_lock);
+#endif
+}
+
+static void net_http_pool_unlock(void)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(http_pool_lock);
+#endif
+}
+
+bool net_http_pool_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!http_pool_lock)
+      http_pool_lock = slock_new();
+   if (!http_pool_lock)
+      return false;
+#endif
+   http_pool_inited = true;
+   return true;
+}
+
+void net_http_pool_deinit(void)
+{
+   unsigned i;
+
+   /* The lock stays, requests on other threads may still
+    * be finishing. */
+   net_http_pool_lock();
+
+   for (i = 0; i < http_pool_count; i++)
+      socket_close(http_pool[i].fd);
+
+   http_pool_count  = 0;
+   http_pool_inited = false;
+
+   net_http_pool_unlock();
+}
+
+/* Takes an idle connection to @domain:@port out of the pool,
+ * closing the ones that idled for too long on the way. */
+static int net_http_pool_get(const char *domain, int port)
+{
+   unsigned i;
+   int fd     = -1;
+   time_t now = time(NULL);
+
+   net_http_pool_lock();
+
+   for (i = 0; i < http_pool_count; )
+   {
+      struct http_pooled_connection *entry = &http_pool[i];
+
+      if (now - entry->idle_since > HTTP_POOL_IDLE_SECONDS)
+      {
+         socket_close(entry->fd);
+         *entry = http_pool[--http_pool_count];
+         continue;
+      }
+
+      if (fd < 0 && entry->port == port
+            && string_is_equal(entry->domain, domain))
+      {
+         fd     = entry->fd;
+         *entry = http_pool[--http_pool_count];
+         continue;
+      }
+
+      i++;
+   }
+
+   net_http_pool_unlock();
+
+   return fd;
+}
+
+/* Hands a connection with no pending response back to the pool.
+ * Closes it if the pool is full or not in use. */
+static void net_http_pool_put(const char *domain, int port, int fd)
+{
+   if (strlen(domain) < sizeof(http_pool[0].domain))
+   {
+      net_http_pool_lock();
+
+      if (http_pool_inited && http_pool_count < HTTP_POOL_SIZE)
+      {
+         struct http_pooled_connection *entry = &http_pool[http_pool_count++];
+
+         strlcpy(entry->domain, domain, sizeof(entry->domain));
+         entry->port       = port;
+         entry->fd         = fd;
+         entry->idle_since = time(NULL);
+         fd                = -1;
+      }
 
-   if (!socket_send_all_blocking(fd, text, strlen(text), true))
-      *error = true;
+      net_http_pool_unlock();
+   }
+
+   if (fd >= 0)
+      socket_close(fd);
 }
 
 struct http_connection_t *net_http_connection_new(const char *url,
@@ -213,6 +361,7 @@ bool net_http_connection_iterate(struct http_connection_t *conn)
 
 bool net_http_connection_done(struct http_connection_t *conn)
 {
+   char delim;
    char **location = NULL;
 
    if (!conn)
@@ -223,10 +372,12 @@ bool net_http_connection_done(struct http_connection_t *conn)
    if (*conn->scan == '\0')
       return false;
 
+   /* Terminates the domain, so look at what ended it first. */
+   delim        = *conn->scan;
    *conn->scan  = '\0';
    conn->port   = 80;
 
-   if (*conn->scan == ':')
+   if (delim == ':')
    {
       if (!isdigit((int)conn->scan[1]))
          return false;
@@ -272,133 +423,161 @@ const char *net_http_connection_url(struct http_connection_t *conn)
    return conn->urlcopy;
 }
 
-struct http_t *net_http_new(struct http_connection_t *conn)
+/* Builds the whole request, so it goes out in one send and
+ * can be sent again on a fresh connection. */
+static char *net_http_build_request(struct http_connection_t *conn,
+      size_t *len)
 {
-   bool error            = false;
-   int fd                = -1;
-   struct http_t *state  = NULL;
+   size_t size;
+   char *request        = NULL;
+   const char *method   = conn->methodcopy ? conn->methodcopy : "GET";
+   bool is_post         = string_is_equal(method, "POST");
+   size_t post_len      = 0;
+   char port[16];
+   char content_length[64];
 
-   if (!conn)
-      goto error;
+   port[0] = content_length[0] = '\0';
 
-   fd = net_http_new_socket(conn->domain, conn->port);
-   if (fd < 0)
-      goto error;
-
-   error = false;
-
-   /* This is a bit lazy, but it works. */
-   if (conn->methodcopy)
-   {
-      net_http_send_str(fd, &error, conn->methodcopy);
-      net_http_send_str(fd, &error, " /");
-   }
-   else
+   if (is_post)
    {
-      net_http_send_str(fd, &error, "GET /");
+      if (!conn->postdatacopy)
+         return NULL;
+      post_len = strlen(conn->postdatacopy);
+      snprintf(content_length, sizeof(content_length),
+            "Content-Length: %lu\r\n", (unsigned long)post_len);
    }
 
-   net_http_send_str(fd, &error, conn->location);
-   net_http_send_str(fd, &error, " HTTP/1.1\r\n");
-
-   net_http_send_str(fd, &error, "Host: ");
-   net_http_send_str(fd, &error, conn->domain);
-
    if (conn->port != 80)
-   {
-      char portstr[16];
+      snprintf(port, sizeof(port), ":%i", conn->port);
 
-      portstr[0] = '\0';
+   size = strlen(method) + strlen(conn->location) + strlen(conn->domain)
+      + (conn->contenttypecopy ? strlen(conn->contenttypecopy) : 0)
+      + strlen(port) + strlen(content_length) + post_len + 256;
 
-      snprintf(portstr, sizeof(portstr), ":%i", conn->port);
-      net_http_send_str(fd, &error, portstr);
-   }
+   request = (char*)malloc(size);
 
-   net_http_send_str(fd, &error, "\r\n");
+   if (!request)
+      return NULL;
 
-   /* this is not being set anywhere yet */
-   if (conn->contenttypecopy)
-   {
-      net_http_send_str(fd, &error, "Content-Type: ");
-      net_http_send_str(fd, &error, conn->contenttypecopy);
-      net_http_send_str(fd, &error, "\r\n");
-   }
+   /* This is a bit lazy, but it works. */
+   snprintf(request, size,
+         "%s /%s HTTP/1.1\r\n"
+         "Host: %s%s\r\n"
+         "%s%s%s"
+         "%s%s"
+         "User-Agent: libretro\r\n"
+         "Connection: keep-alive\r\n"
+         "\r\n"
+         "%s",
+         method, conn->location,
+         conn->domain, port,
+         conn->contenttypecopy ? "Content-Type: " : "",
+         conn->contenttypecopy ? conn->contenttypecopy : "",
+         conn->contenttypecopy ? "\r\n" : "",
+         (is_post && !conn->contenttypecopy)
+         ? "Content-Type: application/x-www-form-urlencoded\r\n" : "",
+         content_length,
+         is_post ? conn->postdatacopy : "");
+
+   *len = strlen(request);
+
+   return request;
+}
 
-   if (conn->methodcopy && string_is_equal(conn->methodcopy, "POST"))
-   {
-      size_t post_len, len;
-      char *len_str        = NULL;
+/* Sends the request, on a pooled connection to the host if there
+ * is one. */
+static bool net_http_send_request(struct http_t *state, bool allow_reuse)
+{
+   state->reused = false;
+   state->fd     = allow_reuse
+      ? net_http_pool_get(state->domain, state->port) : -1;
 
-      if (!conn->postdatacopy)
-         goto error;
+   if (state->fd >= 0)
+   {
+      if (socket_send_all_blocking(state->fd,
+               state->request, state->request_len, true))
+      {
+         state->reused = true;
+         return true;
+      }
 
-      if (!conn->contenttypecopy)
-         net_http_send_str(fd, &error,
-               "Content-Type: application/x-www-form-urlencoded\r\n");
+      /* Closed by the server while idle. */
+      socket_close(state->fd);
+   }
 
-      net_http_send_str(fd, &error, "Content-Length: ");
+   state->fd = net_http_new_socket(state->domain, state->port);
 
-      post_len = strlen(conn->postdatacopy);
-#ifdef _WIN32
-      len = snprintf(NULL, 0, "%I64u", post_len);
-      len_str = (char*)malloc(len + 1);
-      snprintf(len_str, len + 1, "%I64u", post_len);
-#else
-      len = snprintf(NULL, 0, "%llu", (long long unsigned)post_len);
-      len_str = (char*)malloc(len + 1);
-      snprintf(len_str, len + 1, "%llu", (long long unsigned)post_len);
-#endif
+   if (state->fd < 0)
+      return false;
 
-      len_str[len] = '\0';
+   return socket_send_all_blocking(state->fd,
+         state->request, state->request_len, true);
+}
 
-      net_http_send_str(fd, &error, len_str);
-      net_http_send_str(fd, &error, "\r\n");
+struct http_t *net_http_new(struct http_connection_t *conn)
+{
+   struct http_t *state  = NULL;
+   const char *method    = NULL;
 
-      free(len_str);
-   }
+   if (!conn)
+      goto error;
 
-   net_http_send_str(fd, &error, "User-Agent: libretro\r\n");
-   net_http_send_str(fd, &error, "Connection: close\r\n");
-   net_http_send_str(fd, &error, "\r\n");
+   state = (struct http_t*)calloc(1, sizeof(struct http_t));
 
-   if (conn->methodcopy && string_is_equal(conn->methodcopy, "POST"))
-      net_http_send_str(fd, &error, conn->postdatacopy);
+   if (!state)
+      goto error;
 
-   if (error)
+   state->fd         = -1;
+   state->status     = -1;
+   state->part       = P_HEADER_TOP;
+   state->bodytype   = T_FULL;
+   state->keep_alive = true;
+   state->port       = conn->port;
+   state->buflen     = 4096;
+   state->buf        = (char*)malloc(state->buflen);
+   state->domain     = strdup(conn->domain);
+   state->request    = net_http_build_request(conn, &state->request_len);
+
+   method            = conn->methodcopy ? conn->methodcopy : "GET";
+   state->idempotent = string_is_equal(method, "GET")
+      || string_is_equal(method, "HEAD");
+
+   if (!state->buf || !state->domain || !state->request)
       goto error;
 
-   state          = (struct http_t*)malloc(sizeof(struct http_t));
-   state->fd      = fd;
-   state->status  = -1;
-   state->data    = NULL;
-   state->part    = P_HEADER_TOP;
-   state->bodytype= T_FULL;
-   state->error   = false;
-   state->pos     = 0;
-   state->len     = 0;
-   state->buflen  = 512;
-   state->data    = (char*)malloc(state->buflen);
-
-   if (!state->data)
+   /* Anything else gets a new connection, since it can't be
+    * retried should the pooled one turn out to be closed. */
+   if (!net_http_send_request(state, state->idempotent))
       goto error;
 
    return state;
 
 error:
-   if (conn->methodcopy)
-      free(conn->methodcopy);
-   if (conn->contenttypecopy)
-      free(conn->contenttypecopy);
-   conn->methodcopy = NULL;
-   conn->contenttypecopy = NULL;
-   conn->postdatacopy = NULL;
-   if (fd >= 0)
-      socket_close(fd);
+   if (conn)
+   {
+      if (conn->methodcopy)
+         free(conn->methodcopy);
+      if (conn->contenttypecopy)
+         free(conn->contenttypecopy);
+      conn->methodcopy = NULL;
+      conn->contenttypecopy = NULL;
+      conn->postdatacopy = NULL;
+   }
    if (state)
-      free(state);
+      net_http_delete(state);
    return NULL;
 }
 
+void net_http_set_sink(struct http_t *state,
+      net_http_sink_t sink, void *userdata)
+{
+   if (!state)
+      return;
+
+   state->sink      = sink;
+   state->sink_data = userdata;
+}
+
 int net_http_fd(struct http_t *state)
 {
    if (!state)
@@ -406,210 +585,281 @@ int net_http_fd(struct http_t *state)
    return state->fd;
 }
 
-bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
+/* Passes body bytes to the sink or appends them to the body. */
+static bool net_http_body(struct http_t *state, const char *data, size_t len)
 {
-   ssize_t newlen = 0;
+   if (!len)
+      return true;
 
-   if (!state || state->error)
-      goto fail;
+   if (state->sink)
+   {
+      state->len += len;
+      return state->sink(state->sink_data, (const uint8_t*)data, len);
+   }
 
-   if (state->part < P_BODY)
+   if (state->len + len > state->datalen)
    {
-      if (state->error)
-         newlen = -1;
-      else
-         newlen = socket_receive_all_nonblocking(state->fd, &state->error,
-               (uint8_t*)state->data + state->pos,
-               state->buflen - state->pos);
+      size_t datalen = state->datalen ? state->datalen : 512;
+      char *body     = NULL;
 
-      if (newlen < 0)
-         goto fail;
+      while (datalen < state->len + len)
+         datalen *= 2;
 
-      if (state->pos + newlen >= state->buflen - 64)
-      {
-         state->buflen *= 2;
-         state->data    = (char*)realloc(state->data, state->buflen);
-      }
-      state->pos += newlen;
+      body = (char*)realloc(state->data, datalen);
 
-      while (state->part < P_BODY)
-      {
-         char *dataend = state->data + state->pos;
-         char *lineend = (char*)memchr(state->data, '\n', state->pos);
+      if (!body)
+         return false;
 
-         if (!lineend)
-            break;
+      state->data    = body;
+      state->datalen = datalen;
+   }
 
-         *lineend='\0';
+   memcpy(state->data + state->len, data, len);
+   state->len += len;
 
-         if (lineend != state->data && lineend[-1]=='\r')
-            lineend[-1]='\0';
+   return true;
+}
 
-         if (state->part == P_HEADER_TOP)
-         {
-            if (strncmp(state->data, "HTTP/1.", strlen("HTTP/1."))!=0)
-               goto fail;
-            state->status = (int)strtoul(state->data + strlen("HTTP/1.1 "), NULL, 10);
-            state->part   = P_HEADER;
-         }
-         else
-         {
-            if (!strncmp(state->data, "Content-Length: ",
-                     strlen("Content-Length: ")))
-            {
-               state->bodytype = T_LEN;
-               state->len = strtol(state->data + 
-                     strlen("Content-Length: "), NULL, 10);
-            }
-            if (string_is_equal(state->data, "Transfer-Encoding: chunked"))
-               state->bodytype = T_CHUNK;
-
-            /* TODO: save headers somewhere */
-            if (state->data[0]=='\0')
-            {
-               state->part = P_BODY;
-               if (state->bodytype == T_CHUNK)
-                  state->part = P_BODY_CHUNKLEN;
-            }
-         }
+/* Header names are case insensitive. */
+static const char *net_http_header_value(const char *line, const char *name)
+{
+   while (*name)
+   {
+      if (tolower((unsigned char)*line) != tolower((unsigned char)*name))
+         return NULL;
+      line++;
+      name++;
+   }
 
-         memmove(state->data, lineend + 1, dataend-(lineend+1));
-         state->pos = (dataend-(lineend + 1));
-      }
-      if (state->part >= P_BODY)
-      {
-         newlen = state->pos;
-         state->pos = 0;
-      }
+   while (*line == ' ' || *line == '\t')
+      line++;
+
+   return line;
+}
+
+static bool net_http_header(struct http_t *state, const char *line)
+{
+   const char *value = NULL;
+
+   if (state->part == P_HEADER_TOP)
+   {
+      if (strncmp(line, "HTTP/1.", strlen("HTTP/1.")) != 0)
+         return false;
+
+      /* HTTP/1.0 closes unless told otherwise, we don't ask. */
+      if (line[strlen("HTTP/1.")] == '0')
+         state->keep_alive = false;
+
+      state->status = (int)strtoul(line + strlen("HTTP/1.1 "), NULL, 10);
+      state->part   = P_HEADER;
+      return true;
    }
 
-   if (state->part >= P_BODY && state->part < P_DONE)
+   if (!*line)
    {
-      if (!newlen)
-      {
-         if (state->error)
-            newlen = -1;
-         else
-            newlen = socket_receive_all_nonblocking(
-                  state->fd,
-                  &state->error,
-                  (uint8_t*)state->data + state->pos,
-                  state->buflen - state->pos);
+      state->part = P_BODY;
 
-         if (newlen < 0)
-         {
-            if (state->bodytype == T_FULL)
-            {
-               state->part = P_DONE;
-               state->data = (char*)realloc(state->data, state->len);
-            }
-            else
-               goto fail;
-            newlen=0;
-         }
+      if (state->bodytype == T_CHUNK)
+         state->part = P_BODY_CHUNKLEN;
+      /* No body in these. */
+      else if (state->status == 204 || state->status == 304
+            || (state->bodytype == T_LEN && !state->remaining))
+         state->part = P_DONE;
+      /* Without a length the body ends with the connection. */
+      else if (state->bodytype == T_FULL)
+         state->keep_alive = false;
+
+      return true;
+   }
 
-         if (state->pos + newlen >= state->buflen - 64)
+   if ((value = net_http_header_value(line, "Content-Length:")))
+   {
+      state->bodytype  = T_LEN;
+      state->remaining = strtoul(value, NULL, 10);
+      state->total     = state->remaining;
+
+      /* Reserve the whole body once instead of growing it. */
+      if (!state->sink && state->total > state->datalen)
+      {
+         char *body = (char*)realloc(state->data, state->total);
+
+         if (body)
          {
-            state->buflen *= 2;
-            state->data = (char*)realloc(state->data, state->buflen);
+            state->data    = body;
+            state->datalen = state->total;
          }
       }
+   }
+   else if ((value = net_http_header_value(line, "Transfer-Encoding:")))
+   {
+      if (strstr(value, "chunked"))
+         state->bodytype = T_CHUNK;
+   }
+   else if ((value = net_http_header_value(line, "Connection:")))
+   {
+      if (strstr(value, "close"))
+         state->keep_alive = false;
+   }
 
-parse_again:
-      if (state->bodytype == T_CHUNK)
+   /* TODO: save headers somewhere */
+   return true;
+}
+
+/* Consumes what has been received so far. */
+static bool net_http_parse(struct http_t *state)
+{
+   size_t start = 0;
+
+   while (start < state->pos && state->part != P_DONE)
+   {
+      char *data   = state->buf + start;
+      size_t avail = state->pos - start;
+
+      if (state->part == P_BODY)
       {
-         if (state->part == P_BODY_CHUNKLEN)
+         size_t len = avail;
+
+         if (state->bodytype != T_FULL && len > state->remaining)
+            len = state->remaining;
+
+         if (!net_http_body(state, data, len))
+            return false;
+
+         start += len;
+
+         if (state->bodytype != T_FULL)
          {
-            state->pos += newlen;
-            if (state->pos - state->len >= 2)
-            {
-               /*
-                * len=start of chunk including \r\n
-                * pos=end of data
-                */
-
-               char *fullend = state->data + state->pos;
-               char *end     = (char*)memchr(state->data + state->len + 2, '\n',
-                                             state->pos - state->len - 2);
-
-               if (end)
-               {
-                  size_t chunklen = strtoul(state->data+state->len, NULL, 16);
-                  state->pos      = state->len;
-                  end++;
-
-                  memmove(state->data+state->len, end, fullend-end);
-
-                  state->len      = chunklen;
-                  newlen          = (fullend - end);
-
-                  /*
-                     len=num bytes
-                     newlen=unparsed bytes after \n
-                     pos=start of chunk including \r\n
-                     */
-
-                  state->part = P_BODY;
-                  if (state->len == 0)
-                  {
-                     state->part = P_DONE;
-                     state->len  = state->pos;
-                     state->data = (char*)realloc(state->data, state->len);
-                  }
-                  goto parse_again;
-               }
-            }
+            state->remaining -= len;
+
+            if (!state->remaining)
+               state->part = (state->bodytype == T_CHUNK)
+                  ? P_BODY_CHUNKEND : P_DONE;
          }
-         else if (state->part == P_BODY)
+      }
+      else
+      {
+         char *lineend = (char*)memchr(data, '\n', avail);
+
+         if (!lineend)
+            break;
+
+         start   += lineend + 1 - data;
+         *lineend = '\0';
+
+         if (lineend != data && lineend[-1] == '\r')
+            lineend[-1] = '\0';
+
+         switch (state->part)
          {
-            if ((size_t)newlen >= state->len)
-            {
-               state->pos += state->len;
-               newlen     -= state->len;
-               state->len  = state->pos;
+            case P_HEADER_TOP:
+            case P_HEADER:
+               if (!net_http_header(state, data))
+                  return false;
+               break;
+            case P_BODY_CHUNKLEN:
+               if (!isxdigit((unsigned char)*data))
+                  return false;
+               state->remaining = strtoul(data, NULL, 16);
+               state->part      = state->remaining ? P_BODY : P_TRAILER;
+               break;
+            case P_BODY_CHUNKEND:
+               if (*data)
+                  return false;
                state->part = P_BODY_CHUNKLEN;
-               goto parse_again;
-            }
-            else
-            {
-               state->pos += newlen;
-               state->len -= newlen;
-            }
+               break;
+            case P_TRAILER:
+               if (!*data)
+                  state->part = P_DONE;
+               break;
          }
       }
-      else
+   }
+
+   /* Anything after the response means we are out of sync. */
+   if (state->part == P_DONE && start != state->pos)
+      state->keep_alive = false;
+
+   memmove(state->buf, state->buf + start, state->pos - start);
+   state->pos -= start;
+
+   return true;
+}
+
+bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
+{
+   ssize_t newlen = 0;
+
+   if (!state || state->error)
+      goto fail;
+
+   if (state->part < P_DONE)
+   {
+      /* Header and chunk size lines have to fit. */
+      if (state->pos == state->buflen)
+      {
+         char *buf = (char*)realloc(state->buf, state->buflen * 2);
+
+         if (!buf)
+            goto fail;
+
+         state->buf     = buf;
+         state->buflen *= 2;
+      }
+
+      newlen = socket_receive_all_nonblocking(state->fd, &state->error,
+            (uint8_t*)state->buf + state->pos,
+            state->buflen - state->pos);
+
+      if (newlen < 0)
       {
-         state->pos += newlen;
+         /* A pooled connection the server closed in the meantime,
+          * try once more on a new one, which can be pooled again. */
+         if (state->reused && state->idempotent && !state->received_any)
+         {
+            socket_close(state->fd);
+            state->error = false;
+
+            if (!net_http_send_request(state, false))
+               goto fail;
 
-         if (state->pos == state->len)
+            newlen = 0;
+         }
+         /* The body runs until the server closes. */
+         else if (state->part == P_BODY && state->bodytype == T_FULL)
          {
-            state->part = P_DONE;
-            state->data = (char*)realloc(state->data, state->len);
+            state->error      = false;
+            state->keep_alive = false;
+            state->part       = P_DONE;
+            newlen            = 0;
          }
-         if (state->pos > state->len)
+         else
             goto fail;
       }
+
+      if (newlen > 0)
+         state->received_any = true;
+
+      state->pos += newlen;
+
+      if (!net_http_parse(state))
+         goto fail;
    }
 
    if (progress)
-      *progress = state->pos;
+      *progress = state->len;
 
    if (total)
-   {
-      if (state->bodytype == T_LEN)
-         *total=state->len;
-      else
-         *total=0;
-   }
+      *total = state->total;
 
    return (state->part == P_DONE);
 
 fail:
    if (state)
    {
-      state->error  = true;
-      state->part   = P_ERROR;
-      state->status = -1;
+      state->error      = true;
+      state->keep_alive = false;
+      state->part       = P_ERROR;
+      state->status     = -1;
    }
 
    return true;
@@ -637,6 +887,18 @@ uint8_t* net_http_data(struct http_t *state, size_t* len, bool accept_error)
    if (len)
       *len=state->len;
 
+   /* Shrink to fit, the caller owns the data from here on. */
+   if (!state->sink && (!state->data || state->datalen != state->len))
+   {
+      char *body = (char*)realloc(state->data, state->len ? state->len : 1);
+
+      if (body)
+      {
+         state->data    = body;
+         state->datalen = state->len;
+      }
+   }
+
    return (uint8_t*)state->data;
 }
 
@@ -646,7 +908,16 @@ void net_http_delete(struct http_t *state)
       return;
 
    if (state->fd >= 0)
-      socket_close(state->fd);
+   {
+      if (state->part == P_DONE && state->keep_alive)
+         net_http_pool_put(state->domain, state->port, state->fd);
+      else
+         socket_close(state->fd);
+   }
+
+   free(state->buf);
+   free(state->domain);
+   free(state->request);
    free(state);
 }
 
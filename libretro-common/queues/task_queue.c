@@ -23,8 +23,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <queues/task_queue.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
@@ -62,6 +65,49 @@ static task_queue_t tasks_finished = {NULL, NULL};
 static struct retro_task_impl *impl_current = NULL;
 static bool task_threaded_enable            = false;
 
+/* Guarded by running_lock when threaded. */
+static uint64_t task_stats_pushed           = 0;
+static uint64_t task_stats_started          = 0;
+static uint64_t task_stats_finished         = 0;
+static int64_t task_stats_latency_total     = 0;
+static int64_t task_stats_latency_max       = 0;
+
+/* Accounts for the push to first tick latency of @task. */
+static void task_queue_stats_start(retro_task_t *task)
+{
+   int64_t latency;
+
+   if (!task->queued_time)
+      return;
+
+   latency           = cpu_features_get_time_usec() - task->queued_time;
+   task->queued_time = 0;
+
+   task_stats_started++;
+   task_stats_latency_total += latency;
+   if (latency > task_stats_latency_max)
+      task_stats_latency_max = latency;
+}
+
+static void task_queue_stats_fill(task_queue_stats_t *stats)
+{
+   retro_task_t *task = NULL;
+
+   for (task = tasks_running.front; task; task = task->next)
+   {
+      if (task->busy)
+         stats->running++;
+      else if (task->priority < TASK_PRIORITY_LAST)
+         stats->queued[task->priority]++;
+   }
+
+   stats->pushed      = task_stats_pushed;
+   stats->finished    = task_stats_finished;
+   stats->latency_max = task_stats_latency_max;
+   stats->latency_avg = task_stats_started
+      ? task_stats_latency_total / (int64_t)task_stats_started : 0;
+}
+
 static void task_queue_msg_push(retro_task_t *task,
       unsigned prio, unsigned duration,
       bool flush, const char *fmt, ...)
@@ -176,12 +222,16 @@ static void retro_task_regular_gather(void)
    for (task = queue; task; task = next)
    {
       next = task->next;
+      task_queue_stats_start(task);
       task->handler(task);
 
       task_queue_push_progress(task);
 
       if (task->finished)
+      {
+         task_stats_finished++;
          task_queue_put(&tasks_finished, task);
+      }
       else
          retro_task_regular_push_running(task);
    }
@@ -282,43 +332,44 @@ static struct retro_task_impl impl_regular = {
 };
 
 #ifdef HAVE_THREADS
+#define TASK_QUEUE_MIN_WORKERS 2
+#define TASK_QUEUE_MAX_WORKERS 8
+
 static slock_t *running_lock    = NULL;
 static slock_t *finished_lock   = NULL;
 static slock_t *property_lock   = NULL;
-static slock_t *queue_lock      = NULL;
 static scond_t *worker_cond     = NULL;
-static sthread_t *worker_thread = NULL;
 static bool worker_continue     = true; /* use running_lock when touching it */
 
+/* Task each worker is running, so non-reentrant handlers
+ * stay on a single worker at a time.
+ * Guarded by running_lock. */
+static retro_task_t *worker_tasks[TASK_QUEUE_MAX_WORKERS];
+static sthread_t *worker_threads[TASK_QUEUE_MAX_WORKERS];
+static unsigned worker_count    = 0;
+
+/* Must be called with running_lock held. */
 static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
 {
-   retro_task_t     *t = NULL;
-   retro_task_t *front = NULL;
-
-   slock_lock(queue_lock);
-   front = queue->front;
-   slock_unlock(queue_lock);
+   retro_task_t *t = queue->front;
 
    /* Remove first element if needed */
-   if (task == front)
+   if (task == t)
    {
-      slock_lock(queue_lock);
       queue->front = task->next;
-      slock_unlock(queue_lock);
       task->next   = NULL;
-       
       return;
    }
 
    /* Parse queue */
-   t = front;
-    
    while (t && t->next)
    {
       /* Remove task and update queue */
       if (t->next == task)
       {
          t->next    = task->next;
+         if (queue->back == task)
+            queue->back = t;
          task->next = NULL;
          break;
       }
@@ -328,13 +379,56 @@ static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
    }
 }
 
+/* Whether @task has to wait for a worker running the same
+ * handler. Only reentrant tasks share a handler. */
+static bool task_queue_handler_busy(const retro_task_t *task)
+{
+   unsigned i;
+
+   for (i = 0; i < worker_count; i++)
+   {
+      const retro_task_t *busy = worker_tasks[i];
+
+      if (busy && busy->handler == task->handler
+            && !(busy->reentrant && task->reentrant))
+         return true;
+   }
+
+   return false;
+}
+
+/* Picks the next task for a worker: a cancelled task first, so
+ * it can wind down right away, then the highest priority one.
+ * Tasks are put back at the end of the queue after every tick,
+ * which keeps tasks of the same priority round-robin.
+ * Must be called with running_lock held. */
+static retro_task_t *task_queue_pick(void)
+{
+   static const unsigned rank[TASK_PRIORITY_LAST] = { 1, 0, 2 };
+   retro_task_t *task = NULL;
+   retro_task_t *best = NULL;
+
+   for (task = tasks_running.front; task; task = task->next)
+   {
+      if (task->busy)
+         continue;
+      if (task_queue_handler_busy(task))
+         continue;
+      if (task->cancelled)
+         return task;
+      if (!best || rank[task->priority % TASK_PRIORITY_LAST]
+            < rank[best->priority % TASK_PRIORITY_LAST])
+         best = task;
+   }
+
+   return best;
+}
+
 static void retro_task_threaded_push_running(retro_task_t *task)
 {
    slock_lock(running_lock);
-   slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
    scond_signal(worker_cond);
-   slock_unlock(queue_lock);
    slock_unlock(running_lock);
 }
 
@@ -349,6 +443,8 @@ static void retro_task_threaded_cancel(void *task)
       if (t == task)
       {
         t->cancelled = true;
+        /* Run it ahead of the others. */
+        scond_signal(worker_cond);
         break;
       }
    }
@@ -394,6 +490,7 @@ static void retro_task_threaded_reset(void)
    slock_lock(running_lock);
    for (task = tasks_running.front; task; task = task->next)
       task->cancelled = true;
+   scond_broadcast(worker_cond);
    slock_unlock(running_lock);
 }
 
@@ -432,26 +529,24 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
 
 static void threaded_worker(void *userdata)
 {
-   (void)userdata;
+   unsigned id = (unsigned)(uintptr_t)userdata;
+
+   slock_lock(running_lock);
 
    for (;;)
    {
       retro_task_t *task  = NULL;
       bool finished = false;
 
+      while (worker_continue && !(task = task_queue_pick()))
+         scond_wait(worker_cond, running_lock);
+
       if (!worker_continue)
          break; /* should we keep running until all tasks finished? */
 
-      slock_lock(running_lock);
-
-      /* Get first task to run */
-      task = tasks_running.front;
-      if (task == NULL)
-      {
-         scond_wait(worker_cond, running_lock);
-         slock_unlock(running_lock);
-         continue;
-      }
+      task->busy          = true;
+      worker_tasks[id]    = task;
+      task_queue_stats_start(task);
 
       slock_unlock(running_lock);
 
@@ -462,61 +557,83 @@ static void threaded_worker(void *userdata)
       slock_unlock(property_lock);
 
       slock_lock(running_lock);
+
+      task->busy          = false;
+      worker_tasks[id]    = NULL;
       task_queue_remove(&tasks_running, task);
-      slock_unlock(running_lock);
 
       /* Update queue */
       if (!finished)
       {
-         /* Re-add task to running queue */
-         retro_task_threaded_push_running(task);
+         /* Re-add task to the end of the running queue */
+         task_queue_put(&tasks_running, task);
       }
       else
       {
-         /* Add task to finished queue */
+         /* Add task to finished queue, before it leaves the running
+          * one can be observed, so waiting never misses it */
          slock_lock(finished_lock);
          task_queue_put(&tasks_finished, task);
          slock_unlock(finished_lock);
+         task_stats_finished++;
       }
+
+      /* Wake up workers waiting on this handler. */
+      scond_broadcast(worker_cond);
    }
+
+   slock_unlock(running_lock);
 }
 
 static void retro_task_threaded_init(void)
 {
+   unsigned i;
+   unsigned cores = cpu_features_get_core_amount();
+
    running_lock  = slock_new();
    finished_lock = slock_new();
    property_lock = slock_new();
-   queue_lock    = slock_new();
    worker_cond   = scond_new();
 
    slock_lock(running_lock);
    worker_continue = true;
    slock_unlock(running_lock);
 
-   worker_thread = sthread_create(threaded_worker, NULL);
+   worker_count = MAX(TASK_QUEUE_MIN_WORKERS, MIN(cores, TASK_QUEUE_MAX_WORKERS));
+
+   for (i = 0; i < worker_count; i++)
+   {
+      worker_tasks[i]    = NULL;
+      worker_threads[i]  = sthread_create(threaded_worker, (void*)(uintptr_t)i);
+   }
 }
 
 static void retro_task_threaded_deinit(void)
 {
+   unsigned i;
+
    slock_lock(running_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
+   scond_broadcast(worker_cond);
    slock_unlock(running_lock);
 
-   sthread_join(worker_thread);
+   for (i = 0; i < worker_count; i++)
+   {
+      if (worker_threads[i])
+         sthread_join(worker_threads[i]);
+      worker_threads[i] = NULL;
+   }
 
    scond_free(worker_cond);
    slock_free(running_lock);
    slock_free(finished_lock);
    slock_free(property_lock);
-   slock_free(queue_lock);
 
-   worker_thread = NULL;
+   worker_count  = 0;
    worker_cond   = NULL;
    running_lock  = NULL;
    finished_lock = NULL;
    property_lock = NULL;
-   queue_lock = NULL;
 }
 
 static struct retro_task_impl impl_threaded = {
@@ -617,7 +734,7 @@ bool task_queue_ctl(enum task_queue_ctl_state state, void *data)
                retro_task_t *running = NULL;
                bool found = false;
 
-               SLOCK_LOCK(queue_lock);
+               SLOCK_LOCK(running_lock);
                running = tasks_running.front;
 
                for (; running; running = running->next)
@@ -629,13 +746,20 @@ bool task_queue_ctl(enum task_queue_ctl_state state, void *data)
                   }
                }
 
-               SLOCK_UNLOCK(queue_lock);
+               SLOCK_UNLOCK(running_lock);
 
                /* skip this task, user must try again later */
                if (found)
                   break;
             }
 
+            task->busy        = false;
+            task->queued_time = cpu_features_get_time_usec();
+
+            SLOCK_LOCK(running_lock);
+            task_stats_pushed++;
+            SLOCK_UNLOCK(running_lock);
+
             /* The lack of NULL checks in the following functions
              * is proposital to ensure correct control flow by the users. */
             impl_current->push_running(task);
@@ -663,6 +787,19 @@ void task_queue_cancel_task(void *task)
    impl_current->cancel(task);
 }
 
+void task_queue_get_stats(task_queue_stats_t *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+
+   SLOCK_LOCK(running_lock);
+#ifdef HAVE_THREADS
+   if (impl_current == &impl_threaded)
+      stats->workers = worker_count;
+#endif
+   task_queue_stats_fill(stats);
+   SLOCK_UNLOCK(running_lock);
+}
+
 void *task_queue_retriever_info_next(task_retriever_info_t **link)
 {
    void *data = NULL;
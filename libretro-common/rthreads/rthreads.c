@@ -25,6 +25,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <boolean.h>
 #include <rthreads/rthreads.h>
@@ -258,6 +259,27 @@ bool sthread_isself(sthread_t *thread)
 #endif
 }
 
+/**
+ * sthread_get_current_thread_id:
+ *
+ * Returns: an ID of the calling thread, unique among
+ * the threads running at the same time.
+ */
+uintptr_t sthread_get_current_thread_id(void)
+{
+#ifdef USE_WIN32_THREADS
+   return (uintptr_t)GetCurrentThreadId();
+#else
+   /* pthread_t is opaque, it isn't an integer everywhere. */
+   uintptr_t id     = 0;
+   pthread_t thread = pthread_self();
+
+   memcpy(&id, &thread,
+         sizeof(id) < sizeof(thread) ? sizeof(id) : sizeof(thread));
+   return id;
+#endif
+}
+
 /**
  * slock_new:
  *
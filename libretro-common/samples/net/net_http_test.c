@@ -21,38 +21,475 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <net/net_http.h>
 #include <net/net_compat.h>
+#include <net/net_socket.h>
 
-#ifdef _WIN32
-#include <winsock2.h>
-#endif
+/* A local stand-in for an HTTP server, stepped from the same loop
+ * as the client so the sample needs no threads. It answers:
+ *
+ * /length  : "hello world" with a Content-Length
+ * /chunked : "hello world" in chunks, with an extension and a trailer
+ * /big     : SINK_SIZE bytes of a pattern, for the sink
+ * /close   : like /length, but with "Connection: close"
+ * /post    : like /length, for POST requests, which it counts
+ */
+#define STAND_IN_CLIENTS 4
+#define SINK_SIZE        (256 * 1024)
 
-int main(void)
+struct stand_in_client
 {
-   char   *data;
-   struct http_t *http1, *http3;
-   size_t len, pos = 0, tot = 0;
+   int fd;
+   size_t in_len;
+   char in[4096];
+   size_t out_len;
+   size_t out_pos;
+   char *out;
+   bool close_after;
+};
 
-   if (!network_init())
-      return -1;
+struct stand_in
+{
+   int fd;
+   unsigned port;
+   unsigned accepted;
+   unsigned posts;
+   struct stand_in_client clients[STAND_IN_CLIENTS];
+};
+
+struct sink_state
+{
+   size_t len;
+   bool mismatch;
+};
+
+static unsigned failures = 0;
+
+static void check(bool ok, const char *what)
+{
+   printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+   if (!ok)
+      failures++;
+}
+
+static uint8_t pattern_byte(size_t i)
+{
+   return (uint8_t)((i * 7) ^ (i >> 8));
+}
+
+static bool stand_in_init(struct stand_in *server)
+{
+   struct sockaddr_in addr;
+   socklen_t addr_len     = sizeof(addr);
+   struct addrinfo *res   = NULL;
+   unsigned i;
+
+   memset(server, 0, sizeof(*server));
+
+   for (i = 0; i < STAND_IN_CLIENTS; i++)
+      server->clients[i].fd = -1;
+
+   server->fd = socket_init((void**)&res, 0, "127.0.0.1", SOCKET_TYPE_STREAM);
+
+   if (server->fd < 0)
+      return false;
+
+   if (     !socket_bind(server->fd, res)
+         || listen(server->fd, STAND_IN_CLIENTS) < 0
+         || getsockname(server->fd, (struct sockaddr*)&addr, &addr_len) < 0
+         || !socket_nonblock(server->fd))
+   {
+      freeaddrinfo_retro(res);
+      socket_close(server->fd);
+      return false;
+   }
+
+   freeaddrinfo_retro(res);
+   server->port = ntohs(addr.sin_port);
+   return true;
+}
+
+static void stand_in_drop(struct stand_in_client *client)
+{
+   socket_close(client->fd);
+   free(client->out);
+   memset(client, 0, sizeof(*client));
+   client->fd = -1;
+}
+
+/* Like a server timing out idle keep-alive connections. */
+static void stand_in_drop_all(struct stand_in *server)
+{
+   unsigned i;
+
+   for (i = 0; i < STAND_IN_CLIENTS; i++)
+      if (server->clients[i].fd >= 0)
+         stand_in_drop(&server->clients[i]);
+}
+
+static void stand_in_deinit(struct stand_in *server)
+{
+   stand_in_drop_all(server);
+   socket_close(server->fd);
+}
+
+static void stand_in_respond(struct stand_in_client *client, const char *path)
+{
+   static const char length[] =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Length: 11\r\n"
+      "\r\n"
+      "hello world";
+   static const char chunked[] =
+      "HTTP/1.1 200 OK\r\n"
+      "transfer-encoding: chunked\r\n"
+      "\r\n"
+      "5\r\nhello\r\n"
+      "1;ext=1\r\n \r\n"
+      "5\r\nworld\r\n"
+      "0\r\n"
+      "X-Trailer: yes\r\n"
+      "\r\n";
+   static const char closing[] =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Length: 11\r\n"
+      "Connection: close\r\n"
+      "\r\n"
+      "hello world";
+   static const char not_found[] =
+      "HTTP/1.1 404 Not Found\r\n"
+      "Content-Length: 0\r\n"
+      "\r\n";
+   const char *response = not_found;
+   size_t len           = sizeof(not_found) - 1;
+
+   client->out_pos     = 0;
+   client->close_after = false;
+
+   if (!strcmp(path, "/length") || !strcmp(path, "/post"))
+   {
+      response = length;
+      len      = sizeof(length) - 1;
+   }
+   else if (!strcmp(path, "/chunked"))
+   {
+      response = chunked;
+      len      = sizeof(chunked) - 1;
+   }
+   else if (!strcmp(path, "/close"))
+   {
+      response            = closing;
+      len                 = sizeof(closing) - 1;
+      client->close_after = true;
+   }
+   else if (!strcmp(path, "/big"))
+   {
+      size_t i;
+      char header[64];
+      size_t header_len = snprintf(header, sizeof(header),
+            "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n",
+            (unsigned)SINK_SIZE);
+
+      client->out     = (char*)malloc(header_len + SINK_SIZE);
+      client->out_len = header_len + SINK_SIZE;
+      memcpy(client->out, header, header_len);
+
+      for (i = 0; i < SINK_SIZE; i++)
+         client->out[header_len + i] = (char)pattern_byte(i);
+      return;
+   }
+
+   client->out     = (char*)malloc(len);
+   client->out_len = len;
+   memcpy(client->out, response, len);
+}
+
+static void stand_in_step(struct stand_in *server)
+{
+   unsigned i;
+   int fd = accept(server->fd, NULL, NULL);
+
+   if (fd >= 0)
+   {
+      for (i = 0; i < STAND_IN_CLIENTS; i++)
+      {
+         if (server->clients[i].fd < 0)
+         {
+            server->clients[i].fd = fd;
+            socket_nonblock(fd);
+            server->accepted++;
+            fd = -1;
+            break;
+         }
+      }
+
+      if (fd >= 0)
+         socket_close(fd);
+   }
+
+   for (i = 0; i < STAND_IN_CLIENTS; i++)
+   {
+      struct stand_in_client *client = &server->clients[i];
+      bool error                     = false;
+      char *end                      = NULL;
+      ssize_t got;
+
+      if (client->fd < 0)
+         continue;
+
+      if (client->out)
+      {
+         ssize_t sent = socket_send_all_nonblocking(client->fd,
+               client->out + client->out_pos,
+               client->out_len - client->out_pos, true);
+
+         if (sent < 0)
+         {
+            stand_in_drop(client);
+            continue;
+         }
+
+         client->out_pos += sent;
+
+         if (client->out_pos < client->out_len)
+            continue;
+
+         free(client->out);
+         client->out = NULL;
+
+         if (client->close_after)
+         {
+            stand_in_drop(client);
+            continue;
+         }
+      }
+
+      got = socket_receive_all_nonblocking(client->fd, &error,
+            client->in + client->in_len,
+            sizeof(client->in) - 1 - client->in_len);
+
+      if (got < 0)
+      {
+         stand_in_drop(client);
+         continue;
+      }
+
+      client->in_len            += got;
+      client->in[client->in_len] = '\0';
+      end                        = strstr(client->in, "\r\n\r\n");
 
-   http1 = net_http_new("http://buildbot.libretro.com/nightly/win-x86/latest/mednafen_psx_libretro.dll.zip");
+      /* One request at a time, as the client doesn't pipeline. */
+      if (end)
+      {
+         char method[16];
+         char path[256];
+         const char *length = strstr(client->in, "Content-Length: ");
+         size_t used        = end + 4 - client->in;
 
-   while (!net_http_update(http1, &pos, &tot))
-      printf("%.9lu / %.9lu        \r",pos,tot);
-	
-   http3 = net_http_new("http://www.wikipedia.org/");
-   while (!net_http_update(http3, NULL, NULL)) {}
-	
-   data  = (char*)net_http_data(http3, &len, false);
+         if (length && length < end)
+            used += strtoul(length + strlen("Content-Length: "), NULL, 10);
+
+         /* Wait for the rest of the body. */
+         if (used > client->in_len)
+            continue;
+
+         if (sscanf(client->in, "%15s %255s", method, path) != 2)
+            path[0] = '\0';
+         else if (!strcmp(method, "POST"))
+         {
+            if (!strcmp(path, "/post"))
+               server->posts++;
+         }
+         else if (strcmp(method, "GET") || !strcmp(path, "/post"))
+            path[0] = '\0';
+
+         stand_in_respond(client, path);
+
+         memmove(client->in, client->in + used, client->in_len - used);
+         client->in_len -= used;
+      }
+   }
+}
+
+static bool sink_check(void *userdata, const uint8_t *data, size_t len)
+{
+   size_t i;
+   struct sink_state *sink = (struct sink_state*)userdata;
+
+   for (i = 0; i < len; i++)
+      if (data[i] != pattern_byte(sink->len + i))
+         sink->mismatch = true;
+
+   sink->len += len;
+   return true;
+}
+
+/* Runs one request against the stand-in, a POST of @postdata if
+ * there is one. On success, @data is the body, which the caller
+ * frees, and @len its size; with a sink, @data is NULL and @len
+ * is what the sink was given. */
+static bool fetch(struct stand_in *server, const char *path,
+      const char *postdata, struct sink_state *sink,
+      uint8_t **data, size_t *len)
+{
+   char url[256];
+   struct http_t *http            = NULL;
+   struct http_connection_t *conn = NULL;
+   bool ok                        = false;
+
+   *data = NULL;
+   *len  = 0;
+
+   snprintf(url, sizeof(url), "http://127.0.0.1:%u%s", server->port, path);
+
+   conn = net_http_connection_new(url,
+         postdata ? "POST" : "GET", postdata);
+
+   if (!conn)
+      return false;
+
+   while (!net_http_connection_iterate(conn)) {}
+
+   if (net_http_connection_done(conn))
+      http = net_http_new(conn);
+
+   if (http)
+   {
+      if (sink)
+         net_http_set_sink(http, sink_check, sink);
+
+      while (!net_http_update(http, NULL, NULL))
+         stand_in_step(server);
+
+      /* Let the stand-in finish what it was doing. */
+      stand_in_step(server);
+
+      *data = net_http_data(http, len, false);
+      ok    = !net_http_error(http);
+
+      net_http_delete(http);
+   }
+
+   net_http_connection_free(conn);
+   return ok;
+}
+
+static bool is_hello(bool ok, uint8_t *data, size_t len)
+{
+   bool hello = ok && data && len == 11 && !memcmp(data, "hello world", 11);
+   free(data);
+   return hello;
+}
+
+static void test_stand_in(void)
+{
+   struct stand_in server;
+   struct sink_state sink;
+   uint8_t *data = NULL;
+   size_t len    = 0;
+   bool ok       = false;
+
+   if (!stand_in_init(&server))
+   {
+      check(false, "start the local stand-in server");
+      return;
+   }
+
+   net_http_pool_init();
+
+   ok = fetch(&server, "/length", NULL, NULL, &data, &len);
+   check(is_hello(ok, data, len), "Content-Length body");
+   check(server.accepted == 1, "first request opens a connection");
+
+   ok = fetch(&server, "/chunked", NULL, NULL, &data, &len);
+   check(is_hello(ok, data, len), "chunked body with extension and trailer");
+   check(server.accepted == 1, "keep-alive reuses the connection");
+
+   memset(&sink, 0, sizeof(sink));
+   ok = fetch(&server, "/big", NULL, &sink, &data, &len);
+   check(ok && !data, "sink keeps the body out of memory");
+   check(len == SINK_SIZE && sink.len == SINK_SIZE && !sink.mismatch,
+         "sink receives the whole body in order");
+   check(server.accepted == 1, "reused after a streamed body");
+   free(data);
+
+   ok = fetch(&server, "/close", NULL, NULL, &data, &len);
+   check(is_hello(ok, data, len), "Connection: close body");
+
+   ok = fetch(&server, "/length", NULL, NULL, &data, &len);
+   check(is_hello(ok, data, len), "request after close");
+   check(server.accepted == 2, "closed connection is not pooled");
+
+   stand_in_drop_all(&server);
+
+   ok = fetch(&server, "/length", NULL, NULL, &data, &len);
+   check(is_hello(ok, data, len),
+         "retried when the server dropped the idle connection");
+   check(server.accepted == 3, "retry opens a new connection");
+
+   ok = fetch(&server, "/missing", NULL, NULL, &data, &len);
+   check(!ok && !data, "404 is an error, not data");
+   check(server.accepted == 3, "retried connection is pooled again");
+   free(data);
+
+   /* A POST can't be sent twice, so it doesn't risk a pooled
+    * connection the server may have closed. */
+   ok = fetch(&server, "/post", "a=1", NULL, &data, &len);
+   check(is_hello(ok, data, len), "POST body");
+   check(server.accepted == 4, "POST opens a new connection");
+   check(server.posts == 1, "POST is sent once");
+
+   net_http_pool_deinit();
+   stand_in_deinit(&server);
+}
+
+/* Downloads @url, showing the progress. */
+static void download(const char *url)
+{
+   size_t pos                     = 0;
+   size_t tot                     = 0;
+   size_t len                     = 0;
+   struct http_t *http            = NULL;
+   struct http_connection_t *conn = net_http_connection_new(url, "GET", NULL);
+
+   if (!conn)
+      return;
+
+   while (!net_http_connection_iterate(conn)) {}
+
+   if (net_http_connection_done(conn))
+      http = net_http_new(conn);
+
+   if (http)
+   {
+      while (!net_http_update(http, &pos, &tot))
+         printf("%.9lu / %.9lu        \r", (unsigned long)pos,
+               (unsigned long)tot);
+
+      free(net_http_data(http, &len, true));
+      printf("\nstatus %d, %lu bytes\n", net_http_status(http),
+            (unsigned long)len);
+
+      net_http_delete(http);
+   }
+
+   net_http_connection_free(conn);
+}
+
+int main(int argc, char *argv[])
+{
+   if (!network_init())
+      return -1;
 
-   printf("%.*s\n", (int)256, data);
+   if (argc > 1)
+      download(argv[1]);
+   else
+      test_stand_in();
 
-   net_http_delete(http1);
-   net_http_delete(http3);
-   
    network_deinit();
 
-   return 0;
+   return failures ? 1 : 0;
 }
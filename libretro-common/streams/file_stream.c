@@ -79,7 +79,7 @@ struct RFILE
 #define MODE_STR_READ "r"
 #define MODE_STR_READ_UNBUF "rb"
 #define MODE_STR_WRITE_UNBUF "wb"
-#define MODE_STR_WRITE_PLUS "w+"
+#define MODE_STR_WRITE_PLUS "r+b"
 
 #if defined(HAVE_BUFFERED_IO)
    FILE *fp;
@@ -437,8 +437,12 @@ ssize_t filestream_tell(RFILE *stream)
    if (stream->mapped && stream->hints & RFILE_HINT_MMAP)
       return stream->mappos;
 #endif
-   if (lseek(stream->fd, 0, SEEK_CUR) < 0)
-      goto error;
+   {
+      off_t pos = lseek(stream->fd, 0, SEEK_CUR);
+      if (pos < 0)
+         goto error;
+      return pos;
+   }
 #endif
 
    return 0;
@@ -554,6 +558,8 @@ int filestream_close(RFILE *stream)
    if (stream->fd > 0)
       close(stream->fd);
 #endif
+   if (stream->ext)
+      free(stream->ext);
    free(stream);
 
    return 0;
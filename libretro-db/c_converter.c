@@ -823,6 +823,23 @@ int main(int argc, char** argv)
 
    filestream_close(rdb_file);
 
+   /* Add hash indexes for the fields looked up when scanning,
+    * so that callers don't need to walk the whole database. */
+   {
+      libretrodb_t *db = libretrodb_new();
+
+      if (db && libretrodb_open(rdb_path, db) == 0)
+      {
+         printf("Creating indexes...\n");
+         libretrodb_create_index(db, "crc", "crc");
+         libretrodb_create_index(db, "serial", "serial");
+         libretrodb_create_index(db, "name", "name");
+         libretrodb_close(db);
+      }
+
+      libretrodb_free(db);
+   }
+
    dat_converter_list_free(dat_parser_list);
 
    while (dat_count--)
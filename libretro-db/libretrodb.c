@@ -32,6 +32,15 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
 #include <compat/strl.h>
@@ -39,34 +48,37 @@
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "query.h"
 #include "libretrodb.h"
 
 #define MAGIC_NUMBER "RARCHDB"
 
-struct node_iter_ctx
+#define LIBRETRODB_MAX_INDEXES 8
+
+struct libretrodb_index
 {
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
+	char name[50];
+	char field_name[50];
+	uint64_t key_size;
+	uint64_t next;
+	uint64_t slots;
+	/* big endian document offsets, 0 marks an empty slot */
+	const uint8_t *table;
 };
 
 struct libretrodb
 {
-	RFILE *fd;
+	const uint8_t *data;
+	uint64_t size;
+	int mapped;
 	uint64_t root;
 	uint64_t count;
 	uint64_t first_index_offset;
+	unsigned num_indexes;
+	struct libretrodb_index indexes[LIBRETRODB_MAX_INDEXES];
    char path[1024];
 };
 
-struct libretrodb_index
-{
-	char name[50];
-	uint64_t key_size;
-	uint64_t next;
-};
-
 typedef struct libretrodb_metadata
 {
 	uint64_t count;
@@ -81,19 +93,19 @@ typedef struct libretrodb_header
 struct libretrodb_cursor
 {
 	int is_valid;
-   RFILE *fd;
+	uint64_t pos;
 	int eof;
+	/* Documents found through an index, in file order;
+	 * NULL if the cursor scans the whole database. */
+	uint64_t *matches;
+	size_t num_matches;
+	size_t next_match;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
 };
 
 static struct rmsgpack_dom_value sentinal;
 
-static int libretrodb_read_metadata(RFILE *fd, libretrodb_metadata_t *md)
-{
-   return rmsgpack_dom_read_into(fd, "count", &md->count, NULL);
-}
-
 static int libretrodb_write_metadata(RFILE *fd, libretrodb_metadata_t *md)
 {
    rmsgpack_write_map_header(fd, 1);
@@ -142,7 +154,7 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    struct rmsgpack_dom_value item;
    uint64_t item_count        = 0;
    libretrodb_header_t header = {{0}};
-   ssize_t root = filestream_seek(fd, 0, SEEK_CUR);
+   ssize_t root = filestream_tell(fd);
 
    memcpy(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1);
 
@@ -171,7 +183,7 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(fd, 0, SEEK_CUR));
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
    libretrodb_write_metadata(fd, &md);
    filestream_seek(fd, root, SEEK_SET);
@@ -181,165 +193,392 @@ clean:
    return rv;
 }
 
-static int libretrodb_read_index_header(RFILE *fd, libretrodb_index_t *idx)
+static uint64_t libretrodb_read_be64(const uint8_t *p)
 {
-   uint64_t name_len = 50;
-   return rmsgpack_dom_read_into(fd,
-         "name", idx->name, &name_len,
-         "key_size", &idx->key_size,
-         "next", &idx->next, NULL);
+   uint64_t value;
+   memcpy(&value, p, sizeof(value));
+   return swap_if_little64(value);
 }
 
-static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
+/* FNV-1a over the payload of a string or binary field. */
+static uint32_t libretrodb_hash(const uint8_t *data, uint32_t len)
 {
-   rmsgpack_write_map_header(fd, 3);
-   rmsgpack_write_string(fd, "name", strlen("name"));
-   rmsgpack_write_string(fd, idx->name, (uint32_t)strlen(idx->name));
-   rmsgpack_write_string(fd, "key_size", (uint32_t)strlen("key_size"));
-   rmsgpack_write_uint(fd, idx->key_size);
-   rmsgpack_write_string(fd, "next", strlen("next"));
-   rmsgpack_write_uint(fd, idx->next);
+   uint32_t i;
+   uint32_t hash = 0x811c9dc5;
+
+   for (i = 0; i < len; i++)
+      hash = (hash ^ data[i]) * 0x01000193;
+
+   return hash;
+}
+
+/* Returns the payload of @field_name in the document at @doc,
+ * @is_binary is set when it is a binary rather than a string. */
+static int libretrodb_get_field(const libretrodb_t *db, const uint8_t *doc,
+      const char *field_name, const uint8_t **bytes, uint32_t *len,
+      int *is_binary)
+{
+   const uint8_t *end = db->data + db->size;
+
+   if (rmsgpack_map_find_buf(&doc, end, field_name,
+            (uint32_t)strlen(field_name)) != 0)
+      return -1;
+
+   if (is_binary)
+      *is_binary = *doc >= 0xc4 && *doc <= 0xc6;
+
+   return rmsgpack_read_bytes_buf(&doc, end, bytes, len);
+}
+
+static void libretrodb_read_indexes(libretrodb_t *db)
+{
+   const uint8_t *pos = db->data + db->first_index_offset;
+   const uint8_t *end = db->data + db->size;
+
+   db->num_indexes = 0;
+
+   while (pos < end && db->num_indexes < LIBRETRODB_MAX_INDEXES)
+   {
+      struct rmsgpack_dom_value header;
+      struct libretrodb_index *idx = &db->indexes[db->num_indexes];
+      struct rmsgpack_dom_value key, *value;
+
+      if (rmsgpack_dom_read_buf(&pos, end, &header) < 0)
+         break;
+
+      memset(idx, 0, sizeof(*idx));
+
+      key.type = RDT_STRING;
+
+      key.val.string.buff = (char*)"name";
+      key.val.string.len  = 4;
+      if ((value = rmsgpack_dom_value_map_value(&header, &key))
+            && value->type == RDT_STRING)
+         strlcpy(idx->name, value->val.string.buff, sizeof(idx->name));
+
+      key.val.string.buff = (char*)"field";
+      key.val.string.len  = 5;
+      if ((value = rmsgpack_dom_value_map_value(&header, &key))
+            && value->type == RDT_STRING)
+         strlcpy(idx->field_name, value->val.string.buff,
+               sizeof(idx->field_name));
+
+      key.val.string.buff = (char*)"key_size";
+      key.val.string.len  = 8;
+      if ((value = rmsgpack_dom_value_map_value(&header, &key))
+            && value->type == RDT_UINT)
+         idx->key_size = value->val.uint_;
+
+      key.val.string.buff = (char*)"next";
+      key.val.string.len  = 4;
+      if ((value = rmsgpack_dom_value_map_value(&header, &key))
+            && value->type == RDT_UINT)
+         idx->next = value->val.uint_;
+
+      key.val.string.buff = (char*)"slots";
+      key.val.string.len  = 5;
+      if ((value = rmsgpack_dom_value_map_value(&header, &key))
+            && value->type == RDT_UINT)
+         idx->slots = value->val.uint_;
+
+      rmsgpack_dom_value_free(&header);
+
+      if (idx->next > (uint64_t)(end - pos))
+         break;
+
+      idx->table = pos;
+      pos       += idx->next;
+
+      /* Only hash indexes are used, older sorted indexes
+       * are skipped over. */
+      if (     idx->slots
+            && !(idx->slots & (idx->slots - 1))
+            && idx->next == idx->slots * sizeof(uint64_t)
+            && *idx->field_name)
+         db->num_indexes++;
+   }
+}
+
+static void libretrodb_unmap(libretrodb_t *db)
+{
+   if (!db->data)
+      return;
+
+#ifdef HAVE_MMAP
+   if (db->mapped)
+      munmap((void*)db->data, (size_t)db->size);
+   else
+#endif
+      free((void*)db->data);
+
+   db->data   = NULL;
+   db->size   = 0;
+   db->mapped = 0;
+}
+
+/* Maps the whole database into memory, or reads it in where
+ * mapping is not available. Everything else reads from there. */
+static int libretrodb_map(libretrodb_t *db, const char *path)
+{
+   void *buf   = NULL;
+   ssize_t len = 0;
+
+#ifdef HAVE_MMAP
+   struct stat st;
+   int fd = open(path, O_RDONLY);
+
+   if (fd >= 0)
+   {
+      if (fstat(fd, &st) == 0 && st.st_size > 0)
+      {
+         buf = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+         if (buf != MAP_FAILED)
+         {
+            db->data   = (const uint8_t*)buf;
+            db->size   = st.st_size;
+            db->mapped = 1;
+         }
+      }
+      close(fd);
+
+      if (db->data)
+         return 0;
+   }
+#endif
+
+   if (!filestream_read_file(path, &buf, &len) || len <= 0)
+   {
+      free(buf);
+      return -EINVAL;
+   }
+
+   db->data   = (const uint8_t*)buf;
+   db->size   = len;
+   db->mapped = 0;
+   return 0;
 }
 
 void libretrodb_close(libretrodb_t *db)
 {
-   if (db->fd)
-      filestream_close(db->fd);
-   db->fd = NULL;
+   libretrodb_unmap(db);
+   db->num_indexes = 0;
 }
 
 int libretrodb_open(const char *path, libretrodb_t *db)
 {
    libretrodb_header_t header;
    libretrodb_metadata_t md;
+   struct rmsgpack_dom_value metadata, key, *value;
+   const uint8_t *pos = NULL;
    int rv;
-   RFILE *fd = filestream_open(path, RFILE_MODE_READ, -1);
 
-   if (!fd)
-      return -errno;
+   if ((rv = libretrodb_map(db, path)) < 0)
+      return rv;
 
    strlcpy(db->path, path, sizeof(db->path));
-   db->root = filestream_seek(fd, 0, SEEK_CUR);
+   db->root = 0;
 
-   if ((rv = (int)filestream_read(fd, &header, sizeof(header))) == -1)
-   {
-      rv = -errno;
+   if (db->size < sizeof(header))
       goto error;
-   }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
-   {
-      rv = -EINVAL;
+   memcpy(&header, db->data, sizeof(header));
+
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1) != 0)
       goto error;
-   }
 
    header.metadata_offset = swap_if_little64(header.metadata_offset);
-   filestream_seek(fd, (ssize_t)header.metadata_offset, SEEK_SET);
 
-   if (libretrodb_read_metadata(fd, &md) < 0)
-   {
-      rv = -EINVAL;
+   if (header.metadata_offset >= db->size)
+      goto error;
+
+   pos = db->data + header.metadata_offset;
+
+   if (rmsgpack_dom_read_buf(&pos, db->data + db->size, &metadata) < 0)
       goto error;
-   }
 
-   db->count = md.count;
-   db->first_index_offset = filestream_seek(fd, 0, SEEK_CUR);
-   db->fd = fd;
+   key.type            = RDT_STRING;
+   key.val.string.buff = (char*)"count";
+   key.val.string.len  = 5;
+   value               = rmsgpack_dom_value_map_value(&metadata, &key);
+   md.count            = (value && value->type == RDT_UINT)
+      ? value->val.uint_ : 0;
+   rmsgpack_dom_value_free(&metadata);
+
+   if (!value)
+      goto error;
+
+   db->count              = md.count;
+   db->first_index_offset = pos - db->data;
+
+   libretrodb_read_indexes(db);
    return 0;
 
 error:
-   if (fd)
-      filestream_close(fd);
-   return rv;
+   libretrodb_unmap(db);
+   return -EINVAL;
 }
 
-static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
-      libretrodb_index_t *idx)
+static const struct libretrodb_index *libretrodb_find_index(
+      const libretrodb_t *db, const char *index_name)
 {
-   ssize_t eof    = filestream_seek(db->fd, 0, SEEK_END);
-   ssize_t offset = filestream_seek(db->fd,
-         (ssize_t)db->first_index_offset, SEEK_SET);
+   unsigned i;
 
-   while (offset < eof)
-   {
-      libretrodb_read_index_header(db->fd, idx);
+   for (i = 0; i < db->num_indexes; i++)
+      if (strcmp(db->indexes[i].name, index_name) == 0)
+         return &db->indexes[i];
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
-         return 0;
+   return NULL;
+}
 
-      offset = filestream_seek(db->fd, (ssize_t)idx->next, SEEK_CUR);
-   }
+static const struct libretrodb_index *libretrodb_find_index_on(
+      const libretrodb_t *db, const char *field_name)
+{
+   unsigned i;
 
-   return -1;
+   for (i = 0; i < db->num_indexes; i++)
+      if (strcmp(db->indexes[i].field_name, field_name) == 0)
+         return &db->indexes[i];
+
+   return NULL;
 }
 
-static int node_compare(const void *a, const void *b, void *ctx)
+int libretrodb_has_index(libretrodb_t *db, const char *field_name)
 {
-   return memcmp(a, b, *(uint8_t *)ctx);
+   return libretrodb_find_index_on(db, field_name) != NULL;
 }
 
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint8_t field_size, uint64_t *offset)
+static int libretrodb_offset_cmp(const void *a, const void *b)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = node_compare(current, item, &field_size);
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+   return x < y ? -1 : x > y;
+}
+
+/* Collects every document whose field is any of @keys,
+ * in file order. */
+static int libretrodb_index_collect(libretrodb_cursor_t *cursor,
+      const struct libretrodb_index *idx,
+      const struct rmsgpack_dom_value *const *keys, unsigned count)
+{
+   unsigned i;
+   size_t j, n;
+   size_t cap       = 0;
+   libretrodb_t *db = cursor->db;
 
-   if (rv == 0)
+   cursor->matches     = NULL;
+   cursor->num_matches = 0;
+
+   for (i = 0; i < count; i++)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
+      uint64_t offset;
+      uint64_t probes    = 0;
+      /* string and binary share their layout */
+      const uint8_t *key = (const uint8_t*)keys[i]->val.string.buff;
+      uint32_t key_len   = keys[i]->val.string.len;
+      uint64_t slot      = libretrodb_hash(key, key_len) & (idx->slots - 1);
+
+      /* A table without an empty slot only comes from a corrupt
+       * file, but must not keep the probe going forever. */
+      while (probes++ < idx->slots && (offset = libretrodb_read_be64(
+                  idx->table + slot * sizeof(uint64_t))))
+      {
+         const uint8_t *bytes = NULL;
+         uint32_t len         = 0;
+
+         if (offset < db->size
+               && libretrodb_get_field(db, db->data + offset,
+                  idx->field_name, &bytes, &len, NULL) == 0
+               && len == key_len && memcmp(bytes, key, len) == 0)
+         {
+            if (cursor->num_matches == cap)
+            {
+               uint64_t *matches;
+
+               cap     = cap ? cap * 2 : 16;
+               matches = (uint64_t*)realloc(cursor->matches,
+                     cap * sizeof(*matches));
+
+               if (!matches)
+               {
+                  free(cursor->matches);
+                  cursor->matches = NULL;
+                  return -ENOMEM;
+               }
+
+               cursor->matches = matches;
+            }
+
+            cursor->matches[cursor->num_matches++] = offset;
+         }
+
+         slot = (slot + 1) & (idx->slots - 1);
+      }
    }
 
-   if (count == 0)
-      return -1;
+   /* Repeated keys would list documents twice */
+   if (cursor->num_matches > 1)
+   {
+      qsort(cursor->matches, cursor->num_matches,
+            sizeof(*cursor->matches), libretrodb_offset_cmp);
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+      for (j = 1, n = 1; j < cursor->num_matches; j++)
+         if (cursor->matches[j] != cursor->matches[n - 1])
+            cursor->matches[n++] = cursor->matches[j];
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+      cursor->num_matches = n;
+   }
+
+   /* An empty result still needs a list, or the cursor scans */
+   if (!cursor->matches)
+      cursor->matches = (uint64_t*)malloc(sizeof(*cursor->matches));
+
+   return cursor->matches ? 0 : -ENOMEM;
 }
 
+/**
+ * libretrodb_find_entry:
+ * @db                  : Handle to database.
+ * @index_name          : Name of the index to look in.
+ * @key                 : Key to look up, @key_size bytes long for
+ *                        indexes over fixed size binary fields and
+ *                        NUL-terminated otherwise.
+ * @out                 : Decoded document.
+ *
+ * Returns: 0 if a document was found, otherwise negative.
+ **/
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       const void *key, struct rmsgpack_dom_value *out)
 {
-   libretrodb_index_t idx;
-   int rv;
-   void *buff;
-   uint64_t offset;
-   ssize_t bufflen, nread = 0;
+   uint64_t slot, offset;
+   uint64_t probes                    = 0;
+   uint32_t key_len;
+   const struct libretrodb_index *idx = libretrodb_find_index(db, index_name);
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
+   if (!idx || !key)
       return -1;
 
-   bufflen = idx.next;
-   buff = malloc(bufflen);
-
-   if (!buff)
-      return -ENOMEM;
+   key_len = idx->key_size ? (uint32_t)idx->key_size
+      : (uint32_t)strlen((const char*)key);
+   slot    = libretrodb_hash((const uint8_t*)key, key_len) & (idx->slots - 1);
 
-   while (nread < bufflen)
+   while (probes++ < idx->slots && (offset = libretrodb_read_be64(
+               idx->table + slot * sizeof(uint64_t))))
    {
-      void *buff_ = (uint64_t *)buff + nread;
-      rv = (int)filestream_read(db->fd, buff_, bufflen - nread);
-
-      if (rv <= 0)
-      {
-         free(buff);
-         return -errno;
-      }
-      nread += rv;
-   }
+      const uint8_t *bytes = NULL;
+      uint32_t len         = 0;
+      const uint8_t *doc   = db->data + offset;
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
-   free(buff);
+      if (offset < db->size
+            && libretrodb_get_field(db, doc, idx->field_name,
+               &bytes, &len, NULL) == 0
+            && len == key_len && memcmp(bytes, key, len) == 0)
+         return rmsgpack_dom_read_buf(&doc, db->data + db->size, out);
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset, SEEK_SET);
+      slot = (slot + 1) & (idx->slots - 1);
+   }
 
-   return rmsgpack_dom_read(db->fd, out);
+   return -1;
 }
 
 /**
@@ -352,40 +591,113 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
-   return (int)filestream_seek(cursor->fd,
-         (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
-         SEEK_SET);
+   cursor->eof        = 0;
+   cursor->pos        = cursor->db->root + sizeof(libretrodb_header_t);
+   cursor->next_match = 0;
+   return 0;
 }
 
-int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
-      struct rmsgpack_dom_value *out)
+/* Finds the next document matching the cursor's query and
+ * leaves the cursor after it. */
+static int libretrodb_cursor_next(libretrodb_cursor_t *cursor,
+      const uint8_t **doc)
 {
    int rv;
+   const uint8_t *end = NULL;
 
-   if (cursor->eof)
+   if (cursor->eof || !cursor->db || !cursor->db->data)
       return EOF;
 
-retry:
-   rv = rmsgpack_dom_read(cursor->fd, out);
-   if (rv < 0)
-      return rv;
+   end = cursor->db->data + cursor->db->size;
 
-   if (out->type == RDT_NULL)
+   for (;;)
    {
-      cursor->eof = 1;
-      return EOF;
-   }
+      int match          = 1;
+      const uint8_t *pos = NULL;
 
-   if (cursor->query)
-   {
-      if (!libretrodb_query_filter(cursor->query, out))
+      if (cursor->matches)
       {
-         rmsgpack_dom_value_free(out);
-         goto retry;
+         if (cursor->next_match >= cursor->num_matches)
+         {
+            cursor->eof = 1;
+            return EOF;
+         }
+         cursor->pos = cursor->matches[cursor->next_match++];
       }
+
+      pos = cursor->db->data + cursor->pos;
+
+      if (pos >= end || *pos == 0xc0 /* nil */)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      *doc = pos;
+
+      /* Documents that don't match are stepped over
+       * without being decoded. */
+      if (cursor->query)
+      {
+         match = libretrodb_query_filter_buf(cursor->query, pos, end);
+
+         if (match && !libretrodb_query_is_compiled(cursor->query))
+         {
+            struct rmsgpack_dom_value item;
+
+            if ((rv = rmsgpack_dom_read_buf(&pos, end, &item)) < 0)
+               return rv;
+            match = libretrodb_query_filter(cursor->query, &item);
+            rmsgpack_dom_value_free(&item);
+            pos   = *doc;
+         }
+      }
+
+      if ((rv = rmsgpack_skip_buf(&pos, end)) < 0)
+         return rv;
+
+      cursor->pos = pos - cursor->db->data;
+
+      if (match)
+         return 0;
    }
+}
 
+int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+   const uint8_t *doc = NULL;
+
+   if ((rv = libretrodb_cursor_next(cursor, &doc)) != 0)
+      return rv;
+
+   return rmsgpack_dom_read_buf(&doc,
+         cursor->db->data + cursor->db->size, out);
+}
+
+/**
+ * libretrodb_cursor_read_raw:
+ * @cursor              : Handle to database cursor.
+ * @doc                 : Start of the next matching document.
+ * @end                 : End of the buffer holding @doc.
+ *
+ * Like libretrodb_cursor_read_item(), without decoding the
+ * document. It stays valid until the database is closed and is
+ * meant to be walked with rmsgpack_read_token_buf().
+ *
+ * Returns: 0 if a document was found, EOF at the end, otherwise
+ * negative.
+ **/
+int libretrodb_cursor_read_raw(libretrodb_cursor_t *cursor,
+      const uint8_t **doc, const uint8_t **end)
+{
+   int rv;
+
+   if ((rv = libretrodb_cursor_next(cursor, doc)) != 0)
+      return rv;
+
+   *end = cursor->db->data + cursor->db->size;
    return 0;
 }
 
@@ -400,15 +712,16 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (!cursor)
       return;
 
-   if (cursor->fd)
-      filestream_close(cursor->fd);
-
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
+   free(cursor->matches);
+
+   cursor->matches     = NULL;
+   cursor->num_matches = 0;
    cursor->is_valid = 0;
    cursor->eof      = 1;
-   cursor->fd       = NULL;
+   cursor->pos      = 0;
    cursor->db       = NULL;
    cursor->query    = NULL;
 }
@@ -426,146 +739,171 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
 int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
       libretrodb_query_t *q)
 {
-   cursor->fd = filestream_open(db->path, RFILE_MODE_READ | RFILE_HINT_MMAP, -1);
+   const struct rmsgpack_dom_value *const *keys = NULL;
+   const struct libretrodb_index *idx           = NULL;
+   const char *field                            = NULL;
+   unsigned count                               = 0;
 
-   if (!cursor->fd)
-      return -errno;
+   if (!db->data)
+      return -EINVAL;
 
-   cursor->db = db;
-   cursor->is_valid = 1;
+   cursor->db          = db;
+   cursor->is_valid    = 1;
+   cursor->matches     = NULL;
+   cursor->num_matches = 0;
    libretrodb_cursor_reset(cursor);
    cursor->query = q;
 
-   if (q)
-      libretrodb_query_inc_ref(q);
-
-   return 0;
-}
-
-static int node_iter(void *value, void *ctx)
-{
-   struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
-
-   if (filestream_write(nictx->db->fd, value,
-            (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
+   if (!q)
       return 0;
 
-   return -1;
-}
+   libretrodb_query_inc_ref(q);
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
-{
-   return filestream_seek(db->fd, 0, SEEK_CUR);
+   /* Equality on an indexed field only visits the documents
+    * the index lists, the query still decides on each. */
+   if (     (field = libretrodb_query_get_index(q, &keys, &count))
+         && (idx   = libretrodb_find_index_on(db, field)))
+      return libretrodb_index_collect(cursor, idx, keys, count);
+
+   return 0;
 }
 
+/**
+ * libretrodb_create_index:
+ * @db                  : Handle to database.
+ * @name                : Name of the new index.
+ * @field_name          : Field to index, string or binary.
+ *
+ * Appends a hash index over @field_name to the database file
+ * and reopens @db so that it is used. Documents without the
+ * field are left out; duplicate keys are allowed and are found
+ * in document order.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
 int libretrodb_create_index(libretrodb_t *db,
       const char *name, const char *field_name)
 {
-   struct node_iter_ctx nictx;
-   struct rmsgpack_dom_value key;
-   libretrodb_index_t idx;
-   struct rmsgpack_dom_value item;
-   uint64_t idx_header_offset       = 0;
-   libretrodb_cursor_t cur          = {0};
-   struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
-   uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
-   bintree_t *tree                  = bintree_new(node_compare, &field_size);
-
-   item.type                        = RDT_NULL;
-
-   if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
-      goto clean;
+   char path[1024];
+   uint64_t i;
+   uint8_t *table      = NULL;
+   uint32_t *hashes    = NULL;
+   uint64_t *offsets   = NULL;
+   uint64_t count      = 0;
+   uint64_t slots      = 16;
+   int64_t key_size    = -1;
+   RFILE *fd           = NULL;
+   int rv              = -EINVAL;
+   const uint8_t *pos  = db->data + db->root + sizeof(libretrodb_header_t);
+   const uint8_t *end  = db->data + db->size;
+
+   if (!db->data)
+      return -EINVAL;
 
-   key.type            = RDT_STRING;
-   key.val.string.len  = (uint32_t)strlen(field_name);
-   key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
+   hashes  = (uint32_t*)calloc(db->count + 1, sizeof(*hashes));
+   offsets = (uint64_t*)calloc(db->count + 1, sizeof(*offsets));
 
-   while (libretrodb_cursor_read_item(&cur, &item) == 0)
+   if (!hashes || !offsets)
    {
-      if (item.type != RDT_MAP)
-      {
-         printf("Only map keys are supported\n");
-         goto clean;
-      }
+      rv = -ENOMEM;
+      goto clean;
+   }
 
-      field = rmsgpack_dom_value_map_value(&item, &key);
+   while (pos < end && *pos != 0xc0 && count <= db->count)
+   {
+      const uint8_t *bytes = NULL;
+      uint32_t len         = 0;
+      int is_binary        = 0;
 
-      if (!field)
+      if (libretrodb_get_field(db, pos, field_name,
+               &bytes, &len, &is_binary) == 0)
       {
-         printf("field not found in item\n");
-         goto clean;
+         /* Binary keys of a single fixed size are looked up as raw
+          * bytes, anything else as NUL-terminated strings. */
+         if (!is_binary)
+            key_size = 0;
+         else if (key_size == -1)
+            key_size = len;
+         else if (key_size != (int64_t)len)
+            key_size = 0;
+
+         hashes[count]  = libretrodb_hash(bytes, len);
+         offsets[count] = pos - db->data;
+         count++;
       }
 
-      if (field->type != RDT_BINARY)
-      {
-         printf("field is not binary\n");
+      if (rmsgpack_skip_buf(&pos, end) < 0)
          goto clean;
-      }
+   }
 
-      if (field->val.binary.len == 0)
-      {
-         printf("field is empty\n");
-         goto clean;
-      }
+   if (!count)
+   {
+      printf("field not found in any item\n");
+      goto clean;
+   }
 
-      if (field_size == 0)
-         field_size = field->val.binary.len;
-      else if (field->val.binary.len != field_size)
-      {
-         printf("field is not of correct size\n");
-         goto clean;
-      }
+   /* Keep the load factor at or below one half. */
+   while (slots < count * 2)
+      slots <<= 1;
 
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
+   table = (uint8_t*)calloc(slots, sizeof(uint64_t));
 
-      memcpy(buff, field->val.binary.buff, field_size);
+   if (!table)
+   {
+      rv = -ENOMEM;
+      goto clean;
+   }
 
-      buff_u64 = (uint64_t *)buff + field_size;
+   for (i = 0; i < count; i++)
+   {
+      uint64_t slot  = hashes[i] & (slots - 1);
+      uint64_t value = swap_if_little64(offsets[i]);
 
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+      while (libretrodb_read_be64(table + slot * sizeof(uint64_t)))
+         slot = (slot + 1) & (slots - 1);
 
-      if (bintree_insert(tree, buff) != 0)
-      {
-         printf("Value is not unique: ");
-         rmsgpack_dom_value_print(field);
-         printf("\n");
-         goto clean;
-      }
-      buff     = NULL;
-      rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
+      memcpy(table + slot * sizeof(uint64_t), &value, sizeof(value));
    }
 
-   idx_header_offset = filestream_seek(db->fd, 0, SEEK_END);
+   /* A hash index is written after the metadata, or after the
+    * previous index, as a header map followed by the table. */
+   if (!(fd = filestream_open(db->path, RFILE_MODE_READ_WRITE, -1)))
+   {
+      rv = -errno;
+      goto clean;
+   }
 
-   (void)idx_header_offset;
+   filestream_seek(fd, 0, SEEK_END);
 
-   strncpy(idx.name, name, 50);
+   rmsgpack_write_map_header(fd, 5);
+   rmsgpack_write_string(fd, "name", strlen("name"));
+   rmsgpack_write_string(fd, name, (uint32_t)strlen(name));
+   rmsgpack_write_string(fd, "field", strlen("field"));
+   rmsgpack_write_string(fd, field_name, (uint32_t)strlen(field_name));
+   rmsgpack_write_string(fd, "key_size", strlen("key_size"));
+   rmsgpack_write_uint(fd, key_size > 0 ? key_size : 0);
+   rmsgpack_write_string(fd, "slots", strlen("slots"));
+   rmsgpack_write_uint(fd, slots);
+   rmsgpack_write_string(fd, "next", strlen("next"));
+   rmsgpack_write_uint(fd, slots * sizeof(uint64_t));
+
+   if (filestream_write(fd, table, slots * sizeof(uint64_t))
+         == (ssize_t)(slots * sizeof(uint64_t)))
+      rv = 0;
 
-   idx.name[49] = '\0';
-   idx.key_size = field_size;
-   idx.next     = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
+   filestream_close(fd);
 
-   nictx.db  = db;
-   nictx.idx = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
+   /* Remap, so that the new index becomes visible. */
+   strlcpy(path, db->path, sizeof(path));
+   libretrodb_close(db);
+   if (libretrodb_open(path, db) < 0)
+      rv = -EINVAL;
 
 clean:
-   rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
-   if (cur.is_valid)
-      libretrodb_cursor_close(&cur);
-   if (tree)
-      bintree_free(tree);
-   free(tree);
-   return 0;
+   free(table);
+   free(hashes);
+   free(offsets);
+   return rv;
 }
 
 libretrodb_cursor_t *libretrodb_cursor_new(void)
@@ -57,6 +57,8 @@ int libretrodb_create_index(libretrodb_t *db, const char *name,
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out);
 
+int libretrodb_has_index(libretrodb_t *db, const char *field_name);
+
 libretrodb_t *libretrodb_new(void);
 
 void libretrodb_free(libretrodb_t *db);
@@ -105,6 +107,9 @@ void libretrodb_query_free(void *q);
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+int libretrodb_cursor_read_raw(libretrodb_cursor_t *cursor,
+      const uint8_t **doc, const uint8_t **end);
+
 RETRO_END_DECLS
 
 #endif
@@ -21,13 +21,87 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <string/stdstring.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 
+/* Compiles and runs @query_exp @iterations times, the way the
+ * frontend does for every lookup, and reports the throughput. */
+static int libretrodb_tool_bench(libretrodb_t *db, libretrodb_cursor_t *cur,
+      const char *query_exp, unsigned iterations)
+{
+   unsigned i;
+   double elapsed;
+   clock_t start;
+   unsigned matches  = 0;
+   const char *field = NULL;
+   const char *error = NULL;
+   libretrodb_query_t *q = (libretrodb_query_t*)libretrodb_query_compile(
+         db, query_exp, strlen(query_exp), &error);
+   const struct rmsgpack_dom_value *const *keys = NULL;
+   unsigned count    = 0;
+
+   if (error || !q)
+   {
+      if (error)
+         printf("%s\n", error);
+      return -1;
+   }
+
+   field = libretrodb_query_get_index(q, &keys, &count);
+
+   printf("Plan: %s%s, %s\n",
+         field ? "index on " : "full scan",
+         field ? field : "",
+         libretrodb_query_is_compiled(q)
+         ? "compiled" : "decoded documents");
+
+   libretrodb_query_free(q);
+
+   start = clock();
+
+   for (i = 0; i < iterations; i++)
+   {
+      struct rmsgpack_dom_value item;
+
+      q = (libretrodb_query_t*)libretrodb_query_compile(
+            db, query_exp, strlen(query_exp), &error);
+
+      if (!q)
+         return -1;
+
+      if (libretrodb_cursor_open(db, cur, q) != 0)
+      {
+         /* The cursor may hold a reference to q and index matches. */
+         libretrodb_cursor_close(cur);
+         libretrodb_query_free(q);
+         return -1;
+      }
+
+      while (libretrodb_cursor_read_item(cur, &item) == 0)
+      {
+         matches++;
+         rmsgpack_dom_value_free(&item);
+      }
+
+      libretrodb_cursor_close(cur);
+      libretrodb_query_free(q);
+   }
+
+   elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+   printf("%u queries, %u matches each, %.3f s, %.1f queries/s\n",
+         iterations, iterations ? matches / iterations : 0, elapsed,
+         elapsed > 0 ? iterations / elapsed : 0);
+
+   return 0;
+}
+
 int main(int argc, char ** argv)
 {
    int rv;
@@ -44,6 +118,7 @@ int main(int argc, char ** argv)
       printf("\tlist\n");
       printf("\tcreate-index <index name> <field name>\n");
       printf("\tfind <query expression>\n");
+      printf("\tbench <query expression> [iterations]\n");
       return 1;
    }
 
@@ -113,6 +188,21 @@ int main(int argc, char ** argv)
          rmsgpack_dom_value_free(&item);
       }
    }
+   else if (string_is_equal(command, "bench"))
+   {
+      unsigned iterations = 1000;
+
+      if (argc != 4 && argc != 5)
+      {
+         printf("Usage: %s <db file> bench <query expression> [iterations]\n", argv[0]);
+         goto error;
+      }
+
+      if (argc == 5)
+         iterations = (unsigned)strtoul(argv[4], NULL, 10);
+
+      libretrodb_tool_bench(db, cur, argv[3], iterations);
+   }
    else if (string_is_equal(command, "create-index"))
    {
       const char * index_name, * field_name;
@@ -35,10 +35,12 @@
 
 #include "libretrodb.h"
 #include "query.h"
+#include "rmsgpack.h"
 #include "rmsgpack_dom.h"
 
 #define MAX_ERROR_LEN   256
 #define QUERY_MAX_ARGS  50
+#define QUERY_MAX_DEPTH 16
 
 struct buffer
 {
@@ -78,10 +80,60 @@ struct argument
    } a;
 };
 
+/* Predicates are compiled into a flat program that runs directly
+ * on the undecoded msgpack of a document. It keeps a stack of
+ * values (the document, then the fields of nested tables) and a
+ * single result register. */
+enum query_op
+{
+   QOP_TRUE = 0,
+   QOP_FALSE,
+   /* Sets the result, jumps to @target if the value isn't a map */
+   QOP_ENTER_MAP,
+   /* Pushes field @a of the current map, nil if missing */
+   QOP_FIELD,
+   QOP_POP,
+   QOP_EQUALS,
+   QOP_BETWEEN,
+   QOP_GLOB,
+   /* glob() of a pattern that is a literal prefix of @len bytes,
+    * followed by '*' if @b is set */
+   QOP_PREFIX,
+   QOP_IS_TRUE,
+   QOP_JUMP_IF_TRUE,
+   QOP_JUMP_IF_FALSE
+};
+
+struct query_insn
+{
+   enum query_op op;
+   unsigned target;
+   uint32_t len;
+   const struct rmsgpack_dom_value *a;
+   const struct rmsgpack_dom_value *b;
+};
+
+struct query_program
+{
+   struct query_insn *code;
+   unsigned len;
+   unsigned cap;
+   unsigned depth;
+   /* Unset if parts of the query could not be compiled and
+    * were replaced by 'true', matches then need to be
+    * confirmed on the decoded document. */
+   int exact;
+};
+
 struct query
 {
    unsigned ref_count;
    struct invocation root;
+   struct query_program program;
+   /* Equality clause picked to be answered by an index */
+   const struct rmsgpack_dom_value *index_field;
+   const struct rmsgpack_dom_value *index_keys[QUERY_MAX_ARGS];
+   unsigned index_key_count;
 };
 
 struct registered_func
@@ -947,6 +999,266 @@ success:
    return buff;
 }
 
+static int query_emit(struct query_program *prog, enum query_op op,
+      const struct rmsgpack_dom_value *a)
+{
+   struct query_insn *insn;
+
+   if (prog->len == prog->cap)
+   {
+      unsigned cap            = prog->cap ? prog->cap * 2 : 32;
+      struct query_insn *code = (struct query_insn*)
+         realloc(prog->code, cap * sizeof(*code));
+
+      if (!code)
+         return -1;
+
+      prog->code = code;
+      prog->cap  = cap;
+   }
+
+   insn         = &prog->code[prog->len];
+   insn->op     = op;
+   insn->target = 0;
+   insn->len    = 0;
+   insn->a      = a;
+   insn->b      = NULL;
+
+   return prog->len++;
+}
+
+static void query_patch(struct query_program *prog, int at)
+{
+   if (at >= 0)
+      prog->code[at].target = prog->len;
+}
+
+/* Returns 1 if the glob @pattern has meta characters
+ * besides a trailing run of '*'. */
+static int query_glob_is_prefix(const struct rmsgpack_dom_value *pattern,
+      uint32_t *len, int *wildcard)
+{
+   uint32_t i;
+   const char *str = pattern->val.string.buff;
+   uint32_t plen   = (uint32_t)strlen(str);
+
+   *wildcard = 0;
+
+   while (plen && str[plen - 1] == '*')
+   {
+      plen--;
+      *wildcard = 1;
+   }
+
+   for (i = 0; i < plen; i++)
+      if (str[i] == '*' || str[i] == '?' || str[i] == '[' || str[i] == '\\')
+         return 0;
+
+   *len = plen;
+   return 1;
+}
+
+static int query_compile_invocation(struct query_program *prog,
+      const struct invocation *inv);
+
+/* Evaluates @arg against the value on top of the stack. */
+static int query_compile_argument(struct query_program *prog,
+      const struct argument *arg)
+{
+   if (arg->type == AT_VALUE)
+      return query_emit(prog, QOP_EQUALS, &arg->a.value) < 0 ? -1 : 0;
+   return query_compile_invocation(prog, &arg->a.invocation);
+}
+
+static int query_compile_invocation(struct query_program *prog,
+      const struct invocation *inv)
+{
+   unsigned i;
+   int at;
+   int jumps[QUERY_MAX_ARGS];
+   unsigned num_jumps = 0;
+
+   if (inv->func == query_func_all_map)
+   {
+      if (inv->argc % 2 != 0)
+         return query_emit(prog, QOP_FALSE, NULL) < 0 ? -1 : 0;
+
+      if ((at = query_emit(prog, QOP_ENTER_MAP, NULL)) < 0)
+         return -1;
+      jumps[num_jumps++] = at;
+
+      for (i = 0; i < inv->argc; i += 2)
+      {
+         const struct argument *key = &inv->argv[i];
+
+         if (key->type != AT_VALUE)
+         {
+            if (query_emit(prog, QOP_FALSE, NULL) < 0)
+               return -1;
+            break;
+         }
+
+         /* Raw lookups match keys by their bytes only */
+         if (key->a.value.type != RDT_STRING
+               || prog->depth + 1 >= QUERY_MAX_DEPTH)
+         {
+            prog->exact = 0;
+            continue;
+         }
+
+         prog->depth++;
+         if (query_emit(prog, QOP_FIELD, &key->a.value) < 0
+               || query_compile_argument(prog, &inv->argv[i + 1]) < 0
+               || query_emit(prog, QOP_POP, NULL) < 0
+               || (at = query_emit(prog, QOP_JUMP_IF_FALSE, NULL)) < 0)
+            return -1;
+         prog->depth--;
+
+         jumps[num_jumps++] = at;
+      }
+   }
+   else if (inv->func == query_func_operator_or
+         || inv->func == query_func_operator_and)
+   {
+      enum query_op jump = inv->func == query_func_operator_or
+         ? QOP_JUMP_IF_TRUE : QOP_JUMP_IF_FALSE;
+
+      if (query_emit(prog, QOP_FALSE, NULL) < 0)
+         return -1;
+
+      for (i = 0; i < inv->argc; i++)
+      {
+         if (query_compile_argument(prog, &inv->argv[i]) < 0
+               || (at = query_emit(prog, jump, NULL)) < 0)
+            return -1;
+         jumps[num_jumps++] = at;
+      }
+   }
+   else if (inv->func == query_func_between)
+   {
+      if (inv->argc != 2
+            || inv->argv[0].type != AT_VALUE
+            || inv->argv[1].type != AT_VALUE
+            || inv->argv[0].a.value.type != RDT_INT
+            || inv->argv[1].a.value.type != RDT_INT)
+         return query_emit(prog, QOP_FALSE, NULL) < 0 ? -1 : 0;
+
+      if ((at = query_emit(prog, QOP_BETWEEN, &inv->argv[0].a.value)) < 0)
+         return -1;
+      prog->code[at].b = &inv->argv[1].a.value;
+   }
+   else if (inv->func == query_func_glob)
+   {
+      uint32_t len = 0;
+      int wildcard = 0;
+
+      if (inv->argc != 1
+            || inv->argv[0].type != AT_VALUE
+            || inv->argv[0].a.value.type != RDT_STRING)
+         return query_emit(prog, QOP_FALSE, NULL) < 0 ? -1 : 0;
+
+      /* Plain prefixes are compared directly instead of
+       * going through fnmatch. */
+      if (query_glob_is_prefix(&inv->argv[0].a.value, &len, &wildcard))
+      {
+         if ((at = query_emit(prog, QOP_PREFIX, &inv->argv[0].a.value)) < 0)
+            return -1;
+         prog->code[at].len = len;
+         prog->code[at].b   = wildcard ? &inv->argv[0].a.value : NULL;
+      }
+      else if (query_emit(prog, QOP_GLOB, &inv->argv[0].a.value) < 0)
+         return -1;
+   }
+   else if (inv->func == query_func_is_true)
+   {
+      if (query_emit(prog, inv->argc > 0 ? QOP_FALSE : QOP_IS_TRUE, NULL) < 0)
+         return -1;
+   }
+   else
+   {
+      prog->exact = 0;
+      if (query_emit(prog, QOP_TRUE, NULL) < 0)
+         return -1;
+   }
+
+   for (i = 0; i < num_jumps; i++)
+      query_patch(prog, jumps[i]);
+
+   return 0;
+}
+
+static void query_compile_program(struct query_program *prog,
+      const struct invocation *root)
+{
+   prog->exact = 1;
+   prog->depth = 0;
+
+   if (query_compile_invocation(prog, root) < 0)
+   {
+      /* Falls back to evaluating decoded documents */
+      free(prog->code);
+      prog->code  = NULL;
+      prog->len   = 0;
+      prog->cap   = 0;
+      prog->exact = 0;
+   }
+}
+
+/* Returns 1 if @arg is a string or binary constant whose
+ * bytes can be looked up in an index. */
+static int query_arg_is_bytes(const struct argument *arg)
+{
+   return arg->type == AT_VALUE
+      && (arg->a.value.type == RDT_STRING || arg->a.value.type == RDT_BINARY);
+}
+
+/* Picks the first top level equality, or or() of equalities,
+ * on a field that @db has an index for. */
+static void query_plan_index(struct query *q, libretrodb_t *db)
+{
+   unsigned i, j;
+   const struct invocation *root = &q->root;
+
+   if (root->func != query_func_all_map || root->argc % 2 != 0)
+      return;
+
+   for (i = 0; i < root->argc; i += 2)
+   {
+      const struct argument *key = &root->argv[i];
+      const struct argument *arg = &root->argv[i + 1];
+
+      if (key->type != AT_VALUE || key->a.value.type != RDT_STRING
+            || !libretrodb_has_index(db, key->a.value.val.string.buff))
+         continue;
+
+      if (query_arg_is_bytes(arg))
+      {
+         q->index_field     = &key->a.value;
+         q->index_keys[0]   = &arg->a.value;
+         q->index_key_count = 1;
+         return;
+      }
+
+      if (arg->type != AT_FUNCTION
+            || arg->a.invocation.func != query_func_operator_or
+            || arg->a.invocation.argc == 0)
+         continue;
+
+      for (j = 0; j < arg->a.invocation.argc; j++)
+         if (!query_arg_is_bytes(&arg->a.invocation.argv[j]))
+            break;
+
+      if (j < arg->a.invocation.argc)
+         continue;
+
+      for (j = 0; j < arg->a.invocation.argc; j++)
+         q->index_keys[j] = &arg->a.invocation.argv[j].a.value;
+      q->index_field     = &key->a.value;
+      q->index_key_count = arg->a.invocation.argc;
+      return;
+   }
+}
+
 void libretrodb_query_free(void *q)
 {
    unsigned i;
@@ -960,6 +1272,7 @@ void libretrodb_query_free(void *q)
       query_argument_free(&real_q->root.argv[i]);
 
    free(real_q->root.argv);
+   free(real_q->program.code);
    real_q->root.argv = NULL;
    real_q->root.argc = 0;
    free(real_q);
@@ -1001,6 +1314,11 @@ void *libretrodb_query_compile(libretrodb_t *db,
       goto error;
    }
 
+   query_compile_program(&q->program, &q->root);
+
+   if (db)
+      query_plan_index(q, db);
+
    return q;
 
 error:
@@ -1023,3 +1341,205 @@ int libretrodb_query_filter(libretrodb_query_t *q,
    struct rmsgpack_dom_value res = inv.func(*v, inv.argc, inv.argv);
    return (res.type == RDT_BOOL && res.val.bool_);
 }
+
+const char *libretrodb_query_get_index(libretrodb_query_t *q,
+      const struct rmsgpack_dom_value *const **keys, unsigned *count)
+{
+   struct query *rq = (struct query*)q;
+
+   if (!rq->index_field)
+      return NULL;
+
+   *keys  = rq->index_keys;
+   *count = rq->index_key_count;
+   return rq->index_field->val.string.buff;
+}
+
+int libretrodb_query_is_compiled(libretrodb_query_t *q)
+{
+   return ((struct query*)q)->program.exact;
+}
+
+static const uint8_t query_nil = 0xc0;
+
+static void query_raw_read(const uint8_t *p, const uint8_t *end,
+      struct rmsgpack_token *out)
+{
+   if (p == &query_nil)
+      end = p + 1;
+
+   /* anything that doesn't decode never matches */
+   if (rmsgpack_read_token_buf(&p, end, out) < 0)
+      out->type = RMSGPACK_TOKEN_ARRAY;
+}
+
+/* Same as func_equals() on the decoded value. */
+static int query_raw_equals(const struct rmsgpack_token *v,
+      const struct rmsgpack_dom_value *c)
+{
+   switch (v->type)
+   {
+      case RMSGPACK_TOKEN_NIL:
+         return c->type == RDT_NULL;
+      case RMSGPACK_TOKEN_BOOL:
+         return c->type == RDT_BOOL && v->val.bool_ == c->val.bool_;
+      case RMSGPACK_TOKEN_INT:
+         return c->type == RDT_INT && v->val.int_ == c->val.int_;
+      case RMSGPACK_TOKEN_UINT:
+         if (c->type == RDT_INT)
+            return v->val.uint_ == (uint64_t)c->val.int_;
+         return c->type == RDT_UINT && v->val.uint_ == c->val.uint_;
+      case RMSGPACK_TOKEN_STRING:
+         return c->type == RDT_STRING
+            && v->val.string.len == c->val.string.len
+            && strncmp(v->val.string.buff, c->val.string.buff,
+                  v->val.string.len) == 0;
+      case RMSGPACK_TOKEN_BINARY:
+         return c->type == RDT_BINARY
+            && v->val.binary.len == c->val.binary.len
+            && memcmp(v->val.binary.buff, c->val.binary.buff,
+                  v->val.binary.len) == 0;
+      default:
+         break;
+   }
+
+   return 0;
+}
+
+static int query_raw_glob(const struct rmsgpack_token *v,
+      const char *pattern)
+{
+   int rv;
+   char tmp[256];
+   char *str = tmp;
+
+   if (v->type != RMSGPACK_TOKEN_STRING)
+      return 0;
+
+   if (v->val.string.len >= sizeof(tmp)
+         && !(str = (char*)malloc(v->val.string.len + 1)))
+      return 0;
+
+   memcpy(str, v->val.string.buff, v->val.string.len);
+   str[v->val.string.len] = '\0';
+   rv                     = rl_fnmatch(pattern, str, 0) == 0;
+
+   if (str != tmp)
+      free(str);
+   return rv;
+}
+
+/* glob() of a pattern without meta characters other than a
+ * trailing '*', decoded strings end at the first NUL. */
+static int query_raw_prefix(const struct rmsgpack_token *v,
+      const struct query_insn *insn)
+{
+   if (     v->type != RMSGPACK_TOKEN_STRING
+         || v->val.string.len < insn->len
+         || memcmp(v->val.string.buff,
+            insn->a->val.string.buff, insn->len) != 0)
+      return 0;
+
+   return insn->b
+      || v->val.string.len == insn->len
+      || v->val.string.buff[insn->len] == '\0';
+}
+
+/* Same as query_func_between() on the decoded value. */
+static int query_raw_between(const struct rmsgpack_token *v,
+      const struct query_insn *insn)
+{
+   switch (v->type)
+   {
+      case RMSGPACK_TOKEN_INT:
+         return v->val.int_ >= insn->a->val.int_
+            && v->val.int_ <= insn->b->val.int_;
+      case RMSGPACK_TOKEN_UINT:
+         return ((unsigned)v->val.int_ >= insn->a->val.uint_)
+            && (v->val.int_ <= insn->b->val.int_);
+      default:
+         break;
+   }
+
+   return 0;
+}
+
+int libretrodb_query_filter_buf(libretrodb_query_t *q,
+      const uint8_t *doc, const uint8_t *end)
+{
+   unsigned pc;
+   struct rmsgpack_token v;
+   const uint8_t *stack[QUERY_MAX_DEPTH];
+   const struct query_program *prog = &((struct query*)q)->program;
+   unsigned sp                      = 0;
+   int res                          = 0;
+
+   if (!prog->code)
+      return 1;
+
+   stack[0] = doc;
+
+   for (pc = 0; pc < prog->len; pc++)
+   {
+      const struct query_insn *insn = &prog->code[pc];
+
+      switch (insn->op)
+      {
+         case QOP_TRUE:
+            res = 1;
+            break;
+         case QOP_FALSE:
+            res = 0;
+            break;
+         case QOP_ENTER_MAP:
+            res = 1;
+            query_raw_read(stack[sp], end, &v);
+            if (v.type != RMSGPACK_TOKEN_MAP)
+               pc = insn->target - 1;
+            break;
+         case QOP_FIELD:
+            {
+               const uint8_t *pos = stack[sp];
+               if (rmsgpack_map_find_buf(&pos, end,
+                        insn->a->val.string.buff,
+                        insn->a->val.string.len) != 0)
+                  pos = &query_nil;
+               stack[++sp] = pos;
+            }
+            break;
+         case QOP_POP:
+            sp--;
+            break;
+         case QOP_EQUALS:
+            query_raw_read(stack[sp], end, &v);
+            res = query_raw_equals(&v, insn->a);
+            break;
+         case QOP_BETWEEN:
+            query_raw_read(stack[sp], end, &v);
+            res = query_raw_between(&v, insn);
+            break;
+         case QOP_GLOB:
+            query_raw_read(stack[sp], end, &v);
+            res = query_raw_glob(&v, insn->a->val.string.buff);
+            break;
+         case QOP_PREFIX:
+            query_raw_read(stack[sp], end, &v);
+            res = query_raw_prefix(&v, insn);
+            break;
+         case QOP_IS_TRUE:
+            query_raw_read(stack[sp], end, &v);
+            res = v.type == RMSGPACK_TOKEN_BOOL && v.val.bool_;
+            break;
+         case QOP_JUMP_IF_TRUE:
+            if (res)
+               pc = insn->target - 1;
+            break;
+         case QOP_JUMP_IF_FALSE:
+            if (!res)
+               pc = insn->target - 1;
+            break;
+      }
+   }
+
+   return res;
+}
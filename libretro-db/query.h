@@ -38,6 +38,45 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+/**
+ * libretrodb_query_filter_buf:
+ * @q                   : Query to test against.
+ * @doc                 : Undecoded document.
+ * @end                 : End of the buffer holding @doc.
+ *
+ * Runs the compiled form of @q on the raw msgpack of a document.
+ * Unless libretrodb_query_is_compiled() says otherwise, the result
+ * is the same as libretrodb_query_filter() on the decoded document.
+ *
+ * Returns: 0 if the document cannot match @q and does not need
+ * to be decoded, otherwise 1.
+ **/
+int libretrodb_query_filter_buf(libretrodb_query_t *q,
+      const uint8_t *doc, const uint8_t *end);
+
+/**
+ * libretrodb_query_is_compiled:
+ * @q                   : Query.
+ *
+ * Returns: 1 if all of @q could be compiled, so that
+ * libretrodb_query_filter_buf() is exact, 0 if its matches have
+ * to be confirmed with libretrodb_query_filter().
+ **/
+int libretrodb_query_is_compiled(libretrodb_query_t *q);
+
+/**
+ * libretrodb_query_get_index:
+ * @q                   : Query.
+ * @keys                : Values the indexed field is compared to.
+ * @count               : Number of @keys.
+ *
+ * Returns: the field whose index can answer @q, any matching
+ * document has it set to one of @keys. NULL if the database has
+ * to be scanned.
+ **/
+const char *libretrodb_query_get_index(libretrodb_query_t *q,
+      const struct rmsgpack_dom_value *const **keys, unsigned *count);
+
 RETRO_END_DECLS
 
 #endif
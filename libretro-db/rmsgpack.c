@@ -271,8 +271,7 @@ int rmsgpack_write_bool(RFILE *fd, int value)
       if (filestream_write(fd, &MPF_TRUE, sizeof(MPF_TRUE)) == -1)
          goto error;
    }
-
-   if (filestream_write(fd, &MPF_FALSE, sizeof(MPF_FALSE)) == -1)
+   else if (filestream_write(fd, &MPF_FALSE, sizeof(MPF_FALSE)) == -1)
       goto error;
 
    return sizeof(uint8_t);
@@ -658,3 +657,470 @@ int rmsgpack_read(RFILE *fd,
 error:
    return -errno;
 }
+
+static int buf_read_uint(const uint8_t **pos, const uint8_t *end,
+      uint64_t *out, size_t size)
+{
+   size_t i;
+   uint64_t value   = 0;
+   const uint8_t *p = *pos;
+
+   if ((size_t)(end - p) < size)
+      return -EINVAL;
+
+   for (i = 0; i < size; i++)
+      value = (value << 8) | p[i];
+
+   *out = value;
+   *pos = p + size;
+   return 0;
+}
+
+static int buf_read_int(const uint8_t **pos, const uint8_t *end,
+      int64_t *out, size_t size)
+{
+   uint64_t value = 0;
+
+   if (buf_read_uint(pos, end, &value, size) < 0)
+      return -EINVAL;
+
+   switch (size)
+   {
+      case 1:
+         *out = (int8_t)value;
+         break;
+      case 2:
+         *out = (int16_t)value;
+         break;
+      case 4:
+         *out = (int32_t)value;
+         break;
+      default:
+         *out = (int64_t)value;
+         break;
+   }
+   return 0;
+}
+
+static int buf_read_buff(const uint8_t **pos, const uint8_t *end,
+      uint64_t len, char **pbuff)
+{
+   if ((uint64_t)(end - *pos) < len)
+      return -EINVAL;
+
+   *pbuff = (char *)malloc((size_t)(len + 1) * sizeof(char));
+
+   if (!*pbuff)
+      return -ENOMEM;
+
+   memcpy(*pbuff, *pos, (size_t)len);
+   (*pbuff)[len] = '\0';
+   *pos         += len;
+   return 0;
+}
+
+int rmsgpack_read_buf(const uint8_t **pos, const uint8_t *end,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
+{
+   int rv;
+   unsigned i;
+   uint64_t tmp_len  = 0;
+   uint64_t tmp_uint = 0;
+   int64_t tmp_int   = 0;
+   uint8_t type      = 0;
+   char *buff        = NULL;
+
+   if (*pos >= end)
+      return -EINVAL;
+
+   type = *(*pos)++;
+
+   if (type < MPF_FIXMAP)
+      return callbacks->read_int ? callbacks->read_int(type, data) : 0;
+   else if (type < MPF_FIXARRAY)
+   {
+      tmp_len = type - MPF_FIXMAP;
+      goto map;
+   }
+   else if (type < MPF_FIXSTR)
+   {
+      tmp_len = type - MPF_FIXARRAY;
+      goto array;
+   }
+   else if (type < MPF_NIL)
+   {
+      tmp_len = type - MPF_FIXSTR;
+      goto string;
+   }
+   else if (type > MPF_MAP32)
+      return callbacks->read_int ? callbacks->read_int(type - 0xff - 1, data) : 0;
+
+   switch (type)
+   {
+      case _MPF_NIL:
+         return callbacks->read_nil ? callbacks->read_nil(data) : 0;
+      case _MPF_FALSE:
+         return callbacks->read_bool ? callbacks->read_bool(0, data) : 0;
+      case _MPF_TRUE:
+         return callbacks->read_bool ? callbacks->read_bool(1, data) : 0;
+      case _MPF_BIN8:
+      case _MPF_BIN16:
+      case _MPF_BIN32:
+         if (buf_read_uint(pos, end, &tmp_len, 1<<(type - _MPF_BIN8)) < 0)
+            return -EINVAL;
+         if (!callbacks->read_bin)
+            goto skip_bytes;
+         if ((rv = buf_read_buff(pos, end, tmp_len, &buff)) < 0)
+            return rv;
+         return callbacks->read_bin(buff, (uint32_t)tmp_len, data);
+      case _MPF_UINT8:
+      case _MPF_UINT16:
+      case _MPF_UINT32:
+      case _MPF_UINT64:
+         if (buf_read_uint(pos, end, &tmp_uint,
+                  (size_t)(UINT64_C(1) << (type - _MPF_UINT8))) < 0)
+            return -EINVAL;
+         return callbacks->read_uint ? callbacks->read_uint(tmp_uint, data) : 0;
+      case _MPF_INT8:
+      case _MPF_INT16:
+      case _MPF_INT32:
+      case _MPF_INT64:
+         if (buf_read_int(pos, end, &tmp_int,
+                  (size_t)(UINT64_C(1) << (type - _MPF_INT8))) < 0)
+            return -EINVAL;
+         return callbacks->read_int ? callbacks->read_int(tmp_int, data) : 0;
+      case _MPF_STR8:
+      case _MPF_STR16:
+      case _MPF_STR32:
+         if (buf_read_uint(pos, end, &tmp_len, 1<<(type - _MPF_STR8)) < 0)
+            return -EINVAL;
+         goto string;
+      case _MPF_ARRAY16:
+      case _MPF_ARRAY32:
+         if (buf_read_uint(pos, end, &tmp_len, 2<<(type - _MPF_ARRAY16)) < 0)
+            return -EINVAL;
+         goto array;
+      case _MPF_MAP16:
+      case _MPF_MAP32:
+         if (buf_read_uint(pos, end, &tmp_len, 2<<(type - _MPF_MAP16)) < 0)
+            return -EINVAL;
+         goto map;
+   }
+
+   return 0;
+
+string:
+   if (!callbacks->read_string)
+      goto skip_bytes;
+   if ((rv = buf_read_buff(pos, end, tmp_len, &buff)) < 0)
+      return rv;
+   return callbacks->read_string(buff, (uint32_t)tmp_len, data);
+
+skip_bytes:
+   if ((uint64_t)(end - *pos) < tmp_len)
+      return -EINVAL;
+   *pos += tmp_len;
+   return 0;
+
+map:
+   if (callbacks->read_map_start &&
+         (rv = callbacks->read_map_start((uint32_t)tmp_len, data)) < 0)
+      return rv;
+   tmp_len *= 2;
+   goto items;
+
+array:
+   if (callbacks->read_array_start &&
+         (rv = callbacks->read_array_start((uint32_t)tmp_len, data)) < 0)
+      return rv;
+
+items:
+   for (i = 0; i < tmp_len; i++)
+   {
+      if ((rv = rmsgpack_read_buf(pos, end, callbacks, data)) < 0)
+         return rv;
+   }
+
+   return 0;
+}
+
+int rmsgpack_skip_buf(const uint8_t **pos, const uint8_t *end)
+{
+   /* Values still to be skipped, so that nesting
+    * doesn't need recursion. */
+   uint64_t pending = 1;
+
+   while (pending--)
+   {
+      uint8_t type;
+      uint64_t len = 0;
+
+      if (*pos >= end)
+         return -EINVAL;
+
+      type = *(*pos)++;
+
+      if (type < MPF_FIXMAP || type > MPF_MAP32)
+         continue;
+      else if (type < MPF_FIXARRAY)
+      {
+         pending += 2 * (uint64_t)(type - MPF_FIXMAP);
+         continue;
+      }
+      else if (type < MPF_FIXSTR)
+      {
+         pending += type - MPF_FIXARRAY;
+         continue;
+      }
+      else if (type < MPF_NIL)
+         len = type - MPF_FIXSTR;
+      else
+      {
+         switch (type)
+         {
+            case _MPF_BIN8:
+            case _MPF_BIN16:
+            case _MPF_BIN32:
+               if (buf_read_uint(pos, end, &len, 1<<(type - _MPF_BIN8)) < 0)
+                  return -EINVAL;
+               break;
+            case _MPF_STR8:
+            case _MPF_STR16:
+            case _MPF_STR32:
+               if (buf_read_uint(pos, end, &len, 1<<(type - _MPF_STR8)) < 0)
+                  return -EINVAL;
+               break;
+            case _MPF_UINT8:
+            case _MPF_UINT16:
+            case _MPF_UINT32:
+            case _MPF_UINT64:
+               len = UINT64_C(1) << (type - _MPF_UINT8);
+               break;
+            case _MPF_INT8:
+            case _MPF_INT16:
+            case _MPF_INT32:
+            case _MPF_INT64:
+               len = UINT64_C(1) << (type - _MPF_INT8);
+               break;
+            case _MPF_ARRAY16:
+            case _MPF_ARRAY32:
+               if (buf_read_uint(pos, end, &len, 2<<(type - _MPF_ARRAY16)) < 0)
+                  return -EINVAL;
+               pending += len;
+               len      = 0;
+               break;
+            case _MPF_MAP16:
+            case _MPF_MAP32:
+               if (buf_read_uint(pos, end, &len, 2<<(type - _MPF_MAP16)) < 0)
+                  return -EINVAL;
+               pending += 2 * len;
+               len      = 0;
+               break;
+            default:
+               break;
+         }
+      }
+
+      if ((uint64_t)(end - *pos) < len)
+         return -EINVAL;
+      *pos += len;
+   }
+
+   return 0;
+}
+
+int rmsgpack_read_bytes_buf(const uint8_t **pos, const uint8_t *end,
+      const uint8_t **bytes, uint32_t *len)
+{
+   uint64_t tmp_len = 0;
+   const uint8_t *p = *pos;
+   uint8_t type;
+
+   if (p >= end)
+      return -EINVAL;
+
+   type = *p++;
+
+   if (type >= MPF_FIXSTR && type < MPF_NIL)
+      tmp_len = type - MPF_FIXSTR;
+   else if (type >= _MPF_STR8 && type <= _MPF_STR32)
+   {
+      if (buf_read_uint(&p, end, &tmp_len, 1<<(type - _MPF_STR8)) < 0)
+         return -EINVAL;
+   }
+   else if (type >= _MPF_BIN8 && type <= _MPF_BIN32)
+   {
+      if (buf_read_uint(&p, end, &tmp_len, 1<<(type - _MPF_BIN8)) < 0)
+         return -EINVAL;
+   }
+   else
+      return -EINVAL;
+
+   if ((uint64_t)(end - p) < tmp_len)
+      return -EINVAL;
+
+   *bytes = p;
+   *len   = (uint32_t)tmp_len;
+   *pos   = p + tmp_len;
+   return 0;
+}
+
+int rmsgpack_read_token_buf(const uint8_t **pos, const uint8_t *end,
+      struct rmsgpack_token *token)
+{
+   uint64_t tmp_len = 0;
+   const uint8_t *p = *pos;
+   uint8_t type;
+
+   if (p >= end)
+      return -EINVAL;
+
+   type = *p;
+
+   if (type < MPF_FIXMAP)
+   {
+      token->type     = RMSGPACK_TOKEN_INT;
+      token->val.int_ = type;
+      *pos            = p + 1;
+      return 0;
+   }
+   else if (type > MPF_MAP32)
+   {
+      token->type     = RMSGPACK_TOKEN_INT;
+      token->val.int_ = (int8_t)type;
+      *pos            = p + 1;
+      return 0;
+   }
+   else if ((type >= MPF_FIXSTR && type < MPF_NIL)
+         || (type >= _MPF_STR8 && type <= _MPF_STR32)
+         || (type >= _MPF_BIN8 && type <= _MPF_BIN32))
+   {
+      const uint8_t *bytes = NULL;
+      uint32_t len         = 0;
+
+      if (rmsgpack_read_bytes_buf(pos, end, &bytes, &len) < 0)
+         return -EINVAL;
+
+      token->type = (type >= _MPF_BIN8 && type <= _MPF_BIN32)
+         ? RMSGPACK_TOKEN_BINARY : RMSGPACK_TOKEN_STRING;
+      token->val.string.buff = (const char*)bytes;
+      token->val.string.len  = len;
+      return 0;
+   }
+
+   p++;
+
+   if (type < MPF_FIXARRAY)
+   {
+      token->type    = RMSGPACK_TOKEN_MAP;
+      token->val.len = type - MPF_FIXMAP;
+      *pos           = p;
+      return 0;
+   }
+   else if (type < MPF_FIXSTR)
+   {
+      token->type    = RMSGPACK_TOKEN_ARRAY;
+      token->val.len = type - MPF_FIXARRAY;
+      *pos           = p;
+      return 0;
+   }
+
+   switch (type)
+   {
+      case _MPF_NIL:
+         token->type = RMSGPACK_TOKEN_NIL;
+         break;
+      case _MPF_FALSE:
+      case _MPF_TRUE:
+         token->type      = RMSGPACK_TOKEN_BOOL;
+         token->val.bool_ = type == _MPF_TRUE;
+         break;
+      case _MPF_UINT8:
+      case _MPF_UINT16:
+      case _MPF_UINT32:
+      case _MPF_UINT64:
+         token->type = RMSGPACK_TOKEN_UINT;
+         if (buf_read_uint(&p, end, &token->val.uint_,
+                  (size_t)(UINT64_C(1) << (type - _MPF_UINT8))) < 0)
+            return -EINVAL;
+         break;
+      case _MPF_INT8:
+      case _MPF_INT16:
+      case _MPF_INT32:
+      case _MPF_INT64:
+         token->type = RMSGPACK_TOKEN_INT;
+         if (buf_read_int(&p, end, &token->val.int_,
+                  (size_t)(UINT64_C(1) << (type - _MPF_INT8))) < 0)
+            return -EINVAL;
+         break;
+      case _MPF_ARRAY16:
+      case _MPF_ARRAY32:
+         token->type = RMSGPACK_TOKEN_ARRAY;
+         if (buf_read_uint(&p, end, &tmp_len, 2<<(type - _MPF_ARRAY16)) < 0)
+            return -EINVAL;
+         token->val.len = (uint32_t)tmp_len;
+         break;
+      case _MPF_MAP16:
+      case _MPF_MAP32:
+         token->type = RMSGPACK_TOKEN_MAP;
+         if (buf_read_uint(&p, end, &tmp_len, 2<<(type - _MPF_MAP16)) < 0)
+            return -EINVAL;
+         token->val.len = (uint32_t)tmp_len;
+         break;
+      default:
+         /* floats and extensions aren't used by databases */
+         return -EINVAL;
+   }
+
+   *pos = p;
+   return 0;
+}
+
+int rmsgpack_map_find_buf(const uint8_t **pos, const uint8_t *end,
+      const char *key, uint32_t key_len)
+{
+   uint64_t i;
+   uint64_t len     = 0;
+   const uint8_t *p = *pos;
+   uint8_t type;
+
+   if (p >= end)
+      return -EINVAL;
+
+   type = *p++;
+
+   if (type >= MPF_FIXMAP && type < MPF_FIXARRAY)
+      len = type - MPF_FIXMAP;
+   else if (type == _MPF_MAP16 || type == _MPF_MAP32)
+   {
+      if (buf_read_uint(&p, end, &len, 2<<(type - _MPF_MAP16)) < 0)
+         return -EINVAL;
+   }
+   else
+      return -EINVAL;
+
+   for (i = 0; i < len; i++)
+   {
+      const uint8_t *bytes = NULL;
+      uint32_t bytes_len   = 0;
+      const uint8_t *next  = p;
+
+      if (rmsgpack_read_bytes_buf(&next, end, &bytes, &bytes_len) == 0)
+      {
+         if (bytes_len == key_len && memcmp(bytes, key, key_len) == 0)
+         {
+            *pos = next;
+            return 0;
+         }
+      }
+      else if (rmsgpack_skip_buf(&next, end) < 0)
+         return -EINVAL;
+
+      p = next;
+
+      if (rmsgpack_skip_buf(&p, end) < 0)
+         return -EINVAL;
+   }
+
+   return -1;
+}
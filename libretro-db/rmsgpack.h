@@ -39,6 +39,43 @@ struct rmsgpack_read_callbacks
    int (*read_array_start)(uint32_t, void *);
 };
 
+enum rmsgpack_token_type
+{
+   RMSGPACK_TOKEN_NIL = 0,
+   RMSGPACK_TOKEN_BOOL,
+   RMSGPACK_TOKEN_INT,
+   RMSGPACK_TOKEN_UINT,
+   RMSGPACK_TOKEN_STRING,
+   RMSGPACK_TOKEN_BINARY,
+   RMSGPACK_TOKEN_MAP,
+   RMSGPACK_TOKEN_ARRAY
+};
+
+/* A value read in place. Strings and binaries point into the
+ * buffer they were read from and are not NUL-terminated. */
+struct rmsgpack_token
+{
+   enum rmsgpack_token_type type;
+   union
+   {
+      int bool_;
+      int64_t int_;
+      uint64_t uint_;
+      struct
+      {
+         const char *buff;
+         uint32_t len;
+      } string;
+      struct
+      {
+         const char *buff;
+         uint32_t len;
+      } binary;
+      /* entries of a map or array */
+      uint32_t len;
+   } val;
+};
+
 int rmsgpack_write_array_header(RFILE *fd, uint32_t size);
 
 int rmsgpack_write_map_header(RFILE *fd, uint32_t size);
@@ -57,5 +94,32 @@ int rmsgpack_write_uint(RFILE *fd, uint64_t value );
 
 int rmsgpack_read(RFILE *fd, struct rmsgpack_read_callbacks *callbacks, void *data);
 
+/* The *_buf variants decode from memory, typically a mapped
+ * database. They advance *pos past whatever they consumed and
+ * never read at or beyond @end. */
+
+int rmsgpack_read_buf(const uint8_t **pos, const uint8_t *end,
+      struct rmsgpack_read_callbacks *callbacks, void *data);
+
+/* Steps over one complete value without decoding it. */
+int rmsgpack_skip_buf(const uint8_t **pos, const uint8_t *end);
+
+/* Expects a map at *pos and leaves *pos at the value stored
+ * under the string key @key. Returns -1 if there is none. */
+int rmsgpack_map_find_buf(const uint8_t **pos, const uint8_t *end,
+      const char *key, uint32_t key_len);
+
+/* Pull reader, reads the value at *pos without allocating.
+ * Maps and arrays only report their number of entries and leave
+ * *pos at the first one, which are then read or skipped in turn,
+ * keys and values alternating for maps. */
+int rmsgpack_read_token_buf(const uint8_t **pos, const uint8_t *end,
+      struct rmsgpack_token *token);
+
+/* Returns a view of the payload of the string or binary value
+ * at *pos, or -EINVAL if the value is of another type. */
+int rmsgpack_read_bytes_buf(const uint8_t **pos, const uint8_t *end,
+      const uint8_t **bytes, uint32_t *len);
+
 #endif
 
@@ -0,0 +1,383 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <compat/strl.h>
+#include <compat/posix_string.h>
+#include <file/archive_file.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <retro_miscellaneous.h>
+#include <retro_stat.h>
+#include <rhash.h>
+
+#include "extract_cache_manager.h"
+
+#include "../verbosity.h"
+
+#define EXTRACT_CACHE_DIR      "extracted"
+#define EXTRACT_CACHE_MANIFEST "manifest"
+
+/* One extracted file. Lives in <cache>/extracted/<dir>/<basename>
+ * and is described by a line of the manifest. */
+struct extract_cache_entry
+{
+   char *path;
+   char dir[17];
+   uint32_t size;
+   uint32_t crc;
+   int64_t archive_mtime;
+   int64_t file_mtime;
+   int64_t last_used;
+};
+
+struct extract_cache
+{
+   char root[PATH_MAX_LENGTH];
+   char manifest[PATH_MAX_LENGTH];
+   struct extract_cache_entry *entries;
+   size_t count;
+   size_t capacity;
+   uint64_t total;
+};
+
+static void extract_cache_free(struct extract_cache *cache)
+{
+   size_t i;
+
+   for (i = 0; i < cache->count; i++)
+      free(cache->entries[i].path);
+   free(cache->entries);
+
+   cache->entries  = NULL;
+   cache->count    = 0;
+   cache->capacity = 0;
+   cache->total    = 0;
+}
+
+static struct extract_cache_entry *extract_cache_append(
+      struct extract_cache *cache)
+{
+   struct extract_cache_entry *entry = NULL;
+
+   if (cache->count == cache->capacity)
+   {
+      size_t capacity = cache->capacity ? cache->capacity * 2 : 16;
+      struct extract_cache_entry *entries = (struct extract_cache_entry*)
+         realloc(cache->entries, capacity * sizeof(*entries));
+
+      if (!entries)
+         return NULL;
+
+      cache->entries  = entries;
+      cache->capacity = capacity;
+   }
+
+   entry = &cache->entries[cache->count++];
+   memset(entry, 0, sizeof(*entry));
+
+   return entry;
+}
+
+static void extract_cache_entry_file(const struct extract_cache *cache,
+      const struct extract_cache_entry *entry, char *s, size_t len)
+{
+   char dir[PATH_MAX_LENGTH];
+   const char *delim = path_get_archive_delim(entry->path);
+
+   dir[0] = '\0';
+
+   fill_pathname_join(dir, cache->root, entry->dir, sizeof(dir));
+   fill_pathname_join(s, dir,
+         path_basename(delim ? delim + 1 : entry->path), len);
+}
+
+/* Deletes the extracted file of entry @i and drops the entry. */
+static void extract_cache_remove(struct extract_cache *cache, size_t i)
+{
+   char file[PATH_MAX_LENGTH];
+   char dir[PATH_MAX_LENGTH];
+   struct extract_cache_entry *entry = &cache->entries[i];
+
+   file[0] = dir[0] = '\0';
+
+   extract_cache_entry_file(cache, entry, file, sizeof(file));
+   fill_pathname_join(dir, cache->root, entry->dir, sizeof(dir));
+
+   remove(file);
+   /* Only succeeds where remove() deletes empty directories,
+    * a leftover directory is reused by the next extraction. */
+   remove(dir);
+
+   cache->total -= entry->size;
+   free(entry->path);
+
+   cache->entries[i] = cache->entries[--cache->count];
+}
+
+static bool extract_cache_load(struct extract_cache *cache,
+      const char *cache_dir)
+{
+   ssize_t len = 0;
+   void *buf   = NULL;
+   char *line  = NULL;
+   char *save  = NULL;
+
+   memset(cache, 0, sizeof(*cache));
+
+   fill_pathname_join(cache->root, cache_dir, EXTRACT_CACHE_DIR,
+         sizeof(cache->root));
+   fill_pathname_join(cache->manifest, cache->root, EXTRACT_CACHE_MANIFEST,
+         sizeof(cache->manifest));
+
+   if (!path_is_directory(cache->root) && !path_mkdir(cache->root))
+      return false;
+
+   if (!path_file_exists(cache->manifest))
+      return true;
+
+   if (!filestream_read_file(cache->manifest, &buf, &len))
+      return true;
+
+   /* dir \t size \t last used \t file mtime \t archive mtime \t crc \t path */
+   for (line = strtok_r((char*)buf, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save))
+   {
+      unsigned i;
+      char *fields[7];
+      struct extract_cache_entry *entry = NULL;
+      char *pos                         = line;
+
+      for (i = 0; i < 6 && pos; i++)
+      {
+         fields[i] = pos;
+         pos       = strchr(pos, '\t');
+         if (pos)
+            *pos++ = '\0';
+      }
+
+      if (!pos || !*pos || strlen(fields[0]) != 16)
+         continue;
+
+      fields[6] = pos;
+      entry     = extract_cache_append(cache);
+
+      if (!entry)
+         break;
+
+      strlcpy(entry->dir, fields[0], sizeof(entry->dir));
+      entry->size          = (uint32_t)strtoul(fields[1], NULL, 10);
+      entry->last_used     = strtoll(fields[2], NULL, 10);
+      entry->file_mtime    = strtoll(fields[3], NULL, 10);
+      entry->archive_mtime = strtoll(fields[4], NULL, 10);
+      entry->crc           = (uint32_t)strtoul(fields[5], NULL, 16);
+      entry->path          = strdup(fields[6]);
+
+      if (!entry->path)
+      {
+         cache->count--;
+         break;
+      }
+
+      cache->total += entry->size;
+   }
+
+   free(buf);
+   return true;
+}
+
+static void extract_cache_save(const struct extract_cache *cache)
+{
+   size_t i;
+   RFILE *file = filestream_open(cache->manifest, RFILE_MODE_WRITE, -1);
+
+   if (!file)
+      return;
+
+   for (i = 0; i < cache->count; i++)
+   {
+      char line[PATH_MAX_LENGTH + 128];
+      const struct extract_cache_entry *entry = &cache->entries[i];
+      int n = snprintf(line, sizeof(line), "%s\t%u\t%lld\t%lld\t%lld\t%08x\t%s\n",
+            entry->dir, (unsigned)entry->size,
+            (long long)entry->last_used, (long long)entry->file_mtime,
+            (long long)entry->archive_mtime, (unsigned)entry->crc,
+            entry->path);
+
+      if (n > 0 && (size_t)n < sizeof(line))
+         filestream_write(file, line, n);
+   }
+
+   filestream_close(file);
+}
+
+/* Evicts least recently used extractions until @size more
+ * bytes fit into @max_size. */
+static void extract_cache_make_room(struct extract_cache *cache,
+      uint64_t max_size, uint64_t size)
+{
+   while (cache->count && cache->total + size > max_size)
+   {
+      size_t i;
+      size_t oldest = 0;
+
+      for (i = 1; i < cache->count; i++)
+         if (cache->entries[i].last_used < cache->entries[oldest].last_used)
+            oldest = i;
+
+      RARCH_LOG("Evicting cached extraction: %s.\n",
+            cache->entries[oldest].path);
+      extract_cache_remove(cache, oldest);
+   }
+}
+
+bool extract_cache_manager_fetch(const char *cache_dir, uint64_t max_size,
+      const char *path, char *out_path, size_t len)
+{
+   size_t i;
+   struct extract_cache cache;
+   struct file_archive_entry found;
+   char archive[PATH_MAX_LENGTH];
+   char dir[PATH_MAX_LENGTH];
+   char key[17];
+   struct extract_cache_entry *entry = NULL;
+   const char *delim                 = path_get_archive_delim(path);
+   ssize_t extracted_len             = 0;
+   int64_t archive_mtime             = 0;
+   int64_t now                       = (int64_t)time(NULL);
+
+   if (!delim || string_is_empty(cache_dir) || !max_size)
+      return false;
+
+   archive[0] = dir[0] = '\0';
+   strlcpy(archive, path, sizeof(archive));
+   archive[delim - path] = '\0';
+
+   archive_mtime = path_get_mtime(archive);
+
+   if (archive_mtime < 0 ||
+         !file_archive_find_entry(archive, delim + 1, true, &found))
+      return false;
+
+   if (found.size > max_size || !extract_cache_load(&cache, cache_dir))
+      return false;
+
+   for (i = 0; i < cache.count; )
+   {
+      entry = &cache.entries[i];
+
+      if (!string_is_equal(entry->path, path))
+      {
+         i++;
+         continue;
+      }
+
+      if (     entry->archive_mtime == archive_mtime
+            && entry->crc           == found.crc32
+            && entry->size          == found.size)
+      {
+         extract_cache_entry_file(&cache, entry, out_path, len);
+
+         /* Reuse only what is still exactly as we wrote it. */
+         if (     path_get_size(out_path)  == (int32_t)entry->size
+               && path_get_mtime(out_path) == entry->file_mtime)
+         {
+            RARCH_LOG("Reusing cached extraction: %s.\n", out_path);
+
+            entry->last_used = now;
+            extract_cache_save(&cache);
+            extract_cache_free(&cache);
+            return true;
+         }
+      }
+
+      /* Stale, the archive or the extracted file changed. */
+      extract_cache_remove(&cache, i);
+   }
+
+   snprintf(key, sizeof(key), "%08x%08x",
+         (unsigned)djb2_calculate(path),
+         (unsigned)(found.crc32 ^ (uint32_t)archive_mtime));
+
+   /* A hash collision with another path, that one has to go. */
+   for (i = 0; i < cache.count; i++)
+   {
+      if (string_is_equal(cache.entries[i].dir, key))
+      {
+         extract_cache_remove(&cache, i);
+         break;
+      }
+   }
+
+   extract_cache_make_room(&cache, max_size, found.size);
+
+   entry = extract_cache_append(&cache);
+
+   if (!entry)
+      goto error;
+
+   entry->path = strdup(path);
+
+   if (!entry->path)
+   {
+      cache.count--;
+      goto error;
+   }
+
+   strlcpy(entry->dir, key, sizeof(entry->dir));
+   entry->size          = found.size;
+   entry->crc           = found.crc32;
+   entry->archive_mtime = archive_mtime;
+   entry->last_used     = now;
+
+   fill_pathname_join(dir, cache.root, entry->dir, sizeof(dir));
+   extract_cache_entry_file(&cache, entry, out_path, len);
+
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+      goto error_entry;
+
+   /* file_archive_compressed_read keeps existing files. */
+   remove(out_path);
+
+   if (!file_archive_compressed_read(path, NULL, out_path, &extracted_len)
+         || extracted_len < 0
+         || path_get_size(out_path) != (int32_t)found.size)
+   {
+      remove(out_path);
+      goto error_entry;
+   }
+
+   entry->file_mtime = path_get_mtime(out_path);
+   cache.total      += entry->size;
+
+   RARCH_LOG("Cached extraction: %s.\n", out_path);
+
+   extract_cache_save(&cache);
+   extract_cache_free(&cache);
+   return true;
+
+error_entry:
+   free(entry->path);
+   cache.count--;
+error:
+   extract_cache_save(&cache);
+   extract_cache_free(&cache);
+   return false;
+}
@@ -0,0 +1,53 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXTRACT_CACHE_MANAGER_H__
+#define EXTRACT_CACHE_MANAGER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * extract_cache_manager_fetch:
+ * @cache_dir        : directory the cache lives in.
+ * @max_size         : size budget of the cache in bytes.
+ * @path             : path to a file inside an archive,
+ *                     e.g. "game.7z#game.iso".
+ * @out_path         : location of the extracted file.
+ * @len              : size of @out_path.
+ *
+ * Returns a previous extraction of @path if the archive (by mtime)
+ * and the entry (by CRC32) are unchanged and the extracted file
+ * still has the size and mtime it was written with. Otherwise
+ * extracts @path into the cache, evicting the least recently used
+ * extractions to stay within @max_size.
+ *
+ * Files handed out belong to the cache and must not be removed
+ * by the caller.
+ *
+ * Returns: true (1) if @out_path holds the extracted file,
+ * otherwise false (0).
+ **/
+bool extract_cache_manager_fetch(const char *cache_dir, uint64_t max_size,
+      const char *path, char *out_path, size_t len);
+
+RETRO_END_DECLS
+
+#endif
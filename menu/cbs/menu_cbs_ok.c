@@ -1336,6 +1336,7 @@ static int action_ok_playlist_entry_collection(const char *path,
    playlist_t *tmp_playlist                = NULL;
    menu_handle_t *menu                     = NULL;
    rarch_system_info_t *info               = NULL;
+   settings_t *settings                    = config_get_ptr();
 
    if (!menu_driver_ctl(RARCH_MENU_CTL_DRIVER_DATA_GET, &menu))
       return menu_cbs_exit();
@@ -1349,7 +1350,8 @@ static int action_ok_playlist_entry_collection(const char *path,
    if (!tmp_playlist)
    {
       tmp_playlist = playlist_init(
-            menu->db_playlist_file, COLLECTION_SIZE);
+            menu->db_playlist_file, COLLECTION_SIZE,
+            settings->playlist_binary_format);
 
       if (!tmp_playlist)
          return menu_cbs_exit();
@@ -1552,6 +1554,7 @@ static int action_ok_playlist_entry_start_content(const char *path,
    const char *core_name            = NULL;
    playlist_t *tmp_playlist         = NULL;
    menu_handle_t *menu              = NULL;
+   settings_t *settings             = config_get_ptr();
 
    if (!menu_driver_ctl(RARCH_MENU_CTL_DRIVER_DATA_GET, &menu))
       return menu_cbs_exit();
@@ -1563,7 +1566,8 @@ static int action_ok_playlist_entry_start_content(const char *path,
    if (!tmp_playlist)
    {
       tmp_playlist = playlist_init(
-            menu->db_playlist_file, COLLECTION_SIZE);
+            menu->db_playlist_file, COLLECTION_SIZE,
+            settings->playlist_binary_format);
 
       if (!tmp_playlist)
          return menu_cbs_exit();
@@ -2311,6 +2315,12 @@ static void cb_decompressed(void *task_data, void *user_data, const char *err)
          case CB_UPDATE_ASSETS:
             command_event(CMD_EVENT_REINIT, NULL);
             break;
+         case CB_UPDATE_CORE_INFO_FILES:
+            /* Files got overwritten, directory mtimes
+             * don't tell. */
+            core_info_cache_invalidate();
+            command_event(CMD_EVENT_CORE_INFO_INIT, NULL);
+            break;
       }
    }
 
@@ -2464,26 +2474,14 @@ static void cb_generic_dir_download(void *task_data,
    }
 }
 
-/* expects http_transfer_t*, menu_file_transfer_t* */
-static void cb_generic_download(void *task_data,
-      void *user_data, const char *err)
+/* Directory a download of type @enum_idx goes to. */
+static const char *generic_download_dir(enum msg_hash_enums enum_idx,
+      bool *extract)
 {
-   char output_path[PATH_MAX_LENGTH];
-   bool extract = true;
-   const char             *dir_path      = NULL;
-   menu_file_transfer_t     *transf      = (menu_file_transfer_t*)user_data;
-   settings_t              *settings     = config_get_ptr();
-   http_transfer_data_t        *data     = (http_transfer_data_t*)task_data;
+   const char *dir_path     = NULL;
+   settings_t *settings     = config_get_ptr();
 
-   if (!data || !data->data | !transf)
-      goto finish;
-
-   output_path[0] = '\0';
-
-   /* we have to determine dir_path at the time of writting or else
-    * we'd run into races when the user changes the setting during an
-    * http transfer. */
-   switch (transf->enum_idx)
+   switch (enum_idx)
    {
       case MENU_ENUM_LABEL_CB_CORE_THUMBNAILS_DOWNLOAD:
          dir_path = settings->directory.thumbnails;
@@ -2493,7 +2491,8 @@ static void cb_generic_download(void *task_data,
          break;
       case MENU_ENUM_LABEL_CB_CORE_CONTENT_DOWNLOAD:
          dir_path = settings->directory.core_assets;
-         extract = settings->network.buildbot_auto_extract_archive;
+         if (extract)
+            *extract = settings->network.buildbot_auto_extract_archive;
          break;
       case MENU_ENUM_LABEL_CB_UPDATE_CORE_INFO_FILES:
          dir_path = settings->path.libretro_info;
@@ -2520,11 +2519,11 @@ static void cb_generic_download(void *task_data,
             static char shaderdir[PATH_MAX_LENGTH]       = {0};
             const char *dirname                          = NULL;
 
-            if (transf->enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_CG)
+            if (enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_CG)
                dirname                                   = "shaders_cg";
-            else if (transf->enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_GLSL)
+            else if (enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_GLSL)
                dirname                                   = "shaders_glsl";
-            else if (transf->enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_SLANG)
+            else if (enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_SLANG)
                dirname                                   = "shaders_slang";
 
             fill_pathname_join(shaderdir,
@@ -2533,7 +2532,7 @@ static void cb_generic_download(void *task_data,
                   sizeof(shaderdir));
 
             if (!path_file_exists(shaderdir) && !path_mkdir(shaderdir))
-               goto finish;
+               return NULL;
 
             dir_path = shaderdir;
          }
@@ -2543,10 +2542,84 @@ static void cb_generic_download(void *task_data,
          break;
       default:
          RARCH_WARN("Unknown transfer type '%s' bailing out.\n",
-               msg_hash_to_str(transf->enum_idx));
+               msg_hash_to_str(enum_idx));
          break;
    }
 
+   return dir_path;
+}
+
+/* Moves a streamed download to @dst, copying it where renaming
+ * isn't possible (e.g. across file systems). */
+static bool generic_download_move(const char *src, const char *dst)
+{
+   bool ret     = false;
+   RFILE *in    = NULL;
+   RFILE *out   = NULL;
+   char *buf    = NULL;
+
+   /* rename() doesn't replace files everywhere. */
+   remove(dst);
+
+   if (!rename(src, dst))
+      return true;
+
+   in  = filestream_open(src, RFILE_MODE_READ, -1);
+   out = filestream_open(dst, RFILE_MODE_WRITE, -1);
+   buf = (char*)malloc(64 * 1024);
+
+   if (in && out && buf)
+   {
+      ssize_t len;
+
+      ret = true;
+
+      while ((len = filestream_read(in, buf, 64 * 1024)) > 0)
+      {
+         if (filestream_write(out, buf, len) != len)
+         {
+            ret = false;
+            break;
+         }
+      }
+
+      if (len < 0)
+         ret = false;
+   }
+
+   free(buf);
+   if (in)
+      filestream_close(in);
+   if (out && filestream_close(out) != 0)
+      ret = false;
+
+   if (!ret)
+      remove(dst);
+   remove(src);
+
+   return ret;
+}
+
+/* expects http_transfer_t*, menu_file_transfer_t* */
+static void cb_generic_download(void *task_data,
+      void *user_data, const char *err)
+{
+   char output_path[PATH_MAX_LENGTH];
+   bool extract = true;
+   const char             *dir_path      = NULL;
+   menu_file_transfer_t     *transf      = (menu_file_transfer_t*)user_data;
+   http_transfer_data_t        *data     = (http_transfer_data_t*)task_data;
+
+   if (!data || (!data->data && !data->path) || !transf)
+      goto finish;
+
+   output_path[0] = '\0';
+
+   /* we have to determine dir_path at the time of writting or else
+    * we'd run into races when the user changes the setting during an
+    * http transfer. */
+   dir_path = generic_download_dir(transf->enum_idx, &extract);
+
    if (!string_is_empty(dir_path))
       fill_pathname_join(output_path, dir_path,
             transf->path, sizeof(output_path));
@@ -2575,7 +2648,15 @@ static void cb_generic_download(void *task_data,
    }
 #endif
 
-   if (!filestream_write_file(output_path, data->data, data->len))
+   if (data->path)
+   {
+      if (!generic_download_move(data->path, output_path))
+      {
+         err = "Write failed.";
+         goto finish;
+      }
+   }
+   else if (!filestream_write_file(output_path, data->data, data->len))
    {
       err = "Write failed.";
       goto finish;
@@ -2616,6 +2697,12 @@ finish:
 
    if (data)
    {
+      if (data->path)
+      {
+         /* Still there unless it was moved in place. */
+         remove(data->path);
+         free(data->path);
+      }
       if (data->data)
          free(data->data);
       free(data);
@@ -2710,6 +2797,41 @@ static int action_ok_download_generic(const char *path,
    transf->enum_idx = enum_idx;
    strlcpy(transf->path, path, sizeof(transf->path));
 
+   if (cb == cb_generic_download)
+   {
+      /* Stream to the cache, or next to where the download is
+       * headed, and move it in place once it's complete. */
+      char tmp[PATH_MAX_LENGTH];
+      char tmp_dir[PATH_MAX_LENGTH];
+      const char *dir_path = settings->directory.cache;
+
+      tmp[0] = tmp_dir[0] = '\0';
+
+      if (string_is_empty(dir_path))
+      {
+         dir_path = generic_download_dir(enum_idx, NULL);
+
+         if (!string_is_empty(dir_path))
+         {
+            fill_pathname_join(tmp_dir, dir_path, path, sizeof(tmp_dir));
+            path_basedir_wrapper(tmp_dir);
+            dir_path = tmp_dir;
+         }
+      }
+
+      if (!string_is_empty(dir_path) &&
+            (path_is_directory(dir_path) || path_mkdir(dir_path)))
+      {
+         snprintf(tmp, sizeof(tmp), "%08x.download",
+               (unsigned)msg_hash_calculate(s3));
+         fill_pathname_join(tmp_dir, dir_path, tmp, sizeof(tmp_dir));
+
+         if (task_push_http_transfer_file(s3, tmp_dir, suppress_msg,
+                  msg_hash_to_str(enum_idx), cb, transf))
+            return 0;
+      }
+   }
+
    task_push_http_transfer(s3, suppress_msg, msg_hash_to_str(enum_idx), cb, transf);
 #endif
    return 0;
@@ -63,6 +63,7 @@ int action_scan_file(const char *path,
 
    task_push_dbscan(
          settings->directory.playlist,
+         settings->playlist_binary_format,
          settings->path.content_database,
          fullpath, false, handle_dbscan_finished);
 
@@ -89,6 +90,7 @@ int action_scan_directory(const char *path,
 
    task_push_dbscan(
          settings->directory.playlist,
+         settings->playlist_binary_format,
          settings->path.content_database,
          fullpath, true, handle_dbscan_finished);
 
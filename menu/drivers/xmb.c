@@ -55,6 +55,7 @@
 
 #include "../../verbosity.h"
 #include "../../configuration.h"
+#include "../../performance_counters.h"
 #include "../../retroarch.h"
 #include "../../playlist.h"
 #include "../../runloop.h"
@@ -3478,9 +3479,13 @@ static void xmb_context_reset_textures(
       xmb_handle_t *xmb, const char *iconpath)
 {
    unsigned i;
+   const char *paths[XMB_TEXTURE_LAST];
 
    for (i = 0; i < XMB_TEXTURE_LAST; i++)
-      menu_display_reset_textures_list(xmb_texture_path(i), iconpath, &xmb->textures.list[i], TEXTURE_FILTER_MIPMAP_LINEAR);
+      paths[i] = xmb_texture_path(i);
+
+   menu_display_reset_textures_lists(paths, XMB_TEXTURE_LAST, iconpath,
+         xmb->textures.list, TEXTURE_FILTER_MIPMAP_LINEAR);
 
    menu_display_allocate_white_texture();
 
@@ -3544,6 +3549,7 @@ static void xmb_context_reset_background(const char *iconpath)
 static void xmb_context_reset(void *data)
 {
    char iconpath[PATH_MAX_LENGTH];
+   int span                        = -1;
    xmb_handle_t *xmb               = (xmb_handle_t*)data;
    if (!xmb)
       return;
@@ -3558,11 +3564,20 @@ static void xmb_context_reset(void *data)
          APPLICATION_SPECIAL_DIRECTORY_ASSETS_XMB_ICONS);
 
    xmb_layout(xmb);
-   xmb->font = menu_display_font(APPLICATION_SPECIAL_DIRECTORY_ASSETS_XMB_FONT, xmb->font_size);
+
+   span       = rarch_startup_trace_begin("xmb fonts");
+   xmb->font  = menu_display_font(APPLICATION_SPECIAL_DIRECTORY_ASSETS_XMB_FONT, xmb->font_size);
    xmb->font2 = menu_display_font(APPLICATION_SPECIAL_DIRECTORY_ASSETS_XMB_FONT, xmb->font2_size);
+   rarch_startup_trace_end(span);
+
+   span       = rarch_startup_trace_begin("xmb textures");
    xmb_context_reset_textures(xmb, iconpath);
    xmb_context_reset_background(iconpath);
+   rarch_startup_trace_end(span);
+
+   span       = rarch_startup_trace_begin("xmb horizontal list");
    xmb_context_reset_horizontal_list(xmb);
+   rarch_startup_trace_end(span);
 
    if (!string_is_equal(xmb_thumbnails_ident(),
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_OFF)))
@@ -29,6 +29,9 @@
 #endif
 
 #ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+
 #include "../gfx/video_thread_wrapper.h"
 #endif
 
@@ -1216,3 +1219,175 @@ void menu_display_reset_textures_list(const char *texture_path, const char *icon
          filter_type, item);
    image_texture_free(&ti);
 }
+
+/* Decoding the PNGs is what takes time, uploading has to stay
+ * on this thread. Helper threads decode a few textures ahead
+ * of the upload. */
+#define MENU_DISPLAY_DECODE_THREADS 4
+#define MENU_DISPLAY_DECODE_AHEAD   8
+
+struct menu_display_decode
+{
+   const char **paths;
+   const char *iconpath;
+   struct texture_image *images;
+   bool *decoded;
+   size_t count;
+   size_t next;
+   size_t uploaded;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+#endif
+};
+
+static void menu_display_decode_texture(struct menu_display_decode *dec,
+      size_t i)
+{
+   char path[PATH_MAX_LENGTH];
+
+   path[0] = '\0';
+
+   dec->images[i].supports_rgba = video_driver_supports_rgba();
+
+   if (!string_is_empty(dec->paths[i]))
+      fill_pathname_join(path, dec->iconpath, dec->paths[i], sizeof(path));
+
+   if (!string_is_empty(path) && path_file_exists(path))
+      image_texture_load(&dec->images[i], path);
+}
+
+#ifdef HAVE_THREADS
+static void menu_display_decode_thread(void *data)
+{
+   struct menu_display_decode *dec = (struct menu_display_decode*)data;
+
+   slock_lock(dec->lock);
+
+   for (;;)
+   {
+      size_t i;
+
+      while (     dec->next < dec->count
+            && dec->next >= dec->uploaded + MENU_DISPLAY_DECODE_AHEAD)
+         scond_wait(dec->cond, dec->lock);
+
+      if (dec->next >= dec->count)
+         break;
+
+      i = dec->next++;
+
+      slock_unlock(dec->lock);
+      menu_display_decode_texture(dec, i);
+      slock_lock(dec->lock);
+
+      dec->decoded[i] = true;
+      scond_broadcast(dec->cond);
+   }
+
+   slock_unlock(dec->lock);
+}
+#endif
+
+/**
+ * menu_display_reset_textures_lists:
+ * @texture_paths      : file names of the textures, may be NULL.
+ * @count              : number of textures.
+ * @iconpath           : directory of the textures.
+ * @items              : textures to load into.
+ * @filter_type        : filter of all textures.
+ *
+ * Like calling menu_display_reset_textures_list() for every texture,
+ * but decodes them on several threads.
+ **/
+void menu_display_reset_textures_lists(const char **texture_paths,
+      size_t count, const char *iconpath, uintptr_t *items,
+      enum texture_filter_type filter_type)
+{
+   size_t i;
+   struct menu_display_decode dec;
+#ifdef HAVE_THREADS
+   sthread_t *threads[MENU_DISPLAY_DECODE_THREADS] = {NULL};
+   unsigned num_threads = cpu_features_get_core_amount();
+   unsigned t;
+#endif
+
+   memset(&dec, 0, sizeof(dec));
+
+   dec.paths    = texture_paths;
+   dec.iconpath = iconpath;
+   dec.count    = count;
+   dec.images   = (struct texture_image*)calloc(count, sizeof(*dec.images));
+   dec.decoded  = (bool*)calloc(count, sizeof(*dec.decoded));
+
+   if (!dec.images || !dec.decoded)
+   {
+      for (i = 0; i < count; i++)
+         menu_display_reset_textures_list(texture_paths[i], iconpath,
+               &items[i], filter_type);
+      goto end;
+   }
+
+#ifdef HAVE_THREADS
+   if (num_threads > MENU_DISPLAY_DECODE_THREADS)
+      num_threads = MENU_DISPLAY_DECODE_THREADS;
+
+   if (num_threads > 1)
+   {
+      dec.lock = slock_new();
+      dec.cond = scond_new();
+
+      for (t = 0; dec.lock && dec.cond && t < num_threads; t++)
+      {
+         threads[t] = sthread_create(menu_display_decode_thread, &dec);
+         if (!threads[t])
+            break;
+      }
+   }
+
+   if (threads[0])
+   {
+      for (i = 0; i < count; i++)
+      {
+         slock_lock(dec.lock);
+         while (!dec.decoded[i])
+            scond_wait(dec.cond, dec.lock);
+         slock_unlock(dec.lock);
+
+         if (dec.images[i].pixels)
+            video_driver_texture_load(&dec.images[i], filter_type, &items[i]);
+         image_texture_free(&dec.images[i]);
+
+         slock_lock(dec.lock);
+         dec.uploaded = i + 1;
+         scond_broadcast(dec.cond);
+         slock_unlock(dec.lock);
+      }
+
+      for (t = 0; t < num_threads; t++)
+         if (threads[t])
+            sthread_join(threads[t]);
+   }
+   else
+#endif
+   {
+      for (i = 0; i < count; i++)
+      {
+         menu_display_decode_texture(&dec, i);
+
+         if (dec.images[i].pixels)
+            video_driver_texture_load(&dec.images[i], filter_type, &items[i]);
+         image_texture_free(&dec.images[i]);
+      }
+   }
+
+end:
+#ifdef HAVE_THREADS
+   if (dec.lock)
+      slock_free(dec.lock);
+   if (dec.cond)
+      scond_free(dec.cond);
+#endif
+   free(dec.images);
+   free(dec.decoded);
+}
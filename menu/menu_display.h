@@ -300,6 +300,10 @@ font_data_t *menu_display_font(enum application_special_type type, float font_si
 void menu_display_reset_textures_list(const char *texture_path, const char *iconpath,
       uintptr_t *item, enum texture_filter_type filter_type);
 
+void menu_display_reset_textures_lists(const char **texture_paths,
+      size_t count, const char *iconpath, uintptr_t *items,
+      enum texture_filter_type filter_type);
+
 extern uintptr_t menu_display_white_texture;
 
 extern menu_display_ctx_driver_t menu_display_ctx_gl;
@@ -325,7 +325,7 @@ static int menu_displaylist_parse_core_info(menu_displaylist_info_t *info)
 
    core_info_get_current_core(&core_info);
 
-   if (!core_info || !core_info->config_data)
+   if (!core_info || !core_info->has_info)
    {
       menu_entries_append_enum(info->list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_CORE_INFORMATION_AVAILABLE),
@@ -1706,7 +1706,8 @@ static int menu_displaylist_parse_database_entry(menu_displaylist_info_t *info)
    fill_pathname_join(path_playlist, settings->directory.playlist, path_base,
          sizeof(path_playlist));
 
-   playlist = playlist_init(path_playlist, COLLECTION_SIZE);
+   playlist = playlist_init(path_playlist, COLLECTION_SIZE,
+         settings->playlist_binary_format);
 
    if (playlist)
       strlcpy(menu->db_playlist_file, path_playlist,
@@ -2856,7 +2857,7 @@ static int menu_displaylist_parse_information_list(
 
    core_info_get_current_core(&core_info);
 
-   if (core_info && core_info->config_data)
+   if (core_info && core_info->has_info)
       menu_entries_append_enum(info->list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_CORE_INFORMATION),
             msg_hash_to_str(MENU_ENUM_LABEL_CORE_INFORMATION),
@@ -3980,8 +3981,6 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type, void *data)
 
    settings = config_get_ptr();
 
-   core_info_get_list(&list);
-
    disp_list.info = info;
    disp_list.type = type;
 
@@ -4381,6 +4380,9 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type, void *data)
          ret = menu_displaylist_parse_settings_enum(menu, info,
                MENU_ENUM_LABEL_PLAYLIST_ENTRY_REMOVE,
                PARSE_ONLY_BOOL, false);			   
+         ret = menu_displaylist_parse_settings_enum(menu, info,
+               MENU_ENUM_LABEL_PLAYLIST_BINARY_FORMAT,
+               PARSE_ONLY_BOOL, false);
 
          menu_displaylist_parse_playlist_associations(info);
          info->need_push    = true;
@@ -5220,6 +5222,9 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type, void *data)
          menu_displaylist_parse_settings_enum(menu, info,
                MENU_ENUM_LABEL_VIDEO_FRAME_DELAY,
                PARSE_ONLY_UINT, false);
+         menu_displaylist_parse_settings_enum(menu, info,
+               MENU_ENUM_LABEL_VIDEO_FRAME_DELAY_AUTO,
+               PARSE_ONLY_BOOL, false);
          menu_displaylist_parse_settings_enum(menu, info,
                MENU_ENUM_LABEL_VIDEO_BLACK_FRAME_INSERTION,
                PARSE_ONLY_BOOL, false);
@@ -5474,6 +5479,9 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type, void *data)
                   MENU_ENUM_LABEL_FAVORITES,
                   MENU_SETTING_ACTION, 0, 0);
 
+         /* Waits for the list, only this entry needs it. */
+         core_info_get_list(&list);
+
          if (core_info_list_num_info_files(list))
          {
             menu_entries_append_enum(info->list,
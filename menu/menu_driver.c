@@ -461,11 +461,12 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
          break;
       case RARCH_MENU_CTL_PLAYLIST_INIT:
          {
-            const char *path = (const char*)data;
+            const char *path     = (const char*)data;
+            settings_t *settings = config_get_ptr();
             if (string_is_empty(path))
                return false;
             menu_driver_playlist  = playlist_init(path,
-                  COLLECTION_SIZE);
+                  COLLECTION_SIZE, settings->playlist_binary_format);
          }
          break;
       case RARCH_MENU_CTL_PLAYLIST_GET:
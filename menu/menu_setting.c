@@ -3609,6 +3609,23 @@ static bool setting_append_list(
          menu_settings_list_current_add_range(list, list_info, 0, 15, 1, true, true);
          settings_data_list_current_add_flags(list, list_info, SD_FLAG_LAKKA_ADVANCED);
 
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->video.frame_delay_auto,
+               MENU_ENUM_LABEL_VIDEO_FRAME_DELAY_AUTO,
+               MENU_ENUM_LABEL_VALUE_VIDEO_FRAME_DELAY_AUTO,
+               frame_delay_auto,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_NONE
+               );
+         settings_data_list_current_add_flags(list, list_info, SD_FLAG_LAKKA_ADVANCED);
+
 #if !defined(RARCH_MOBILE)
          CONFIG_BOOL(
                list, list_info,
@@ -5530,6 +5547,21 @@ static bool setting_append_list(
                general_write_handler,
                general_read_handler,
                SD_FLAG_NONE);
+
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->playlist_binary_format,
+               MENU_ENUM_LABEL_PLAYLIST_BINARY_FORMAT,
+               MENU_ENUM_LABEL_VALUE_PLAYLIST_BINARY_FORMAT,
+               def_playlist_binary_format,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_NONE);
 		 
          END_SUB_GROUP(list, list_info, parent_group);
 		 
@@ -265,10 +265,7 @@ void menu_shader_manager_set_preset(void *data,
 
    /* Makes sure that we use Menu Preset shader on driver reinit.
     * Only do this when the cgp actually works to avoid potential errors. */
-   strlcpy(settings->path.shader,
-         preset_path ? preset_path : "",
-         sizeof(settings->path.shader));
-   settings->video.shader_enable = true;
+   video_driver_shader_save_when_applied(preset_path);
 
    if (!preset_path || !shader)
       return;
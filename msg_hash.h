@@ -296,6 +296,8 @@ enum msg_hash_enums
    MSG_VIEWPORT_SIZE_CALCULATION_FAILED,
    MSG_AUTOSAVE_FAILED,
    MSG_MOVIE_RECORD_STOPPED,
+   MSG_RECORD_REPLAY_SAVED,
+   MSG_RECORD_REPLAY_FAILED,
    MSG_MOVIE_PLAYBACK_ENDED,
    MSG_TAKING_SCREENSHOT,
    MSG_WIFI_SCAN_COMPLETE,
@@ -556,6 +558,7 @@ enum msg_hash_enums
    MENU_ENUM_LABEL_VALUE_INPUT_META_DISK_PREV,
    MENU_ENUM_LABEL_VALUE_INPUT_META_GRAB_MOUSE_TOGGLE,
    MENU_ENUM_LABEL_VALUE_INPUT_META_GAME_FOCUS_TOGGLE,
+   MENU_ENUM_LABEL_VALUE_INPUT_META_RECORD_REPLAY_SAVE,
    MENU_ENUM_LABEL_VALUE_INPUT_META_MENU_TOGGLE,
 
    MENU_ENUM_LABEL_VALUE_INPUT_DEVICE_INDEX,
@@ -600,6 +603,7 @@ enum msg_hash_enums
    MENU_LABEL(VIDEO_GPU_SCREENSHOT),
    MENU_LABEL(VIDEO_BLACK_FRAME_INSERTION),
    MENU_LABEL(VIDEO_FRAME_DELAY),
+   MENU_LABEL(VIDEO_FRAME_DELAY_AUTO),
    MENU_LABEL(VIDEO_VSYNC),
    MENU_LABEL(VIDEO_HARD_SYNC),
    MENU_LABEL(VIDEO_HARD_SYNC_FRAMES),
@@ -706,6 +710,7 @@ enum msg_hash_enums
    MENU_LABEL(HISTORY_LIST_ENABLE),
    MENU_LABEL(CONTENT_HISTORY_SIZE),
    MENU_LABEL(PLAYLIST_ENTRY_REMOVE),
+   MENU_LABEL(PLAYLIST_BINARY_FORMAT),
    MENU_LABEL(MENU_THROTTLE_FRAMERATE),
    MENU_LABEL(NO_ACHIEVEMENTS_TO_DISPLAY),
    MENU_LABEL(NO_ENTRIES_TO_DISPLAY),
@@ -1568,6 +1573,7 @@ enum msg_hash_enums
 
 #define CB_CORE_UPDATER_DOWNLOAD                                               0x7412da7dU
 #define CB_UPDATE_ASSETS                                                       0xbf85795eU
+#define CB_UPDATE_CORE_INFO_FILES                                              0xe6084091U
 
 /* Deferred */
 
@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -24,6 +25,12 @@
 #endif
 
 #include <compat/strl.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "performance_counters.h"
 
@@ -36,11 +43,71 @@
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %llu ticks, %llu runs.\n"
 #endif
 
+#define STARTUP_TRACE_MAX_SPANS 256
+
+/* Events kept by the trace ring buffer, a power of two. */
+#define PERF_TRACE_EVENTS      (1 << 16)
+/* Frames the per-frame statistics cover. */
+#define PERF_TRACE_FRAMES      256
+#define PERF_TRACE_COUNTERS    (MAX_COUNTERS * 2)
+#define PERF_TRACE_MAX_THREADS 32
+
+#if defined(__GNUC__)
+#define PERF_TRACE_ATOMIC
+#endif
+
+struct startup_trace_span
+{
+   const char *name;
+   retro_time_t start;
+   retro_time_t end;
+   uintptr_t thread;
+};
+
+struct perf_trace_event
+{
+   const char *name;
+   retro_time_t time;
+   uintptr_t thread;
+   enum perf_trace_phase phase;
+};
+
+struct perf_trace_thread
+{
+   uintptr_t thread;
+   unsigned depth;
+};
+
 static struct retro_perf_counter *perf_counters_rarch[MAX_COUNTERS];
 static struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 static unsigned perf_ptr_rarch;
 static unsigned perf_ptr_libretro;
 
+static struct startup_trace_span startup_trace_spans[STARTUP_TRACE_MAX_SPANS];
+static unsigned startup_trace_count;
+static retro_time_t startup_trace_origin;
+static bool startup_trace_done;
+static char *startup_trace_path;
+#ifdef HAVE_THREADS
+static slock_t *startup_trace_lock;
+#endif
+
+static struct perf_trace_event *perf_trace_events;
+static volatile uint32_t perf_trace_head;
+static volatile bool perf_trace_active;
+static bool perf_trace_perfcnt_was_enabled;
+static uintptr_t perf_trace_main_thread;
+static retro_time_t perf_trace_last_frame;
+static unsigned perf_trace_frame_count;
+static retro_time_t perf_trace_frame_times[PERF_TRACE_FRAMES];
+static retro_perf_tick_t (*perf_trace_counter_ticks)[PERF_TRACE_FRAMES];
+static retro_perf_tick_t perf_trace_counter_last[PERF_TRACE_COUNTERS];
+static char **perf_trace_names;
+static unsigned perf_trace_names_count;
+#if defined(HAVE_THREADS) && !defined(PERF_TRACE_ATOMIC)
+static slock_t *perf_trace_lock;
+#endif
+
 struct retro_perf_counter **retro_get_perf_counter_rarch(void)
 {
    return perf_counters_rarch;
@@ -83,10 +150,16 @@ void performance_counter_register(struct retro_perf_counter *perf)
    perf->registered = true;
 }
 
+static void perf_trace_retain_names(void);
+
 void performance_counters_clear(void)
 {
+   perf_trace_retain_names();
+
    perf_ptr_libretro = 0;
    memset(perf_counters_libretro, 0, sizeof(perf_counters_libretro));
+   memset(perf_trace_counter_last + MAX_COUNTERS, 0,
+         MAX_COUNTERS * sizeof(*perf_trace_counter_last));
 }
 
 static void log_counters(struct retro_perf_counter **counters, unsigned num)
@@ -173,3 +246,571 @@ void rarch_timer_begin(rarch_timer_t *timer, uint64_t sec)
    timer->timer_begin = true;
    timer->timer_end   = false;
 }
+
+static uintptr_t perf_thread_id(void)
+{
+#ifdef HAVE_THREADS
+   return sthread_get_current_thread_id();
+#else
+   return 0;
+#endif
+}
+
+int rarch_startup_trace_begin(const char *name)
+{
+   int span              = -1;
+   retro_time_t now      = cpu_features_get_time_usec();
+
+   /* The first span comes from the main thread, before
+    * anything else runs. */
+   if (!startup_trace_origin)
+   {
+      startup_trace_origin = now;
+#ifdef HAVE_THREADS
+      startup_trace_lock   = slock_new();
+#endif
+   }
+
+#ifdef HAVE_THREADS
+   slock_lock(startup_trace_lock);
+#endif
+   if (!startup_trace_done && startup_trace_count < STARTUP_TRACE_MAX_SPANS)
+   {
+      struct startup_trace_span *s = &startup_trace_spans[startup_trace_count];
+
+      s->name   = name;
+      s->start  = now;
+      s->end    = 0;
+      s->thread = perf_thread_id();
+      span      = (int)startup_trace_count++;
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(startup_trace_lock);
+#endif
+
+   return span;
+}
+
+void rarch_startup_trace_end(int span)
+{
+   if (span < 0)
+      return;
+
+#ifdef HAVE_THREADS
+   slock_lock(startup_trace_lock);
+#endif
+   if (!startup_trace_done)
+      startup_trace_spans[span].end = cpu_features_get_time_usec();
+#ifdef HAVE_THREADS
+   slock_unlock(startup_trace_lock);
+#endif
+}
+
+void rarch_startup_trace_set_path(const char *path)
+{
+   free(startup_trace_path);
+   startup_trace_path = string_is_empty(path) ? NULL : strdup(path);
+}
+
+/* Chrome trace event format, loads in chrome://tracing
+ * and Perfetto. */
+static void startup_trace_write(const char *path, retro_time_t now)
+{
+   unsigned i;
+   uintptr_t main_thread = startup_trace_spans[0].thread;
+   FILE *file            = fopen(path, "w");
+
+   if (!file)
+   {
+      RARCH_ERR("[Startup]: Could not write trace to %s.\n", path);
+      return;
+   }
+
+   fputs("{\"traceEvents\":[\n", file);
+
+   for (i = 0; i < startup_trace_count; i++)
+   {
+      const struct startup_trace_span *s = &startup_trace_spans[i];
+
+      if (!s->end)
+         continue;
+
+      fprintf(file,
+            "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\","
+            "\"pid\":1,\"tid\":%llu,\"ts\":%lld,\"dur\":%lld},\n",
+            s->name,
+            s->thread == main_thread ? 1ULL : (unsigned long long)s->thread,
+            (long long)(s->start - startup_trace_origin),
+            (long long)(s->end - s->start));
+   }
+
+   fprintf(file,
+         "{\"name\":\"first frame\",\"cat\":\"startup\",\"ph\":\"i\","
+         "\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":%lld}\n]}\n",
+         (long long)(now - startup_trace_origin));
+
+   fclose(file);
+
+   RARCH_LOG("[Startup]: Trace written to %s.\n", path);
+}
+
+void rarch_startup_trace_finish(void)
+{
+   unsigned i;
+   retro_time_t now = cpu_features_get_time_usec();
+
+   if (!startup_trace_origin || startup_trace_done)
+      return;
+
+#ifdef HAVE_THREADS
+   slock_lock(startup_trace_lock);
+#endif
+   startup_trace_done = true;
+#ifdef HAVE_THREADS
+   slock_unlock(startup_trace_lock);
+#endif
+
+   RARCH_LOG("[Startup]: First frame after %lld ms.\n",
+         (long long)((now - startup_trace_origin) / 1000));
+
+   for (i = 0; i < startup_trace_count; i++)
+   {
+      const struct startup_trace_span *s = &startup_trace_spans[i];
+
+      if (s->end)
+         RARCH_LOG("[Startup]: %s: %lld us.\n",
+               s->name, (long long)(s->end - s->start));
+   }
+
+   if (startup_trace_path)
+      startup_trace_write(startup_trace_path, now);
+
+   free(startup_trace_path);
+   startup_trace_path = NULL;
+}
+
+static uint32_t perf_trace_claim(void)
+{
+#if defined(PERF_TRACE_ATOMIC)
+   return __sync_fetch_and_add(&perf_trace_head, 1);
+#elif defined(HAVE_THREADS)
+   uint32_t slot;
+
+   slock_lock(perf_trace_lock);
+   slot = perf_trace_head++;
+   slock_unlock(perf_trace_lock);
+
+   return slot;
+#else
+   return perf_trace_head++;
+#endif
+}
+
+void rarch_perf_trace_event(const char *name, enum perf_trace_phase phase)
+{
+   struct perf_trace_event *e = NULL;
+
+   if (!perf_trace_active)
+      return;
+
+   e         = &perf_trace_events[perf_trace_claim() & (PERF_TRACE_EVENTS - 1)];
+   e->name   = name;
+   e->time   = cpu_features_get_time_usec();
+   e->thread = perf_thread_id();
+   e->phase  = phase;
+}
+
+static unsigned perf_trace_event_count(void)
+{
+   return MIN(perf_trace_head, PERF_TRACE_EVENTS);
+}
+
+static void perf_trace_free_names(void)
+{
+   unsigned i;
+
+   for (i = 0; i < perf_trace_names_count; i++)
+      free(perf_trace_names[i]);
+   free(perf_trace_names);
+
+   perf_trace_names       = NULL;
+   perf_trace_names_count = 0;
+}
+
+/* Core counter identifiers live in the core, events still in the
+ * ring buffer get copies before it is unloaded. */
+static void perf_trace_retain_names(void)
+{
+   unsigned i, j;
+   unsigned count = perf_trace_events ? perf_trace_event_count() : 0;
+
+   for (i = 0; i < perf_ptr_libretro; i++)
+   {
+      const char *ident = perf_counters_libretro[i]->ident;
+      char *copy        = NULL;
+
+      if (!ident)
+         continue;
+
+      for (j = 0; j < count; j++)
+      {
+         if (perf_trace_events[j].name != ident)
+            continue;
+
+         if (!copy)
+         {
+            char **names = (char**)realloc(perf_trace_names,
+                  (perf_trace_names_count + 1) * sizeof(*names));
+
+            if (!names)
+               break;
+
+            perf_trace_names = names;
+            copy             = strdup(ident);
+
+            if (!copy)
+               break;
+
+            perf_trace_names[perf_trace_names_count++] = copy;
+         }
+
+         perf_trace_events[j].name = copy;
+      }
+
+      /* Out of memory, the identifier must not be used anymore. */
+      if (!copy)
+         for (j = 0; j < count; j++)
+            if (perf_trace_events[j].name == ident)
+               perf_trace_events[j].name = "core";
+   }
+}
+
+static struct retro_perf_counter *perf_trace_counter(unsigned i)
+{
+   if (i < MAX_COUNTERS)
+      return i < perf_ptr_rarch ? perf_counters_rarch[i] : NULL;
+
+   i -= MAX_COUNTERS;
+   return i < perf_ptr_libretro ? perf_counters_libretro[i] : NULL;
+}
+
+static void perf_trace_counters_snapshot(void)
+{
+   unsigned i;
+
+   for (i = 0; i < PERF_TRACE_COUNTERS; i++)
+   {
+      const struct retro_perf_counter *perf = perf_trace_counter(i);
+      perf_trace_counter_last[i]            = perf ? perf->total : 0;
+   }
+}
+
+bool rarch_perf_trace_start(void)
+{
+   if (perf_trace_active)
+      return true;
+
+   if (!perf_trace_events)
+   {
+      perf_trace_events        = (struct perf_trace_event*)
+         calloc(PERF_TRACE_EVENTS, sizeof(*perf_trace_events));
+      perf_trace_counter_ticks = (retro_perf_tick_t(*)[PERF_TRACE_FRAMES])
+         calloc(PERF_TRACE_COUNTERS, sizeof(*perf_trace_counter_ticks));
+
+      if (!perf_trace_events || !perf_trace_counter_ticks)
+      {
+         rarch_perf_trace_deinit();
+         return false;
+      }
+   }
+
+#if defined(HAVE_THREADS) && !defined(PERF_TRACE_ATOMIC)
+   if (!perf_trace_lock)
+      perf_trace_lock = slock_new();
+#endif
+
+   perf_trace_free_names();
+   perf_trace_counters_snapshot();
+
+   perf_trace_head                = 0;
+   perf_trace_frame_count         = 0;
+   perf_trace_last_frame          = 0;
+   perf_trace_main_thread         = perf_thread_id();
+   perf_trace_perfcnt_was_enabled =
+      runloop_ctl(RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL);
+
+   /* Counters only tick while enabled. */
+   runloop_ctl(RUNLOOP_CTL_SET_PERFCNT_ENABLE, NULL);
+
+   perf_trace_active              = true;
+
+   RARCH_LOG("[PERF]: Tracing started.\n");
+   return true;
+}
+
+void rarch_perf_trace_stop(void)
+{
+   if (!perf_trace_active)
+      return;
+
+   perf_trace_active = false;
+
+   if (!perf_trace_perfcnt_was_enabled)
+      runloop_ctl(RUNLOOP_CTL_UNSET_PERFCNT_ENABLE, NULL);
+
+   RARCH_LOG("[PERF]: Tracing stopped.\n");
+}
+
+bool rarch_perf_trace_is_active(void)
+{
+   return perf_trace_active;
+}
+
+void rarch_perf_trace_frame(void)
+{
+   unsigned i, slot;
+   retro_time_t now;
+
+   if (!perf_trace_active)
+      return;
+
+   now = cpu_features_get_time_usec();
+   rarch_perf_trace_event("frame", PERF_TRACE_INSTANT);
+
+   if (!perf_trace_last_frame)
+   {
+      perf_trace_counters_snapshot();
+      perf_trace_last_frame = now;
+      return;
+   }
+
+   slot                         = perf_trace_frame_count++ % PERF_TRACE_FRAMES;
+   perf_trace_frame_times[slot] = now - perf_trace_last_frame;
+   perf_trace_last_frame        = now;
+
+   for (i = 0; i < PERF_TRACE_COUNTERS; i++)
+   {
+      const struct retro_perf_counter *perf = perf_trace_counter(i);
+      retro_perf_tick_t total               = perf ? perf->total : 0;
+
+      perf_trace_counter_ticks[i][slot] = total >= perf_trace_counter_last[i]
+         ? total - perf_trace_counter_last[i] : 0;
+      perf_trace_counter_last[i]        = total;
+   }
+}
+
+static struct perf_trace_thread *perf_trace_find_thread(
+      struct perf_trace_thread *threads, unsigned *count, uintptr_t thread)
+{
+   unsigned i;
+
+   for (i = 0; i < *count; i++)
+      if (threads[i].thread == thread)
+         return &threads[i];
+
+   if (*count >= PERF_TRACE_MAX_THREADS)
+      return NULL;
+
+   threads[*count].thread = thread;
+   threads[*count].depth  = 0;
+
+   return &threads[(*count)++];
+}
+
+/* Writes @s as a JSON string, counter names come from the core. */
+static void perf_trace_write_string(FILE *file, const char *s)
+{
+   fputc('"', file);
+
+   for (; *s; s++)
+   {
+      unsigned char c = (unsigned char)*s;
+
+      if (c == '"' || c == '\\')
+         fprintf(file, "\\%c", c);
+      else if (c < 0x20)
+         fprintf(file, "\\u%04x", c);
+      else
+         fputc(c, file);
+   }
+
+   fputc('"', file);
+}
+
+bool rarch_perf_trace_write(const char *path)
+{
+   uint32_t i, first, last;
+   retro_time_t origin;
+   struct perf_trace_thread threads[PERF_TRACE_MAX_THREADS];
+   unsigned thread_count = 0;
+   bool was_active       = perf_trace_active;
+   FILE *file            = NULL;
+
+   if (!perf_trace_events || !perf_trace_head)
+      return false;
+
+   file = fopen(path, "w");
+
+   if (!file)
+   {
+      RARCH_ERR("[PERF]: Could not write trace to %s.\n", path);
+      return false;
+   }
+
+   /* Pause recording, or the oldest events are overwritten
+    * while they are being written out. */
+   perf_trace_active = false;
+
+   last   = perf_trace_head;
+   first  = last - perf_trace_event_count();
+   origin = perf_trace_events[first & (PERF_TRACE_EVENTS - 1)].time;
+
+   fprintf(file, "{\"traceEvents\":[\n"
+         "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+         "\"args\":{\"name\":\"main\"}}");
+
+   for (i = first; i != last; i++)
+   {
+      const struct perf_trace_event *e =
+         &perf_trace_events[i & (PERF_TRACE_EVENTS - 1)];
+      struct perf_trace_thread *thread = perf_trace_find_thread(
+            threads, &thread_count, e->thread);
+      char phase                       = 'i';
+
+      switch (e->phase)
+      {
+         case PERF_TRACE_BEGIN:
+            phase = 'B';
+            if (thread)
+               thread->depth++;
+            break;
+         case PERF_TRACE_END:
+            /* Its begin was overwritten already. */
+            if (thread && !thread->depth)
+               continue;
+            phase = 'E';
+            if (thread)
+               thread->depth--;
+            break;
+         default:
+            break;
+      }
+
+      fputs(",\n{\"name\":", file);
+      perf_trace_write_string(file, e->name ? e->name : "");
+      fprintf(file,
+            ",\"cat\":\"perf\",\"ph\":\"%c\","
+            "\"pid\":1,\"tid\":%llu,\"ts\":%lld%s}",
+            phase,
+            e->thread == perf_trace_main_thread
+            ? 1ULL : (unsigned long long)e->thread,
+            (long long)(e->time - origin),
+            phase == 'i' ? ",\"s\":\"p\"" : "");
+   }
+
+   fputs("\n]}\n", file);
+   fclose(file);
+
+   perf_trace_active = was_active;
+
+   RARCH_LOG("[PERF]: Trace of %u events written to %s.\n",
+         (unsigned)(last - first), path);
+   return true;
+}
+
+static int perf_trace_compare(const void *a, const void *b)
+{
+   retro_perf_tick_t x = *(const retro_perf_tick_t*)a;
+   retro_perf_tick_t y = *(const retro_perf_tick_t*)b;
+
+   return x < y ? -1 : x > y;
+}
+
+/* Sorts @samples, returns p50, p99 and the maximum. */
+static void perf_trace_percentiles(retro_perf_tick_t *samples,
+      unsigned count, retro_perf_tick_t *out)
+{
+   qsort(samples, count, sizeof(*samples), perf_trace_compare);
+
+   out[0] = samples[count / 2];
+   out[1] = samples[(count * 99) / 100];
+   out[2] = samples[count - 1];
+}
+
+void rarch_perf_trace_stats(char *s, size_t len)
+{
+   unsigned i, j;
+   int n;
+   retro_perf_tick_t samples[PERF_TRACE_FRAMES];
+   retro_perf_tick_t p[3];
+   size_t pos      = 0;
+   unsigned frames = MIN(perf_trace_frame_count, PERF_TRACE_FRAMES);
+
+   if (!len)
+      return;
+
+   if (!perf_trace_counter_ticks || !frames)
+   {
+      strlcpy(s, "frames=0\n", len);
+      return;
+   }
+
+   for (i = 0; i < frames; i++)
+      samples[i] = (retro_perf_tick_t)perf_trace_frame_times[i];
+   perf_trace_percentiles(samples, frames, p);
+
+   n = snprintf(s, len, "frames=%u\nframe p50=%llu p99=%llu max=%llu usec\n",
+         frames, (unsigned long long)p[0], (unsigned long long)p[1],
+         (unsigned long long)p[2]);
+
+   if (n < 0 || (size_t)n >= len)
+      return;
+   pos = n;
+
+   for (i = 0; i < PERF_TRACE_COUNTERS; i++)
+   {
+      const struct retro_perf_counter *perf = perf_trace_counter(i);
+
+      if (!perf || !perf->ident)
+         continue;
+
+      for (j = 0; j < frames; j++)
+         samples[j] = perf_trace_counter_ticks[i][j];
+      perf_trace_percentiles(samples, frames, p);
+
+      if (!p[2])
+         continue;
+
+      n = snprintf(s + pos, len - pos, "%s p50=%llu p99=%llu max=%llu ticks\n",
+            perf->ident, (unsigned long long)p[0], (unsigned long long)p[1],
+            (unsigned long long)p[2]);
+
+      /* Leave out what does not fit. */
+      if (n < 0 || pos + n >= len)
+      {
+         s[pos] = '\0';
+         break;
+      }
+      pos += n;
+   }
+}
+
+void rarch_perf_trace_deinit(void)
+{
+   rarch_perf_trace_stop();
+
+   free(perf_trace_events);
+   free(perf_trace_counter_ticks);
+   perf_trace_free_names();
+
+   perf_trace_events        = NULL;
+   perf_trace_counter_ticks = NULL;
+   perf_trace_head          = 0;
+   perf_trace_frame_count   = 0;
+
+#if defined(HAVE_THREADS) && !defined(PERF_TRACE_ATOMIC)
+   if (perf_trace_lock)
+      slock_free(perf_trace_lock);
+   perf_trace_lock = NULL;
+#endif
+}
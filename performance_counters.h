@@ -17,6 +17,7 @@
 #ifndef _PERFORMANCE_COUNTERS_H
 #define _PERFORMANCE_COUNTERS_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <boolean.h>
 
@@ -57,6 +58,66 @@ void rarch_perf_log(void);
 
 void rarch_perf_register(struct retro_perf_counter *perf);
 
+enum perf_trace_phase
+{
+   PERF_TRACE_BEGIN = 0,
+   PERF_TRACE_END,
+   PERF_TRACE_INSTANT
+};
+
+/**
+ * rarch_perf_trace_event:
+ * @name               : identifier of the counter, must stay valid
+ *                       while tracing (core counters are copied
+ *                       when the core is unloaded).
+ * @phase              : begin or end of the counted section.
+ *
+ * Records an event with the current time and thread into the trace
+ * ring buffer. Does nothing unless tracing was started with
+ * rarch_perf_trace_start(). Can be called from any thread.
+ **/
+void rarch_perf_trace_event(const char *name, enum perf_trace_phase phase);
+
+/* Enables performance counters and starts recording events
+ * and per-frame statistics. Call from the main thread. */
+bool rarch_perf_trace_start(void);
+
+void rarch_perf_trace_stop(void);
+
+bool rarch_perf_trace_is_active(void);
+
+/**
+ * rarch_perf_trace_frame:
+ *
+ * Marks the end of a frame. Samples the frame time and the time
+ * every counter spent during the frame.
+ **/
+void rarch_perf_trace_frame(void);
+
+/**
+ * rarch_perf_trace_write:
+ * @path               : file to write.
+ *
+ * Writes the events currently in the ring buffer in Chrome trace
+ * JSON, which loads in chrome://tracing and Perfetto.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool rarch_perf_trace_write(const char *path);
+
+/**
+ * rarch_perf_trace_stats:
+ * @s                  : output text, one line per counter.
+ * @len                : size of @s.
+ *
+ * Formats p50, p99 and maximum of the frame time (in microseconds)
+ * and of the time every counter spent per frame (in ticks) over
+ * the last frames.
+ **/
+void rarch_perf_trace_stats(char *s, size_t len);
+
+void rarch_perf_trace_deinit(void);
+
 #define performance_counter_init(perf, name) \
    perf.ident = name; \
    if (!perf.registered) \
@@ -66,12 +127,19 @@ void rarch_perf_register(struct retro_perf_counter *perf);
    if ((is_perfcnt_enable)) \
    { \
       perf.call_cnt++; \
+      rarch_perf_trace_event(perf.ident, PERF_TRACE_BEGIN); \
       perf.start = cpu_features_get_perf_counter(); \
    }
 
+/* Counters can be enabled between start and stop, such a
+ * section has no start time and is not counted. */
 #define performance_counter_stop_internal(is_perfcnt_enable, perf) \
-   if ((is_perfcnt_enable)) \
-      perf.total += cpu_features_get_perf_counter() - perf.start
+   if ((is_perfcnt_enable) && perf.start) \
+   { \
+      perf.total += cpu_features_get_perf_counter() - perf.start; \
+      perf.start  = 0; \
+      rarch_perf_trace_event(perf.ident, PERF_TRACE_END); \
+   }
 
 /**
  * performance_counter_start:
@@ -89,6 +157,27 @@ void rarch_perf_register(struct retro_perf_counter *perf);
  **/
 #define performance_counter_stop_plus(is_perfcnt_enable, perf) performance_counter_stop_internal(is_perfcnt_enable, perf)
 
+/**
+ * rarch_startup_trace_begin:
+ * @name               : static string naming the step.
+ *
+ * Starts a span of the startup trace, which covers process start
+ * up to the first presented frame. Can be called from any thread.
+ *
+ * Returns: the span to pass to rarch_startup_trace_end(), or -1
+ * once startup is over.
+ **/
+int rarch_startup_trace_begin(const char *name);
+
+void rarch_startup_trace_end(int span);
+
+/* Where rarch_startup_trace_finish() writes the trace,
+ * in Chrome trace JSON. */
+void rarch_startup_trace_set_path(const char *path);
+
+/* Ends startup, logs the spans and writes the trace. */
+void rarch_startup_trace_finish(void);
+
 void rarch_timer_tick(rarch_timer_t *timer);
 
 bool rarch_timer_is_running(rarch_timer_t *timer);
@@ -20,6 +20,8 @@
 
 #include <boolean.h>
 #include <compat/posix_string.h>
+#include <retro_endianness.h>
+#include <rhash.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
 #include <file/file_path.h>
@@ -31,10 +33,217 @@
 #define PLAYLIST_ENTRIES 6
 #endif
 
+/* Binary playlist layout, all values little endian:
+ *
+ * header   : magic, version, entry count, string arena size
+ * entries  : PLAYLIST_ENTRIES arena offsets per entry, in the
+ *            same order as the text format's lines;
+ *            PLAYLIST_BIN_NULL for an absent field
+ * arena    : NUL-terminated strings
+ */
+#define PLAYLIST_BIN_MAGIC   0x424c5052 /* "RPLB" */
+#define PLAYLIST_BIN_VERSION 1
+#define PLAYLIST_BIN_NULL    0xffffffff
+
+struct playlist_bin_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t count;
+   uint32_t arena_size;
+};
+
 typedef int (playlist_sort_fun_t)(
       const struct playlist_entry *a,
       const struct playlist_entry *b);
 
+static bool playlist_string_in_arena(playlist_t *playlist, const char *s)
+{
+   return playlist->arena && s >= playlist->arena &&
+      s < playlist->arena + playlist->arena_size;
+}
+
+static void playlist_free_string(playlist_t *playlist, char *s)
+{
+   if (s && !playlist_string_in_arena(playlist, s))
+      free(s);
+}
+
+static void playlist_index_insert(size_t *index, size_t cap,
+      const char *key, size_t idx)
+{
+   size_t slot = djb2_calculate(key) & (cap - 1);
+
+   while (index[slot])
+      slot = (slot + 1) & (cap - 1);
+
+   index[slot] = idx + 1;
+}
+
+static const char *playlist_index_key(
+      const struct playlist_entry *entry, bool crc32)
+{
+   return crc32 ? entry->crc32 : entry->path;
+}
+
+/* Backward-shift deletion: later slots of the probe run that
+ * could have lived in the freed slot are moved up into it, so
+ * lookups never stop early at the hole. */
+static void playlist_index_remove(playlist_t *playlist,
+      size_t *index, bool crc32, size_t idx)
+{
+   size_t mask     = playlist->index_cap - 1;
+   const char *key = playlist_index_key(&playlist->entries[idx], crc32);
+   size_t slot, next;
+
+   if (!key)
+      return;
+
+   slot = djb2_calculate(key) & mask;
+
+   while (index[slot] && index[slot] != idx + 1)
+      slot = (slot + 1) & mask;
+
+   if (!index[slot])
+      return;
+
+   index[slot] = 0;
+
+   for (next = (slot + 1) & mask; index[next]; next = (next + 1) & mask)
+   {
+      size_t home = djb2_calculate(playlist_index_key(
+               &playlist->entries[index[next] - 1], crc32)) & mask;
+
+      /* Leave the slot alone if its home lies cyclically
+       * within (slot, next]. */
+      if (slot <= next
+            ? (home > slot && home <= next)
+            : (home > slot || home <= next))
+         continue;
+
+      index[slot] = index[next];
+      index[next] = 0;
+      slot        = next;
+   }
+}
+
+/* Entry @moved goes to the top of the playlist and every entry
+ * above it moves down by one. Pass the playlist size for a new
+ * entry. Keys are untouched, so no slot changes place. */
+static void playlist_index_shift(size_t *index, size_t cap, size_t moved)
+{
+   size_t slot;
+
+   for (slot = 0; slot < cap; slot++)
+   {
+      if (!index[slot])
+         continue;
+
+      if (index[slot] - 1 < moved)
+         index[slot]++;
+      else if (index[slot] - 1 == moved)
+         index[slot] = 1;
+   }
+}
+
+static bool playlist_index_build(playlist_t *playlist)
+{
+   size_t i;
+   size_t cap = 16;
+
+   if (playlist->index_valid)
+      return true;
+
+   /* Keep the load factor at or below one half. */
+   while (cap < playlist->size * 2)
+      cap <<= 1;
+
+   if (cap != playlist->index_cap)
+   {
+      free(playlist->path_index);
+      free(playlist->crc32_index);
+      playlist->path_index  = (size_t*)malloc(cap * sizeof(size_t));
+      playlist->crc32_index = (size_t*)malloc(cap * sizeof(size_t));
+      playlist->index_cap   = cap;
+
+      if (!playlist->path_index || !playlist->crc32_index)
+      {
+         free(playlist->path_index);
+         free(playlist->crc32_index);
+         playlist->path_index  = NULL;
+         playlist->crc32_index = NULL;
+         playlist->index_cap   = 0;
+         return false;
+      }
+   }
+
+   memset(playlist->path_index,  0, cap * sizeof(size_t));
+   memset(playlist->crc32_index, 0, cap * sizeof(size_t));
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+
+      if (entry->path)
+         playlist_index_insert(playlist->path_index, cap, entry->path, i);
+      if (entry->crc32)
+         playlist_index_insert(playlist->crc32_index, cap, entry->crc32, i);
+   }
+
+   playlist->index_valid = true;
+   return true;
+}
+
+/**
+ * playlist_find_path:
+ * @playlist            : Playlist handle.
+ * @path                : Entry path to look up.
+ * @core_path           : Core path the entry must also match, or NULL.
+ *
+ * Returns: index of the first matching entry, or the
+ * playlist size if there is none.
+ **/
+static size_t playlist_find_path(playlist_t *playlist,
+      const char *path, const char *core_path)
+{
+   size_t i, slot;
+   size_t found = playlist->size;
+
+   if (!path)
+      return playlist->size;
+
+   if (!playlist_index_build(playlist))
+   {
+      for (i = 0; i < playlist->size; i++)
+      {
+         const struct playlist_entry *entry = &playlist->entries[i];
+
+         if (string_is_equal(entry->path, path) && (!core_path
+                  || string_is_equal(entry->core_path, core_path)))
+            return i;
+      }
+      return playlist->size;
+   }
+
+   slot = djb2_calculate(path) & (playlist->index_cap - 1);
+
+   /* Pushes update the index in place, so matches are not in
+    * playlist order along the probe run; keep the lowest. */
+   while (playlist->path_index[slot])
+   {
+      i = playlist->path_index[slot] - 1;
+
+      if (i < found && string_is_equal(playlist->entries[i].path, path)
+            && (!core_path || string_is_equal(
+                  playlist->entries[i].core_path, core_path)))
+         found = i;
+
+      slot = (slot + 1) & (playlist->index_cap - 1);
+   }
+
+   return found;
+}
+
 /**
  * playlist_get_index:
  * @playlist            : Playlist handle.
@@ -85,7 +294,8 @@ void playlist_delete_index(playlist_t *playlist,
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
          (playlist->size - idx) * sizeof(struct playlist_entry));
 
-   playlist->size = playlist->size - 1;
+   playlist->size        = playlist->size - 1;
+   playlist->index_valid = false;
 
    playlist_write_file(playlist);
 }
@@ -101,11 +311,10 @@ void playlist_get_index_by_path(playlist_t *playlist,
    if (!playlist)
       return;
 
-   for (i = 0; i < playlist->size; i++)
-   {
-      if (!string_is_equal(playlist->entries[i].path, search_path))
-         continue;
+   i = playlist_find_path(playlist, search_path, NULL);
 
+   if (i < playlist->size)
+   {
       if (path)
          *path      = playlist->entries[i].path;
       if (label)
@@ -118,7 +327,6 @@ void playlist_get_index_by_path(playlist_t *playlist,
          *db_name   = playlist->entries[i].db_name;
       if (crc32)
          *crc32     = playlist->entries[i].crc32;
-      break;
    }
 }
 
@@ -126,50 +334,83 @@ bool playlist_entry_exists(playlist_t *playlist,
       const char *path,
       const char *crc32)
 {
-   size_t i;
    if (!playlist)
       return false;
 
-   for (i = 0; i < playlist->size; i++)
-      if (string_is_equal(playlist->entries[i].path, path))
-         return true;
+   return playlist_find_path(playlist, path, NULL) < playlist->size;
+}
+
+bool playlist_get_index_by_crc32(playlist_t *playlist,
+      const char *crc32, size_t *idx)
+{
+   size_t i, slot;
+   size_t found;
+
+   if (!playlist || string_is_empty(crc32))
+      return false;
+
+   if (!playlist_index_build(playlist))
+   {
+      for (i = 0; i < playlist->size; i++)
+      {
+         if (string_is_equal(playlist->entries[i].crc32, crc32))
+         {
+            *idx = i;
+            return true;
+         }
+      }
+      return false;
+   }
+
+   found = playlist->size;
+   slot  = djb2_calculate(crc32) & (playlist->index_cap - 1);
+
+   while (playlist->crc32_index[slot])
+   {
+      i = playlist->crc32_index[slot] - 1;
 
-   return false;
+      if (i < found && string_is_equal(playlist->entries[i].crc32, crc32))
+         found = i;
+
+      slot = (slot + 1) & (playlist->index_cap - 1);
+   }
+
+   if (found == playlist->size)
+      return false;
+
+   *idx = found;
+   return true;
 }
 
 /**
  * playlist_free_entry:
+ * @playlist            : Playlist handle.
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
-   if (!string_is_empty(entry->path))
-      free(entry->path);
+   playlist_free_string(playlist, entry->path);
    entry->path      = NULL;
 
-   if (!string_is_empty(entry->label))
-      free(entry->label);
+   playlist_free_string(playlist, entry->label);
    entry->label     = NULL;
 
-   if (!string_is_empty(entry->core_path))
-      free(entry->core_path);
+   playlist_free_string(playlist, entry->core_path);
    entry->core_path = NULL;
 
-   if (!string_is_empty(entry->core_name))
-      free(entry->core_name);
+   playlist_free_string(playlist, entry->core_name);
    entry->core_name = NULL;
 
-   if (!string_is_empty(entry->db_name))
-      free(entry->db_name);
+   playlist_free_string(playlist, entry->db_name);
    entry->db_name   = NULL;
 
-   if (!string_is_empty(entry->crc32))
-      free(entry->crc32);
+   playlist_free_string(playlist, entry->crc32);
    entry->crc32     = NULL;
 }
 
@@ -184,41 +425,42 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (!playlist || idx > playlist->size)
       return;
 
-   entry            = &playlist->entries[idx];
+   entry                 = &playlist->entries[idx];
+   playlist->index_valid = false;
 
    if (path && (path != entry->path))
    {
-      free(entry->path);
+      playlist_free_string(playlist, entry->path);
       entry->path = strdup(path);
    }
 
    if (label && (label != entry->label))
    {
-      free(entry->label);
+      playlist_free_string(playlist, entry->label);
       entry->label = strdup(label);
    }
 
    if (core_path && (core_path != entry->core_path))
    {
-      free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
       entry->core_path = strdup(core_path);
    }
 
    if (core_name && (core_name != entry->core_name))
    {
-      free(entry->core_name);
+      playlist_free_string(playlist, entry->core_name);
       entry->core_name = strdup(core_name);
    }
 
    if (db_name && (db_name != entry->db_name))
    {
-      free(entry->db_name);
+      playlist_free_string(playlist, entry->db_name);
       entry->db_name = strdup(db_name);
    }
 
    if (crc32 && (crc32 != entry->crc32))
    {
-      free(entry->crc32);
+      playlist_free_string(playlist, entry->crc32);
       entry->crc32 = strdup(crc32);
    }
 }
@@ -266,20 +508,21 @@ bool playlist_push(playlist_t *playlist,
    if (!playlist)
       return false;
 
-   for (i = 0; i < playlist->size; i++)
+   /* Core name can have changed while still being the same core.
+    * Differentiate based on the core path only. */
+   if (path)
+      i = playlist_find_path(playlist, path, core_path);
+   else
    {
-      struct playlist_entry tmp;
-      bool equal_path = (!path && !playlist->entries[i].path) ||
-         (path && playlist->entries[i].path &&
-          string_is_equal(path,playlist->entries[i].path));
-
-      /* Core name can have changed while still being the same core.
-       * Differentiate based on the core path only. */
-      if (!equal_path)
-         continue;
+      for (i = 0; i < playlist->size; i++)
+         if (!playlist->entries[i].path &&
+               string_is_equal(playlist->entries[i].core_path, core_path))
+            break;
+   }
 
-      if (!string_is_equal(playlist->entries[i].core_path, core_path))
-         continue;
+   if (i < playlist->size)
+   {
+      struct playlist_entry tmp;
 
       /* If top entry, we don't want to push a new entry since
        * the top and the entry to be pushed are the same. */
@@ -292,6 +535,14 @@ bool playlist_push(playlist_t *playlist,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
 
+      if (playlist->index_valid)
+      {
+         playlist_index_shift(playlist->path_index,
+               playlist->index_cap, i);
+         playlist_index_shift(playlist->crc32_index,
+               playlist->index_cap, i);
+      }
+
       return true;
    }
 
@@ -299,8 +550,16 @@ bool playlist_push(playlist_t *playlist,
    {
       struct playlist_entry *entry = &playlist->entries[playlist->cap - 1];
 
+      if (playlist->index_valid)
+      {
+         playlist_index_remove(playlist, playlist->path_index,
+               false, playlist->cap - 1);
+         playlist_index_remove(playlist, playlist->crc32_index,
+               true, playlist->cap - 1);
+      }
+
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
       playlist->size--;
    }
 
@@ -326,11 +585,109 @@ bool playlist_push(playlist_t *playlist,
    if (!string_is_empty(crc32))
       playlist->entries[0].crc32     = strdup(crc32);
 
+   /* Grow by rebuilding on the next lookup once the load factor
+    * would pass one half, otherwise index the new entry now. */
+   if (playlist->index_valid
+         && (playlist->size + 1) * 2 > playlist->index_cap)
+      playlist->index_valid = false;
+   else if (playlist->index_valid)
+   {
+      playlist_index_shift(playlist->path_index,
+            playlist->index_cap, playlist->size);
+      playlist_index_shift(playlist->crc32_index,
+            playlist->index_cap, playlist->size);
+
+      if (playlist->entries[0].path)
+         playlist_index_insert(playlist->path_index,
+               playlist->index_cap, playlist->entries[0].path, 0);
+      if (playlist->entries[0].crc32)
+         playlist_index_insert(playlist->crc32_index,
+               playlist->index_cap, playlist->entries[0].crc32, 0);
+   }
+
    playlist->size++;
 
    return true;
 }
 
+static bool playlist_write_file_binary(playlist_t *playlist)
+{
+   size_t i, j;
+   struct playlist_bin_header header;
+   size_t arena_size    = 0;
+   size_t table_size    = playlist->size * PLAYLIST_ENTRIES * sizeof(uint32_t);
+   uint8_t *buf         = NULL;
+   uint32_t *table      = NULL;
+   char *arena          = NULL;
+   bool ret             = false;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+      const char *fields[PLAYLIST_ENTRIES];
+
+      fields[0] = entry->path;
+      fields[1] = entry->label;
+      fields[2] = entry->core_path;
+      fields[3] = entry->core_name;
+      fields[4] = entry->crc32;
+      fields[5] = entry->db_name;
+
+      for (j = 0; j < PLAYLIST_ENTRIES; j++)
+         if (fields[j])
+            arena_size += strlen(fields[j]) + 1;
+   }
+
+   buf = (uint8_t*)malloc(sizeof(header) + table_size + arena_size);
+   if (!buf)
+      return false;
+
+   table      = (uint32_t*)(buf + sizeof(header));
+   arena      = (char*)buf + sizeof(header) + table_size;
+   arena_size = 0;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+      const char *fields[PLAYLIST_ENTRIES];
+
+      fields[0] = entry->path;
+      fields[1] = entry->label;
+      fields[2] = entry->core_path;
+      fields[3] = entry->core_name;
+      fields[4] = entry->crc32;
+      fields[5] = entry->db_name;
+
+      for (j = 0; j < PLAYLIST_ENTRIES; j++)
+      {
+         size_t len;
+
+         if (!fields[j])
+         {
+            *table++ = swap_if_big32(PLAYLIST_BIN_NULL);
+            continue;
+         }
+
+         len = strlen(fields[j]) + 1;
+         memcpy(arena + arena_size, fields[j], len);
+         *table++    = swap_if_big32((uint32_t)arena_size);
+         arena_size += len;
+      }
+   }
+
+   header.magic      = swap_if_big32(PLAYLIST_BIN_MAGIC);
+   header.version    = swap_if_big32(PLAYLIST_BIN_VERSION);
+   header.count      = swap_if_big32((uint32_t)playlist->size);
+   header.arena_size = swap_if_big32((uint32_t)arena_size);
+   memcpy(buf, &header, sizeof(header));
+
+   ret = filestream_write_file(playlist->conf_path, buf,
+         sizeof(header) + table_size + arena_size);
+
+   free(buf);
+   return ret;
+}
+
 void playlist_write_file(playlist_t *playlist)
 {
    size_t i;
@@ -339,6 +696,15 @@ void playlist_write_file(playlist_t *playlist)
    if (!playlist)
       return;
 
+   if (playlist->binary)
+   {
+      RARCH_LOG("Trying to write to playlist file: %s\n", playlist->conf_path);
+
+      if (!playlist_write_file_binary(playlist))
+         RARCH_ERR("Failed to write to playlist file: %s\n", playlist->conf_path);
+      return;
+   }
+
    file = fopen(playlist->conf_path, "w");
 
    RARCH_LOG("Trying to write to playlist file: %s\n", playlist->conf_path);
@@ -385,12 +751,16 @@ void playlist_free(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
 
    free(playlist->entries);
    playlist->entries = NULL;
 
+   free(playlist->path_index);
+   free(playlist->crc32_index);
+   free(playlist->arena);
+
    free(playlist);
 }
 
@@ -411,9 +781,10 @@ void playlist_clear(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
-   playlist->size = 0;
+   playlist->size        = 0;
+   playlist->index_valid = false;
 }
 
 /**
@@ -431,65 +802,150 @@ size_t playlist_size(playlist_t *playlist)
 }
 
 
-static bool playlist_read_file(
-      playlist_t *playlist, const char *path)
+static char *playlist_arena_field(char *arena, size_t arena_size,
+      uint32_t offset)
 {
-   unsigned i;
-   char buf[PLAYLIST_ENTRIES][1024];
-   RFILE *file                      = filestream_open(
-         path, RFILE_MODE_READ_TEXT, -1);
+   offset = swap_if_big32(offset);
 
-   for (i = 0; i < PLAYLIST_ENTRIES; i++)
-      buf[i][0] = '\0';
+   if (offset == PLAYLIST_BIN_NULL || offset >= arena_size)
+      return NULL;
+   return arena + offset;
+}
 
-   /* If playlist file does not exist,
-    * create an empty playlist instead.
-    */
-   if (!file)
-      return true;
+static bool playlist_read_file_binary(playlist_t *playlist,
+      char *buf, size_t len)
+{
+   size_t i, table_size;
+   struct playlist_bin_header header;
+   const uint32_t *table = NULL;
+   char *arena           = NULL;
+
+   if (len < sizeof(header))
+      return false;
+
+   memcpy(&header, buf, sizeof(header));
+   header.version    = swap_if_big32(header.version);
+   header.count      = swap_if_big32(header.count);
+   header.arena_size = swap_if_big32(header.arena_size);
+
+   if (header.version != PLAYLIST_BIN_VERSION)
+      return false;
+
+   table_size = (size_t)header.count * PLAYLIST_ENTRIES * sizeof(uint32_t);
+   if (len != sizeof(header) + table_size + header.arena_size)
+      return false;
+
+   table = (const uint32_t*)(buf + sizeof(header));
+   arena = buf + sizeof(header) + table_size;
+
+   /* Every string must be terminated inside the arena. */
+   if (header.arena_size && arena[header.arena_size - 1] != '\0')
+      return false;
+
+   for (i = 0; i < header.count && playlist->size < playlist->cap; i++)
+   {
+      const uint32_t *fields       = table + i * PLAYLIST_ENTRIES;
+      struct playlist_entry *entry = &playlist->entries[playlist->size];
+
+      entry->path      = playlist_arena_field(arena, header.arena_size, fields[0]);
+      entry->label     = playlist_arena_field(arena, header.arena_size, fields[1]);
+      entry->core_path = playlist_arena_field(arena, header.arena_size, fields[2]);
+      entry->core_name = playlist_arena_field(arena, header.arena_size, fields[3]);
+      entry->crc32     = playlist_arena_field(arena, header.arena_size, fields[4]);
+      entry->db_name   = playlist_arena_field(arena, header.arena_size, fields[5]);
+      playlist->size++;
+   }
+
+   return true;
+}
+
+static void playlist_read_file_text(playlist_t *playlist, char *buf)
+{
+   char *ptr = buf;
 
    for (playlist->size = 0; playlist->size < playlist->cap; )
    {
       unsigned i;
-      struct playlist_entry *entry     = NULL;
+      char *lines[PLAYLIST_ENTRIES];
+      struct playlist_entry *entry = NULL;
+
+      /* Split the next entry's lines in place. */
       for (i = 0; i < PLAYLIST_ENTRIES; i++)
       {
-         char *last  = NULL;
-         *buf[i]     = '\0';
-
-         if (!filestream_gets(file, buf[i], sizeof(buf[i])))
-            goto end;
-
-         /* Read playlist entry and terminate string with NUL character
-          * regardless of Windows or Unix line endings
-          */
-          if((last = strrchr(buf[i], '\r')))
-             *last = '\0';
-          else if((last = strrchr(buf[i], '\n')))
-             *last = '\0';	
+         char *next = NULL;
+
+         if (!ptr || !*ptr)
+            return;
+
+         lines[i] = ptr;
+         next     = strchr(ptr, '\n');
+
+         if (next)
+         {
+            *next = '\0';
+            ptr   = next + 1;
+         }
+         else
+            ptr   = NULL;
+
+         /* Terminate string with NUL character regardless
+          * of Windows or Unix line endings. */
+         if ((next = strrchr(lines[i], '\r')))
+            *next = '\0';
       }
 
-      entry = &playlist->entries[playlist->size];
-
-      if (!*buf[2] || !*buf[3])
+      if (!*lines[2] || !*lines[3])
          continue;
 
-      if (*buf[0])
-         entry->path      = strdup(buf[0]);
-      if (*buf[1])
-         entry->label     = strdup(buf[1]);
-
-      entry->core_path    = strdup(buf[2]);
-      entry->core_name    = strdup(buf[3]);
-      if (*buf[4])
-         entry->crc32     = strdup(buf[4]);
-      if (*buf[5])
-         entry->db_name   = strdup(buf[5]);
+      entry            = &playlist->entries[playlist->size];
+      entry->path      = *lines[0] ? lines[0] : NULL;
+      entry->label     = *lines[1] ? lines[1] : NULL;
+      entry->core_path = lines[2];
+      entry->core_name = lines[3];
+      entry->crc32     = *lines[4] ? lines[4] : NULL;
+      entry->db_name   = *lines[5] ? lines[5] : NULL;
       playlist->size++;
    }
+}
+
+/* Both formats are read in one go and the entries point straight
+ * into the file contents, which the playlist keeps as its arena. */
+static bool playlist_read_file(
+      playlist_t *playlist, const char *path)
+{
+   uint32_t magic = 0;
+   ssize_t len    = 0;
+   void *buf      = NULL;
+
+   playlist->size = 0;
+
+   /* If playlist file does not exist,
+    * create an empty playlist instead.
+    */
+   if (!path_file_exists(path))
+      return true;
+
+   if (!filestream_read_file(path, &buf, &len) || len < 0)
+      return true;
+
+   playlist->arena      = (char*)buf;
+   playlist->arena_size = len + 1; /* Includes the appended NUL. */
+
+   if ((size_t)len >= sizeof(magic))
+      memcpy(&magic, buf, sizeof(magic));
+
+   if (swap_if_big32(magic) == PLAYLIST_BIN_MAGIC)
+   {
+      if (!playlist_read_file_binary(playlist, (char*)buf, len))
+      {
+         RARCH_ERR("Invalid binary playlist file: %s\n", path);
+         playlist->size = 0;
+      }
+   }
+   else
+      playlist_read_file_text(playlist, (char*)buf);
 
-end:
-   filestream_close(file);
+   playlist->index_valid = false;
    return true;
 }
 
@@ -497,12 +953,13 @@ end:
  * playlist_init:
  * @path            	   : Path to playlist contents file.
  * @size                : Maximum capacity of playlist size.
+ * @binary              : Write the playlist in the binary format.
  *
- * Creates and initializes a playlist.
+ * Creates and initializes a playlist. Either format is read.
  *
  * Returns: handle to new playlist if successful, otherwise NULL
  **/
-playlist_t *playlist_init(const char *path, size_t size)
+playlist_t *playlist_init(const char *path, size_t size, bool binary)
 {
    struct playlist_entry *entries = NULL;
    playlist_t           *playlist = (playlist_t*)calloc(1, sizeof(*playlist));
@@ -518,6 +975,7 @@ playlist_t *playlist_init(const char *path, size_t size)
 
    playlist->entries   = entries;
    playlist->cap       = size;
+   playlist->binary    = binary;
 
    playlist_read_file(playlist, path);
 
@@ -539,6 +997,7 @@ static int playlist_qsort_func(const struct playlist_entry *a,
 
 void playlist_qsort(playlist_t *playlist)
 {
+   playlist->index_valid = false;
    qsort(playlist->entries, playlist->size,
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
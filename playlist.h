@@ -43,18 +43,34 @@ struct content_playlist
    size_t cap;
 
    char *conf_path;
+   /* Written in the binary format instead of as text. */
+   bool binary;
+
+   /* Contents of the file the playlist was read from. Entry
+    * strings pointing into it are never freed individually. */
+   char *arena;
+   size_t arena_size;
+
+   /* Open-addressed hash tables on entry path and CRC32, holding
+    * entry index + 1 (0 marks an empty slot). Pushes update them
+    * in place; other changes rebuild them on the next lookup. */
+   size_t *path_index;
+   size_t *crc32_index;
+   size_t index_cap;
+   bool index_valid;
 };
 
 /**
  * playlist_init:
  * @path            	   : Path to playlist contents file.
  * @size                : Maximum capacity of playlist size.
+ * @binary              : Write the playlist in the binary format.
  *
- * Creates and initializes a playlist.
+ * Creates and initializes a playlist. Either format is read.
  *
  * Returns: handle to new playlist if successful, otherwise NULL
  **/
-playlist_t *playlist_init(const char *path, size_t size);
+playlist_t *playlist_init(const char *path, size_t size, bool binary);
 
 /**
  * playlist_free:
@@ -140,6 +156,18 @@ bool playlist_entry_exists(playlist_t *playlist,
       const char *path,
       const char *crc32);
 
+/**
+ * playlist_get_index_by_crc32:
+ * @playlist            : Playlist handle.
+ * @crc32               : CRC32 string of entry to look up.
+ * @idx                 : Index of the first matching entry.
+ *
+ * Returns: true (1) if an entry with the given CRC32 exists,
+ * otherwise false (0).
+ **/
+bool playlist_get_index_by_crc32(playlist_t *playlist,
+      const char *crc32, size_t *idx);
+
 void playlist_write_file(playlist_t *playlist);
 
 void playlist_qsort(playlist_t *playlist);
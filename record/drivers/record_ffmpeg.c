@@ -22,6 +22,9 @@
 #include <compat/msvc.h>
 
 #include <boolean.h>
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
 #include <queues/fifo_queue.h>
 #include <rthreads/rthreads.h>
 #include <gfx/scaler/scaler.h>
@@ -122,6 +125,10 @@ struct ff_video_info
    struct scaler_ctx scaler;
    struct SwsContext *sws;
    bool use_sws;
+
+   /* Rows of each conversion band must be a multiple of this
+    * so chroma subsampled planes split on whole lines. */
+   unsigned band_align;
 };
 
 struct ff_audio_info
@@ -178,10 +185,15 @@ struct ff_config_param
    char format[64];
    enum PixelFormat out_pix_fmt;
    unsigned threads;
+   unsigned conv_threads;
    unsigned frame_drop_ratio;
    unsigned sample_rate;
    float scale_factor;
 
+   /* Segmented output, both in seconds. */
+   unsigned segment_time;
+   unsigned replay_time;
+
    bool audio_enable;
    /* Keep same naming conventions as libavcodec. */
    bool audio_qscale;
@@ -195,6 +207,98 @@ struct ff_config_param
    AVDictionary *audio_opts;
 };
 
+#define MAX_FRAMES 32
+#define MAX_CONV_THREADS 8
+
+/* Fixed pool of tightly packed capture frames.
+ *
+ * The capture side packs a frame straight into the slot at
+ * write_idx, the encoder thread converts it in place from the
+ * slot at read_idx. A slot is owned by exactly one side at a
+ * time, so frames are handed over by index and never copied
+ * a second time. */
+struct ff_frame_pool
+{
+   uint8_t *buf;
+   size_t frame_size;
+   struct ffemu_video_data attr[MAX_FRAMES];
+   unsigned read_idx;
+   unsigned write_idx;
+   unsigned count;
+};
+
+struct ff_stats
+{
+   uint64_t frames_captured;
+   /* Frames skipped by frame_drop_ratio or too large for a slot. */
+   uint64_t frames_dropped;
+   uint64_t frames_encoded;
+   /* Number of times capture had to wait for the encoder. */
+   uint64_t capture_stalls;
+   unsigned queue_peak;
+};
+
+/* Segmented output.
+ *
+ * Segments are written as <base>_<index><ext>, each a complete
+ * file of its own, and listed in a rolling <base>.ffconcat index
+ * which ffmpeg's concat demuxer can join. With an instant replay
+ * ring, only the last ring_size finished segments stay on disk. */
+struct ff_segment_info
+{
+   /* Segment length in seconds, 0 writes a single file. */
+   unsigned segment_time;
+   /* Number of finished segments kept on disk, 0 keeps all. */
+   unsigned ring_size;
+   /* Segment currently being written. */
+   unsigned index;
+   /* Oldest finished segment still on disk. */
+   unsigned first;
+   unsigned replays;
+
+   /* Start of the current segment in vstream time base. */
+   int64_t start_pts;
+
+   /* Duration of each finished segment, indexed by segment. */
+   double *durations;
+   size_t durations_size;
+
+   char base[PATH_MAX_LENGTH];
+   char ext[32];
+
+   /* Set by the main thread, guarded by the handle's lock. */
+   bool save_requested;
+};
+
+struct ffmpeg;
+
+/* Colorspace conversion worker. Each worker owns its own
+ * scaler state since neither SwsContext nor scaler_ctx
+ * can be shared between threads. */
+struct ff_conv_worker
+{
+   struct ffmpeg *handle;
+   sthread_t *thread;
+   struct scaler_ctx scaler;
+   struct SwsContext *sws;
+   unsigned index;
+};
+
+struct ff_conv_pool
+{
+   struct ff_conv_worker workers[MAX_CONV_THREADS];
+   unsigned count;
+
+   slock_t *lock;
+   scond_t *cond;
+   scond_t *done_cond;
+
+   const struct ffemu_video_data *vid;
+   unsigned generation;
+   unsigned pending;
+   bool alive;
+};
+
 typedef struct ffmpeg
 {
    struct ff_video_info video;
@@ -208,8 +312,10 @@ typedef struct ffmpeg
    slock_t *cond_lock;
    slock_t *lock;
    fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
+   struct ff_frame_pool pool;
+   struct ff_conv_pool conv;
+   struct ff_stats stats;
+   struct ff_segment_info segment;
    sthread_t *thread;
 
    volatile bool alive;
@@ -488,6 +594,11 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
 
    video->codec->thread_count = params->threads;
 
+   /* Segments can only be cut on keyframes. */
+   if (params->segment_time)
+      video->codec->gop_size = MAX(1, (int)(param->fps *
+               params->segment_time / params->frame_drop_ratio));
+
    if (params->video_qscale)
    {
       video->codec->flags |= CODEC_FLAG_QSCALE;
@@ -522,6 +633,14 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    video->conv_frame->height = param->out_height;
    video->conv_frame->format = video->pix_fmt;
 
+   video->band_align = 1;
+   if (video->use_sws)
+   {
+      const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(video->pix_fmt);
+      if (desc)
+         video->band_align = 1 << desc->log2_chroma_h;
+   }
+
    return true;
 }
 
@@ -534,6 +653,7 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
    params->out_pix_fmt = PIX_FMT_NONE;
    params->scale_factor = 1;
    params->threads = 1;
+   params->conv_threads = MIN(cpu_features_get_core_amount(), 4);
    params->frame_drop_ratio = 1;
    params->audio_enable = true;
 
@@ -555,6 +675,7 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
          sizeof(params->format));
 
    config_get_uint(params->conf, "threads", &params->threads);
+   config_get_uint(params->conf, "conv_threads", &params->conv_threads);
 
    if (!config_get_uint(params->conf, "frame_drop_ratio",
             &params->frame_drop_ratio) || !params->frame_drop_ratio)
@@ -564,6 +685,8 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
       params->audio_enable = true;
 
    config_get_uint(params->conf, "sample_rate", &params->sample_rate);
+   config_get_uint(params->conf, "segment_time", &params->segment_time);
+   config_get_uint(params->conf, "replay_time", &params->replay_time);
    config_get_float(params->conf, "scale_factor", &params->scale_factor);
 
    params->audio_qscale = config_get_int(params->conf, "audio_global_quality",
@@ -603,11 +726,47 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
    return true;
 }
 
+static void ffmpeg_segment_path(ffmpeg_t *handle, unsigned index,
+      char *s, size_t len)
+{
+   snprintf(s, len, "%s_%05u%s",
+         handle->segment.base, index, handle->segment.ext);
+}
+
+static void ffmpeg_segment_init(ffmpeg_t *handle)
+{
+   const char *ext                = NULL;
+   struct ff_segment_info *seg    = &handle->segment;
+   struct ff_config_param *params = &handle->config;
+
+   seg->segment_time = params->segment_time;
+
+   if (params->replay_time)
+      seg->ring_size = (params->replay_time + params->segment_time - 1)
+         / params->segment_time;
+
+   strlcpy(seg->base, handle->params.filename, sizeof(seg->base));
+
+   ext = path_get_extension(handle->params.filename);
+   if (ext && *ext)
+   {
+      snprintf(seg->ext, sizeof(seg->ext), ".%s", ext);
+      path_remove_extension(seg->base);
+   }
+
+   RARCH_LOG("[FFmpeg]: Writing %u second segments to %s_*%s.\n",
+         seg->segment_time, seg->base, seg->ext);
+}
+
 static bool ffmpeg_init_muxer_pre(ffmpeg_t *handle)
 {
    AVFormatContext *ctx = avformat_alloc_context();
 
-   av_strlcpy(ctx->filename, handle->params.filename, sizeof(ctx->filename));
+   if (handle->segment.segment_time)
+      ffmpeg_segment_path(handle, handle->segment.index,
+            ctx->filename, sizeof(ctx->filename));
+   else
+      av_strlcpy(ctx->filename, handle->params.filename, sizeof(ctx->filename));
 
    if (*handle->config.format)
       ctx->oformat = av_guess_format(handle->config.format, NULL, NULL);
@@ -629,6 +788,8 @@ static bool ffmpeg_init_muxer_pre(ffmpeg_t *handle)
 
 static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
 {
+   int ret;
+   AVDictionary *opts = NULL;
    AVStream *stream = avformat_new_stream(handle->muxer.ctx,
          handle->video.encoder);
 
@@ -650,12 +811,305 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
    av_dict_set(&handle->muxer.ctx->metadata, "title",
          "RetroArch video dump", 0); 
 
-   return avformat_write_header(handle->muxer.ctx, NULL) >= 0;
+   /* Fragment MP4 segments so a crash loses at most a fragment
+    * instead of the whole unfinalized segment. */
+   if (handle->segment.segment_time && av_match_name(
+            handle->muxer.ctx->oformat->name, "mp4,mov,ipod"))
+      av_dict_set(&opts, "movflags", "frag_keyframe+empty_moov", 0);
+
+   ret = avformat_write_header(handle->muxer.ctx, opts ? &opts : NULL);
+
+   av_dict_free(&opts);
+
+   return ret >= 0;
 }
 
-#define MAX_FRAMES 32
+static void ffmpeg_muxer_close(ffmpeg_t *handle)
+{
+   unsigned i;
+   AVFormatContext *ctx = handle->muxer.ctx;
+
+   av_write_trailer(ctx);
+   avio_closep(&ctx->pb);
+
+   /* The codec contexts are ours and outlive the segment. */
+   for (i = 0; i < ctx->nb_streams; i++)
+      ctx->streams[i]->codec = NULL;
+
+   avformat_free_context(ctx);
+
+   handle->muxer.ctx     = NULL;
+   handle->muxer.vstream = NULL;
+   handle->muxer.astream = NULL;
+}
+
+static void ffmpeg_segment_write_index(ffmpeg_t *handle,
+      const char *base, unsigned first, unsigned last)
+{
+   unsigned i;
+   FILE *file = NULL;
+   char path[PATH_MAX_LENGTH];
+   char tmp[PATH_MAX_LENGTH];
+
+   snprintf(path, sizeof(path), "%s.ffconcat", base);
+   snprintf(tmp,  sizeof(tmp),  "%s.tmp", path);
+
+   file = fopen(tmp, "w");
+   if (!file)
+      return;
+
+   fprintf(file, "ffconcat version 1.0\n");
+
+   for (i = first; i < last; i++)
+   {
+      char segment[PATH_MAX_LENGTH];
+
+      snprintf(segment, sizeof(segment), "%s_%05u%s",
+            base, i, handle->segment.ext);
+      fprintf(file, "file '%s'\n", path_basename(segment));
+
+      if (i < handle->segment.durations_size)
+         fprintf(file, "duration %.3f\n", handle->segment.durations[i]);
+   }
+
+   fclose(file);
+
+   /* Replace the old index in one step so readers never see a
+    * partially written one. */
+   remove(path);
+   rename(tmp, path);
+}
+
+/* Moves the finished segments of the ring out of its way,
+ * so that they are no longer evicted. */
+static void ffmpeg_segment_save_replay(ffmpeg_t *handle)
+{
+   unsigned i;
+   char base[PATH_MAX_LENGTH];
+   struct ff_segment_info *seg = &handle->segment;
+
+   snprintf(base, sizeof(base), "%s_replay%03u",
+         seg->base, seg->replays++);
+
+   for (i = seg->first; i < seg->index; i++)
+   {
+      char from[PATH_MAX_LENGTH];
+      char to[PATH_MAX_LENGTH];
+
+      ffmpeg_segment_path(handle, i, from, sizeof(from));
+      snprintf(to, sizeof(to), "%s_%05u%s", base, i, seg->ext);
+
+      if (rename(from, to) != 0)
+         RARCH_WARN("[FFmpeg]: Failed to keep replay segment %s.\n", from);
+   }
+
+   ffmpeg_segment_write_index(handle, base, seg->first, seg->index);
+
+   RARCH_LOG("[FFmpeg]: Saved instant replay to %s.ffconcat.\n", base);
+
+   seg->first = seg->index;
+}
+
+static bool ffmpeg_segment_save_pending(ffmpeg_t *handle)
+{
+   bool pending;
+
+   slock_lock(handle->lock);
+   pending = handle->segment.save_requested;
+   slock_unlock(handle->lock);
+
+   return pending;
+}
+
+/* Clears the request in the same step, so one made while the
+ * replay is being saved is kept for the next segment. */
+static bool ffmpeg_segment_take_save_request(ffmpeg_t *handle)
+{
+   bool pending;
+
+   slock_lock(handle->lock);
+   pending                        = handle->segment.save_requested;
+   handle->segment.save_requested = false;
+   slock_unlock(handle->lock);
+
+   return pending;
+}
+
+static void ffmpeg_segment_set_duration(ffmpeg_t *handle, double duration)
+{
+   struct ff_segment_info *seg = &handle->segment;
+
+   if (seg->index >= seg->durations_size)
+   {
+      size_t size = seg->durations_size ? seg->durations_size * 2 : 64;
+      double *tmp = (double*)realloc(seg->durations,
+            size * sizeof(*seg->durations));
+
+      if (!tmp)
+         return;
+
+      seg->durations      = tmp;
+      seg->durations_size = size;
+   }
+
+   seg->durations[seg->index] = duration;
+}
+
+/* Closes the current segment and starts the next one with pkt,
+ * which must be a video keyframe. */
+static bool ffmpeg_segment_next(ffmpeg_t *handle, AVPacket *pkt,
+      double duration)
+{
+   AVRational time_base        = handle->muxer.vstream->time_base;
+   struct ff_segment_info *seg = &handle->segment;
+
+   ffmpeg_muxer_close(handle);
+   ffmpeg_segment_set_duration(handle, duration);
+
+   seg->index++;
+
+   if (ffmpeg_segment_take_save_request(handle))
+      ffmpeg_segment_save_replay(handle);
+
+   /* Evict segments which fell out of the replay ring. */
+   while (seg->ring_size && seg->index - seg->first > seg->ring_size)
+   {
+      char path[PATH_MAX_LENGTH];
+      ffmpeg_segment_path(handle, seg->first++, path, sizeof(path));
+      remove(path);
+   }
+
+   ffmpeg_segment_write_index(handle, seg->base, seg->first, seg->index);
+
+   if (!ffmpeg_init_muxer_pre(handle) || !ffmpeg_init_muxer_post(handle))
+   {
+      RARCH_ERR("[FFmpeg]: Failed to open segment %u.\n", seg->index);
+      return false;
+   }
+
+   if (pkt->pts != (int64_t)AV_NOPTS_VALUE)
+      pkt->pts = av_rescale_q(pkt->pts, time_base,
+            handle->muxer.vstream->time_base);
+   if (pkt->dts != (int64_t)AV_NOPTS_VALUE)
+      pkt->dts = av_rescale_q(pkt->dts, time_base,
+            handle->muxer.vstream->time_base);
+
+   pkt->stream_index = handle->muxer.vstream->index;
+   seg->start_pts    = pkt->pts;
+
+   return true;
+}
+
+static bool ffmpeg_segment_write_video(ffmpeg_t *handle, AVPacket *pkt)
+{
+   struct ff_segment_info *seg = &handle->segment;
+
+   if (seg->segment_time && (pkt->flags & AV_PKT_FLAG_KEY)
+         && pkt->pts != (int64_t)AV_NOPTS_VALUE)
+   {
+      double duration = (pkt->pts - seg->start_pts) *
+         av_q2d(handle->muxer.vstream->time_base);
+
+      if (duration >= seg->segment_time ||
+            (duration > 0.0 && ffmpeg_segment_save_pending(handle)))
+      {
+         if (!ffmpeg_segment_next(handle, pkt, duration))
+            return false;
+      }
+   }
+
+   return av_interleaved_write_frame(handle->muxer.ctx, pkt) >= 0;
+}
 
 static void ffmpeg_thread(void *data);
+static void ffmpeg_conv_thread(void *data);
+
+static bool init_conv_threads(ffmpeg_t *handle)
+{
+   unsigned i;
+   struct ff_conv_pool *conv = &handle->conv;
+   unsigned threads          = handle->config.conv_threads;
+
+   if (threads > MAX_CONV_THREADS)
+      threads = MAX_CONV_THREADS;
+   if (threads < 1)
+      threads = 1;
+
+   conv->count = threads;
+
+   for (i = 0; i < conv->count; i++)
+   {
+      conv->workers[i].handle         = handle;
+      conv->workers[i].index          = i;
+      conv->workers[i].scaler.in_fmt  = handle->video.scaler.in_fmt;
+      conv->workers[i].scaler.out_fmt = handle->video.scaler.out_fmt;
+   }
+
+   /* Worker 0 is the encoder thread itself. */
+   if (conv->count < 2)
+      return true;
+
+   conv->lock      = slock_new();
+   conv->cond      = scond_new();
+   conv->done_cond = scond_new();
+   conv->alive     = true;
+
+   if (!conv->lock || !conv->cond || !conv->done_cond)
+      return false;
+
+   for (i = 1; i < conv->count; i++)
+   {
+      conv->workers[i].thread = sthread_create(ffmpeg_conv_thread,
+            &conv->workers[i]);
+      if (!conv->workers[i].thread)
+         return false;
+   }
+
+   RARCH_LOG("[FFmpeg]: Using %u colorspace conversion threads.\n",
+         conv->count);
+
+   return true;
+}
+
+static void deinit_conv_threads(ffmpeg_t *handle)
+{
+   unsigned i;
+   struct ff_conv_pool *conv = &handle->conv;
+
+   if (conv->lock)
+   {
+      slock_lock(conv->lock);
+      conv->alive = false;
+      scond_broadcast(conv->cond);
+      slock_unlock(conv->lock);
+   }
+
+   for (i = 0; i < conv->count; i++)
+   {
+      struct ff_conv_worker *worker = &conv->workers[i];
+
+      if (worker->thread)
+         sthread_join(worker->thread);
+      worker->thread = NULL;
+
+      scaler_ctx_gen_reset(&worker->scaler);
+      if (worker->sws)
+         sws_freeContext(worker->sws);
+      worker->sws = NULL;
+   }
+
+   if (conv->lock)
+      slock_free(conv->lock);
+   if (conv->cond)
+      scond_free(conv->cond);
+   if (conv->done_cond)
+      scond_free(conv->done_cond);
+
+   conv->lock      = NULL;
+   conv->cond      = NULL;
+   conv->done_cond = NULL;
+   conv->count     = 0;
+}
 
 static bool init_thread(ffmpeg_t *handle)
 {
@@ -664,9 +1118,16 @@ static bool init_thread(ffmpeg_t *handle)
    handle->cond = scond_new();
    handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
          handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct ffemu_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
+
+   handle->pool.frame_size = handle->params.fb_width *
+      handle->params.fb_height * handle->video.pix_size;
+   /* For some reason, FFmpeg has a tendency to crash 
+    * if we don't overallocate a bit. */
+   handle->pool.buf = (uint8_t*)av_malloc(handle->pool.frame_size *
+         (MAX_FRAMES + 1));
+
+   if (!init_conv_threads(handle))
+      return false;
 
    handle->alive = true;
    handle->can_sleep = true;
@@ -674,7 +1135,7 @@ static bool init_thread(ffmpeg_t *handle)
 
    retro_assert(handle->lock && handle->cond_lock &&
       handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+      handle->pool.buf && handle->thread);
 
    return true;
 }
@@ -696,7 +1157,10 @@ static void deinit_thread(ffmpeg_t *handle)
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
-   handle->thread = NULL;
+   handle->lock      = NULL;
+   handle->cond_lock = NULL;
+   handle->cond      = NULL;
+   handle->thread    = NULL;
 }
 
 static void deinit_thread_buf(ffmpeg_t *handle)
@@ -707,17 +1171,11 @@ static void deinit_thread_buf(ffmpeg_t *handle)
       handle->audio_fifo = NULL;
    }
    
-   if (handle->attr_fifo)
-   {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
-   }
+   av_free(handle->pool.buf);
+   handle->pool.buf   = NULL;
+   handle->pool.count = 0;
 
-   if (handle->video_fifo)
-   {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
-   }
+   deinit_conv_threads(handle);
 }
 
 static void ffmpeg_free(void *data)
@@ -768,6 +1226,8 @@ static void ffmpeg_free(void *data)
    av_free(handle->audio.fixed_conv);
    av_free(handle->audio.planar_buf);
 
+   free(handle->segment.durations);
+
    free(handle);
 }
 
@@ -787,6 +1247,9 @@ static void *ffmpeg_new(const struct ffemu_params *params)
    if (!ffmpeg_init_config(&handle->config, params->config))
       goto error;
 
+   if (handle->config.segment_time)
+      ffmpeg_segment_init(handle);
+
    if (!ffmpeg_init_muxer_pre(handle))
       goto error;
 
@@ -812,36 +1275,60 @@ error:
 static bool ffmpeg_push_video(void *data,
       const struct ffemu_video_data *vid)
 {
-   unsigned y;
+   unsigned y, slot;
    bool drop_frame;
-   struct ffemu_video_data attr_data;
+   size_t frame_size;
+   struct ffemu_video_data *attr_data = NULL;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    int offset = 0;
+   bool stalled = false;
 
    if (!handle || !vid)
       return false;
 
+   handle->stats.frames_captured++;
+
    drop_frame = handle->video.frame_drop_count++ %
       handle->video.frame_drop_ratio;
 
    handle->video.frame_drop_count %= handle->video.frame_drop_ratio;
 
    if (drop_frame)
+   {
+      handle->stats.frames_dropped++;
+      return true;
+   }
+
+   frame_size = vid->is_dupe ? 0 : vid->width * vid->height *
+      handle->video.pix_size;
+
+   if (frame_size > handle->pool.frame_size)
+   {
+      handle->stats.frames_dropped++;
       return true;
+   }
 
+   /* Back-pressure: rather than dropping frames when the encoder
+    * falls behind, block until it hands a pool slot back. */
    for (;;)
    {
-      unsigned avail;
+      unsigned count;
       slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->attr_fifo);
+      count = handle->pool.count;
       slock_unlock(handle->lock);
 
       if (!handle->alive)
          return false;
 
-      if (avail >= sizeof(*vid))
+      if (count < MAX_FRAMES)
          break;
 
+      if (!stalled)
+      {
+         handle->stats.capture_stalls++;
+         stalled = true;
+      }
+
       slock_lock(handle->cond_lock);
       if (handle->can_sleep)
       {
@@ -855,24 +1342,32 @@ static bool ffmpeg_push_video(void *data,
       slock_unlock(handle->cond_lock);
    }
 
-   slock_lock(handle->lock);
+   /* We are the only producer, so the slot at write_idx stays
+    * ours until it is committed below and can be filled
+    * without holding the lock. */
+   slot      = handle->pool.write_idx;
+   attr_data = &handle->pool.attr[slot];
+   *attr_data = *vid;
 
    /* Tightly pack our frame to conserve memory.
     * libretro tends to use a very large pitch.
     */
-   attr_data = *vid;
-
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
+   if (attr_data->is_dupe)
+      attr_data->width = attr_data->height = attr_data->pitch = 0;
    else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
+      attr_data->pitch = attr_data->width * handle->video.pix_size;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+   attr_data->data = handle->pool.buf + slot * handle->pool.frame_size;
 
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+   for (y = 0; y < attr_data->height; y++, offset += vid->pitch)
+      memcpy((uint8_t*)attr_data->data + y * attr_data->pitch,
+            (const uint8_t*)vid->data + offset, attr_data->pitch);
 
+   slock_lock(handle->lock);
+   handle->pool.write_idx = (slot + 1) % MAX_FRAMES;
+   handle->pool.count++;
+   if (handle->pool.count > handle->stats.queue_peak)
+      handle->stats.queue_peak = handle->pool.count;
    slock_unlock(handle->lock);
    scond_signal(handle->cond);
 
@@ -961,43 +1456,171 @@ static bool encode_video(ffmpeg_t *handle, AVPacket *pkt, AVFrame *frame)
    return true;
 }
 
-static void ffmpeg_scale_input(ffmpeg_t *handle,
-      const struct ffemu_video_data *vid)
+static void ffmpeg_scale_band(ffmpeg_t *handle,
+      struct ff_conv_worker *worker,
+      const struct ffemu_video_data *vid,
+      unsigned band, unsigned bands)
 {
+   unsigned i;
+   uint8_t *dst[4];
+   int dst_linesize[4];
+   unsigned start, end;
+   const uint8_t *src;
+   unsigned rows   = handle->params.out_height;
+   unsigned align  = handle->video.band_align;
+   unsigned band_h = (rows / bands) & ~(align - 1);
+   AVFrame *frame  = handle->video.conv_frame;
    /* Attempt to preserve more information if we scale down. */
-   bool shrunk = handle->params.out_width < vid->width
+   bool shrunk     = handle->params.out_width < vid->width
       || handle->params.out_height < vid->height;
 
+   /* Only the whole frame can be resampled vertically, so
+    * banding is limited to frames with a matching height. */
+   if (bands > 1 && band_h && vid->height == rows)
+   {
+      start = band * band_h;
+      end   = (band == bands - 1) ? rows : start + band_h;
+   }
+   else if (band == 0)
+   {
+      start = 0;
+      end   = vid->height;
+   }
+   else
+      return;
+
+   src = (const uint8_t*)vid->data + start * vid->pitch;
+
+   for (i = 0; i < 4; i++)
+   {
+      unsigned shift = 0;
+
+      dst_linesize[i] = frame->linesize[i];
+      if (!frame->data[i])
+      {
+         dst[i] = NULL;
+         continue;
+      }
+
+      /* Chroma planes of subsampled formats have fewer rows. */
+      if ((i == 1 || i == 2) && handle->video.use_sws)
+      {
+         const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(
+               handle->video.pix_fmt);
+         if (desc && !(desc->flags & AV_PIX_FMT_FLAG_RGB))
+            shift = desc->log2_chroma_h;
+      }
+
+      dst[i] = frame->data[i] + (start >> shift) * frame->linesize[i];
+   }
+
    if (handle->video.use_sws)
    {
       int linesize = vid->pitch;
+      unsigned out_h = (start == 0 && end == vid->height) ?
+         handle->params.out_height : end - start;
 
-      handle->video.sws = sws_getCachedContext(handle->video.sws,
-            vid->width, vid->height, handle->video.in_pix_fmt,
-            handle->params.out_width, handle->params.out_height,
+      worker->sws = sws_getCachedContext(worker->sws,
+            vid->width, end - start, handle->video.in_pix_fmt,
+            handle->params.out_width, out_h,
             handle->video.pix_fmt,
             shrunk ? SWS_BILINEAR : SWS_POINT, NULL, NULL, NULL);
 
-      sws_scale(handle->video.sws, (const uint8_t* const*)&vid->data,
-            &linesize, 0, vid->height, handle->video.conv_frame->data,
-            handle->video.conv_frame->linesize);
+      sws_scale(worker->sws, (const uint8_t* const*)&src,
+            &linesize, 0, end - start, dst, dst_linesize);
    }
    else
    {
+      unsigned out_h = (start == 0 && end == vid->height) ?
+         handle->params.out_height : end - start;
+
       video_frame_record_scale(
-            &handle->video.scaler,
-            handle->video.conv_frame->data[0],
-            vid->data,
+            &worker->scaler,
+            dst[0],
+            src,
             handle->params.out_width,
-            handle->params.out_height,
-            handle->video.conv_frame->linesize[0],
+            out_h,
+            dst_linesize[0],
             vid->width,
-            vid->height,
+            end - start,
             vid->pitch,
             shrunk);
    }
 }
 
+static void ffmpeg_conv_thread(void *data)
+{
+   struct ff_conv_worker *worker = (struct ff_conv_worker*)data;
+   ffmpeg_t *handle              = worker->handle;
+   struct ff_conv_pool *conv     = &handle->conv;
+   unsigned generation           = 0;
+
+   slock_lock(conv->lock);
+
+   for (;;)
+   {
+      const struct ffemu_video_data *vid = NULL;
+
+      while (conv->alive && conv->generation == generation)
+         scond_wait(conv->cond, conv->lock);
+
+      if (!conv->alive)
+         break;
+
+      generation = conv->generation;
+      vid        = conv->vid;
+      slock_unlock(conv->lock);
+
+      ffmpeg_scale_band(handle, worker, vid, worker->index, conv->count);
+
+      slock_lock(conv->lock);
+      if (--conv->pending == 0)
+         scond_signal(conv->done_cond);
+   }
+
+   slock_unlock(conv->lock);
+}
+
+static void ffmpeg_scale_input(ffmpeg_t *handle,
+      const struct ffemu_video_data *vid)
+{
+   struct ff_conv_pool *conv = &handle->conv;
+
+   if (conv->count < 2 || !conv->lock)
+   {
+      ffmpeg_scale_band(handle, &conv->workers[0], vid, 0, 1);
+      return;
+   }
+
+   slock_lock(conv->lock);
+   conv->vid     = vid;
+   conv->pending = conv->count - 1;
+   conv->generation++;
+   scond_broadcast(conv->cond);
+   slock_unlock(conv->lock);
+
+   ffmpeg_scale_band(handle, &conv->workers[0], vid, 0, conv->count);
+
+   slock_lock(conv->lock);
+   while (conv->pending)
+      scond_wait(conv->done_cond, conv->lock);
+   slock_unlock(conv->lock);
+}
+
+/* Hands the oldest pool slot back to the capture side. */
+static void ffmpeg_frame_pool_release(ffmpeg_t *handle)
+{
+   slock_lock(handle->lock);
+   handle->pool.read_idx = (handle->pool.read_idx + 1) % MAX_FRAMES;
+   handle->pool.count--;
+   slock_unlock(handle->lock);
+
+   if (handle->cond)
+      scond_signal(handle->cond);
+}
+
+/* Converts the frame at the head of the frame pool and
+ * releases its slot before the (slower) encode step. */
 static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
       const struct ffemu_video_data *vid)
 {
@@ -1006,18 +1629,26 @@ static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
    if (!vid->is_dupe)
       ffmpeg_scale_input(handle, vid);
 
+   ffmpeg_frame_pool_release(handle);
+
    handle->video.conv_frame->pts = handle->video.frame_cnt;
 
+   /* Cut the replay segment as soon as possible. */
+   handle->video.conv_frame->pict_type =
+      handle->segment.ring_size && ffmpeg_segment_save_pending(handle) ?
+      AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
    if (!encode_video(handle, &pkt, handle->video.conv_frame))
       return false;
 
    if (pkt.size)
    {
-      if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+      if (!ffmpeg_segment_write_video(handle, &pkt))
          return false;
    }
 
    handle->video.frame_cnt++;
+   handle->stats.frames_encoded++;
    return true;
 }
 
@@ -1290,8 +1921,6 @@ static void ffmpeg_flush_video(ffmpeg_t *handle)
 static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
    bool did_work;
-   void *video_buf = av_malloc(2 * handle->params.fb_width * 
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ? 
       (handle->audio.codec->frame_size * 
        handle->params.channels * sizeof(int16_t)) : 0;
@@ -1324,12 +1953,9 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
          }
       }
 
-      if (fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
+      if (handle->pool.count)
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf, 
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
+         attr_buf = handle->pool.attr[handle->pool.read_idx];
          ffmpeg_push_video_thread(handle, &attr_buf);
 
          did_work = true;
@@ -1343,10 +1969,20 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
+static void ffmpeg_log_stats(ffmpeg_t *handle)
+{
+   RARCH_LOG("[FFmpeg]: Frames captured: %llu, encoded: %llu, dropped: %llu.\n",
+         (unsigned long long)handle->stats.frames_captured,
+         (unsigned long long)handle->stats.frames_encoded,
+         (unsigned long long)handle->stats.frames_dropped);
+   RARCH_LOG("[FFmpeg]: Peak queue depth: %u/%u, capture stalls: %llu.\n",
+         handle->stats.queue_peak, MAX_FRAMES,
+         (unsigned long long)handle->stats.capture_stalls);
+}
+
 static bool ffmpeg_finalize(void *data)
 {
    ffmpeg_t *handle = (ffmpeg_t*)data;
@@ -1364,6 +2000,22 @@ static bool ffmpeg_finalize(void *data)
    /* Write final data. */
    av_write_trailer(handle->muxer.ctx);
 
+   if (handle->segment.segment_time)
+   {
+      struct ff_segment_info *seg = &handle->segment;
+
+      /* The last segment is finished as well now. */
+      seg->index++;
+
+      if (ffmpeg_segment_take_save_request(handle))
+         ffmpeg_segment_save_replay(handle);
+      else
+         ffmpeg_segment_write_index(handle, seg->base,
+               seg->first, seg->index);
+   }
+
+   ffmpeg_log_stats(handle);
+
    return true;
 }
 
@@ -1372,12 +2024,6 @@ static void ffmpeg_thread(void *data)
    size_t audio_buf_size;
    void *audio_buf = NULL;
    ffmpeg_t *ff    = (ffmpeg_t*)data;
-   /* For some reason, FFmpeg has a tendency to crash 
-    * if we don't overallocate a bit. */
-   void *video_buf = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
-
-   retro_assert(video_buf);
 
    audio_buf_size = ff->config.audio_enable ? 
       (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
@@ -1391,8 +2037,11 @@ static void ffmpeg_thread(void *data)
       bool avail_audio = false;
 
       slock_lock(ff->lock);
-      if (fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
+      if (ff->pool.count)
+      {
+         attr_buf    = ff->pool.attr[ff->pool.read_idx];
          avail_video = true;
+      }
 
       if (ff->config.audio_enable)
          if (fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
@@ -1414,18 +2063,8 @@ static void ffmpeg_thread(void *data)
          slock_unlock(ff->cond_lock);
       }
 
-      if (avail_video && video_buf)
-      {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
+      if (avail_video)
          ffmpeg_push_video_thread(ff, &attr_buf);
-      }
 
       if (avail_audio && audio_buf)
       {
@@ -1443,15 +2082,29 @@ static void ffmpeg_thread(void *data)
       }
    }
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
+static bool ffmpeg_save_replay(void *data)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   if (!handle || !handle->segment.ring_size)
+      return false;
+
+   /* Picked up by the encoder thread on the next keyframe. */
+   slock_lock(handle->lock);
+   handle->segment.save_requested = true;
+   slock_unlock(handle->lock);
+   return true;
+}
+
 const record_driver_t ffemu_ffmpeg = {
    ffmpeg_new,
    ffmpeg_free,
    ffmpeg_push_video,
    ffmpeg_push_audio,
    ffmpeg_finalize,
+   ffmpeg_save_replay,
    "ffmpeg",
 };
@@ -291,6 +291,15 @@ void recording_push_audio(const int16_t *data, size_t samples)
       recording_driver->push_audio(recording_data, &ffemu_data);
 }
 
+bool recording_save_replay(void)
+{
+   if (!recording_data || !recording_driver
+         || !recording_driver->save_replay)
+      return false;
+
+   return recording_driver->save_replay(recording_data);
+}
+
 /**
  * recording_init:
  *
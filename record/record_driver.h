@@ -87,6 +87,7 @@ typedef struct record_driver
    bool  (*push_video)(void *data,const struct ffemu_video_data *video_data);
    bool  (*push_audio)(void *data, const struct ffemu_audio_data *audio_data);
    bool  (*finalize)(void *data);
+   bool  (*save_replay)(void *data);
    const char *ident;
 } record_driver_t;
 
@@ -166,6 +167,15 @@ void recording_set_state(bool state);
 
 void recording_push_audio(const int16_t *data, size_t samples);
 
+/**
+ * recording_save_replay:
+ *
+ * Asks the recording driver to keep its instant replay ring.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool recording_save_replay(void);
+
 void *recording_driver_get_data_ptr(void);
 
 void recording_driver_clear_data_ptr(void);
@@ -73,6 +73,7 @@
 #include "dirs.h"
 #include "paths.h"
 #include "file_path_special.h"
+#include "performance_counters.h"
 #include "verbosity.h"
 
 #include "frontend/frontend_driver.h"
@@ -122,7 +123,8 @@ enum
    RA_OPT_VERSION,
    RA_OPT_EOF_EXIT,
    RA_OPT_LOG_FILE,
-   RA_OPT_MAX_FRAMES
+   RA_OPT_MAX_FRAMES,
+   RA_OPT_STARTUP_TRACE
 };
 
 static jmp_buf error_sjlj_context;
@@ -371,7 +373,11 @@ static void retroarch_print_help(const char *arg0)
          "Not relevant for all platforms.");
    puts("      --max-frames=NUMBER\n"
         "                        Runs for the specified number of frames, "
-        "then exits.\n");
+        "then exits.");
+   puts("      --startup-trace=FILE\n"
+        "                        Writes a trace of startup up to the first "
+        "frame to FILE,\n"
+        "                        in Chrome trace JSON.\n");
 }
 
 #define FFMPEG_RECORD_ARG "r:"
@@ -444,6 +450,7 @@ static void retroarch_parse_input(int argc, char *argv[])
       { "features",     0, NULL, RA_OPT_FEATURES },
       { "subsystem",    1, NULL, RA_OPT_SUBSYSTEM },
       { "max-frames",   1, NULL, RA_OPT_MAX_FRAMES },
+      { "startup-trace", 1, NULL, RA_OPT_STARTUP_TRACE },
       { "eof-exit",     0, NULL, RA_OPT_EOF_EXIT },
       { "version",      0, NULL, RA_OPT_VERSION },
 #ifdef HAVE_FILE_LOGGER
@@ -823,6 +830,10 @@ static void retroarch_parse_input(int argc, char *argv[])
             }
             break;
 
+         case RA_OPT_STARTUP_TRACE:
+            rarch_startup_trace_set_path(optarg);
+            break;
+
          case RA_OPT_SUBSYSTEM:
             path_set(RARCH_PATH_SUBSYSTEM, optarg);
             break;
@@ -1028,6 +1039,8 @@ static void retroarch_main_init_media(void)
 bool retroarch_main_init(int argc, char *argv[])
 {
    bool init_failed = false;
+   int span         = rarch_startup_trace_begin("main init");
+   int step         = -1;
 
    retroarch_init_state();
 
@@ -1040,7 +1053,10 @@ bool retroarch_main_init(int argc, char *argv[])
 
    rarch_ctl(RARCH_CTL_SET_ERROR_ON_INIT, NULL);
    retro_main_log_file_init(NULL);
+
+   step = rarch_startup_trace_begin("parse input");
    retroarch_parse_input(argc, argv);
+   rarch_startup_trace_end(step);
 
    if (verbosity_is_enabled())
    {
@@ -1060,13 +1076,22 @@ bool retroarch_main_init(int argc, char *argv[])
    }
 
    retroarch_validate_cpu_features();
+
+   step = rarch_startup_trace_begin("config load");
    config_load();
+   rarch_startup_trace_end(step);
 
+   step = rarch_startup_trace_begin("task init");
    runloop_ctl(RUNLOOP_CTL_TASK_INIT, NULL);
+   rarch_startup_trace_end(step);
 
    retroarch_main_init_media();
 
+   step = rarch_startup_trace_begin("driver init pre");
    driver_ctl(RARCH_DRIVER_CTL_INIT_PRE, NULL);
+   rarch_startup_trace_end(step);
+
+   step = rarch_startup_trace_begin("core init");
 
    /* Attempt to initialize core */
    if (has_set_core)
@@ -1098,7 +1123,13 @@ bool retroarch_main_init(int argc, char *argv[])
       }
    }
 
+   rarch_startup_trace_end(step);
+
+   step = rarch_startup_trace_begin("drivers init");
    drivers_init(DRIVERS_CMD_ALL);
+   rarch_startup_trace_end(step);
+
+   step = rarch_startup_trace_begin("subsystems init");
    command_event(CMD_EVENT_COMMAND_INIT, NULL);
    command_event(CMD_EVENT_REMOTE_INIT, NULL);
    command_event(CMD_EVENT_REWIND_INIT, NULL);
@@ -1109,15 +1140,18 @@ bool retroarch_main_init(int argc, char *argv[])
    path_init_savefile();
 
    command_event(CMD_EVENT_SET_PER_GAME_RESOLUTION, NULL);
+   rarch_startup_trace_end(step);
 
    rarch_ctl(RARCH_CTL_UNSET_ERROR_ON_INIT, NULL);
    rarch_ctl(RARCH_CTL_SET_INITED, NULL);
 
+   rarch_startup_trace_end(span);
    return true;
 
 error:
    command_event(CMD_EVENT_CORE_DEINIT, NULL);
    rarch_ctl(RARCH_CTL_UNSET_INITED, NULL);
+   rarch_startup_trace_end(span);
    return false;
 }
 
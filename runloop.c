@@ -23,6 +23,7 @@
 #include <compat/strl.h>
 #include <retro_assert.h>
 #include <file/file_path.h>
+#include <file/archive_file.h>
 #include <queues/message_queue.h>
 #include <queues/task_queue.h>
 #include <string/stdstring.h>
@@ -48,6 +49,8 @@
 #endif
 
 #ifdef HAVE_NETWORKING
+#include <net/net_http.h>
+
 #include "network/netplay/netplay.h"
 #endif
 
@@ -64,6 +67,7 @@
 #include "retroarch.h"
 #include "runloop.h"
 #include "file_path_special.h"
+#include "gfx/video_pacing.h"
 #include "managers/core_option_manager.h"
 #include "managers/cheat_manager.h"
 #include "managers/state_manager.h"
@@ -510,6 +514,12 @@ bool runloop_ctl(enum runloop_ctl_state state, void *data)
             bool threaded_enable = false;
 #endif
             task_queue_deinit();
+            file_archive_cache_deinit();
+            file_archive_cache_init();
+#ifdef HAVE_NETWORKING
+            net_http_pool_deinit();
+            net_http_pool_init();
+#endif
             task_queue_init(threaded_enable, runloop_msg_queue_push);
          }
          break;
@@ -525,7 +535,24 @@ bool runloop_ctl(enum runloop_ctl_state state, void *data)
          runloop_exec = true;
          break;
       case RUNLOOP_CTL_DATA_DEINIT:
+         {
+            task_queue_stats_t stats;
+
+            task_queue_get_stats(&stats);
+
+            if (stats.pushed)
+               RARCH_LOG("Tasks: %u workers, %u pushed, %u finished, "
+                     "latency avg %u ms, max %u ms.\n",
+                     stats.workers, (unsigned)stats.pushed,
+                     (unsigned)stats.finished,
+                     (unsigned)(stats.latency_avg / 1000),
+                     (unsigned)(stats.latency_max / 1000));
+         }
          task_queue_deinit();
+         file_archive_cache_deinit();
+#ifdef HAVE_NETWORKING
+         net_http_pool_deinit();
+#endif
          break;
       case RUNLOOP_CTL_IS_CORE_OPTION_UPDATED:
          if (!runloop_core_options)
@@ -724,6 +751,9 @@ static enum runloop_state runloop_check_state(
    if (runloop_cmd_triggered(trigger_input, RARCH_GRAB_MOUSE_TOGGLE))
       command_event(CMD_EVENT_GRAB_MOUSE_TOGGLE, NULL);
 
+   if (runloop_cmd_triggered(trigger_input, RARCH_RECORD_REPLAY_SAVE))
+      command_event(CMD_EVENT_RECORD_REPLAY_SAVE, NULL);
+
 
 #ifdef HAVE_OVERLAY
    if (input_keyboard_ctl(
@@ -1149,7 +1179,10 @@ int runloop_iterate(unsigned *sleep_ms)
       input_push_analog_dpad(auto_binds,    dpad_mode);
    }
 
-   if ((settings->video.frame_delay > 0) && !input_driver_is_nonblock)
+   if (settings->video.frame_delay_auto && !input_driver_is_nonblock
+         && !video_driver_is_threaded())
+      video_pacing_wait(settings->video.refresh_rate);
+   else if ((settings->video.frame_delay > 0) && !input_driver_is_nonblock)
       retro_sleep(settings->video.frame_delay);
 
    core_run();
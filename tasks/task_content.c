@@ -43,6 +43,17 @@
 #include "../config.h"
 #endif
 
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
 #include <boolean.h>
 
 #include <encodings/crc32.h>
@@ -56,6 +67,12 @@
 #include <streams/file_stream.h>
 #include <retro_stat.h>
 #include <retro_assert.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <streams/trans_stream.h>
+#endif
 
 #include <lists/string_list.h>
 #include <string/stdstring.h>
@@ -90,9 +107,82 @@
 #include "../file_path_special.h"
 #include "../core.h"
 #include "../dirs.h"
+#include "../managers/extract_cache_manager.h"
 #include "../paths.h"
 #include "../verbosity.h"
 
+/* Content handed to the core in memory. Plain files are mapped
+ * privately, so pages are shared with the page cache and soft
+ * patching only copies the pages it writes to. */
+typedef struct content_buffer
+{
+   uint8_t *data;
+   size_t size;
+   size_t map_size; /* 0 if data is on the heap */
+} content_buffer_t;
+
+static void content_buffer_free(content_buffer_t *content)
+{
+#ifdef HAVE_MMAP
+   if (content->map_size)
+      munmap(content->data, content->map_size);
+   else
+#endif
+      free(content->data);
+
+   content->data     = NULL;
+   content->size     = 0;
+   content->map_size = 0;
+}
+
+/* Replaces the contents of @content with heap memory @data. */
+static void content_buffer_set(content_buffer_t *content,
+      uint8_t *data, size_t size)
+{
+   content_buffer_free(content);
+
+   content->data = data;
+   content->size = size;
+}
+
+/* Shrinks or grows @content to @size bytes. Growing moves mapped
+ * content to the heap and zero fills the new bytes. */
+static bool content_buffer_resize(content_buffer_t *content, size_t size)
+{
+   uint8_t *data = NULL;
+
+   if (size <= content->size)
+   {
+      content->size = size;
+      return true;
+   }
+
+   if (content->map_size)
+   {
+      data = (uint8_t*)malloc(size + 1);
+      if (!data)
+         return false;
+      memcpy(data, content->data, content->size);
+#ifdef HAVE_MMAP
+      munmap(content->data, content->map_size);
+#endif
+   }
+   else
+   {
+      data = (uint8_t*)realloc(content->data, size + 1);
+      if (!data)
+         return false;
+   }
+
+   memset(data + content->size, 0, size + 1 - content->size);
+
+   content->data     = data;
+   content->size     = size;
+   content->map_size = 0;
+
+   return true;
+}
+
 #include "task_patch.c"
 
 #define MAX_ARGS 32
@@ -117,6 +207,8 @@ typedef struct content_information_ctx
    char *directory_cache;
    char *directory_system;
 
+   unsigned extraction_cache_size;
+
    bool history_list_enable;
    bool block_extract;
    bool need_fullpath;
@@ -133,28 +225,517 @@ static bool _content_is_inited                                = false;
 static bool core_does_not_need_content                        = false;
 static uint32_t content_crc                                   = 0;
 
+enum content_load_stage
+{
+   CONTENT_LOAD_STAGE_READ = 0,
+   CONTENT_LOAD_STAGE_DECOMPRESS,
+   CONTENT_LOAD_STAGE_PATCH,
+   CONTENT_LOAD_STAGE_HASH,
+   CONTENT_LOAD_STAGE_CORE,
+   CONTENT_LOAD_STAGE_LAST
+};
+
+/* Time spent in each stage of the last content load. Stages
+ * can overlap, so these add up to more than the load took. */
+static retro_time_t content_load_time[CONTENT_LOAD_STAGE_LAST];
+
+#ifdef HAVE_MMAP
+/**
+ * content_file_map:
+ * @path             : path to file.
+ * @content          : mapping of the file.
+ *
+ * Maps @path copy-on-write. Like filestream_read_file(), the data
+ * is followed by a NUL byte; a file ending on a page boundary gets
+ * an extra zero page for it.
+ *
+ * Returns: true (1) if the file was mapped, otherwise false (0).
+ */
+static bool content_file_map(const char *path, content_buffer_t *content)
+{
+   struct stat st;
+   size_t map_size;
+   void *base      = MAP_FAILED;
+   void *data      = MAP_FAILED;
+   long page_size  = sysconf(_SC_PAGESIZE);
+   int fd          = open(path, O_RDONLY);
+
+   if (fd < 0)
+      return false;
+
+   if (     page_size <= 0
+         || fstat(fd, &st) != 0
+         || !S_ISREG(st.st_mode)
+         || st.st_size <= 0
+         || (uint64_t)st.st_size >= (size_t)-1 - page_size)
+      goto error;
+
+   map_size = ((size_t)st.st_size + page_size) / page_size * page_size;
+   base     = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+   if (base == MAP_FAILED)
+      goto error;
+
+   data     = mmap(base, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_FIXED, fd, 0);
+
+   if (data == MAP_FAILED)
+   {
+      munmap(base, map_size);
+      goto error;
+   }
+
+   close(fd);
+
+#ifdef MADV_WILLNEED
+   /* Start reading ahead, the CRC pass right after faults
+    * the pages in sequentially. */
+   madvise(data, (size_t)st.st_size, MADV_WILLNEED);
+#endif
+
+   content->data     = (uint8_t*)data;
+   content->size     = (size_t)st.st_size;
+   content->map_size = map_size;
+
+   return true;
+
+error:
+   close(fd);
+   return false;
+}
+#endif
+
+#ifdef HAVE_THREADS
+#define CONTENT_PIPELINE_CHUNK_SIZE     (256 * 1024)
+#define CONTENT_PIPELINE_SLOTS          4
+
+/* Overlaps reading, inflating and hashing of one content file.
+ * The reader thread feeds the inflater thread through a bounded
+ * ring of chunks; whichever of them produces the content advances
+ * @available, and the caller hashes up to it while it waits. */
+typedef struct content_pipeline
+{
+   slock_t *lock;
+   scond_t *cond;
+   RFILE *file;
+
+   uint8_t *slots[CONTENT_PIPELINE_SLOTS];
+   size_t slot_size[CONTENT_PIPELINE_SLOTS];
+   unsigned slots_read;
+   unsigned slots_inflated;
+
+   uint8_t *data;
+   size_t size;
+   size_t csize;
+   size_t available;
+
+   bool deflated;
+   bool read_done;
+   bool done;
+   bool failed;
+
+   retro_time_t read_time;
+   retro_time_t decompress_time;
+} content_pipeline_t;
+
+static void content_pipeline_fail(content_pipeline_t *pipe)
+{
+   slock_lock(pipe->lock);
+   pipe->failed = true;
+   scond_broadcast(pipe->cond);
+   slock_unlock(pipe->lock);
+}
+
+static void content_pipeline_reader(void *userdata)
+{
+   content_pipeline_t *pipe = (content_pipeline_t*)userdata;
+   size_t offset            = 0;
+
+   while (offset < pipe->csize)
+   {
+      retro_time_t start;
+      size_t len   = MIN(pipe->csize - offset, CONTENT_PIPELINE_CHUNK_SIZE);
+      uint8_t *dst = pipe->data + offset;
+
+      slock_lock(pipe->lock);
+      while (pipe->deflated && !pipe->failed &&
+            pipe->slots_read - pipe->slots_inflated == CONTENT_PIPELINE_SLOTS)
+         scond_wait(pipe->cond, pipe->lock);
+      if (pipe->deflated)
+         dst = pipe->slots[pipe->slots_read % CONTENT_PIPELINE_SLOTS];
+      if (pipe->failed)
+      {
+         slock_unlock(pipe->lock);
+         return;
+      }
+      slock_unlock(pipe->lock);
+
+      start = cpu_features_get_time_usec();
+
+      if (filestream_read(pipe->file, dst, len) != (ssize_t)len)
+      {
+         content_pipeline_fail(pipe);
+         return;
+      }
+
+      pipe->read_time += cpu_features_get_time_usec() - start;
+      offset          += len;
+
+      slock_lock(pipe->lock);
+      if (pipe->deflated)
+         pipe->slot_size[pipe->slots_read++ % CONTENT_PIPELINE_SLOTS] = len;
+      else
+         pipe->available = offset;
+      scond_broadcast(pipe->cond);
+      slock_unlock(pipe->lock);
+   }
+
+   slock_lock(pipe->lock);
+   pipe->read_done = true;
+   if (!pipe->deflated)
+      pipe->done   = true;
+   scond_broadcast(pipe->cond);
+   slock_unlock(pipe->lock);
+}
+
+static void content_pipeline_inflater(void *userdata)
+{
+   content_pipeline_t *pipe = (content_pipeline_t*)userdata;
+   size_t out               = 0;
+   bool finished            = false;
+   void *stream             = zlib_inflate_backend.stream_new();
+
+   if (!stream)
+      goto error;
+
+   /* ZIP entries are raw deflate streams. */
+   if (zlib_inflate_backend.define)
+      zlib_inflate_backend.define(stream, "window_bits", (uint32_t)-15);
+
+   for (;;)
+   {
+      retro_time_t start;
+      const uint8_t *in = NULL;
+      size_t in_size    = 0;
+      size_t consumed   = 0;
+
+      slock_lock(pipe->lock);
+      while (!pipe->failed && !pipe->read_done &&
+            pipe->slots_read == pipe->slots_inflated)
+         scond_wait(pipe->cond, pipe->lock);
+      if (pipe->failed || pipe->slots_read == pipe->slots_inflated)
+      {
+         slock_unlock(pipe->lock);
+         break;
+      }
+      in      = pipe->slots[pipe->slots_inflated % CONTENT_PIPELINE_SLOTS];
+      in_size = pipe->slot_size[pipe->slots_inflated % CONTENT_PIPELINE_SLOTS];
+      slock_unlock(pipe->lock);
+
+      start = cpu_features_get_time_usec();
+
+      while (consumed < in_size && !finished)
+      {
+         uint32_t rd                   = 0;
+         uint32_t wn                   = 0;
+         enum trans_stream_error error = TRANS_STREAM_ERROR_NONE;
+
+         zlib_inflate_backend.set_in(stream,
+               in + consumed, (uint32_t)(in_size - consumed));
+         zlib_inflate_backend.set_out(stream,
+               pipe->data + out, (uint32_t)(pipe->size - out));
+
+         if (!zlib_inflate_backend.trans(stream, false, &rd, &wn, &error)
+               && error != TRANS_STREAM_ERROR_BUFFER_FULL)
+            goto error;
+
+         consumed += rd;
+         out      += wn;
+
+         if (error == TRANS_STREAM_ERROR_NONE)
+            finished = true;
+         else if (!rd && !wn)
+            goto error;
+      }
+
+      pipe->decompress_time += cpu_features_get_time_usec() - start;
+
+      slock_lock(pipe->lock);
+      pipe->slots_inflated++;
+      pipe->available = out;
+      scond_broadcast(pipe->cond);
+      slock_unlock(pipe->lock);
+   }
+
+   zlib_inflate_backend.stream_free(stream);
+
+   slock_lock(pipe->lock);
+   if (out == pipe->size)
+      pipe->done   = true;
+   else
+      pipe->failed = true;
+   scond_broadcast(pipe->cond);
+   slock_unlock(pipe->lock);
+   return;
+
+error:
+   if (stream)
+      zlib_inflate_backend.stream_free(stream);
+   content_pipeline_fail(pipe);
+}
+
+/**
+ * content_pipeline_load:
+ * @path             : path to file, may point into a ZIP archive.
+ * @content          : buffer to read the contents of the file into.
+ * @crc              : CRC32 of the content. Can be NULL.
+ *
+ * Reads @path on worker threads, inflating ZIP entries on a
+ * second one, while the calling thread hashes what has arrived.
+ * Used for content that cannot be mapped.
+ *
+ * Returns: true (1) if the content was read, false (0) if it
+ * has to be read the regular way.
+ **/
+static bool content_pipeline_load(const char *path,
+      content_buffer_t *content, uint32_t *crc)
+{
+   unsigned i;
+   content_pipeline_t pipe;
+   char archive[PATH_MAX_LENGTH];
+   sthread_t *reader          = NULL;
+   sthread_t *inflater        = NULL;
+   size_t hashed              = 0;
+   uint32_t hash              = 0;
+   int64_t offset             = 0;
+   bool ret                   = false;
+   const char *delim          = path_get_archive_delim(path);
+
+   memset(&pipe, 0, sizeof(pipe));
+
+   archive[0] = '\0';
+   strlcpy(archive, path, sizeof(archive));
+
+   if (delim)
+   {
+      struct file_archive_entry entry;
+
+      archive[delim - path] = '\0';
+
+      if (file_archive_get_file_backend(path)
+            != file_archive_get_zlib_file_backend())
+         return false;
+      if (!file_archive_find_entry(archive, delim + 1, true, &entry))
+         return false;
+      if (entry.cmode != 0 && entry.cmode != 8)
+         return false;
+
+      offset        = (int64_t)entry.offset;
+      pipe.size     = entry.size;
+      pipe.csize    = entry.csize;
+      pipe.deflated = entry.cmode == 8;
+   }
+   else
+   {
+      int32_t size = path_get_size(path);
+
+      if (size < 0)
+         return false;
+
+      pipe.size  = (size_t)size;
+      pipe.csize = pipe.size;
+   }
+
+   /* Threads don't pay off for small files. */
+   if (pipe.size <= CONTENT_PIPELINE_CHUNK_SIZE ||
+         (!pipe.deflated && pipe.csize != pipe.size))
+      return false;
+
+   pipe.file = filestream_open(archive, RFILE_MODE_READ, -1);
+
+   if (!pipe.file)
+      return false;
+
+   if (filestream_seek(pipe.file, (ssize_t)offset, SEEK_SET) != 0)
+      goto end;
+
+   pipe.lock = slock_new();
+   pipe.cond = scond_new();
+   pipe.data = (uint8_t*)malloc(pipe.size + 1);
+
+   if (!pipe.lock || !pipe.cond || !pipe.data)
+      goto end;
+
+   pipe.data[pipe.size] = '\0';
+
+   if (pipe.deflated)
+   {
+      for (i = 0; i < CONTENT_PIPELINE_SLOTS; i++)
+         if (!(pipe.slots[i] = (uint8_t*)malloc(CONTENT_PIPELINE_CHUNK_SIZE)))
+            goto end;
+
+      inflater = sthread_create(content_pipeline_inflater, &pipe);
+
+      if (!inflater)
+         goto end;
+   }
+
+   reader = sthread_create(content_pipeline_reader, &pipe);
+
+   if (!reader)
+   {
+      content_pipeline_fail(&pipe);
+      goto end;
+   }
+
+   for (;;)
+   {
+      size_t available;
+      bool done;
+      retro_time_t now;
+
+      slock_lock(pipe.lock);
+      while (pipe.available == hashed && !pipe.done && !pipe.failed)
+         scond_wait(pipe.cond, pipe.lock);
+      available = pipe.available;
+      done      = pipe.done;
+      ret       = !pipe.failed;
+      slock_unlock(pipe.lock);
+
+      if (!ret)
+         break;
+
+      now = cpu_features_get_time_usec();
+
+      if (crc && available > hashed)
+      {
+         hash    = encoding_crc32(hash, pipe.data + hashed, available - hashed);
+         content_load_time[CONTENT_LOAD_STAGE_HASH] +=
+            cpu_features_get_time_usec() - now;
+      }
+
+      hashed = available;
+
+      if (done && hashed == pipe.size)
+         break;
+   }
+
+end:
+   if (reader)
+      sthread_join(reader);
+   if (inflater)
+      sthread_join(inflater);
+
+   content_load_time[CONTENT_LOAD_STAGE_READ]       += pipe.read_time;
+   content_load_time[CONTENT_LOAD_STAGE_DECOMPRESS] += pipe.decompress_time;
+
+   for (i = 0; i < CONTENT_PIPELINE_SLOTS; i++)
+      free(pipe.slots[i]);
+   if (pipe.cond)
+      scond_free(pipe.cond);
+   if (pipe.lock)
+      slock_free(pipe.lock);
+   filestream_close(pipe.file);
+
+   if (!ret)
+   {
+      free(pipe.data);
+      return false;
+   }
+
+   content->data     = pipe.data;
+   content->size     = pipe.size;
+   content->map_size = 0;
+
+   if (crc)
+      *crc = hash;
+
+   return true;
+}
+#endif
+
 /**
  * content_file_read:
  * @path             : path to file.
- * @buf              : buffer to allocate and read the contents of the
- *                     file into. Needs to be freed manually.
- * @length           : Number of items read, -1 on error.
+ * @content          : buffer to read the contents of the file into.
+ *                     Needs to be freed with content_buffer_free().
+ * @crc              : CRC32 of the content, if it was computed
+ *                     while reading. Can be NULL.
+ * @hashed           : set to whether @crc was computed.
  *
- * Read the contents of a file into @buf. Will call file_archive_compressed_read
- * if path contains a compressed file, otherwise will call filestream_read_file().
+ * Read the contents of a file into @content. Plain files are mapped
+ * where mmap is available. Otherwise, with threads, large files and
+ * ZIP entries are read through content_pipeline_load(). Anything
+ * else goes through file_archive_compressed_read or
+ * filestream_read_file().
  *
  * Returns: 1 if file read, 0 on error.
  */
-static int content_file_read(const char *path, void **buf, ssize_t *length)
+static int content_file_read(const char *path, content_buffer_t *content,
+      uint32_t *crc, bool *hashed)
 {
+   retro_time_t start;
+   void *buf      = NULL;
+   ssize_t length = 0;
+
+   *hashed = false;
+
 #ifdef HAVE_COMPRESSION
    if (path_contains_compressed_file(path))
    {
-      if (file_archive_compressed_read(path, buf, NULL, length))
+#ifdef HAVE_THREADS
+      if (content_pipeline_load(path, content, crc))
+      {
+         *hashed = crc != NULL;
          return 1;
+      }
+#endif
+      start = cpu_features_get_time_usec();
+      if (file_archive_compressed_read(path, &buf, NULL, &length))
+      {
+         content_load_time[CONTENT_LOAD_STAGE_DECOMPRESS] +=
+            cpu_features_get_time_usec() - start;
+         goto read;
+      }
+   }
+#endif
+#ifdef HAVE_MMAP
+   start = cpu_features_get_time_usec();
+   if (content_file_map(path, content))
+   {
+      content_load_time[CONTENT_LOAD_STAGE_READ] +=
+         cpu_features_get_time_usec() - start;
+      return 1;
+   }
+#endif
+#ifdef HAVE_THREADS
+   if (content_pipeline_load(path, content, crc))
+   {
+      *hashed = crc != NULL;
+      return 1;
    }
 #endif
-   return filestream_read_file(path, buf, length);
+   start = cpu_features_get_time_usec();
+   if (!filestream_read_file(path, &buf, &length))
+      return 0;
+   content_load_time[CONTENT_LOAD_STAGE_READ] +=
+      cpu_features_get_time_usec() - start;
+
+#ifdef HAVE_COMPRESSION
+read:
+#endif
+   if (length < 0)
+   {
+      free(buf);
+      return 0;
+   }
+
+   content->data     = (uint8_t*)buf;
+   content->size     = (size_t)length;
+   content->map_size = 0;
+
+   return 1;
 }
 
 /**
@@ -304,9 +885,9 @@ error:
 
 /**
  * load_content_into_memory:
- * @path         : buffer of the content file.
- * @buf          : size   of the content file.
- * @length       : size of the content file that has been read from.
+ * @i            : index of the content file.
+ * @path         : path of the content file.
+ * @content      : buffer the content file is read into.
  *
  * Read the content file. If read into memory, also performs soft patching
  * (see patch_content function) in case soft patching has not been
@@ -316,18 +897,15 @@ error:
  **/
 static bool load_content_into_memory(
       content_information_ctx_t *content_ctx,
-      unsigned i, const char *path, void **buf,
-      ssize_t *length)
+      unsigned i, const char *path, content_buffer_t *content)
 {
+   uint32_t crc              = 0;
+   bool hashed               = false;
    uint32_t *content_crc_ptr = NULL;
-   uint8_t *ret_buf          = NULL;
 
    RARCH_LOG("%s: %s.\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), path);
-   if (!content_file_read(path, (void**) &ret_buf, length))
-      return false;
-
-   if (*length < 0)
+   if (!content_file_read(path, content, i == 0 ? &crc : NULL, &hashed))
       return false;
 
    if (i == 0)
@@ -338,29 +916,66 @@ static bool load_content_into_memory(
       /* Attempt to apply a patch. */
       if (!content_ctx->patch_is_blocked)
       {
-         global_t *global = global_get_ptr();
-         if (global)
-            patch_content(
+         global_t *global   = global_get_ptr();
+         retro_time_t start = cpu_features_get_time_usec();
+
+         /* A patch invalidates the CRC taken while reading. */
+         if (global && patch_content(
                   global->name.ips,
                   global->name.bps,
                   global->name.ups,
-                  (uint8_t**)&ret_buf,
-                  (void*)length);
+                  content))
+            hashed = false;
+
+         content_load_time[CONTENT_LOAD_STAGE_PATCH] +=
+            cpu_features_get_time_usec() - start;
+      }
+
+      if (!hashed)
+      {
+         retro_time_t start = cpu_features_get_time_usec();
+         crc = encoding_crc32(0, content->data, content->size);
+         content_load_time[CONTENT_LOAD_STAGE_HASH] +=
+            cpu_features_get_time_usec() - start;
       }
 
       content_get_crc(&content_crc_ptr);
 
-      *content_crc_ptr = encoding_crc32(0, ret_buf, *length);
+      *content_crc_ptr = crc;
 
       RARCH_LOG("CRC32: 0x%x .\n", (unsigned)*content_crc_ptr);
    }
 
-   *buf = ret_buf;
-
    return true;
 }
 
 #ifdef HAVE_COMPRESSION
+/**
+ * content_file_extract_cached:
+ * @path             : path to a file inside an archive.
+ * @s                : location of the extracted file.
+ * @len              : size of @s.
+ *
+ * Extracts @path through the extraction cache, so launching the
+ * same archived content again reuses the previous extraction.
+ * Only available with a cache directory and a non-zero
+ * extraction_cache_size.
+ *
+ * Returns: true (1) if @s holds the extracted file, otherwise false (0).
+ **/
+static bool content_file_extract_cached(
+      content_information_ctx_t *content_ctx,
+      const char *path, char *s, size_t len)
+{
+   if (     string_is_empty(content_ctx->directory_cache)
+         || !content_ctx->extraction_cache_size)
+      return false;
+
+   return extract_cache_manager_fetch(content_ctx->directory_cache,
+         (uint64_t)content_ctx->extraction_cache_size * 1024 * 1024,
+         path, s, len);
+}
+
 static bool load_content_from_compressed_archive(
       content_information_ctx_t *content_ctx,
       struct retro_game_info *info,
@@ -380,6 +995,15 @@ static bool load_content_from_compressed_archive(
    new_basedir[0]                    = '\0';
    attributes.i                      = 0;
 
+   if (content_file_extract_cached(content_ctx, path,
+            new_path, sizeof(new_path)))
+   {
+      string_list_append(additional_path_allocs, new_path, attributes);
+      info[i].path =
+         additional_path_allocs->elems[additional_path_allocs->size -1 ].data;
+      return true;
+   }
+
    RARCH_LOG("Compressed file in case of need_fullpath."
          " Now extracting to temporary directory.\n");
 
@@ -458,6 +1082,32 @@ static bool content_file_init_extract(
 
       strlcpy(temp_content, path, sizeof(temp_content));
 
+      /* Without a path inside the archive, pick the
+       * first file with a valid extension. */
+      if (valid_ext && !contains_compressed)
+      {
+         struct string_list *list = file_archive_get_file_list(path, valid_ext);
+
+         if (list && list->size > 0)
+         {
+            strlcat(temp_content, "#", sizeof(temp_content));
+            strlcat(temp_content, list->elems[0].data, sizeof(temp_content));
+         }
+
+         string_list_free(list);
+      }
+
+      if (     valid_ext
+            && path_contains_compressed_file(temp_content)
+            && content_file_extract_cached(content_ctx, temp_content,
+               new_path, sizeof(new_path)))
+      {
+         string_list_set(content, i, new_path);
+         continue;
+      }
+
+      strlcpy(temp_content, path, sizeof(temp_content));
+
       if (!valid_ext || !file_archive_extract_file(
                temp_content,
                sizeof(temp_content),
@@ -491,6 +1141,7 @@ static bool content_file_init_extract(
  * content_file_load:
  * @special          : subsystem of content to be loaded. Can be NULL.
  * content           :
+ * @buffers          : in-memory content, one per entry of @content.
  *
  * Load content file (for libretro core).
  *
@@ -501,12 +1152,15 @@ static bool content_file_load(
       const struct string_list *content,
       content_information_ctx_t *content_ctx,
       char **error_string,
-      const struct retro_subsystem_info *special
+      const struct retro_subsystem_info *special,
+      content_buffer_t *buffers
       )
 {
    unsigned i;
    retro_ctx_load_content_info_t load_info;
    char msg[1024];
+   retro_time_t core_start                    = 0;
+   retro_time_t start                         = cpu_features_get_time_usec();
    struct string_list *additional_path_allocs = string_list_new();
 
    msg[0] = '\0';
@@ -514,6 +1168,8 @@ static bool content_file_load(
    if (!additional_path_allocs)
       return false;
 
+   memset(content_load_time, 0, sizeof(content_load_time));
+
    for (i = 0; i < content->size; i++)
    {
       int         attr     = content->elems[i].attr.i;
@@ -540,11 +1196,9 @@ static bool content_file_load(
       {
          /* Load the content into memory. */
 
-         ssize_t len = 0;
-
          if (!load_content_into_memory(
                   content_ctx,
-                  i, path, (void**)&info[i].data, &len))
+                  i, path, &buffers[i]))
          {
             snprintf(msg, sizeof(msg),
                   "%s \"%s\".\n",
@@ -554,7 +1208,8 @@ static bool content_file_load(
             goto error;
          }
 
-         info[i].size = len;
+         info[i].data = buffers[i].data;
+         info[i].size = buffers[i].size;
       }
       else
       {
@@ -580,6 +1235,8 @@ static bool content_file_load(
    load_info.special = special;
    load_info.info    = info;
 
+   core_start = cpu_features_get_time_usec();
+
    if (!core_load_game(&load_info))
    {
       snprintf(msg, sizeof(msg),
@@ -588,6 +1245,18 @@ static bool content_file_load(
       goto error;
    }
 
+   content_load_time[CONTENT_LOAD_STAGE_CORE] =
+      cpu_features_get_time_usec() - core_start;
+
+   RARCH_LOG("Content loaded in %u ms (read: %u ms, decompress: %u ms, "
+         "patch: %u ms, CRC32: %u ms, core: %u ms).\n",
+         (unsigned)((cpu_features_get_time_usec() - start) / 1000),
+         (unsigned)(content_load_time[CONTENT_LOAD_STAGE_READ]       / 1000),
+         (unsigned)(content_load_time[CONTENT_LOAD_STAGE_DECOMPRESS] / 1000),
+         (unsigned)(content_load_time[CONTENT_LOAD_STAGE_PATCH]      / 1000),
+         (unsigned)(content_load_time[CONTENT_LOAD_STAGE_HASH]       / 1000),
+         (unsigned)(content_load_time[CONTENT_LOAD_STAGE_CORE]       / 1000));
+
 #ifdef HAVE_CHEEVOS
    if (!special)
    {
@@ -738,6 +1407,7 @@ static bool content_file_init(
       char **error_string)
 {
    struct retro_game_info               *info = NULL;
+   content_buffer_t                  *buffers = NULL;
    struct string_list *content                = NULL;
    bool ret                                   = path_is_empty(RARCH_PATH_SUBSYSTEM) 
       ? true : false;
@@ -757,19 +1427,22 @@ static bool content_file_init(
 
    info                   = (struct retro_game_info*)
       calloc(content->size, sizeof(*info));
+   buffers                = (content_buffer_t*)
+      calloc(content->size, sizeof(*buffers));
 
-   if (info)
+   if (info && buffers)
    {
       unsigned i;
       ret = content_file_load(info, content, content_ctx, error_string,
-            special);
+            special, buffers);
 
       for (i = 0; i < content->size; i++)
-         free((void*)info[i].data);
-
-      free(info);
+         content_buffer_free(&buffers[i]);
    }
 
+   free(buffers);
+   free(info);
+
 error:
    if (content)
       string_list_free(content);
@@ -1034,6 +1707,7 @@ bool task_push_start_dummy_core(content_ctx_info_t *content_info)
    content_ctx.history_list_enable            = false;
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
+   content_ctx.extraction_cache_size          = 0;
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
@@ -1108,6 +1782,7 @@ bool task_push_load_content_from_playlist_from_menu(
    content_ctx.history_list_enable            = false;
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
+   content_ctx.extraction_cache_size          = 0;
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
@@ -1184,6 +1859,7 @@ bool task_push_start_current_core(content_ctx_info_t *content_info)
    content_ctx.history_list_enable            = false;
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
+   content_ctx.extraction_cache_size          = 0;
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
@@ -1293,6 +1969,7 @@ bool task_push_load_content_with_new_core_from_menu(
    content_ctx.history_list_enable            = false;
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
+   content_ctx.extraction_cache_size          = 0;
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
@@ -1373,6 +2050,7 @@ static bool task_load_content_callback(content_ctx_info_t *content_info,
    content_ctx.history_list_enable            = false;
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
+   content_ctx.extraction_cache_size          = 0;
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
@@ -1623,6 +2301,7 @@ bool content_init(void)
    content_ctx.history_list_enable            = false;
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
+   content_ctx.extraction_cache_size          = 0;
    content_ctx.valid_extensions               = NULL;
    content_ctx.block_extract                  = false;
    content_ctx.need_fullpath                  = false;
@@ -1641,6 +2320,7 @@ bool content_init(void)
          content_ctx.directory_system         = strdup(settings->directory.system);
       if (!string_is_empty(settings->directory.cache))
          content_ctx.directory_cache          = strdup(settings->directory.cache);
+      content_ctx.extraction_cache_size       = settings->extraction_cache_size;
       if (!string_is_empty(sys_info->info.valid_extensions))
          content_ctx.valid_extensions         = strdup(sys_info->info.valid_extensions);
 
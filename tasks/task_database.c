@@ -36,21 +36,55 @@
 #include "../verbosity.h"
 #include "../core_info.h"
 
+#ifdef HAVE_THREADS
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
+#endif
+
 #ifndef COLLECTION_SIZE
 #define COLLECTION_SIZE                99999
 #endif
 
-typedef struct database_state_handle
+#ifndef DATABASE_SCAN_MAX_THREADS
+#define DATABASE_SCAN_MAX_THREADS      8
+#endif
+
+#define DATABASE_SCAN_CHUNK_SIZE       (64 * 1024)
+
+/* What the scan workers found out about one content file. */
+typedef struct database_scan_result
 {
-   database_info_list_t *info;
-   struct string_list *list;
-   size_t list_index;
-   size_t entry_index;
+   enum database_type type;
    uint32_t crc;
    uint32_t archive_crc;
-   uint8_t *buf;
-   char archive_name[511];
-   char serial[4096];
+   char *serial;
+   bool ready;
+} database_scan_result_t;
+
+/* Hashes and identifies content files ahead of the task, which
+ * only has to look the results up and update the playlists. */
+typedef struct database_scan_pool
+{
+   const struct string_list *list;
+   database_scan_result_t *results;
+#ifdef HAVE_THREADS
+   sthread_t *threads[DATABASE_SCAN_MAX_THREADS];
+   unsigned num_threads;
+   slock_t *lock;
+   scond_t *cond;
+   size_t next;
+   bool cancel;
+#endif
+} database_scan_pool_t;
+
+typedef struct database_state_handle
+{
+   struct string_list *list;
+   database_info_index_t **indexes;
+   bool *index_failed;
+   playlist_t **playlists;
+   playlist_t *lutro_playlist;
+   database_scan_pool_t *pool;
 } database_state_handle_t;
 
 typedef struct db_handle
@@ -58,31 +92,11 @@ typedef struct db_handle
    database_state_handle_t state;
    database_info_handle_t *handle;
    unsigned status;
+   bool playlist_binary_format;
    char playlist_directory[4096];
    char content_database_path[4096];
 } db_handle_t;
 
-static void database_info_set_type(database_info_handle_t *handle, enum database_type type)
-{
-   if (!handle)
-      return;
-   handle->type = type;
-}
-
-static enum database_type database_info_get_type(database_info_handle_t *handle)
-{
-   if (!handle)
-      return DATABASE_TYPE_NONE;
-   return handle->type;
-}
-
-static const char *database_info_get_current_name(database_state_handle_t *handle)
-{
-   if (!handle || !handle->list)
-      return NULL;
-   return handle->list->elems[handle->list_index].data;
-}
-
 static const char *database_info_get_current_element_name(database_info_handle_t *handle)
 {
    if (!handle || !handle->list)
@@ -122,8 +136,7 @@ static int task_database_iterate_start(database_info_handle_t *db,
    return 0;
 }
 
-static int iso_get_serial(database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name, char* serial)
+static int iso_get_serial(const char *name, char* serial)
 {
    const char* system_name = NULL;
    int                 rv  = detect_system(name, &system_name);
@@ -147,8 +160,7 @@ static int iso_get_serial(database_state_handle_t *db_state,
    return 0;
 }
 
-static int cue_get_serial(database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name, char* serial)
+static int cue_get_serial(const char *name, char* serial)
 {
    char track_path[PATH_MAX_LENGTH];
    int32_t offset                   = 0;
@@ -169,198 +181,322 @@ static int cue_get_serial(database_state_handle_t *db_state,
 
    RARCH_LOG("%s\n", msg_hash_to_str(MSG_READING_FIRST_DATA_TRACK));
 
-   return iso_get_serial(db_state, db, track_path, serial);
+   return iso_get_serial(track_path, serial);
 }
 
-static bool file_get_crc(database_state_handle_t *db_state,
-      const char *name, uint32_t *crc)
+/* Streams the file through a fixed-size buffer, so that
+ * several workers hashing disc images at once don't each
+ * hold a whole image in memory. */
+static bool file_get_crc(const char *name, uint32_t *crc)
 {
    ssize_t ret;
-   int read_from            = filestream_read_file(
-         name, (void**)&db_state->buf, &ret);
+   uint8_t *buf = NULL;
+   RFILE *fd    = filestream_open(name, RFILE_MODE_READ, -1);
 
-   if (read_from != 1 || ret <= 0)
-      return 0;
+   if (!fd)
+      return false;
 
-   *crc = encoding_crc32(0, db_state->buf, ret);
+   buf = (uint8_t*)malloc(DATABASE_SCAN_CHUNK_SIZE);
 
-   return 1;
+   if (!buf)
+   {
+      filestream_close(fd);
+      return false;
+   }
+
+   *crc = 0;
+
+   while ((ret = filestream_read(fd, buf, DATABASE_SCAN_CHUNK_SIZE)) > 0)
+      *crc = encoding_crc32(*crc, buf, ret);
+
+   free(buf);
+   filestream_close(fd);
+
+   return ret == 0 && *crc != 0;
 }
 
-static int task_database_iterate_playlist(
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+/* Runs on the scan workers: everything here must only
+ * touch the file itself and @result. */
+static void database_scan_file(const char *name,
+      database_scan_result_t *result)
 {
-   char parent_dir[PATH_MAX_LENGTH];
-
-   parent_dir[0] = '\0';
+   char serial[4096];
 
-   path_parent_dir(parent_dir);
+   serial[0]    = '\0';
+   result->type = DATABASE_TYPE_NONE;
 
-   switch (msg_hash_to_file_type(msg_hash_calculate(path_get_extension(name))))
+   if (path_contains_compressed_file(name))
    {
-      case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         /* first check crc of archive itself */
-         return file_get_crc(db_state, name, &db_state->archive_crc);
-#else
-         break;
+      result->crc = file_archive_get_file_crc32(name);
+      if (result->crc)
+         result->type = DATABASE_TYPE_CRC_LOOKUP;
 #endif
+      return;
+   }
+
+   switch (msg_hash_to_file_type(msg_hash_calculate(path_get_extension(name))))
+   {
       case FILE_TYPE_CUE:
-         db_state->serial[0] = '\0';
-         cue_get_serial(db_state, db, name, db_state->serial);
-         database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         cue_get_serial(name, serial);
+         result->type = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_ISO:
-         db_state->serial[0] = '\0';
-         iso_get_serial(db_state, db, name, db_state->serial);
-         database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         iso_get_serial(name, serial);
+         result->type = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_LUTRO:
-         database_info_set_type(db, DATABASE_TYPE_ITERATE_LUTRO);
+         result->type = DATABASE_TYPE_ITERATE_LUTRO;
+         break;
+#ifdef HAVE_COMPRESSION
+      case FILE_TYPE_COMPRESSED:
+         /* first check crc of archive itself */
+         if (file_get_crc(name, &result->archive_crc))
+            result->type = DATABASE_TYPE_CRC_LOOKUP;
          break;
+#endif
       default:
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         return file_get_crc(db_state, name, &db_state->crc);
+         if (file_get_crc(name, &result->crc))
+            result->type = DATABASE_TYPE_CRC_LOOKUP;
+         break;
    }
 
-   return 1;
+   if (!string_is_empty(serial))
+      result->serial = strdup(serial);
 }
 
-static int database_info_list_iterate_end_no_match(
-      database_state_handle_t *db_state)
+#ifdef HAVE_THREADS
+static void database_scan_thread(void *data)
 {
-   /* Reached end of database list,
-    * CRC match probably didn't succeed. */
-   db_state->list_index  = 0;
-   db_state->entry_index = 0;
+   database_scan_pool_t *pool = (database_scan_pool_t*)data;
 
-   if (db_state->crc != 0)
-      db_state->crc = 0;
+   for (;;)
+   {
+      size_t i;
+      database_scan_result_t result = {DATABASE_TYPE_NONE};
 
-   return 0;
+      slock_lock(pool->lock);
+      if (pool->cancel || pool->next >= pool->list->size)
+      {
+         slock_unlock(pool->lock);
+         break;
+      }
+      i = pool->next++;
+      slock_unlock(pool->lock);
+
+      database_scan_file(pool->list->elems[i].data, &result);
+      result.ready = true;
+
+      slock_lock(pool->lock);
+      pool->results[i] = result;
+      scond_broadcast(pool->cond);
+      slock_unlock(pool->lock);
+   }
 }
+#endif
 
-static int task_database_iterate_next(database_info_handle_t *db)
+static void database_scan_pool_free(database_scan_pool_t *pool)
 {
-   db->list_ptr++;
+   size_t i;
 
-   if (db->list_ptr < db->list->size)
-      return 0;
-   return -1;
+   if (!pool)
+      return;
+
+#ifdef HAVE_THREADS
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->cancel = true;
+      slock_unlock(pool->lock);
+   }
+
+   for (i = 0; i < pool->num_threads; i++)
+      sthread_join(pool->threads[i]);
+
+   if (pool->cond)
+      scond_free(pool->cond);
+   if (pool->lock)
+      slock_free(pool->lock);
+#endif
+
+   if (pool->results)
+   {
+      for (i = 0; i < pool->list->size; i++)
+         free(pool->results[i].serial);
+      free(pool->results);
+   }
+
+   free(pool);
 }
 
-static int database_info_list_iterate_new(database_state_handle_t *db_state,
-      const char *query)
+static database_scan_pool_t *database_scan_pool_new(
+      const struct string_list *list)
 {
-   const char *new_database = database_info_get_current_name(db_state);
+   database_scan_pool_t *pool = (database_scan_pool_t*)
+      calloc(1, sizeof(*pool));
 
-#if 0
-   RARCH_LOG("Check database [%d/%d] : %s\n", (unsigned)db_state->list_index,
-         (unsigned)db_state->list->size, new_database);
+   if (!pool)
+      return NULL;
+
+   pool->list    = list;
+   pool->results = (database_scan_result_t*)
+      calloc(list->size ? list->size : 1, sizeof(*pool->results));
+
+   if (!pool->results)
+      goto error;
+
+#ifdef HAVE_THREADS
+   {
+      unsigned i;
+      unsigned num_threads = cpu_features_get_core_amount();
+
+      if (num_threads > DATABASE_SCAN_MAX_THREADS)
+         num_threads = DATABASE_SCAN_MAX_THREADS;
+      if (num_threads > list->size)
+         num_threads = (unsigned)list->size;
+
+      pool->lock = slock_new();
+      pool->cond = scond_new();
+
+      if (!pool->lock || !pool->cond)
+         goto error;
+
+      for (i = 0; i < num_threads; i++)
+      {
+         pool->threads[pool->num_threads] =
+            sthread_create(database_scan_thread, pool);
+         if (!pool->threads[pool->num_threads])
+            break;
+         pool->num_threads++;
+      }
+
+      RARCH_LOG("[Scanner] Hashing content on %u threads.\n",
+            pool->num_threads);
+   }
+#endif
+
+   return pool;
+
+error:
+   database_scan_pool_free(pool);
+   return NULL;
+}
+
+/* Returns the result for element @i once it is available,
+ * or NULL if the workers haven't got to it yet. */
+static const database_scan_result_t *database_scan_pool_get(
+      database_scan_pool_t *pool, size_t i)
+{
+   database_scan_result_t *result = &pool->results[i];
+
+#ifdef HAVE_THREADS
+   if (pool->num_threads)
+   {
+      bool ready;
+
+      slock_lock(pool->lock);
+      /* Wait briefly instead of spinning through the task
+       * queue while the workers are busy. */
+      if (!result->ready)
+         scond_wait_timeout(pool->cond, pool->lock, 2000);
+      ready = result->ready;
+      slock_unlock(pool->lock);
+
+      return ready ? result : NULL;
+   }
 #endif
-   if (db_state->info)
+
+   if (!result->ready)
    {
-      database_info_list_free(db_state->info);
-      free(db_state->info);
+      database_scan_file(pool->list->elems[i].data, result);
+      result->ready = true;
    }
-   db_state->info = database_info_list_new(new_database, query);
-   return 0;
+
+   return result;
+}
+
+static playlist_t *database_state_get_playlist(db_handle_t *_db,
+      database_state_handle_t *db_state, size_t rdb_index,
+      char *db_playlist_base_str, size_t len)
+{
+   char db_playlist_path[PATH_MAX_LENGTH];
+
+   db_playlist_path[0] = '\0';
+
+   fill_short_pathname_representation_noext(db_playlist_base_str,
+         db_state->list->elems[rdb_index].data, len);
+
+   strlcat(db_playlist_base_str,
+         file_path_str(FILE_PATH_LPL_EXTENSION), len);
+
+   /* Collections stay open until the scan ends, instead of
+    * being read and rewritten for every match. */
+   if (!db_state->playlists[rdb_index])
+   {
+      fill_pathname_join(db_playlist_path, _db->playlist_directory,
+            db_playlist_base_str, sizeof(db_playlist_path));
+      db_state->playlists[rdb_index] = playlist_init(db_playlist_path,
+            COLLECTION_SIZE, _db->playlist_binary_format);
+   }
+
+   return db_state->playlists[rdb_index];
 }
 
 static int database_info_list_iterate_found_match(
       db_handle_t *_db,
       database_state_handle_t *db_state,
       database_info_handle_t *db,
-      const char *archive_name
-      )
+      size_t rdb_index,
+      const database_info_index_entry_t *db_info_entry)
 {
    char db_crc[PATH_MAX_LENGTH];
-   char db_playlist_path[PATH_MAX_LENGTH];
    char  db_playlist_base_str[PATH_MAX_LENGTH];
-   char entry_path_str[PATH_MAX_LENGTH];
    playlist_t   *playlist                      = NULL;
-   const char         *db_path                 =
-      database_info_get_current_name(db_state);
    const char         *entry_path              =
       database_info_get_current_element_name(db);
-   database_info_t *db_info_entry              =
-      &db_state->info->list[db_state->entry_index];
 
    db_crc[0] = '\0';
-   db_playlist_path[0] = '\0';
    db_playlist_base_str[0] = '\0';
-   entry_path_str[0] = '\0';
-
-   fill_short_pathname_representation_noext(db_playlist_base_str,
-         db_path, sizeof(db_playlist_base_str));
-
-   strlcat(db_playlist_base_str,
-         file_path_str(FILE_PATH_LPL_EXTENSION),
-         sizeof(db_playlist_base_str));
-   fill_pathname_join(db_playlist_path, _db->playlist_directory,
-         db_playlist_base_str, sizeof(db_playlist_path));
-
-   playlist = playlist_init(db_playlist_path, COLLECTION_SIZE);
 
+   playlist = database_state_get_playlist(_db, db_state, rdb_index,
+         db_playlist_base_str, sizeof(db_playlist_base_str));
 
    snprintf(db_crc, sizeof(db_crc), "%08X|crc", db_info_entry->crc32);
 
-   if (entry_path)
-      strlcpy(entry_path_str, entry_path, sizeof(entry_path_str));
-
-   if (!string_is_empty(archive_name))
-      fill_pathname_join_delim(entry_path_str, entry_path_str, archive_name,
-            '#', sizeof(entry_path_str));
-
 #if 0
    RARCH_LOG("Found match in database !\n");
 
-   RARCH_LOG("Path: %s\n", db_path);
+   RARCH_LOG("Path: %s\n", db_state->list->elems[rdb_index].data);
    RARCH_LOG("CRC : %s\n", db_crc);
-   RARCH_LOG("Playlist Path: %s\n", db_playlist_path);
    RARCH_LOG("Entry Path: %s\n", entry_path);
    RARCH_LOG("Playlist not NULL: %d\n", playlist != NULL);
-   RARCH_LOG("ZIP entry: %s\n", archive_name);
-   RARCH_LOG("entry path str: %s\n", entry_path_str);
 #endif
 
-   if(!playlist_entry_exists(playlist, entry_path_str, db_crc))
+   if(entry_path && !playlist_entry_exists(playlist, entry_path, db_crc))
    {
-      playlist_push(playlist, entry_path_str,
+      playlist_push(playlist, entry_path,
             db_info_entry->name,
             file_path_str(FILE_PATH_DETECT),
             file_path_str(FILE_PATH_DETECT),
             db_crc, db_playlist_base_str);
    }
 
-   playlist_write_file(playlist);
-   playlist_free(playlist);
-
-   database_info_list_free(db_state->info);
-   free(db_state->info);
-
-   db_state->info = NULL;
-   db_state->crc  = 0;
-
    return 0;
 }
 
-/* End of entries in database info list and didn't find a
- * match, go to the next database. */
-static int database_info_list_iterate_next(
-      database_state_handle_t *db_state
-      )
+static database_info_index_t *database_state_get_index(
+      database_state_handle_t *db_state, size_t rdb_index)
 {
-   db_state->list_index++;
-   db_state->entry_index = 0;
-
-   database_info_list_free(db_state->info);
-   free(db_state->info);
-   db_state->info        = NULL;
+   /* Each database is read once per scan, no matter how
+    * many files are looked up in it. */
+   if (!db_state->indexes[rdb_index] && !db_state->index_failed[rdb_index])
+   {
+      db_state->indexes[rdb_index] = database_info_index_new(
+            db_state->list->elems[rdb_index].data);
+      db_state->index_failed[rdb_index] = !db_state->indexes[rdb_index];
+   }
 
-   return 1;
+   return db_state->indexes[rdb_index];
 }
 
 static int task_database_iterate_crc_lookup(
@@ -368,115 +504,62 @@ static int task_database_iterate_crc_lookup(
       database_state_handle_t *db_state,
       database_info_handle_t *db,
       const char *name,
-      const char *archive_entry)
+      const database_scan_result_t *result)
 {
+   size_t i;
+   bool unsupported_content;
 
-   if (!db_state->list ||
-         (unsigned)db_state->list_index == (unsigned)db_state->list->size)
-      return database_info_list_iterate_end_no_match(db_state);
-
-   if (db_state->entry_index == 0)
-   {
-      bool db_supports_content;
-      bool unsupported_content;
-      char query[50];
+   if (!db_state->list)
+      return 0;
 
-      query[0] = '\0';
+   unsupported_content = core_info_unsupported_content_path(name);
 
-      db_supports_content = core_info_database_supports_content_path(
-            db_state->list->elems[db_state->list_index].data, name);
-      unsupported_content = core_info_unsupported_content_path(name);
+   for (i = 0; i < db_state->list->size; i++)
+   {
+      const database_info_index_entry_t *db_info_entry = NULL;
+      database_info_index_t *index                     = NULL;
+      bool db_supports_content = core_info_database_supports_content_path(
+            db_state->list->elems[i].data, name);
 
       /* don't scan files that can't be in this database */
       if(!db_supports_content && !unsupported_content)
-         return database_info_list_iterate_next(db_state);
+         continue;
 
-      snprintf(query, sizeof(query),
-            "{crc:or(b\"%08X\",b\"%08X\")}",
-            swap_if_big32(db_state->crc),
-            swap_if_big32(db_state->archive_crc));
+      if (!(index = database_state_get_index(db_state, i)))
+         continue;
 
-      database_info_list_iterate_new(db_state, query);
+      if (     (db_info_entry = database_info_index_find_crc(index, result->archive_crc))
+            || (db_info_entry = database_info_index_find_crc(index, result->crc)))
+         return database_info_list_iterate_found_match(
+               _db, db_state, db, i, db_info_entry);
    }
 
-   if (db_state->info)
-   {
-      database_info_t *db_info_entry =
-         &db_state->info->list[db_state->entry_index];
-
-      if (db_info_entry && db_info_entry->crc32)
-      {
-#if 0
-         RARCH_LOG("CRC32: 0x%08X , entry CRC32: 0x%08X (%s).\n",
-               db_state->crc, db_info_entry->crc32, db_info_entry->name);
-#endif
-         if (db_state->archive_crc == db_info_entry->crc32)
-            return database_info_list_iterate_found_match(
-                  _db,
-                  db_state, db, NULL);
-         if (db_state->crc == db_info_entry->crc32)
-            return database_info_list_iterate_found_match(
-                  _db,
-                  db_state, db, archive_entry);
-      }
-   }
-
-   db_state->entry_index++;
-
-   if (db_state->info)
-   {
-      if (db_state->entry_index >= db_state->info->count)
-         return database_info_list_iterate_next(db_state);
-   }
-
-   /* If we haven't reached the end of the database list yet,
-    * continue iterating. */
-   if (db_state->list_index < db_state->list->size)
-      return 1;
-
-   database_info_list_free(db_state->info);
-
-   if (db_state->info)
-      free(db_state->info);
-
    return 0;
 }
 
-static int task_database_iterate_playlist_archive(
-      db_handle_t *_db,
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
-{
-#ifdef HAVE_COMPRESSION
-   if (db_state->crc != 0)
-      return task_database_iterate_crc_lookup(
-            _db, db_state, db, name, db_state->archive_name);
-
-   db_state->crc = file_archive_get_file_crc32(name);
-#endif
-
-   return 1;
-}
-
 static int task_database_iterate_playlist_lutro(
       db_handle_t *_db,
       database_state_handle_t *db_state,
       database_info_handle_t *db,
       const char *path)
 {
-   char db_playlist_path[PATH_MAX_LENGTH];
-   playlist_t   *playlist                  = NULL;
+   if (!db_state->lutro_playlist)
+   {
+      char db_playlist_path[PATH_MAX_LENGTH];
 
-   db_playlist_path[0]                     = '\0';
+      db_playlist_path[0]                  = '\0';
 
-   fill_pathname_join(db_playlist_path,
-         _db->playlist_directory,
-         file_path_str(FILE_PATH_LUTRO_PLAYLIST),
-         sizeof(db_playlist_path));
+      fill_pathname_join(db_playlist_path,
+            _db->playlist_directory,
+            file_path_str(FILE_PATH_LUTRO_PLAYLIST),
+            sizeof(db_playlist_path));
 
-   playlist = playlist_init(db_playlist_path, COLLECTION_SIZE);
+      db_state->lutro_playlist = playlist_init(db_playlist_path,
+            COLLECTION_SIZE, _db->playlist_binary_format);
+   }
 
-   if(!playlist_entry_exists(playlist, path, file_path_str(FILE_PATH_DETECT)))
+   if(!playlist_entry_exists(db_state->lutro_playlist,
+            path, file_path_str(FILE_PATH_DETECT)))
    {
       char game_title[PATH_MAX_LENGTH];
 
@@ -485,7 +568,7 @@ static int task_database_iterate_playlist_lutro(
       fill_short_pathname_representation_noext(game_title,
             path, sizeof(game_title));
 
-      playlist_push(playlist, path,
+      playlist_push(db_state->lutro_playlist, path,
             game_title,
             file_path_str(FILE_PATH_DETECT),
             file_path_str(FILE_PATH_DETECT),
@@ -493,9 +576,6 @@ static int task_database_iterate_playlist_lutro(
             file_path_str(FILE_PATH_LUTRO_PLAYLIST));
    }
 
-   playlist_write_file(playlist);
-   playlist_free(playlist);
-
    return 0;
 }
 
@@ -503,92 +583,59 @@ static int task_database_iterate_playlist_lutro(
 static int task_database_iterate_serial_lookup(
       db_handle_t *_db,
       database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+      database_info_handle_t *db,
+      const database_scan_result_t *result)
 {
-   if (!db_state->list ||
-         (unsigned)db_state->list_index == (unsigned)db_state->list->size)
-      return database_info_list_iterate_end_no_match(db_state);
-
-   if (db_state->entry_index == 0)
-   {
-      char query[50];
-      char *serial_buf =
-         bin_to_hex_alloc((uint8_t*)db_state->serial, 10 * sizeof(uint8_t));
-
-      if (!serial_buf)
-         return 1;
+   size_t i;
 
-      query[0] = '\0';
-
-      snprintf(query, sizeof(query), "{'serial': b'%s'}", serial_buf);
-      database_info_list_iterate_new(db_state, query);
-
-      free(serial_buf);
-   }
+   if (!db_state->list || string_is_empty(result->serial))
+      return 0;
 
-   if (db_state->info)
+   for (i = 0; i < db_state->list->size; i++)
    {
-      database_info_t *db_info_entry = &db_state->info->list[
-         db_state->entry_index];
+      const database_info_index_entry_t *db_info_entry = NULL;
+      database_info_index_t *index = database_state_get_index(db_state, i);
+
+      if (!index)
+         continue;
 
-      if (db_info_entry && db_info_entry->serial)
-      {
 #if 0
-         RARCH_LOG("serial: %s , entry serial: %s (%s).\n",
-                   db_state->serial, db_info_entry->serial,
-                   db_info_entry->name);
+      RARCH_LOG("serial: %s (%s).\n", result->serial,
+            db_state->list->elems[i].data);
 #endif
-         if (string_is_equal(db_state->serial, db_info_entry->serial))
-            return database_info_list_iterate_found_match(_db,
-                  db_state, db, NULL);
-      }
-   }
-
-   db_state->entry_index++;
-
-   if (db_state->info)
-   {
-      if (db_state->entry_index >= db_state->info->count)
-         return database_info_list_iterate_next(db_state);
+      if ((db_info_entry = database_info_index_find_serial(index,
+                  result->serial)))
+         return database_info_list_iterate_found_match(_db,
+               db_state, db, i, db_info_entry);
    }
 
-   /* If we haven't reached the end of the database list yet,
-    * continue iterating. */
-   if (db_state->list_index < db_state->list->size)
-      return 1;
-
-   database_info_list_free(db_state->info);
-   free(db_state->info);
    return 0;
 }
 
+/* Returns 1 while the current file is still being hashed,
+ * 0 once it has been dealt with. */
 static int task_database_iterate(
       db_handle_t *_db,
       database_state_handle_t *db_state,
       database_info_handle_t *db)
 {
+   const database_scan_result_t *result = NULL;
    const char *name = database_info_get_current_element_name(db);
 
-   if (!name)
+   if (!name || !db_state->pool)
       return 0;
 
-   if (database_info_get_type(db) == DATABASE_TYPE_ITERATE)
-      if (path_contains_compressed_file(name))
-         database_info_set_type(db, DATABASE_TYPE_ITERATE_ARCHIVE);
+   if (!(result = database_scan_pool_get(db_state->pool, db->list_ptr)))
+      return 1;
 
-   switch (database_info_get_type(db))
+   switch (result->type)
    {
-      case DATABASE_TYPE_ITERATE:
-         return task_database_iterate_playlist(db_state, db, name);
-      case DATABASE_TYPE_ITERATE_ARCHIVE:
-         return task_database_iterate_playlist_archive(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_LUTRO:
          return task_database_iterate_playlist_lutro(_db, db_state, db, name);
       case DATABASE_TYPE_SERIAL_LOOKUP:
-         return task_database_iterate_serial_lookup(_db, db_state, db, name);
+         return task_database_iterate_serial_lookup(_db, db_state, db, result);
       case DATABASE_TYPE_CRC_LOOKUP:
-         return task_database_iterate_crc_lookup(_db, db_state, db, name, NULL);
-      case DATABASE_TYPE_NONE:
+         return task_database_iterate_crc_lookup(_db, db_state, db, name, result);
       default:
          break;
    }
@@ -596,15 +643,80 @@ static int task_database_iterate(
    return 0;
 }
 
-static void task_database_cleanup_state(
-      database_state_handle_t *db_state)
+static int task_database_iterate_next(database_info_handle_t *db)
 {
-   if (!db_state)
-      return;
+   db->list_ptr++;
+
+   if (db->list_ptr < db->list->size)
+      return 0;
+   return -1;
+}
+
+static bool task_database_init_state(db_handle_t *db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *dbinfo)
+{
+   size_t num_rdb = 0;
+
+   db_state->list = dir_list_new_special(
+         db->content_database_path,
+         DIR_LIST_DATABASES, NULL);
+
+   if (db_state->list)
+      num_rdb = db_state->list->size;
+
+   db_state->indexes      = (database_info_index_t**)
+      calloc(num_rdb + 1, sizeof(*db_state->indexes));
+   db_state->index_failed = (bool*)
+      calloc(num_rdb + 1, sizeof(*db_state->index_failed));
+   db_state->playlists    = (playlist_t**)
+      calloc(num_rdb + 1, sizeof(*db_state->playlists));
+   db_state->pool         = database_scan_pool_new(dbinfo->list);
+
+   return db_state->indexes && db_state->index_failed
+      && db_state->playlists && db_state->pool;
+}
+
+static void task_database_free_state(database_state_handle_t *db_state)
+{
+   size_t i;
+
+   /* Stop the workers first, they reference the content list. */
+   database_scan_pool_free(db_state->pool);
+   db_state->pool = NULL;
+
+   if (db_state->list)
+   {
+      for (i = 0; i < db_state->list->size; i++)
+      {
+         if (db_state->indexes)
+            database_info_index_free(db_state->indexes[i]);
+
+         if (db_state->playlists && db_state->playlists[i])
+         {
+            playlist_write_file(db_state->playlists[i]);
+            playlist_free(db_state->playlists[i]);
+         }
+      }
+
+      dir_list_free(db_state->list);
+   }
+
+   if (db_state->lutro_playlist)
+   {
+      playlist_write_file(db_state->lutro_playlist);
+      playlist_free(db_state->lutro_playlist);
+   }
 
-   if (db_state->buf)
-      free(db_state->buf);
-   db_state->buf = NULL;
+   free(db_state->indexes);
+   free(db_state->index_failed);
+   free(db_state->playlists);
+
+   db_state->list           = NULL;
+   db_state->indexes        = NULL;
+   db_state->index_failed   = NULL;
+   db_state->playlists      = NULL;
+   db_state->lutro_playlist = NULL;
 }
 
 static void task_database_handler(retro_task_t *task)
@@ -631,19 +743,12 @@ static void task_database_handler(retro_task_t *task)
    switch (dbinfo->status)
    {
       case DATABASE_STATUS_ITERATE_BEGIN:
-         if (dbstate && !dbstate->list)
-         {
-            dbstate->list        = dir_list_new_special(
-                  db->content_database_path,
-                  DIR_LIST_DATABASES, NULL);
-         }
+         if (!dbstate->pool && !task_database_init_state(db, dbstate, dbinfo))
+            goto task_finished;
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
          name = database_info_get_current_element_name(dbinfo);
-         task_database_cleanup_state(dbstate);
-         dbstate->list_index  = 0;
-         dbstate->entry_index = 0;
          task_database_iterate_start(dbinfo, name);
          break;
       case DATABASE_STATUS_ITERATE:
@@ -679,16 +784,10 @@ task_finished:
       task_set_finished(task, true);
 
    if (dbstate)
-   {
-      if (dbstate->list)
-         dir_list_free(dbstate->list);
-   }
+      task_database_free_state(dbstate);
 
    if (db)
    {
-      if (db->state.buf)
-         free(db->state.buf);
-
       if (db->handle)
          database_info_free(db->handle);
       free(db);
@@ -700,6 +799,7 @@ task_finished:
 
 bool task_push_dbscan(
       const char *playlist_directory,
+      bool playlist_binary_format,
       const char *content_database,
       const char *fullpath,
       bool directory, retro_task_callback_t cb)
@@ -713,7 +813,9 @@ bool task_push_dbscan(
    t->handler        = task_database_handler;
    t->state          = db;
    t->callback       = cb;
+   t->priority       = TASK_PRIORITY_LOW;
 
+   db->playlist_binary_format = playlist_binary_format;
    strlcpy(db->playlist_directory, playlist_directory,
          sizeof(db->playlist_directory));
    strlcpy(db->content_database_path, content_database,
@@ -23,11 +23,51 @@
 #include <retro_stat.h>
 #include <compat/strl.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include "tasks_internal.h"
 #include "../file_path_special.h"
 #include "../verbosity.h"
 #include "../msg_hash.h"
 
+/* A ZIP entry waiting to be extracted. */
+struct decompress_entry
+{
+   char *name;
+   const uint8_t *cdata;
+   unsigned cmode;
+   uint32_t csize;
+   uint32_t size;
+   uint32_t crc32;
+};
+
+/* State of a decompress task. ZIP entries are first collected
+ * from the central directory, then extracted by the task and by
+ * helper tasks on the other workers, each entry streaming to disk
+ * on its own. */
+typedef struct decompress_task_state
+{
+   /* Must come first, handlers see a decompress_state_t. */
+   decompress_state_t dec;
+   file_archive_file_cb file_cb;
+   struct decompress_entry *entries;
+   size_t count;
+   size_t capacity;
+   /* next entry to hand out */
+   size_t next;
+   size_t extracted;
+   /* helper tasks still running */
+   unsigned helpers;
+   bool collected;
+   bool failed;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+#endif
+} decompress_task_state_t;
+
 static int file_decompressed_target_file(const char *name,
       const char *valid_exts,
       const uint8_t *cdata,
@@ -152,6 +192,255 @@ static void task_decompress_handler_finished(retro_task_t *task,
    free(dec);
 }
 
+static void task_decompress_lock(decompress_task_state_t *state)
+{
+#ifdef HAVE_THREADS
+   slock_lock(state->lock);
+#endif
+}
+
+static void task_decompress_unlock(decompress_task_state_t *state)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(state->lock);
+#endif
+}
+
+static int file_decompressed_collect(const char *name, const char *valid_exts,
+   const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+   uint32_t crc32, struct archive_extract_userdata *userdata)
+{
+   struct decompress_entry *entry   = NULL;
+   decompress_task_state_t *state   = (decompress_task_state_t*)userdata->dec;
+   const file_archive_transfer_t *archive = &state->dec.archive;
+   uint32_t len = (cmode == ARCHIVE_MODE_UNCOMPRESSED) ? size : csize;
+
+   /* Everything an entry points to has to be inside the archive. */
+   if (     cdata < archive->data
+         || (size_t)(cdata - archive->data) > (size_t)archive->archive_size
+         || len > (size_t)archive->archive_size - (cdata - archive->data)
+         || (cmode == ARCHIVE_MODE_UNCOMPRESSED && size > csize))
+   {
+      state->dec.callback_error = (char*)malloc(PATH_MAX_LENGTH);
+      snprintf(state->dec.callback_error, PATH_MAX_LENGTH,
+            "Corrupt archive entry %s.\n", name);
+      state->failed = true;
+      return 0;
+   }
+
+   if (state->count == state->capacity)
+   {
+      size_t capacity = state->capacity ? state->capacity * 2 : 64;
+      struct decompress_entry *entries = (struct decompress_entry*)
+         realloc(state->entries, capacity * sizeof(*entries));
+
+      if (!entries)
+      {
+         state->failed = true;
+         return 0;
+      }
+
+      state->entries  = entries;
+      state->capacity = capacity;
+   }
+
+   entry        = &state->entries[state->count];
+   entry->name  = strdup(name);
+
+   if (!entry->name)
+   {
+      state->failed = true;
+      return 0;
+   }
+
+   entry->cdata = cdata;
+   entry->cmode = cmode;
+   entry->csize = csize;
+   entry->size  = size;
+   entry->crc32 = crc32;
+
+   state->count++;
+
+   return 1;
+}
+
+static struct decompress_entry *task_decompress_take(
+      decompress_task_state_t *state)
+{
+   struct decompress_entry *entry = NULL;
+
+   task_decompress_lock(state);
+   if (!state->failed && state->next < state->count)
+      entry = &state->entries[state->next++];
+   task_decompress_unlock(state);
+
+   return entry;
+}
+
+static void task_decompress_extract(decompress_task_state_t *state,
+      struct decompress_entry *entry)
+{
+   struct archive_extract_userdata userdata = {{0}};
+   /* A copy, so every extraction reports into its own error. */
+   decompress_state_t dec                   = state->dec;
+   bool ok                                  = false;
+
+   dec.callback_error = NULL;
+   userdata.dec       = &dec;
+   strlcpy(userdata.archive_path, dec.source_file,
+         sizeof(userdata.archive_path));
+
+   ok = state->file_cb(entry->name, dec.valid_ext, entry->cdata,
+         entry->cmode, entry->csize, entry->size, entry->crc32,
+         &userdata) != 0;
+
+   task_decompress_lock(state);
+   state->extracted++;
+   if (!ok)
+   {
+      state->failed = true;
+      if (!state->dec.callback_error)
+         state->dec.callback_error = dec.callback_error;
+      else
+         free(dec.callback_error);
+   }
+   task_decompress_unlock(state);
+}
+
+static void task_decompress_helper_handler(retro_task_t *task)
+{
+   struct decompress_entry *entry = NULL;
+   decompress_task_state_t *state = (decompress_task_state_t*)task->state;
+
+   while ((entry = task_decompress_take(state)))
+      task_decompress_extract(state, entry);
+
+   task_decompress_lock(state);
+   state->helpers--;
+#ifdef HAVE_THREADS
+   scond_signal(state->cond);
+#endif
+   task_decompress_unlock(state);
+
+   task_set_finished(task, true);
+}
+
+/* Puts the other workers to use for the entries. */
+static void task_decompress_push_helpers(decompress_task_state_t *state)
+{
+#ifdef HAVE_THREADS
+   unsigned i;
+   task_queue_stats_t stats;
+
+   task_queue_get_stats(&stats);
+
+   if (!state->lock || !state->cond)
+      return;
+
+   for (i = 1; i < stats.workers && i < state->count; i++)
+   {
+      retro_task_t *t = (retro_task_t*)calloc(1, sizeof(*t));
+
+      if (!t)
+         break;
+
+      t->handler   = task_decompress_helper_handler;
+      t->state     = state;
+      t->mute      = true;
+      /* Helpers of one task all work on the same entries. */
+      t->reentrant = true;
+
+      task_decompress_lock(state);
+      state->helpers++;
+      task_decompress_unlock(state);
+
+      task_queue_ctl(TASK_QUEUE_CTL_PUSH, t);
+   }
+#endif
+}
+
+static void task_decompress_handler_zip(retro_task_t *task)
+{
+   struct decompress_entry *entry           = NULL;
+   decompress_task_state_t *state           = (decompress_task_state_t*)task->state;
+   decompress_state_t *dec                  = &state->dec;
+   unsigned helpers                         = 0;
+   size_t i;
+
+   if (!state->collected)
+   {
+      bool retdec                              = true;
+      struct archive_extract_userdata userdata = {{0}};
+
+      userdata.dec = dec;
+      strlcpy(userdata.archive_path, dec->source_file,
+            sizeof(userdata.archive_path));
+
+      /* Reading the central directory is quick, do it at once.
+       * Stops before the archive gets unmapped. */
+      while (     dec->archive.type == ARCHIVE_TRANSFER_INIT
+               || dec->archive.type == ARCHIVE_TRANSFER_ITERATE)
+         file_archive_parse_file_iterate(&dec->archive, &retdec,
+               dec->source_file, dec->valid_ext,
+               file_decompressed_collect, &userdata);
+
+      if (dec->archive.type == ARCHIVE_TRANSFER_DEINIT_ERROR)
+         state->failed = true;
+
+      state->collected = true;
+
+      if (!state->failed)
+         task_decompress_push_helpers(state);
+      return;
+   }
+
+   if (task_get_cancelled(task))
+   {
+      task_decompress_lock(state);
+      state->next = state->count;
+      task_decompress_unlock(state);
+   }
+   else if ((entry = task_decompress_take(state)))
+   {
+      task_decompress_extract(state, entry);
+
+      task_decompress_lock(state);
+      task_set_progress(task, (int)(state->extracted * 100 / state->count));
+      task_decompress_unlock(state);
+      return;
+   }
+
+   /* Nothing left to hand out, wait for the helpers. */
+   task_decompress_lock(state);
+   helpers = state->helpers;
+#ifdef HAVE_THREADS
+   if (helpers)
+      scond_wait_timeout(state->cond, state->lock, 10000);
+#endif
+   task_decompress_unlock(state);
+
+   if (helpers)
+      return;
+
+   if (state->failed && !dec->callback_error)
+      dec->callback_error = strdup("Decompression failed.");
+
+   task_set_error(task, dec->callback_error);
+   file_archive_parse_file_iterate_stop(&dec->archive);
+
+   for (i = 0; i < state->count; i++)
+      free(state->entries[i].name);
+   free(state->entries);
+#ifdef HAVE_THREADS
+   if (state->cond)
+      scond_free(state->cond);
+   if (state->lock)
+      slock_free(state->lock);
+#endif
+
+   task_decompress_handler_finished(task, dec);
+}
+
 static void task_decompress_handler(retro_task_t *task)
 {
    int ret;
@@ -232,7 +521,8 @@ static bool task_decompress_finder(
 {
    decompress_state_t *dec = (decompress_state_t*)task->state;
 
-   if (task->handler != task_decompress_handler)
+   if (     task->handler != task_decompress_handler
+         && task->handler != task_decompress_handler_zip)
       return false;
 
    return string_is_equal(dec->source_file, (const char*)user_data);
@@ -260,6 +550,7 @@ bool task_push_decompress(
       void *user_data)
 {
    char tmp[PATH_MAX_LENGTH];
+   decompress_task_state_t *state = NULL;
    decompress_state_t *s      = NULL;
    retro_task_t *t            = NULL;
 
@@ -294,11 +585,13 @@ bool task_push_decompress(
 
    RARCH_LOG("[decompress] File '%s.\n", source_file);
 
-   s              = (decompress_state_t*)calloc(1, sizeof(*s));
+   state          = (decompress_task_state_t*)calloc(1, sizeof(*state));
 
-   if (!s)
+   if (!state)
       goto error;
 
+   s              = &state->dec;
+
    s->source_file = strdup(source_file);
    s->target_dir  = strdup(target_dir);
 
@@ -313,10 +606,13 @@ bool task_push_decompress(
    t->state       = s;
    t->handler     = task_decompress_handler;
 
+   state->file_cb = file_decompressed;
+
    if (!string_is_empty(subdir))
    {
       s->subdir        = strdup(subdir);
       t->handler       = task_decompress_handler_subdir;
+      state->file_cb   = file_decompressed_subdir;
    }
    else if (!string_is_empty(target_file))
    {
@@ -324,6 +620,19 @@ bool task_push_decompress(
       t->handler       = task_decompress_handler_target_file;
    }
 
+   /* ZIP entries are extracted in parallel, 7z decodes them
+    * in sequence anyway. */
+   if (     t->handler != task_decompress_handler_target_file
+         && file_archive_get_file_backend(source_file)
+         == file_archive_get_zlib_file_backend())
+   {
+#ifdef HAVE_THREADS
+      state->lock      = slock_new();
+      state->cond      = scond_new();
+#endif
+      t->handler       = task_decompress_handler_zip;
+   }
+
    t->callback    = cb;
    t->user_data   = user_data;
 
@@ -338,6 +647,11 @@ bool task_push_decompress(
 
 error:
    if (s)
-      free(s);
+   {
+      free(s->source_file);
+      free(s->target_dir);
+      free(s->valid_ext);
+   }
+   free(state);
    return false;
 }
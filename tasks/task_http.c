@@ -21,6 +21,7 @@
 #include <file/file_path.h>
 #include <file/archive_file.h>
 #include <net/net_compat.h>
+#include <streams/file_stream.h>
 #include <retro_stat.h>
 
 #include "../msg_hash.h"
@@ -54,6 +55,10 @@ typedef struct http_handle
    } connection;
    struct http_t *handle;
    transfer_cb_t  cb;
+   /* the body goes into this file rather than memory */
+   RFILE *file;
+   char path[PATH_MAX_LENGTH];
+   char part_path[PATH_MAX_LENGTH];
    unsigned status;
    bool error;
 } http_handle_t;
@@ -81,6 +86,14 @@ static int task_http_conn_iterate_transfer_parse(
    return 0;
 }
 
+static bool task_http_write_file(void *userdata,
+      const uint8_t *data, size_t len)
+{
+   http_handle_t *http = (http_handle_t*)userdata;
+
+   return filestream_write(http->file, data, len) == (ssize_t)len;
+}
+
 static int cb_http_conn_default(void *data_, size_t len)
 {
    http_handle_t *http = (http_handle_t*)data_;
@@ -100,11 +113,34 @@ static int cb_http_conn_default(void *data_, size_t len)
       return -1;
    }
 
+   if (http->file)
+      net_http_set_sink(http->handle, task_http_write_file, http);
+
    http->cb     = NULL;
 
    return 0;
 }
 
+/* Moves a completed download in place, drops anything else. */
+static bool task_http_finish_file(http_handle_t *http, bool success)
+{
+   bool written = filestream_close(http->file) == 0;
+
+   http->file   = NULL;
+
+   if (success && written)
+   {
+      /* rename() doesn't replace files everywhere. */
+      remove(http->path);
+
+      if (!rename(http->part_path, http->path))
+         return true;
+   }
+
+   remove(http->part_path);
+   return false;
+}
+
 /**
  * task_http_iterate_transfer:
  *
@@ -175,7 +211,15 @@ task_finished:
       if (tmp && http->cb)
          http->cb(tmp, len);
 
-      if (net_http_error(http->handle) || task_get_cancelled(task))
+      if (http->file && !task_http_finish_file(http,
+               !net_http_error(http->handle) && !task_get_cancelled(task)))
+      {
+         if (task_get_cancelled(task))
+            task_set_error(task, strdup("Task cancelled."));
+         else
+            task_set_error(task, strdup("Download failed."));
+      }
+      else if (net_http_error(http->handle) || task_get_cancelled(task))
       {
          tmp = (char*)net_http_data(http->handle, &len, true);
 
@@ -193,6 +237,9 @@ task_finished:
          data->data = tmp;
          data->len  = len;
 
+         if (!string_is_empty(http->path))
+            data->path = strdup(http->path);
+
          task_set_data(task, data);
       }
 
@@ -200,6 +247,9 @@ task_finished:
    } else if (http->error)
       task_set_error(task, strdup("Internal error."));
 
+   if (http->file)
+      task_http_finish_file(http, false);
+
    free(http);
 }
 
@@ -235,7 +285,8 @@ static bool task_http_retriever(retro_task_t *task, void *data)
    return true;
 }
 
-static void* task_push_http_transfer_generic(struct http_connection_t *conn, const char *url, bool mute, const char *type,
+static void* task_push_http_transfer_generic(struct http_connection_t *conn,
+      const char *url, const char *path, bool mute, const char *type,
       retro_task_callback_t cb, void *user_data)
 {
    task_finder_data_t find_data;
@@ -274,6 +325,21 @@ static void* task_push_http_transfer_generic(struct http_connection_t *conn, con
 
    strlcpy(http->connection.url, url, sizeof(http->connection.url));
 
+   if (path)
+   {
+      strlcpy(http->path, path, sizeof(http->path));
+      snprintf(http->part_path, sizeof(http->part_path), "%s.part", path);
+
+      http->file = filestream_open(http->part_path, RFILE_MODE_WRITE, -1);
+
+      if (!http->file)
+      {
+         RARCH_ERR("[http] Could not open '%s' for writing.\n",
+               http->part_path);
+         goto error;
+      }
+   }
+
    http->status            = HTTP_STATUS_CONNECTION_TRANSFER;
    t                       = (retro_task_t*)calloc(1, sizeof(*t));
 
@@ -300,7 +366,11 @@ error:
    if (conn)
       net_http_connection_free(conn);
    if (http)
+   {
+      if (http->file)
+         task_http_finish_file(http, false);
       free(http);
+   }
 
    return NULL;
 }
@@ -312,7 +382,21 @@ void* task_push_http_transfer(const char *url, bool mute, const char *type,
 
    conn = net_http_connection_new(url, "GET", NULL);
 
-   return task_push_http_transfer_generic(conn, url, mute, type, cb, user_data);
+   return task_push_http_transfer_generic(conn, url, NULL, mute, type, cb, user_data);
+}
+
+void* task_push_http_transfer_file(const char *url, const char *path,
+      bool mute, const char *type,
+      retro_task_callback_t cb, void *user_data)
+{
+   struct http_connection_t *conn;
+
+   if (string_is_empty(path))
+      return NULL;
+
+   conn = net_http_connection_new(url, "GET", NULL);
+
+   return task_push_http_transfer_generic(conn, url, path, mute, type, cb, user_data);
 }
 
 void* task_push_http_post_transfer(const char *url, const char *post_data, bool mute,
@@ -322,7 +406,7 @@ void* task_push_http_post_transfer(const char *url, const char *post_data, bool
 
    conn = net_http_connection_new(url, "POST", post_data);
 
-   return task_push_http_transfer_generic(conn, url, mute, type, cb, user_data);
+   return task_push_http_transfer_generic(conn, url, NULL, mute, type, cb, user_data);
 }
 
 task_retriever_info_t *http_task_get_transfer_list(void)
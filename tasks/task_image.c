@@ -374,6 +374,10 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
    t->cleanup   = task_image_load_free;
    t->callback  = cb;
    t->user_data = user_data;
+   /* Thumbnails are short and on screen, and each load
+    * only touches its own nbio handle. */
+   t->priority  = TASK_PRIORITY_HIGH;
+   t->reentrant = true;
 
    task_queue_ctl(TASK_QUEUE_CTL_PUSH, t);
 
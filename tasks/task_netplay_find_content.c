@@ -130,32 +130,26 @@ static void task_netplay_crc_scan_handler(retro_task_t *task)
             if (!strstr(lpl_path, file_path_str(FILE_PATH_LPL_EXTENSION)))
                continue;
 
-            playlist = playlist_init(lpl_path, 99999);
+            /* Only read, never written back. */
+            playlist = playlist_init(lpl_path, 99999, false);
 
-            for (j = 0; j < playlist->size; j++)
+            if (playlist_get_index_by_crc32(playlist, state->content_crc, &j))
             {
-#if 1
-               RARCH_LOG("[lobby] playlist CRC: %s\n", 
-                  playlist->entries[j].crc32);
-#endif
-               if (string_is_equal(playlist->entries[j].crc32, state->content_crc))
-               {
-                  RARCH_LOG("[lobby] CRC match %s\n", playlist->entries[j].crc32);
-                  strlcpy(state->content_path, playlist->entries[j].path, sizeof(state->content_path));
-                  state->found = true;
-                  task_set_data(task, state);
-                  task_set_progress(task, 100);
-                  task_set_title(task, strdup(msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NETPLAY_COMPAT_CONTENT_FOUND)));
-                  task_set_finished(task, true);
-                  string_list_free(state->lpl_list);
-                  free(playlist);
-                  return;
-               }
-
-               task_set_progress(task, (int)(j/playlist->size*100.0));
+               RARCH_LOG("[lobby] CRC match %s\n", playlist->entries[j].crc32);
+               strlcpy(state->content_path, playlist->entries[j].path, sizeof(state->content_path));
+               state->found = true;
+               task_set_data(task, state);
+               task_set_progress(task, 100);
+               task_set_title(task, strdup(msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NETPLAY_COMPAT_CONTENT_FOUND)));
+               task_set_finished(task, true);
+               string_list_free(state->lpl_list);
+               playlist_free(playlist);
+               return;
             }
 
-            free(playlist);
+            task_set_progress(task, (int)((i + 1) * 100.0 / state->lpl_list->size));
+
+            playlist_free(playlist);
          }
          /* CRC matching failed, goto filename matching */
          if (!state->found)
@@ -177,7 +171,8 @@ filename_matching:
             if (!strstr(lpl_path, file_path_str(FILE_PATH_LPL_EXTENSION)))
                continue;
 
-            playlist = playlist_init(lpl_path, 99999);
+            /* Only read, never written back. */
+            playlist = playlist_init(lpl_path, 99999, false);
 
             for (j = 0; j < playlist->size; j++)
             {
@@ -208,13 +203,13 @@ filename_matching:
                   task_set_title(task, strdup(msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NETPLAY_COMPAT_CONTENT_FOUND)));
                   task_set_finished(task, true);
                   string_list_free(state->lpl_list);
-                  free(playlist);
+                  playlist_free(playlist);
                   return;
                }
 
                task_set_progress(task, (int)(j/playlist->size*100.0));
             }
-            free(playlist);
+            playlist_free(playlist);
          }
 
          /* filename matching failed */
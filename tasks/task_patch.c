@@ -66,29 +66,26 @@ struct bps_data
    uint8_t *target_data;
    size_t modify_length, source_length, target_length;
    size_t modify_offset, source_offset, target_offset;
-   uint32_t modify_checksum, source_checksum, target_checksum;
 
-   size_t source_relative_offset, target_relative_offset, output_offset;
-};
-
-struct ups_data
-{
-   const uint8_t *patch_data, *source_data; 
-   uint8_t *target_data;
-   unsigned patch_length, source_length, target_length;
-   unsigned patch_offset, source_offset, target_offset;
-   unsigned patch_checksum, source_checksum, target_checksum;
+   size_t output_offset;
 };
 
 typedef enum patch_error (*patch_func_t)(const uint8_t*, size_t,
-      const uint8_t*, size_t, uint8_t*, size_t*);
+      content_buffer_t*);
+
+static uint32_t patch_read_le32(const uint8_t *data)
+{
+   return  (uint32_t)data[0]
+         | (uint32_t)data[1] << 8
+         | (uint32_t)data[2] << 16
+         | (uint32_t)data[3] << 24;
+}
 
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = ~(encoding_crc32(
-         ~bps->modify_checksum, &data, 1));
-   return data;
+   if (bps->modify_offset >= bps->modify_length)
+      return 0;
+   return bps->modify_data[bps->modify_offset++];
 }
 
 static uint64_t bps_decode(struct bps_data *bps)
@@ -101,6 +98,8 @@ static uint64_t bps_decode(struct bps_data *bps)
       data      += (x & 0x7f) * shift;
       if (x & 0x80)
          break;
+      if (bps->modify_offset >= bps->modify_length)
+         break;
       shift    <<= 7;
       data      += shift;
    }
@@ -108,306 +107,284 @@ static uint64_t bps_decode(struct bps_data *bps)
    return data;
 }
 
-static void bps_write(struct bps_data *bps, uint8_t data)
-{
-   if (!bps)
-      return;
-
-   bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = ~(encoding_crc32(~bps->target_checksum, &data, 1));
-}
-
+/* Streams the target out of the source and the patch. Only the
+ * target is allocated, at its final size, and checksums are taken
+ * once over whole buffers instead of per byte. */
 static enum patch_error bps_apply_patch(
       const uint8_t *modify_data, size_t modify_length,
-      const uint8_t *source_data, size_t source_length,
-      uint8_t *target_data, size_t *target_length)
+      content_buffer_t *content)
 {
    size_t i;
-   uint32_t checksum;
-   size_t modify_source_size;
-   size_t modify_target_size;
-   size_t modify_markup_size;
+   uint64_t modify_source_size;
+   uint64_t modify_target_size;
+   uint64_t modify_markup_size;
    struct bps_data bps = {0};
-   uint32_t modify_source_checksum = 0;
-   uint32_t modify_target_checksum = 0;
-   uint32_t modify_modify_checksum = 0;
 
    if (modify_length < 19)
       return PATCH_PATCH_TOO_SMALL;
 
    bps.modify_data     = modify_data;
-   bps.modify_length   = modify_length;
-   bps.target_data     = target_data;
-   bps.target_length   = *target_length;
-   bps.source_data     = source_data;
-   bps.source_length   = source_length;
-   bps.modify_checksum = ~0;
-   bps.target_checksum = ~0;
+   bps.modify_length   = modify_length - 12;
+   bps.source_data     = content->data;
+   bps.source_length   = content->size;
 
    if ((bps_read(&bps) != 'B') || (bps_read(&bps) != 'P') ||
          (bps_read(&bps) != 'S') || (bps_read(&bps) != '1'))
       return PATCH_PATCH_INVALID_HEADER;
 
+   if (encoding_crc32(0, modify_data, modify_length - 4)
+         != patch_read_le32(modify_data + modify_length - 4))
+      return PATCH_PATCH_CHECKSUM_INVALID;
+
    modify_source_size  = bps_decode(&bps);
    modify_target_size  = bps_decode(&bps);
    modify_markup_size  = bps_decode(&bps);
-   for (i = 0; i < modify_markup_size; i++)
-      bps_read(&bps);
+
+   if (modify_markup_size > bps.modify_length - bps.modify_offset)
+      return PATCH_PATCH_INVALID;
+   bps.modify_offset  += (size_t)modify_markup_size;
 
    if (modify_source_size > bps.source_length)
       return PATCH_SOURCE_TOO_SMALL;
-   if (modify_target_size > bps.target_length)
+   if (modify_target_size > (size_t)-2)
+      return PATCH_TARGET_TOO_SMALL;
+
+   if (encoding_crc32(0, bps.source_data, bps.source_length)
+         != patch_read_le32(modify_data + modify_length - 12))
+      return PATCH_SOURCE_CHECKSUM_INVALID;
+
+   bps.target_length = (size_t)modify_target_size;
+   bps.target_data   = (uint8_t*)malloc(bps.target_length + 1);
+
+   if (!bps.target_data)
       return PATCH_TARGET_TOO_SMALL;
 
-   while (bps.modify_offset < bps.modify_length - 12)
+   bps.target_data[bps.target_length] = '\0';
+
+   while (bps.modify_offset < bps.modify_length)
    {
-      size_t length = bps_decode(&bps);
-      unsigned mode = length & 3;
+      uint64_t length = bps_decode(&bps);
+      unsigned mode   = length & 3;
 
       length = (length >> 2) + 1;
 
+      if (length > bps.target_length - bps.output_offset)
+         goto error;
+
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-               bps_write(&bps, bps.source_data[bps.output_offset]);
+            if (     bps.output_offset > bps.source_length
+                  || length > bps.source_length - bps.output_offset)
+               goto error;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.source_data + bps.output_offset, (size_t)length);
+            bps.output_offset += (size_t)length;
             break;
 
          case TARGET_READ:
-            while (length--)
-               bps_write(&bps, bps_read(&bps));
+            if (length > bps.modify_length - bps.modify_offset)
+               goto error;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.modify_data + bps.modify_offset, (size_t)length);
+            bps.output_offset += (size_t)length;
+            bps.modify_offset += (size_t)length;
             break;
 
          case SOURCE_COPY:
          case TARGET_COPY:
          {
-            int    offset = (int)bps_decode(&bps);
-            bool negative = offset & 1;
-
-            offset >>= 1;
+            uint64_t data  = bps_decode(&bps);
+            size_t offset  = (size_t)(data >> 1);
+            bool negative  = data & 1;
+            size_t *cursor = mode == SOURCE_COPY
+               ? &bps.source_offset : &bps.target_offset;
 
             if (negative)
-               offset = -offset;
+            {
+               if (offset > *cursor)
+                  goto error;
+               *cursor -= offset;
+            }
+            else
+               *cursor += offset;
 
             if (mode == SOURCE_COPY)
             {
-               bps.source_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.source_data[bps.source_offset++]);
+               if (     bps.source_offset > bps.source_length
+                     || length > bps.source_length - bps.source_offset)
+                  goto error;
+               memcpy(bps.target_data + bps.output_offset,
+                     bps.source_data + bps.source_offset, (size_t)length);
+               bps.source_offset += (size_t)length;
+               bps.output_offset += (size_t)length;
             }
             else
             {
-               bps.target_offset += offset;
+               /* May overlap the bytes being written, so bytewise. */
+               if (bps.target_offset >= bps.output_offset)
+                  goto error;
                while (length--)
-                  bps_write(&bps, bps.target_data[bps.target_offset++]);
-               break;
+                  bps.target_data[bps.output_offset++] =
+                     bps.target_data[bps.target_offset++];
             }
             break;
          }
       }
    }
 
-   for (i = 0; i < 32; i += 8)
-      modify_source_checksum |= bps_read(&bps) << i;
-   for (i = 0; i < 32; i += 8)
-      modify_target_checksum |= bps_read(&bps) << i;
-
-   checksum = ~bps.modify_checksum;
-   for (i = 0; i < 32; i += 8)
-      modify_modify_checksum |= bps_read(&bps) << i;
-
-   bps.source_checksum = encoding_crc32(0,
-         bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
-
-   if (bps.source_checksum != modify_source_checksum)
-      return PATCH_SOURCE_CHECKSUM_INVALID;
-
-   if (bps.target_checksum != modify_target_checksum)
+   if (bps.output_offset != bps.target_length
+         || encoding_crc32(0, bps.target_data, bps.target_length)
+         != patch_read_le32(modify_data + modify_length - 8))
+   {
+      free(bps.target_data);
       return PATCH_TARGET_CHECKSUM_INVALID;
+   }
 
-   if (checksum != modify_modify_checksum)
-      return PATCH_PATCH_CHECKSUM_INVALID;
-
-   *target_length = modify_target_size;
+   content_buffer_set(content, bps.target_data, bps.target_length);
 
    return PATCH_SUCCESS;
-}
 
-static uint8_t ups_patch_read(struct ups_data *data) 
-{
-   if (data && data->patch_offset < data->patch_length) 
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum = 
-         ~(encoding_crc32(~data->patch_checksum, &n, 1));
-      return n;
-   }
-   return 0x00;
+error:
+   free(bps.target_data);
+   return PATCH_PATCH_INVALID;
 }
 
-static uint8_t ups_source_read(struct ups_data *data) 
+static uint64_t ups_decode(const uint8_t *data, size_t length, size_t *offset)
 {
-   if (data && data->source_offset < data->source_length) 
+   uint64_t value = 0, shift = 1;
+
+   while (*offset < length)
    {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum =  
-         ~(encoding_crc32(~data->source_checksum, &n, 1));
-      return n;
+      uint8_t x = data[(*offset)++];
+      value    += (x & 0x7f) * shift;
+
+      if (x & 0x80)
+         break;
+      shift <<= 7;
+      value += shift;
    }
-   return 0x00;
+
+   return value;
 }
 
-static void ups_target_write(struct ups_data *data, uint8_t n) 
+/* XORs the patch hunks into @target. Being its own inverse, running
+ * it again undoes it. */
+static void ups_apply_hunks(const uint8_t *patch, size_t patch_length,
+      size_t offset, uint8_t *target, size_t target_length)
 {
+   size_t pos = 0;
 
-   if (data && data->target_offset < data->target_length) 
+   while (offset < patch_length)
    {
-      data->target_data[data->target_offset] = n;
-      data->target_checksum = 
-         ~(encoding_crc32(~data->target_checksum, &n, 1));
-   }
+      uint64_t skip = ups_decode(patch, patch_length, &offset);
 
-   if (data)
-      data->target_offset++;
-}
+      pos = skip > (uint64_t)((size_t)-1 - pos) ? (size_t)-1 : pos + (size_t)skip;
 
-static uint64_t ups_decode(struct ups_data *data) 
-{
-   uint64_t offset = 0, shift = 1;
-   while (true) 
-   {
-      uint8_t x = ups_patch_read(data);
-      offset   += (x & 0x7f) * shift;
+      while (offset < patch_length)
+      {
+         uint8_t patch_xor = patch[offset++];
 
-      if (x & 0x80) 
-         break;
-      shift <<= 7;
-      offset += shift;
+         if (pos < target_length)
+            target[pos] ^= patch_xor;
+         if (pos != (size_t)-1)
+            pos++;
+         if (patch_xor == 0)
+            break;
+      }
    }
-   return offset;
 }
 
+/* UPS only XORs bytes at the same offset of source and target, so
+ * it is applied in place. Checksums are verified upfront; a target
+ * mismatch afterwards is rolled back by applying the hunks again. */
 static enum patch_error ups_apply_patch(
       const uint8_t *patchdata, size_t patchlength,
-      const uint8_t *sourcedata, size_t sourcelength,
-      uint8_t *targetdata, size_t *targetlength)
+      content_buffer_t *content)
 {
-   size_t i;
-   unsigned source_read_length;
-   unsigned target_read_length;
-   uint32_t patch_result_checksum;
-   uint32_t patch_read_checksum  = 0;
+   uint64_t source_read_length;
+   uint64_t target_read_length;
+   uint32_t source_checksum;
+   uint32_t expected_checksum;
+   size_t target_length;
+   size_t hunks_length;
+   size_t offset                 = 4;
+   size_t source_length          = content->size;
    uint32_t source_read_checksum = 0;
    uint32_t target_read_checksum = 0;
-   struct ups_data data          = {0};
-
-   data.patch_data      = patchdata;
-   data.source_data     = sourcedata;
-   data.target_data     = targetdata;
-   data.patch_length    = (unsigned)patchlength;
-   data.source_length   = (unsigned)sourcelength;
-   data.target_length   = (unsigned)*targetlength;
-   data.patch_checksum  = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
-
-   if (data.patch_length < 18) 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'U') 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'P') 
+
+   if (patchlength < 18) 
       return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'S') 
+   if (memcmp(patchdata, "UPS1", 4) != 0)
       return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != '1') 
+
+   if (encoding_crc32(0, patchdata, patchlength - 4)
+         != patch_read_le32(patchdata + patchlength - 4))
       return PATCH_PATCH_INVALID;
 
-   source_read_length = (unsigned)ups_decode(&data);
-   target_read_length = (unsigned)ups_decode(&data);
+   hunks_length         = patchlength - 12;
+   source_read_length   = ups_decode(patchdata, hunks_length, &offset);
+   target_read_length   = ups_decode(patchdata, hunks_length, &offset);
+   source_read_checksum = patch_read_le32(patchdata + patchlength - 12);
+   target_read_checksum = patch_read_le32(patchdata + patchlength - 8);
 
-   if (data.source_length != source_read_length
-         && data.source_length != target_read_length) 
+   if (source_length != source_read_length
+         && source_length != target_read_length) 
       return PATCH_SOURCE_INVALID;
-   *targetlength = (data.source_length == source_read_length ?
-         target_read_length : source_read_length);
-   if (data.target_length < *targetlength) 
-      return PATCH_TARGET_TOO_SMALL;
-   data.target_length = (unsigned)*targetlength;
 
-   while (data.patch_offset < data.patch_length - 12) 
+   source_checksum = encoding_crc32(0, content->data, source_length);
+
+   if (     source_length   == source_read_length
+         && source_checksum == source_read_checksum)
    {
-      unsigned length = (unsigned)ups_decode(&data);
-      while (length--) 
-         ups_target_write(&data, ups_source_read(&data));
-      while (true) 
-      {
-         uint8_t patch_xor = ups_patch_read(&data);
-         ups_target_write(&data, patch_xor ^ ups_source_read(&data));
-         if (patch_xor == 0)
-            break;
-      }
+      if (target_read_length > (size_t)-2)
+         return PATCH_TARGET_TOO_SMALL;
+      target_length     = (size_t)target_read_length;
+      expected_checksum = target_read_checksum;
    }
+   else if (source_length   == target_read_length
+         && source_checksum == target_read_checksum)
+   {
+      if (source_read_length > (size_t)-2)
+         return PATCH_TARGET_TOO_SMALL;
+      target_length     = (size_t)source_read_length;
+      expected_checksum = source_read_checksum;
+   }
+   else
+      return PATCH_SOURCE_INVALID;
 
-   while (data.source_offset < data.source_length) 
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length) 
-      ups_target_write(&data, ups_source_read(&data));
-
-
-   for (i = 0; i < 4; i++) 
-      source_read_checksum |= ups_patch_read(&data) << (i * 8);
-   for (i = 0; i < 4; i++) 
-      target_read_checksum |= ups_patch_read(&data) << (i * 8);
-
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
-
-   for (i = 0; i < 4; i++) 
-      patch_read_checksum |= ups_patch_read(&data) << (i * 8);
+   /* Bytes past the source read as zero. */
+   if (target_length > source_length
+         && !content_buffer_resize(content, target_length))
+      return PATCH_TARGET_TOO_SMALL;
 
-   if (patch_result_checksum != patch_read_checksum) 
-      return PATCH_PATCH_INVALID;
+   ups_apply_hunks(patchdata, hunks_length, offset,
+         content->data, target_length);
 
-   if (data.source_checksum == source_read_checksum
-         && data.source_length == source_read_length) 
-   {
-      if (data.target_checksum == target_read_checksum
-            && data.target_length == target_read_length) 
-         return PATCH_SUCCESS;
-      return PATCH_TARGET_INVALID;
-   } 
-   else if (data.source_checksum == target_read_checksum
-         && data.source_length == target_read_length) 
+   if (encoding_crc32(0, content->data, target_length) != expected_checksum)
    {
-      if (data.target_checksum == source_read_checksum
-            && data.target_length == source_read_length) 
-         return PATCH_SUCCESS;
+      ups_apply_hunks(patchdata, hunks_length, offset,
+            content->data, target_length);
+      content_buffer_resize(content, source_length);
       return PATCH_TARGET_INVALID;
-   } 
+   }
+
+   content_buffer_resize(content, target_length);
 
-   return PATCH_SOURCE_INVALID;
+   return PATCH_SUCCESS;
 }
 
-static enum patch_error ips_apply_patch(
+/* Walks the IPS records. Without @target it only validates them and
+ * reports how large the target must be and its final length. */
+static enum patch_error ips_walk_patch(
       const uint8_t *patchdata, size_t patchlen,
-      const uint8_t *sourcedata, size_t sourcelength,
-      uint8_t *targetdata, size_t *targetlength)
+      uint8_t *target, size_t source_length,
+      size_t *extent, size_t *target_length)
 {
    uint32_t offset = 5;
 
-   if (patchlen < 8 ||
-         patchdata[0] != 'P' ||
-         patchdata[1] != 'A' ||
-         patchdata[2] != 'T' ||
-         patchdata[3] != 'C' ||
-         patchdata[4] != 'H')
-      return PATCH_PATCH_INVALID;
-
-   memcpy(targetdata, sourcedata, sourcelength);
-
-   *targetlength = sourcelength;
+   *extent        = source_length;
+   *target_length = source_length;
 
    for (;;)
    {
@@ -430,7 +407,9 @@ static enum patch_error ips_apply_patch(
             uint32_t size = patchdata[offset++] << 16;
             size |= patchdata[offset++] << 8;
             size |= patchdata[offset++] << 0;
-            *targetlength = size;
+            *target_length = size;
+            if (size > *extent)
+               *extent = size;
             return PATCH_SUCCESS;
          }
       }
@@ -446,8 +425,11 @@ static enum patch_error ips_apply_patch(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset++];
+         if (target)
+            memcpy(target + address, patchdata + offset, length);
+
+         offset  += length;
+         address += length;
       }
       else /* RLE */
       {
@@ -460,31 +442,65 @@ static enum patch_error ips_apply_patch(
          if (length == 0) /* Illegal */
             break;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset];
+         if (target)
+            memset(target + address, patchdata[offset], length);
 
          offset++;
+         address += length;
       }
 
-      if (address > *targetlength)
-         *targetlength = address;
+      if (address > *target_length)
+         *target_length = address;
+      if (address > *extent)
+         *extent = address;
    }
 
    return PATCH_PATCH_INVALID;
 }
 
-static bool apply_patch_content(uint8_t **buf,
-      ssize_t *size, const char *patch_desc, const char *patch_path,
-      patch_func_t func)
+/* IPS overwrites records in place. The records are validated first
+ * so a broken patch leaves the content untouched, and mapped content
+ * only copies the pages the records touch. */
+static enum patch_error ips_apply_patch(
+      const uint8_t *patchdata, size_t patchlen,
+      content_buffer_t *content)
+{
+   size_t extent        = 0;
+   size_t target_length = 0;
+   enum patch_error err = PATCH_PATCH_INVALID;
+
+   if (patchlen < 8 ||
+         patchdata[0] != 'P' ||
+         patchdata[1] != 'A' ||
+         patchdata[2] != 'T' ||
+         patchdata[3] != 'C' ||
+         patchdata[4] != 'H')
+      return PATCH_PATCH_INVALID;
+
+   err = ips_walk_patch(patchdata, patchlen, NULL, content->size,
+         &extent, &target_length);
+
+   if (err != PATCH_SUCCESS)
+      return err;
+
+   if (extent > content->size && !content_buffer_resize(content, extent))
+      return PATCH_TARGET_TOO_SMALL;
+
+   ips_walk_patch(patchdata, patchlen, content->data, content->size,
+         &extent, &extent);
+
+   content_buffer_resize(content, target_length);
+
+   return PATCH_SUCCESS;
+}
+
+static bool apply_patch_content(content_buffer_t *content,
+      const char *patch_desc, const char *patch_path,
+      patch_func_t func, bool *patched)
 {
-   size_t target_size;
    ssize_t patch_size;
    void *patch_data         = NULL;
    enum patch_error err     = PATCH_UNKNOWN;
-   bool success             = false;
-   uint8_t *patched_content = NULL;
-   ssize_t ret_size         = *size;
-   uint8_t *ret_buf         = *buf;
    
    if (!path_is_valid(patch_path))
       return false;
@@ -498,36 +514,16 @@ static bool apply_patch_content(uint8_t **buf,
       return false;
    }
 
-   if (!path_file_exists(patch_path))
-   {
-      free(patch_data);
-      return false;
-   }
-
    RARCH_LOG("Found %s file in \"%s\", attempting to patch ...\n",
          patch_desc, patch_path);
 
-   target_size = ret_size * 4; /* Just to be sure. */
-
-   patched_content = (uint8_t*)malloc(target_size);
-
-   if (!patched_content)
-   {
-      RARCH_ERR("%s\n",
-            msg_hash_to_str(MSG_FAILED_TO_ALLOCATE_MEMORY_FOR_PATCHED_CONTENT));
-      goto error;
-   }
-
-   err = func((const uint8_t*)patch_data, patch_size, ret_buf,
-         ret_size, patched_content, &target_size);
+   err      = func((const uint8_t*)patch_data, patch_size, content);
+   *patched = (err == PATCH_SUCCESS);
 
    if (err == PATCH_SUCCESS)
-   {
       RARCH_LOG("%s (%s).\n",
             msg_hash_to_str(MSG_FATAL_ERROR_RECEIVED_IN),
             patch_desc);
-      success = true;
-   }
    else
       RARCH_ERR("%s %s: %s #%u\n",
             msg_hash_to_str(MSG_FAILED_TO_PATCH),
@@ -535,72 +531,60 @@ static bool apply_patch_content(uint8_t **buf,
             msg_hash_to_str(MSG_ERROR),
             (unsigned)err);
 
-   if (success)
-   {
-      free(ret_buf);
-      *buf = patched_content;
-      *size = target_size;
-   }
-
    free(patch_data);
    return true;
-
-error:
-   *buf = ret_buf;
-   *size = ret_size;
-   free(patch_data);
-
-   return false;
 }
 
 static bool try_bps_patch(bool allow_bps, const char *name_bps,
-      uint8_t **buf, ssize_t *size)
+      content_buffer_t *content, bool *patched)
 {
    if (allow_bps && !string_is_empty(name_bps))
-      return apply_patch_content(buf, size, "BPS", name_bps,
-            bps_apply_patch);
+      return apply_patch_content(content, "BPS", name_bps,
+            bps_apply_patch, patched);
    return false;
 }
 
 static bool try_ups_patch(bool allow_ups, const char *name_ups,
-      uint8_t **buf, ssize_t *size)
+      content_buffer_t *content, bool *patched)
 {
    if (allow_ups && !string_is_empty(name_ups))
-      return apply_patch_content(buf, size, "UPS", name_ups,
-            ups_apply_patch);
+      return apply_patch_content(content, "UPS", name_ups,
+            ups_apply_patch, patched);
    return false;
 }
 
 static bool try_ips_patch(bool allow_ips,
-      const char *name_ips, uint8_t **buf, ssize_t *size)
+      const char *name_ips, content_buffer_t *content, bool *patched)
 {
    if (allow_ips && !string_is_empty(name_ips))
-      return apply_patch_content(buf, size, "IPS", name_ips, ips_apply_patch);
+      return apply_patch_content(content, "IPS", name_ips,
+            ips_apply_patch, patched);
    return false;
 }
 
 /**
  * patch_content:
- * @buf          : buffer of the content file.
- * @size         : size   of the content file.
+ * @content      : the content file.
  *
  * Apply patch to the content file in-memory.
  *
+ * Returns: true if a patch was applied to @content, false if
+ * none was found or applying it failed. A failed patch leaves
+ * @content untouched.
  **/
-static void patch_content(
+static bool patch_content(
       const char *name_ips,
       const char *name_bps,
       const char *name_ups,
-      uint8_t **buf,
-      void *data)
+      content_buffer_t *content)
 {
-   ssize_t *size    = (ssize_t*)data;
    bool is_ips_pref = rarch_ctl(RARCH_CTL_IS_IPS_PREF, NULL);
    bool is_bps_pref = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    bool is_ups_pref = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
    bool allow_ups   = !is_bps_pref && !is_ips_pref;
    bool allow_ips   = !is_ups_pref && !is_bps_pref;
    bool allow_bps   = !is_ups_pref && !is_ips_pref;
+   bool patched     = false;
 
    if (    (unsigned)is_ips_pref 
          + (unsigned)is_bps_pref 
@@ -608,14 +592,17 @@ static void patch_content(
    {
       RARCH_WARN("%s\n",
             msg_hash_to_str(MSG_SEVERAL_PATCHES_ARE_EXPLICITLY_DEFINED));
-      return;
+      return false;
    }
 
-   if (     !try_ips_patch(allow_ips, name_ips, buf, size) 
-         && !try_bps_patch(allow_bps, name_bps, buf, size) 
-         && !try_ups_patch(allow_ups, name_ups, buf, size))
+   if (     !try_ips_patch(allow_ips, name_ips, content, &patched) 
+         && !try_bps_patch(allow_bps, name_bps, content, &patched) 
+         && !try_ups_patch(allow_ups, name_ups, content, &patched))
    {
       RARCH_LOG("%s\n",
             msg_hash_to_str(MSG_DID_NOT_FIND_A_VALID_CONTENT_PATCH));
+      return false;
    }
+
+   return patched;
 }
@@ -81,11 +81,19 @@ typedef struct
 {
     char *data;
     size_t len;
+    /* set instead of data by task_push_http_transfer_file */
+    char *path;
 } http_transfer_data_t;
 
 void *task_push_http_transfer(const char *url, bool mute, const char *type,
       retro_task_callback_t cb, void *userdata);
 
+/* Streams the body to @path as it arrives instead of keeping it
+ * in memory. Only a complete download ends up at @path. */
+void *task_push_http_transfer_file(const char *url, const char *path,
+      bool mute, const char *type,
+      retro_task_callback_t cb, void *userdata);
+
 void *task_push_http_post_transfer(const char *url, const char *post_data, bool mute, const char *type,
       retro_task_callback_t cb, void *userdata);
 
@@ -108,6 +116,7 @@ bool task_push_image_load(const char *fullpath,
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
+      bool playlist_binary_format,
       const char *content_database,
       const char *fullpath,
       bool directory, retro_task_callback_t cb);